@@ -0,0 +1,35 @@
+#include "arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+thread_local Arena* Arena::active = nullptr;
+
+Arena::~Arena() {
+  for (auto it = destructors.rbegin(); it != destructors.rend(); ++it) {
+    it->destroy(it->object);
+  }
+}
+
+void* Arena::allocate(size_t size, size_t alignment) {
+  auto align = [alignment](char* pointer) {
+    const auto address = reinterpret_cast<uintptr_t>(pointer);
+    return reinterpret_cast<char*>((address + alignment - 1) &
+                                   ~(alignment - 1));
+  };
+  if (top == nullptr || align(top) + size > end) {
+    // anything larger than a chunk gets a chunk of its own.
+    const auto chunkSize = std::max(CHUNK_SIZE, size + alignment);
+    chunks.emplace_back(new char[chunkSize]);
+    top = chunks.back().get();
+    end = top + chunkSize;
+  }
+  auto pointer = align(top);
+  top = pointer + size;
+  return pointer;
+}
+
+Arena& Arena::current() {
+  assert(active != nullptr && "no Arena::Scope is open");
+  return *active;
+}
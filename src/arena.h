@@ -0,0 +1,65 @@
+#pragma once
+
+#include "common.h"
+
+// Bump allocator for the nodes of one program, so they are packed together
+// instead of each taking a separate heap block. Nodes are carved out of
+// large chunks and never freed one by one: the Program owning the arena
+// destroys them all at once when it dies. Nodes refer to each other with
+// plain pointers, so destroying one never reaches the others; only nodes
+// holding memory of their own, like the vectors of a block, have their
+// destructors run.
+class Arena {
+ public:
+  static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+  Arena() : chunks(), top(nullptr), end(nullptr), destructors() {}
+  ~Arena();
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  // alignment must be a power of two.
+  void* allocate(size_t size, size_t alignment);
+
+  // constructs a T that lives until the arena dies.
+  template <typename T, typename... Args>
+  T* make(Args&&... args) {
+    auto* object = new (allocate(sizeof(T), alignof(T)))
+        T(std::forward<Args>(args)...);
+    if (!std::is_trivially_destructible<T>::value) {
+      destructors.push_back(
+          {object, [](void* object) { static_cast<T*>(object)->~T(); }});
+    }
+    return object;
+  }
+
+  // the arena of the innermost open Scope of the calling thread, where
+  // nodes made outside a parse go.
+  static Arena& current();
+
+  // Makes arena the current one of the calling thread while it is open.
+  class Scope {
+   public:
+    explicit Scope(Arena& arena) : enclosing(active) { active = &arena; }
+    ~Scope() { active = enclosing; }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    Arena* enclosing;
+  };
+
+ private:
+  struct Destructor {
+    void* object;
+    void (*destroy)(void*);
+  };
+
+  static thread_local Arena* active;
+
+  std::vector<std::unique_ptr<char[]>> chunks;
+  char* top;
+  char* end;
+  // of the objects made that need one, in order of construction.
+  std::vector<Destructor> destructors;
+};
@@ -0,0 +1,173 @@
+#include "assembler.h"
+
+#include <cstring>
+
+namespace {
+
+uint8_t r(Register reg) { return static_cast<uint8_t>(reg); }
+
+}  // namespace
+
+void Assembler::bind(Label& label) {
+  label.position = code.size();
+  for (const auto use : label.uses) {
+    const int32_t rel = label.position - (use + 4);
+    std::memcpy(&code[use], &rel, sizeof(rel));
+  }
+  label.uses.clear();
+}
+
+void Assembler::patch32(size_t position, int32_t value) {
+  std::memcpy(&code[position], &value, sizeof(value));
+}
+
+void Assembler::push(Register reg) { emit(0x50 + r(reg)); }
+
+void Assembler::pop(Register reg) { emit(0x58 + r(reg)); }
+
+void Assembler::mov(Register dst, Register src) {
+  aluRegReg(0x89, dst, src);
+}
+
+void Assembler::mov(Register dst, int64_t imm) {
+  if (imm >= 0 && imm <= UINT32_MAX) {
+    // mov r32, imm32 zero-extends into the full register.
+    emit(0xB8 + r(dst));
+    emit32(static_cast<int32_t>(static_cast<uint32_t>(imm)));
+    return;
+  }
+  rexW();
+  emit(0xB8 + r(dst));
+  emit64(imm);
+}
+
+void Assembler::load(Register dst, Register base, int32_t disp) {
+  rexW();
+  emit(0x8B);
+  memoryOperand(r(dst), base, disp);
+}
+
+void Assembler::store(Register base, int32_t disp, Register src) {
+  rexW();
+  emit(0x89);
+  memoryOperand(r(src), base, disp);
+}
+
+void Assembler::lea(Register dst, Register base, int32_t disp) {
+  rexW();
+  emit(0x8D);
+  memoryOperand(r(dst), base, disp);
+}
+
+void Assembler::add(Register dst, Register src) { aluRegReg(0x01, dst, src); }
+
+void Assembler::sub(Register dst, Register src) { aluRegReg(0x29, dst, src); }
+
+void Assembler::imul(Register dst, Register src) {
+  rexW();
+  emit(0x0F);
+  emit(0xAF);
+  modrm(3, r(dst), r(src));
+}
+
+void Assembler::cmp(Register lhs, Register rhs) { aluRegReg(0x39, lhs, rhs); }
+
+void Assembler::test(Register lhs, Register rhs) {
+  aluRegReg(0x85, lhs, rhs);
+}
+
+void Assembler::neg(Register reg) {
+  rexW();
+  emit(0xF7);
+  modrm(3, 3, r(reg));
+}
+
+void Assembler::cqo() {
+  rexW();
+  emit(0x99);
+}
+
+void Assembler::idiv(Register src) {
+  rexW();
+  emit(0xF7);
+  modrm(3, 7, r(src));
+}
+
+void Assembler::addImm(Register dst, int32_t imm) {
+  rexW();
+  emit(0x81);
+  modrm(3, 0, r(dst));
+  emit32(imm);
+}
+
+void Assembler::subImm(Register dst, int32_t imm) {
+  rexW();
+  emit(0x81);
+  modrm(3, 5, r(dst));
+  emit32(imm);
+}
+
+void Assembler::setcc(Condition cond) {
+  // setcc al; movzx eax, al
+  emit(0x0F);
+  emit(0x90 + static_cast<uint8_t>(cond));
+  modrm(3, 0, r(Register::RAX));
+  emit(0x0F);
+  emit(0xB6);
+  modrm(3, r(Register::RAX), r(Register::RAX));
+}
+
+void Assembler::jmp(Label& label) {
+  emit(0xE9);
+  labelOperand(label);
+}
+
+void Assembler::jcc(Condition cond, Label& label) {
+  emit(0x0F);
+  emit(0x80 + static_cast<uint8_t>(cond));
+  labelOperand(label);
+}
+
+void Assembler::call(Label& label) {
+  emit(0xE8);
+  labelOperand(label);
+}
+
+void Assembler::ret() { emit(0xC3); }
+
+void Assembler::emit32(int32_t value) {
+  uint8_t bytes[sizeof(value)];
+  std::memcpy(bytes, &value, sizeof(value));
+  code.insert(code.end(), bytes, bytes + sizeof(bytes));
+}
+
+void Assembler::emit64(int64_t value) {
+  uint8_t bytes[sizeof(value)];
+  std::memcpy(bytes, &value, sizeof(value));
+  code.insert(code.end(), bytes, bytes + sizeof(bytes));
+}
+
+void Assembler::memoryOperand(uint8_t reg, Register base, int32_t disp) {
+  modrm(2, reg, r(base));
+  if (base == Register::RSP) {
+    // rsp as a base needs a SIB byte.
+    emit(0x24);
+  }
+  emit32(disp);
+}
+
+void Assembler::aluRegReg(uint8_t opcode, Register dst, Register src) {
+  rexW();
+  emit(opcode);
+  modrm(3, r(src), r(dst));
+}
+
+void Assembler::labelOperand(Label& label) {
+  if (label.position >= 0) {
+    const int32_t rel = label.position - (code.size() + 4);
+    emit32(rel);
+  } else {
+    label.uses.push_back(code.size());
+    emit32(0);
+  }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "common.h"
+
+// Minimal x86-64 encoder used by the JIT. Only the eight legacy general
+// purpose registers are supported, which keeps every encoding free of REX.R
+// and REX.B prefixes.
+enum class Register : uint8_t {
+  RAX = 0,
+  RCX = 1,
+  RDX = 2,
+  RBX = 3,
+  RSP = 4,
+  RBP = 5,
+  RSI = 6,
+  RDI = 7,
+};
+
+enum class Condition : uint8_t {
+  OVERFLOW = 0x0,
+  EQUAL = 0x4,
+  NOT_EQUAL = 0x5,
+  LESS = 0xC,
+  GREATER_EQUAL = 0xD,
+  LESS_EQUAL = 0xE,
+  GREATER = 0xF,
+};
+
+struct Label {
+  // code offset once bound, -1 before.
+  int64_t position = -1;
+  // offsets of rel32 operands that refer to this label.
+  std::vector<size_t> uses;
+};
+
+class Assembler {
+ public:
+  Assembler() : code() {}
+
+  const std::vector<uint8_t>& getCode() const { return code; }
+  size_t size() const { return code.size(); }
+
+  void bind(Label& label);
+  // overwrites a previously emitted imm32 operand.
+  void patch32(size_t position, int32_t value);
+
+  void push(Register reg);
+  void pop(Register reg);
+  void mov(Register dst, Register src);
+  void mov(Register dst, int64_t imm);
+  // dst <- [base + disp]
+  void load(Register dst, Register base, int32_t disp);
+  // [base + disp] <- src
+  void store(Register base, int32_t disp, Register src);
+  void lea(Register dst, Register base, int32_t disp);
+
+  void add(Register dst, Register src);
+  void sub(Register dst, Register src);
+  void imul(Register dst, Register src);
+  void cmp(Register lhs, Register rhs);
+  void test(Register lhs, Register rhs);
+  void neg(Register reg);
+  // rdx:rax / src, quotient in rax.
+  void cqo();
+  void idiv(Register src);
+  void addImm(Register dst, int32_t imm);
+  void subImm(Register dst, int32_t imm);
+  // rax <- condition ? 1 : 0
+  void setcc(Condition cond);
+
+  void jmp(Label& label);
+  void jcc(Condition cond, Label& label);
+  void call(Label& label);
+  void ret();
+
+ private:
+  std::vector<uint8_t> code;
+
+  void emit(uint8_t byte) { code.push_back(byte); }
+  void emit32(int32_t value);
+  void emit64(int64_t value);
+  void rexW() { emit(0x48); }
+  void modrm(uint8_t mod, uint8_t reg, uint8_t rm) {
+    emit(static_cast<uint8_t>((mod << 6) | ((reg & 7) << 3) | (rm & 7)));
+  }
+  void memoryOperand(uint8_t reg, Register base, int32_t disp);
+  void aluRegReg(uint8_t opcode, Register dst, Register src);
+  void labelOperand(Label& label);
+};
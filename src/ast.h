@@ -1,8 +1,10 @@
 #pragma once
 
+#include "arena.h"
 #include "common.h"
 #include "location.h"
 #include "object.h"
+#include "symbol.h"
 #include "token.h"
 
 enum class NodeType {
@@ -54,6 +56,8 @@ enum class NodeType {
 
 struct Node {
   const NodeType Type;
+  // source line the node was emitted at, 0 when unknown.
+  int line{0};
 
   Node() : Type(NodeType::EMPTY_STATEMENT) {}
   Node(const NodeType type) : Type(type) {}
@@ -62,32 +66,63 @@ struct Node {
 
   virtual std::string toString() const { return "(Node)"; }
 };
-using NodePtr = std::shared_ptr<Node>;
+using NodePtr = Node*;
+
+// a node of the arena of the current Arena::Scope, see Program.
+template <typename T, typename... Args>
+T* makeNode(Args&&... args) {
+  return Arena::current().make<T>(std::forward<Args>(args)...);
+}
+
+// Where a variable lives, filled in by the Resolver: the number of
+// environments to walk up from the one the node is evaluated in, and the
+// slot in the environment reached. Globals have their own table.
+struct LexicalAddress {
+  static constexpr int GLOBAL_DEPTH = -1;
+
+  int depth{GLOBAL_DEPTH};
+  int slot{-1};
+
+  bool isGlobal() const { return depth == GLOBAL_DEPTH; }
+};
+
+// How the Evaluator reads an operand the Optimizer fused into its parent:
+// variables and integer literals are read in place instead of going
+// through evalExpression.
+enum class Operand { EXPRESSION, VARIABLE, CONSTANT };
 
 struct Statement : public Node {
   Statement() : Node(NodeType::EMPTY_STATEMENT) {}
   Statement(NodeType type) : Node(type) {}
 
-  static std::shared_ptr<Statement> make() {
-    return std::make_shared<Statement>();
+  static Statement* make() {
+    return makeNode<Statement>();
   }
 
   virtual std::string toString() const override { return "(Statement)"; }
 };
-using StatementPtr = std::shared_ptr<Statement>;
+using StatementPtr = Statement*;
+
+// How control leaves a statement.
+enum class Completion { NORMAL, RETURN, BREAK, CONTINUE };
 
 struct Expression : public Node {
   Expression(NodeType type) : Node(type) {}
 
   virtual std::string toString() const override { return "(Expression)"; }
 };
-using ExpressionPtr = std::shared_ptr<Expression>;
+using ExpressionPtr = Expression*;
 
 struct IntegerLiteral : public Expression {
   const int64_t Value;
+  // runtime value of the literal, shared through the program's constant
+  // pool when built by ASTBuilderImpl.
+  ::Value constant;
 
   IntegerLiteral(const int64_t value)
-      : Expression(NodeType::INTEGER_LITERAL), Value(value) {}
+      : Expression(NodeType::INTEGER_LITERAL),
+        Value(value),
+        constant(::Value::integer(value)) {}
 
   bool isEqual(const Node& other) override {
     if (Type == other.Type) {
@@ -103,11 +138,11 @@ struct IntegerLiteral : public Expression {
     return "(IntegerLiteral " + std::to_string(Value) + ")";
   }
 
-  static std::shared_ptr<IntegerLiteral> make(const int64_t value) {
-    return std::make_shared<IntegerLiteral>(value);
+  static IntegerLiteral* make(const int64_t value) {
+    return makeNode<IntegerLiteral>(value);
   }
 };
-using IntegerLiteralPtr = std::shared_ptr<IntegerLiteral>;
+using IntegerLiteralPtr = IntegerLiteral*;
 
 struct BooleanLiteral : public Expression {
   const int64_t Value;
@@ -129,25 +164,30 @@ struct BooleanLiteral : public Expression {
     return "(BooleanLiteral " + std::to_string(Value) + ")";
   }
 
-  static std::shared_ptr<BooleanLiteral> makeTrue() {
-    return std::make_shared<BooleanLiteral>(true);
+  static BooleanLiteral* makeTrue() {
+    return makeNode<BooleanLiteral>(true);
   }
 
-  static std::shared_ptr<BooleanLiteral> makeFalse() {
-    return std::make_shared<BooleanLiteral>(false);
+  static BooleanLiteral* makeFalse() {
+    return makeNode<BooleanLiteral>(false);
   }
 
-  static std::shared_ptr<BooleanLiteral> make(const bool value) {
-    return std::make_shared<BooleanLiteral>(value);
+  static BooleanLiteral* make(const bool value) {
+    return makeNode<BooleanLiteral>(value);
   }
 };
-using BooleanLiteralPtr = std::shared_ptr<BooleanLiteral>;
+using BooleanLiteralPtr = BooleanLiteral*;
 
 struct StringLiteral : public Expression {
   const std::string Value;
+  // runtime value of the literal, shared through the program's constant
+  // pool when built by ASTBuilderImpl.
+  ::Value constant;
 
   StringLiteral(const std::string& value)
-      : Expression(NodeType::STRING_LITERAL), Value(value) {}
+      : Expression(NodeType::STRING_LITERAL),
+        Value(value),
+        constant(makeRef<StringObject>(value)) {}
 
   bool isEqual(const Node& other) override {
     if (Type == other.Type) {
@@ -163,11 +203,11 @@ struct StringLiteral : public Expression {
     return "(StringLiteral " + Value + ")";
   }
 
-  static std::shared_ptr<StringLiteral> make(const std::string& value) {
-    return std::make_shared<StringLiteral>(value);
+  static StringLiteral* make(const std::string& value) {
+    return makeNode<StringLiteral>(value);
   }
 };
-using StringLiteralPtr = std::shared_ptr<StringLiteral>;
+using StringLiteralPtr = StringLiteral*;
 
 struct NilLiteral : public Expression {
   NilLiteral() : Expression(NodeType::NIL_LITERAL) {}
@@ -178,11 +218,11 @@ struct NilLiteral : public Expression {
 
   std::string toString() const override { return "(NilLiteral)"; }
 
-  static std::shared_ptr<NilLiteral> make() {
-    return std::make_shared<NilLiteral>();
+  static NilLiteral* make() {
+    return makeNode<NilLiteral>();
   }
 };
-using NilLiteralPtr = std::shared_ptr<NilLiteral>;
+using NilLiteralPtr = NilLiteral*;
 
 // NilLiteral expr also serves as a EmptyExpression.
 // When we need a placeholder for an empty expression, for example, on for loop
@@ -190,11 +230,13 @@ using NilLiteralPtr = std::shared_ptr<NilLiteral>;
 using EmptyExpression = NilLiteral;
 
 struct VariableExpr : public Expression {
-  std::string identifier;
+  Symbol identifier;
+  LexicalAddress address;
+  // index of the method of the enclosing class the name refers to, -1 for
+  // a variable; address is then the self slot of the record.
+  int method = -1;
 
-  VariableExpr(const std::string& identifier)
-      : Expression(NodeType::VARIABLE_EXPRESSION), identifier(identifier) {}
-  VariableExpr(std::string&& identifier)
+  VariableExpr(Symbol identifier)
       : Expression(NodeType::VARIABLE_EXPRESSION), identifier(identifier) {}
 
   bool isEqual(const Node& other) override {
@@ -210,24 +252,29 @@ struct VariableExpr : public Expression {
   }
 
   std::string toString() const override {
-    return "(VariableExpr " + identifier + ")";
+    return "(VariableExpr " + identifier.str() + ")";
   }
 
-  static std::shared_ptr<VariableExpr> make(const std::string& variableName) {
-    return std::make_shared<VariableExpr>(variableName);
+  static VariableExpr* make(Symbol variableName) {
+    return makeNode<VariableExpr>(variableName);
   }
 };
-using VariableExprPtr = std::shared_ptr<VariableExpr>;
+using VariableExprPtr = VariableExpr*;
 
 struct Assignment : public Expression {
-  std::string identifier;
+  Symbol identifier;
   ExpressionPtr value;
+  LexicalAddress address;
+  // set by the Optimizer for x = x + c and x = x - c, which the Evaluator
+  // runs as one step adding step to x while x holds an integer.
+  bool increment = false;
+  int64_t step = 0;
 
-  Assignment(const std::string& identifier)
+  Assignment(Symbol identifier)
       : Expression(NodeType::ASSIGNMENT_EXPRESSION),
         identifier(identifier),
         value(nullptr) {}
-  Assignment(const std::string& identifier, const ExpressionPtr& value)
+  Assignment(Symbol identifier, const ExpressionPtr& value)
       : Expression(NodeType::ASSIGNMENT_EXPRESSION),
         identifier(identifier),
         value(value) {}
@@ -256,23 +303,29 @@ struct Assignment : public Expression {
   }
 
   std::string toString() const override {
-    return "(Assignment " + identifier + " " + value->toString() + ")";
+    return "(Assignment " + identifier.str() + " " + value->toString() + ")";
   }
 
-  static std::shared_ptr<Assignment> make(const std::string& identifier) {
-    return std::make_shared<Assignment>(identifier);
+  static Assignment* make(Symbol identifier) {
+    return makeNode<Assignment>(identifier);
   }
-  static std::shared_ptr<Assignment> make(const std::string& identifier,
-                                          const ExpressionPtr& value) {
-    return std::make_shared<Assignment>(identifier, value);
+  static Assignment* make(Symbol identifier, const ExpressionPtr& value) {
+    return makeNode<Assignment>(identifier, value);
   }
 };
-using AssignmentPtr = std::shared_ptr<Assignment>;
+using AssignmentPtr = Assignment*;
 
 struct BinaryExpr : public Expression {
+  // operand types the Evaluator has seen at this node. INTEGER sites take a
+  // fast path until an operand of another type turns them GENERIC for good.
+  enum class Feedback { UNINITIALIZED, INTEGER, GENERIC };
+
   ExpressionPtr left;
   Token operator_;
   ExpressionPtr right;
+  Feedback feedback = Feedback::UNINITIALIZED;
+  Operand leftOperand = Operand::EXPRESSION;
+  Operand rightOperand = Operand::EXPRESSION;
 
   BinaryExpr(const ExpressionPtr& left, const Token& operator_,
              const ExpressionPtr& right)
@@ -304,13 +357,12 @@ struct BinaryExpr : public Expression {
            right->toString() + ")";
   }
 
-  static std::shared_ptr<BinaryExpr> make(const ExpressionPtr& left,
-                                          const Token& operator_,
-                                          const ExpressionPtr& right) {
-    return std::make_shared<BinaryExpr>(left, operator_, right);
+  static BinaryExpr* make(const ExpressionPtr& left, const Token& operator_,
+                          const ExpressionPtr& right) {
+    return makeNode<BinaryExpr>(left, operator_, right);
   }
 };
-using BinaryExprPtr = std::shared_ptr<BinaryExpr>;
+using BinaryExprPtr = BinaryExpr*;
 
 struct UnaryExpr : public Expression {
   Token operator_;
@@ -340,12 +392,11 @@ struct UnaryExpr : public Expression {
     return "(UnaryExpr " + operator_.lexeme() + " " + right->toString() + ")";
   }
 
-  static std::shared_ptr<UnaryExpr> make(const Token& operator_,
-                                         const ExpressionPtr& right) {
-    return std::make_shared<UnaryExpr>(operator_, right);
+  static UnaryExpr* make(const Token& operator_, const ExpressionPtr& right) {
+    return makeNode<UnaryExpr>(operator_, right);
   }
 };
-using UnaryExprPtr = std::shared_ptr<UnaryExpr>;
+using UnaryExprPtr = UnaryExpr*;
 
 struct CallExpr : public Expression {
   ExpressionPtr left;
@@ -389,18 +440,35 @@ struct CallExpr : public Expression {
     return result;
   }
 
-  static std::shared_ptr<CallExpr> make(
-      const ExpressionPtr& left, const std::vector<ExpressionPtr>& arguments) {
-    return std::make_shared<CallExpr>(left, arguments);
+  static CallExpr* make(const ExpressionPtr& left,
+                        const std::vector<ExpressionPtr>& arguments) {
+    return makeNode<CallExpr>(left, arguments);
   }
 };
-using CallExprPtr = std::shared_ptr<CallExpr>;
+using CallExprPtr = CallExpr*;
+
+class Shape;
 
 struct MemberExpr : public Expression {
+  // one inline cache entry: the index of member in the method table of the
+  // class of one shape, -1 when it has no such method.
+  struct CacheEntry {
+    const Shape* shape;
+    // keeps the shape's memory, and so its address, from being reused.
+    std::weak_ptr<Shape> pin;
+    int method;
+  };
+  // classes cached before the site is considered megamorphic.
+  static constexpr size_t MAX_CACHE_ENTRIES = 4;
+
   VariableExprPtr left;
-  std::string member;
+  Symbol member;
+  // filled by the Evaluator: monomorphic with one entry, polymorphic with up
+  // to MAX_CACHE_ENTRIES; megamorphic sites stop caching.
+  std::vector<CacheEntry> cache;
+  bool megamorphic = false;
 
-  MemberExpr(const VariableExprPtr& left, const std::string& member)
+  MemberExpr(const VariableExprPtr& left, Symbol member)
       : Expression(NodeType::MEMBER_EXPRESSION), left(left), member(member) {}
 
   bool isEqual(const Node& other) override {
@@ -419,22 +487,33 @@ struct MemberExpr : public Expression {
   }
 
   std::string toString() const override {
-    return "(MemberExpr " + left->toString() + " " + member + ")";
+    return "(MemberExpr " + left->toString() + " " + member.str() + ")";
   }
 
-  static std::shared_ptr<MemberExpr> make(const VariableExprPtr& left,
-                                          const std::string& member) {
-    return std::make_shared<MemberExpr>(left, member);
+  static MemberExpr* make(const VariableExprPtr& left, Symbol member) {
+    return makeNode<MemberExpr>(left, member);
   }
 };
-using MemberExprPtr = std::shared_ptr<MemberExpr>;
+using MemberExprPtr = MemberExpr*;
 
+// The root of a parse, and the owner of its nodes: they live in its arena
+// and go with the program, all at once. Whatever keeps nodes of a program,
+// like the functions an Evaluator declared, must keep the program too.
 struct Program : public Node {
   std::vector<StatementPtr> statements;
+  // interned literal values referenced by the program's literal nodes.
+  std::vector<Value> constants;
 
-  Program() : Node(NodeType::PROGRAM), statements() {}
+  Program() : Node(NodeType::PROGRAM), statements(), arena(new Arena()) {}
   Program(const std::vector<StatementPtr>& statements)
-      : Node(NodeType::PROGRAM), statements(statements) {}
+      : Node(NodeType::PROGRAM), statements(statements), arena(new Arena()) {}
+  Program(const std::vector<StatementPtr>& statements,
+          std::unique_ptr<Arena> arena)
+      : Node(NodeType::PROGRAM),
+        statements(statements),
+        arena(std::move(arena)) {}
+  // where nodes added to the program, by the Optimizer say, are made.
+  Arena& getArena() { return *arena; }
 
   bool isEqual(const Node& other) override {
     if (Type == other.Type) {
@@ -463,23 +542,27 @@ struct Program : public Node {
     return result;
   }
 
+  // a program of nodes made in the current arena, which must outlive it.
   static std::shared_ptr<Program> make(
       const std::vector<StatementPtr>& statements) {
     return std::make_shared<Program>(statements);
   }
+
+ private:
+  std::unique_ptr<Arena> arena;
 };
 using ProgramPtr = std::shared_ptr<Program>;
 
 struct VarDeclaration : public Statement {
-  std::string identifier;
+  Symbol identifier;
   ExpressionPtr initializer;
+  LexicalAddress address;
 
-  VarDeclaration(const std::string& identifier)
+  VarDeclaration(Symbol identifier)
       : Statement(NodeType::VAR_DECLARATION),
         identifier(identifier),
         initializer(nullptr) {}
-  VarDeclaration(const std::string& identifier,
-                 const ExpressionPtr& initializer)
+  VarDeclaration(Symbol identifier, const ExpressionPtr& initializer)
       : Statement(NodeType::VAR_DECLARATION),
         identifier(identifier),
         initializer(initializer) {}
@@ -513,7 +596,7 @@ struct VarDeclaration : public Statement {
   }
 
   std::string toString() const override {
-    std::string result = "(VarDeclaration " + identifier;
+    std::string result = "(VarDeclaration " + identifier.str();
     if (initializer) {
       result += " " + initializer->toString();
     }
@@ -521,26 +604,28 @@ struct VarDeclaration : public Statement {
     return result;
   }
 
-  static std::shared_ptr<VarDeclaration> make(
-      const std::string& identifier,
-      const ExpressionPtr& initializer = nullptr) {
-    return std::make_shared<VarDeclaration>(identifier, initializer);
+  static VarDeclaration* make(Symbol identifier,
+                              const ExpressionPtr& initializer = nullptr) {
+    return makeNode<VarDeclaration>(identifier, initializer);
   }
 };
-using VarDeclarationPtr = std::shared_ptr<VarDeclaration>;
+using VarDeclarationPtr = VarDeclaration*;
 
 struct FunctionDeclaration : public Statement {
-  std::string identifier;
-  std::vector<std::string> params;
+  Symbol identifier;
+  std::vector<Symbol> params;
   StatementPtr body;
+  // binding of the function's name; params take slots 0..n-1 of the call
+  // frame, followed by the locals of the body's outermost block.
+  LexicalAddress address;
+  size_t scopeSize{0};
 
-  FunctionDeclaration(const std::string& identifier)
+  FunctionDeclaration(Symbol identifier)
       : Statement(NodeType::FUNCTION_DECLARATION),
         identifier(identifier),
         params(),
         body(nullptr) {}
-  FunctionDeclaration(const std::string& identifier,
-                      const std::vector<std::string>& params,
+  FunctionDeclaration(Symbol identifier, const std::vector<Symbol>& params,
                       const StatementPtr& body)
       : Statement(NodeType::FUNCTION_DECLARATION),
         identifier(identifier),
@@ -582,9 +667,9 @@ struct FunctionDeclaration : public Statement {
   }
 
   std::string toString() const override {
-    std::string result = "(FunctionDeclaration " + identifier;
+    std::string result = "(FunctionDeclaration " + identifier.str();
     for (const auto& param : params) {
-      result += " " + param;
+      result += " " + param.str();
     }
     if (body) {
       result += " " + body->toString();
@@ -593,26 +678,29 @@ struct FunctionDeclaration : public Statement {
     return result;
   }
 
-  static std::shared_ptr<FunctionDeclaration> make(
-      const std::string& identifier, const std::vector<std::string>& params,
-      const StatementPtr& body) {
-    return std::make_shared<FunctionDeclaration>(identifier, params, body);
+  static FunctionDeclaration* make(Symbol identifier,
+                                   const std::vector<Symbol>& params,
+                                   const StatementPtr& body) {
+    return makeNode<FunctionDeclaration>(identifier, params, body);
   }
 };
-using FunctionDeclarationPtr = std::shared_ptr<FunctionDeclaration>;
+using FunctionDeclarationPtr = FunctionDeclaration*;
 
 struct ClassDeclaration : public Statement {
-  std::string identifier;
+  Symbol identifier;
   FunctionDeclarationPtr ctor;
   std::vector<VarDeclarationPtr> fields;
   std::vector<FunctionDeclarationPtr> methods;
+  LexicalAddress address;
+  // layout of its records, built by the Resolver.
+  std::shared_ptr<Shape> shape;
 
-  ClassDeclaration(const std::string& identifier)
+  ClassDeclaration(Symbol identifier)
       : Statement(NodeType::CLASS_DECLARATION),
         identifier(identifier),
+        ctor(nullptr),
         methods() {}
-  ClassDeclaration(const std::string& identifier,
-                   const FunctionDeclarationPtr& ctor,
+  ClassDeclaration(Symbol identifier, const FunctionDeclarationPtr& ctor,
                    const std::vector<VarDeclarationPtr>& fields,
                    const std::vector<FunctionDeclarationPtr>& methods)
       : Statement(NodeType::CLASS_DECLARATION),
@@ -629,7 +717,7 @@ struct ClassDeclaration : public Statement {
   }
 
   std::string toString() const {
-    std::string result = "(ClassDeclaration " + identifier + " ";
+    std::string result = "(ClassDeclaration " + identifier.str() + " ";
     for (const auto& field : fields) {
       result += "var " + field->toString() + ", ";
     }
@@ -640,18 +728,20 @@ struct ClassDeclaration : public Statement {
     return result;
   }
 
-  static std::shared_ptr<ClassDeclaration> make(
-      const std::string& identifier, const FunctionDeclarationPtr& ctor,
+  static ClassDeclaration* make(
+      Symbol identifier, const FunctionDeclarationPtr& ctor,
       const std::vector<VarDeclarationPtr>& fields,
       const std::vector<FunctionDeclarationPtr>& methods) {
-    return std::make_shared<ClassDeclaration>(identifier, ctor, fields,
-                                              methods);
+    return makeNode<ClassDeclaration>(identifier, ctor, fields, methods);
   }
 };
-using ClassDeclarationPtr = std::shared_ptr<ClassDeclaration>;
+using ClassDeclarationPtr = ClassDeclaration*;
 
 struct Block : public Statement {
   std::vector<StatementPtr> statements;
+  size_t scopeSize{0};
+  // a function or class declared within may keep the scope alive.
+  bool captured{false};
 
   Block() : Statement(NodeType::BLOCK_STATEMENT), statements() {}
   Block(const std::vector<StatementPtr>& statements)
@@ -683,18 +773,20 @@ struct Block : public Statement {
     return result;
   }
 
-  static std::shared_ptr<Block> make(
-      const std::vector<StatementPtr>& statements) {
-    return std::make_shared<Block>(statements);
+  static Block* make(const std::vector<StatementPtr>& statements) {
+    return makeNode<Block>(statements);
   }
 };
-using BlockPtr = std::shared_ptr<Block>;
+using BlockPtr = Block*;
 
 struct ForStatement : public Statement {
   StatementPtr initializer;
   ExpressionPtr condition;
   ExpressionPtr increment;
   StatementPtr body;
+  size_t scopeSize{0};
+  // a function or class declared within may keep the scope alive.
+  bool captured{false};
 
   ForStatement()
       : Statement(NodeType::FOR_STATEMENT),
@@ -776,15 +868,15 @@ struct ForStatement : public Statement {
     return result;
   }
 
-  static std::shared_ptr<ForStatement> make(const StatementPtr& initializer,
-                                            const ExpressionPtr& condition,
-                                            const ExpressionPtr& increment,
-                                            const StatementPtr& body) {
-    return std::make_shared<ForStatement>(initializer, condition, increment,
+  static ForStatement* make(const StatementPtr& initializer,
+                            const ExpressionPtr& condition,
+                            const ExpressionPtr& increment,
+                            const StatementPtr& body) {
+    return makeNode<ForStatement>(initializer, condition, increment,
                                           body);
   }
 };
-using ForStatementPtr = std::shared_ptr<ForStatement>;
+using ForStatementPtr = ForStatement*;
 
 struct WhileStatement : public Statement {
   ExpressionPtr condition;
@@ -835,16 +927,16 @@ struct WhileStatement : public Statement {
     return result;
   }
 
-  static std::shared_ptr<WhileStatement> make() {
-    return std::make_shared<WhileStatement>();
+  static WhileStatement* make() {
+    return makeNode<WhileStatement>();
   }
 
-  static std::shared_ptr<WhileStatement> make(const ExpressionPtr& condition,
-                                              const StatementPtr& body) {
-    return std::make_shared<WhileStatement>(condition, body);
+  static WhileStatement* make(const ExpressionPtr& condition,
+                              const StatementPtr& body) {
+    return makeNode<WhileStatement>(condition, body);
   }
 };
-using WhileStatementPtr = std::shared_ptr<WhileStatement>;
+using WhileStatementPtr = WhileStatement*;
 
 struct PrintStatement : public Statement {
   ExpressionPtr expression;
@@ -875,15 +967,15 @@ struct PrintStatement : public Statement {
     return result;
   }
 
-  static std::shared_ptr<PrintStatement> make() {
-    return std::make_shared<PrintStatement>();
+  static PrintStatement* make() {
+    return makeNode<PrintStatement>();
   }
 
-  static std::shared_ptr<PrintStatement> make(const ExpressionPtr& expression) {
-    return std::make_shared<PrintStatement>(expression);
+  static PrintStatement* make(const ExpressionPtr& expression) {
+    return makeNode<PrintStatement>(expression);
   }
 };
-using PrintStatementPtr = std::shared_ptr<PrintStatement>;
+using PrintStatementPtr = PrintStatement*;
 
 struct IfStatement : public Statement {
   ExpressionPtr condition;
@@ -907,14 +999,14 @@ struct IfStatement : public Statement {
         thenBranch(thenBranch),
         elseBranch(elseBranch) {}
 
-  static std::shared_ptr<IfStatement> make(const ExpressionPtr& condition,
-                                           const StatementPtr& thenBranch) {
-    return std::make_shared<IfStatement>(condition, thenBranch);
+  static IfStatement* make(const ExpressionPtr& condition,
+                           const StatementPtr& thenBranch) {
+    return makeNode<IfStatement>(condition, thenBranch);
   }
-  static std::shared_ptr<IfStatement> make(const ExpressionPtr& condition,
-                                           const StatementPtr& thenBranch,
-                                           const StatementPtr& elseBranch) {
-    return std::make_shared<IfStatement>(condition, thenBranch, elseBranch);
+  static IfStatement* make(const ExpressionPtr& condition,
+                           const StatementPtr& thenBranch,
+                           const StatementPtr& elseBranch) {
+    return makeNode<IfStatement>(condition, thenBranch, elseBranch);
   }
 
   bool isEqual(const Node& other) override {
@@ -959,10 +1051,11 @@ struct IfStatement : public Statement {
     return result;
   }
 };
-using IfStatementPtr = std::shared_ptr<IfStatement>;
+using IfStatementPtr = IfStatement*;
 
 struct ReturnStatement : public Statement {
   ExpressionPtr expression;
+  Operand operand = Operand::EXPRESSION;
 
   ReturnStatement()
       : Statement(NodeType::RETURN_STATEMENT), expression(nullptr) {}
@@ -998,15 +1091,14 @@ struct ReturnStatement : public Statement {
     return result;
   }
 
-  static std::shared_ptr<ReturnStatement> make() {
-    return std::make_shared<ReturnStatement>();
+  static ReturnStatement* make() {
+    return makeNode<ReturnStatement>();
   }
-  static std::shared_ptr<ReturnStatement> make(
-      const ExpressionPtr& expression) {
-    return std::make_shared<ReturnStatement>(expression);
+  static ReturnStatement* make(const ExpressionPtr& expression) {
+    return makeNode<ReturnStatement>(expression);
   }
 };
-using ReturnStatementPtr = std::shared_ptr<ReturnStatement>;
+using ReturnStatementPtr = ReturnStatement*;
 
 struct BreakStatement : public Statement {
   BreakStatement() : Statement(NodeType::BREAK_STATEMENT) {}
@@ -1023,11 +1115,11 @@ struct BreakStatement : public Statement {
 
   std::string toString() const override { return "(BreakStatement)"; }
 
-  static std::shared_ptr<BreakStatement> make() {
-    return std::make_shared<BreakStatement>();
+  static BreakStatement* make() {
+    return makeNode<BreakStatement>();
   }
 };
-using BreakStatementPtr = std::shared_ptr<BreakStatement>;
+using BreakStatementPtr = BreakStatement*;
 
 struct ContinueStatement : public Statement {
   ContinueStatement() : Statement(NodeType::CONTINUE_STATEMENT) {}
@@ -1045,11 +1137,11 @@ struct ContinueStatement : public Statement {
 
   std::string toString() const override { return "(ContinueStatement)"; }
 
-  static std::shared_ptr<ContinueStatement> make() {
-    return std::make_shared<ContinueStatement>();
+  static ContinueStatement* make() {
+    return makeNode<ContinueStatement>();
   }
 };
-using ContinueStatementPtr = std::shared_ptr<ContinueStatement>;
+using ContinueStatementPtr = ContinueStatement*;
 
 struct ExpressionStatement : public Statement {
   ExpressionPtr expression;
@@ -1081,12 +1173,11 @@ struct ExpressionStatement : public Statement {
     return result;
   }
 
-  static std::shared_ptr<ExpressionStatement> make(
-      const ExpressionPtr& expression) {
-    return std::make_shared<ExpressionStatement>(expression);
+  static ExpressionStatement* make(const ExpressionPtr& expression) {
+    return makeNode<ExpressionStatement>(expression);
   }
 };
-using ExpressionStatementPtr = std::shared_ptr<ExpressionStatement>;
+using ExpressionStatementPtr = ExpressionStatement*;
 
 struct ArrayLiteral : public Expression {
   std::vector<ExpressionPtr> elements;
@@ -1124,16 +1215,17 @@ struct ArrayLiteral : public Expression {
     return result;
   }
 
-  static std::shared_ptr<ArrayLiteral> make(
-      const std::vector<ExpressionPtr>& elements = {}) {
-    return std::make_shared<ArrayLiteral>(elements);
+  static ArrayLiteral* make(const std::vector<ExpressionPtr>& elements = {}) {
+    return makeNode<ArrayLiteral>(elements);
   }
 };
-using ArrayLiteralPtr = std::shared_ptr<ArrayLiteral>;
+using ArrayLiteralPtr = ArrayLiteral*;
 
 struct ArraySubscriptExpr : public Expression {
   ExpressionPtr array;
   ExpressionPtr index;
+  Operand arrayOperand = Operand::EXPRESSION;
+  Operand indexOperand = Operand::EXPRESSION;
 
   ArraySubscriptExpr()
       : Expression(NodeType::ARRAY_SUBSCRIPT_EXPRESSION),
@@ -1169,13 +1261,13 @@ struct ArraySubscriptExpr : public Expression {
     return array->isEqual(*other.array) && index->isEqual(*other.index);
   }
 
-  static std::shared_ptr<ArraySubscriptExpr> make(const ExpressionPtr& array,
-                                                  const ExpressionPtr& index) {
-    return std::make_shared<ArraySubscriptExpr>(array, index);
+  static ArraySubscriptExpr* make(const ExpressionPtr& array,
+                                  const ExpressionPtr& index) {
+    return makeNode<ArraySubscriptExpr>(array, index);
   }
 };
 
-using ArraySubscriptExprPtr = std::shared_ptr<ArraySubscriptExpr>;
+using ArraySubscriptExprPtr = ArraySubscriptExpr*;
 
 template <typename T>
 class NodeVisitor {
@@ -2,35 +2,42 @@
 
 using std::vector;
 
-constexpr auto MagicCtorName = "__init__";
+const Symbol MagicCtorName("__init__");
 
 ProgramPtr ASTBuilderImpl::emitProgram(
     const std::vector<StatementPtr> &statements) {
-  program = Program::make(statements);
+  program = std::make_shared<Program>(statements, std::move(arena));
+  for (auto &pair : integerConstants) {
+    program->constants.push_back(std::move(pair.second));
+  }
+  for (auto &pair : stringConstants) {
+    program->constants.push_back(std::move(pair.second));
+  }
+  integerConstants.clear();
+  stringConstants.clear();
   return program;
 }
 
 VarDeclarationPtr ASTBuilderImpl::emitVarDeclaration(
-    VariableExprPtr identifier, ExpressionPtr initializer) {
+    const Token &identifier, ExpressionPtr initializer) {
   if (!initializer) {
-    initializer = NilLiteral::make();
+    initializer = allocate<NilLiteral>();
   }
-  return VarDeclaration::make(identifier->identifier, initializer);
+  return located(allocate<VarDeclaration>(identifier.symbol(), initializer));
 }
 
 ClassDeclarationPtr ASTBuilderImpl::emitClassDeclaration(
     const Token &name, const std::vector<StatementPtr> &definitions) {
-  const auto classIdentifier = name.lexeme();
-  FunctionDeclarationPtr ctor;
+  const auto classIdentifier = name.symbol();
+  FunctionDeclarationPtr ctor = nullptr;
   vector<VarDeclarationPtr> fields;
   vector<FunctionDeclarationPtr> methods;
   // TODO: Add ctor and general class validation here for parsing errors
   for (const auto &definition : definitions) {
     if (definition->Type == NodeType::VAR_DECLARATION) {
-      fields.push_back(std::dynamic_pointer_cast<VarDeclaration>(definition));
+      fields.push_back(dynamic_cast<VarDeclaration*>(definition));
     } else if (definition->Type == NodeType::FUNCTION_DECLARATION) {
-      auto functionPtr =
-          std::dynamic_pointer_cast<FunctionDeclaration>(definition);
+      auto functionPtr = dynamic_cast<FunctionDeclaration*>(definition);
       // TODO: check for ctor validation here: duplicate ctors.
       // if a method name is exactly as the magic ctor name, it is a ctor.
       if (functionPtr->identifier == MagicCtorName) {
@@ -42,132 +49,143 @@ ClassDeclarationPtr ASTBuilderImpl::emitClassDeclaration(
       assert(false);
     }
   }
-  return ClassDeclaration::make(classIdentifier, ctor, fields, methods);
+  return located(
+      allocate<ClassDeclaration>(classIdentifier, ctor, fields, methods));
 }
 
 ExpressionStatementPtr ASTBuilderImpl::emitExpressionStatement(
     ExpressionPtr expr) {
-  return ExpressionStatement::make(expr);
+  return located(allocate<ExpressionStatement>(expr));
 }
 
 IntegerLiteralPtr ASTBuilderImpl::emitIntegerLiteral(const Token &value) {
-  return IntegerLiteral::make(std::stoll(value.lexeme()));
+  auto literal = allocate<IntegerLiteral>(std::stoll(value.lexeme()));
+  literal->constant =
+      intern(integerConstants, literal->Value, literal->constant);
+  return located(literal);
 }
 
 StringLiteralPtr ASTBuilderImpl::emitStringLiteral(const Token &value) {
-  return StringLiteral::make(value.lexeme());
+  auto literal = allocate<StringLiteral>(value.lexeme());
+  literal->constant =
+      intern(stringConstants, literal->Value, literal->constant);
+  return located(literal);
 }
 
 BooleanLiteralPtr ASTBuilderImpl::emitBooleanLiteral(bool value) {
-  return BooleanLiteral::make(value);
+  return located(allocate<BooleanLiteral>(value));
 }
 
-NilLiteralPtr ASTBuilderImpl::emitNilLiteral() { return NilLiteral::make(); }
+NilLiteralPtr ASTBuilderImpl::emitNilLiteral() {
+  return located(allocate<NilLiteral>());
+}
 
 ArrayLiteralPtr ASTBuilderImpl::emitArrayLiteral(
     const std::vector<ExpressionPtr> &elements) {
-  return ArrayLiteral::make(elements);
+  return located(allocate<ArrayLiteral>(elements));
 }
 
 ArraySubscriptExprPtr ASTBuilderImpl::emitArraySubscript(ExpressionPtr array,
                                                          ExpressionPtr index) {
-  return ArraySubscriptExpr::make(array, index);
+  return located(allocate<ArraySubscriptExpr>(array, index));
 }
 
 VariableExprPtr ASTBuilderImpl::emitVarExpression(const Token &value) {
-  return VariableExpr::make(value.lexeme());
+  return located(allocate<VariableExpr>(value.symbol()));
 }
 
 MemberExprPtr ASTBuilderImpl::emitMemberExpression(VariableExprPtr object,
                                                    const Token &member) {
-  return MemberExpr::make(object, member.lexeme());
+  return located(allocate<MemberExpr>(object, member.symbol()));
 }
 
 AssignmentPtr ASTBuilderImpl::emitAssignmentExpression(ExpressionPtr lhs,
                                                        ExpressionPtr rhs) {
-  auto identifier = std::dynamic_pointer_cast<VariableExpr>(lhs);
+  auto identifier = dynamic_cast<VariableExpr*>(lhs);
   assert(identifier != nullptr);
-  return Assignment::make(identifier->identifier, rhs);
+  return located(allocate<Assignment>(identifier->identifier, rhs));
 }
 
 CallExprPtr ASTBuilderImpl::emitCallExpression(
     ExpressionPtr callee, const std::vector<ExpressionPtr> &arguments) {
-  return CallExpr::make(callee, arguments);
+  return located(allocate<CallExpr>(callee, arguments));
 }
 
 UnaryExprPtr ASTBuilderImpl::emitUnaryOp(TokenType op, ExpressionPtr rhs) {
-  return UnaryExpr::make(Token::make(op), rhs);
+  return located(allocate<UnaryExpr>(Token::make(op), rhs));
 }
 
 BinaryExprPtr ASTBuilderImpl::emitBinaryOp(TokenType op, ExpressionPtr lhs,
                                            ExpressionPtr rhs) {
-  return BinaryExpr::make(lhs, Token::make(op), rhs);
+  return located(allocate<BinaryExpr>(lhs, Token::make(op), rhs));
 }
 
-StatementPtr ASTBuilderImpl::emitEmptyStatement() { return Statement::make(); }
+StatementPtr ASTBuilderImpl::emitEmptyStatement() {
+  return located(allocate<Statement>());
+}
 
 IfStatementPtr ASTBuilderImpl::emitIfStatement(ExpressionPtr condition,
                                                BlockPtr thenBody,
                                                BlockPtr elseBody) {
   if (elseBody == nullptr) {
-    return IfStatement::make(condition, thenBody);
+    return located(allocate<IfStatement>(condition, thenBody));
   }
-  return IfStatement::make(condition, thenBody, elseBody);
+  return located(allocate<IfStatement>(condition, thenBody, elseBody));
 }
 
 WhileStatementPtr ASTBuilderImpl::emitWhileStatement(ExpressionPtr condition,
                                                      BlockPtr body) {
-  return WhileStatement::make(condition, body);
+  return located(allocate<WhileStatement>(condition, body));
 }
 
 ForStatementPtr ASTBuilderImpl::emitForStatement(
     StatementPtr initialization, ExpressionStatementPtr condition,
     ExpressionStatementPtr increment, BlockPtr body) {
-  ExpressionPtr conditionExpr;
+  ExpressionPtr conditionExpr = nullptr;
   if (condition != nullptr) {
     conditionExpr = condition->expression;
   }
   if (conditionExpr == nullptr) {
-    conditionExpr = BooleanLiteral::makeTrue();
+    conditionExpr = allocate<BooleanLiteral>(true);
   }
-  ExpressionPtr incrementExpr;
+  ExpressionPtr incrementExpr = nullptr;
   if (increment != nullptr) {
     incrementExpr = increment->expression;
   }
   if (incrementExpr == nullptr) {
-    incrementExpr = NilLiteral::make();
+    incrementExpr = allocate<NilLiteral>();
   }
-  return ForStatement::make(initialization, conditionExpr, incrementExpr, body);
+  return located(allocate<ForStatement>(initialization, conditionExpr,
+                                        incrementExpr, body));
 }
 
 FunctionDeclarationPtr ASTBuilderImpl::emitDefStatement(
-    VariableExprPtr name, const std::vector<VariableExprPtr> &arguments,
-    BlockPtr body) {
-  Token nameToken(TokenType::TOKEN_IDENTIFIER, name->identifier);
-  std::vector<std::string> argumentNames;
+    const Token &name, const std::vector<Token> &arguments, BlockPtr body) {
+  std::vector<Symbol> argumentNames;
   for (const auto &arg : arguments) {
-    argumentNames.push_back(arg->identifier);
+    argumentNames.push_back(arg.symbol());
   }
-  return FunctionDeclaration::make(name->identifier, argumentNames, body);
+  return located(
+      allocate<FunctionDeclaration>(name.symbol(), argumentNames, body));
 }
 
 PrintStatementPtr ASTBuilderImpl::emitPrintStatement(ExpressionPtr expr) {
-  return PrintStatement::make(expr);
+  return located(allocate<PrintStatement>(expr));
 }
 
 ReturnStatementPtr ASTBuilderImpl::emitReturnStatement(ExpressionPtr expr) {
-  return ReturnStatement::make(expr);
+  return located(allocate<ReturnStatement>(expr));
 }
 
 BreakStatementPtr ASTBuilderImpl::emitBreakStatement() {
-  return BreakStatement::make();
+  return located(allocate<BreakStatement>());
 }
 
 ContinueStatementPtr ASTBuilderImpl::emitContinueStatement() {
-  return ContinueStatement::make();
+  return located(allocate<ContinueStatement>());
 }
 
 BlockPtr ASTBuilderImpl::emitBlock(
     const std::vector<StatementPtr> &statements) {
-  return Block::make(statements);
+  return located(allocate<Block>(statements));
 }
\ No newline at end of file
@@ -1,16 +1,20 @@
 #pragma once
 
+#include "arena.h"
 #include "ast.h"
 #include "common.h"
 #include "parser.h"
 
 class ASTBuilderImpl : public ASTBuilder {
  public:
-  ASTBuilderImpl() = default;
-  ~ASTBuilderImpl() = default;
+  ASTBuilderImpl() : arena(new Arena()) {}
+  ASTBuilderImpl(const ASTBuilderImpl &) = delete;
+  ASTBuilderImpl &operator=(const ASTBuilderImpl &) = delete;
+
+  void setLine(int line) override { currentLine = line; }
 
   ProgramPtr emitProgram(const std::vector<StatementPtr> &statements) override;
-  VarDeclarationPtr emitVarDeclaration(VariableExprPtr identifier,
+  VarDeclarationPtr emitVarDeclaration(const Token &identifier,
                                        ExpressionPtr initializer) override;
   ClassDeclarationPtr emitClassDeclaration(
       const Token &name, const std::vector<StatementPtr> &definitions) override;
@@ -43,9 +47,9 @@ class ASTBuilderImpl : public ASTBuilder {
                                    ExpressionStatementPtr condition,
                                    ExpressionStatementPtr increment,
                                    BlockPtr body) override;
-  FunctionDeclarationPtr emitDefStatement(
-      VariableExprPtr name, const std::vector<VariableExprPtr> &arguments,
-      BlockPtr body) override;
+  FunctionDeclarationPtr emitDefStatement(const Token &name,
+                                          const std::vector<Token> &arguments,
+                                          BlockPtr body) override;
   PrintStatementPtr emitPrintStatement(ExpressionPtr expr) override;
   ReturnStatementPtr emitReturnStatement(ExpressionPtr expr) override;
   BreakStatementPtr emitBreakStatement() override;
@@ -55,5 +59,29 @@ class ASTBuilderImpl : public ASTBuilder {
   ProgramPtr getProgram() const { return program; }
 
  private:
+  // holds every node of the parse until the program takes it over.
+  std::unique_ptr<Arena> arena;
   ProgramPtr program;
+  int currentLine = 0;
+  // constant pool of the program being built; identical literals share
+  // a single runtime object.
+  std::unordered_map<int64_t, Value> integerConstants;
+  std::unordered_map<std::string, Value> stringConstants;
+
+  template <typename T, typename... Args>
+  T *allocate(Args &&...args) {
+    return arena->make<T>(std::forward<Args>(args)...);
+  }
+
+  template <typename T>
+  T *located(T *node) {
+    node->line = currentLine;
+    return node;
+  }
+
+  template <typename K>
+  const Value &intern(std::unordered_map<K, Value> &pool, const K &key,
+                      const Value &value) {
+    return pool.emplace(key, value).first->second;
+  }
 };
\ No newline at end of file
@@ -0,0 +1,176 @@
+#include "chunk.h"
+
+#include "vm_object.h"
+
+void Chunk::write(uint8_t byte, size_t line) {
+  code.push_back(byte);
+  lines.write(line);
+}
+
+size_t Chunk::addConstant(ObjectPtr value) {
+  constants.push_back(value);
+  return constants.size() - 1;
+}
+
+void Chunk::disassemble(const std::string &name) {
+  std::cout << "== " << name << " ==" << std::endl;
+  for (size_t offset = 0; offset < code.size();) {
+    offset = disassembleInstruction(offset);
+  }
+}
+
+size_t Chunk::disassembleInstruction(size_t offset) {
+  std::cout << std::setfill('0') << std::setw(4) << offset << " ";
+  if (offset > 0 && getLine(offset) == getLine(offset - 1)) {
+    std::cout << "   | ";
+  } else {
+    std::cout << std::setfill(' ') << std::setw(4) << getLine(offset) << " ";
+  }
+
+  const auto instruction = static_cast<OpCode>(code[offset]);
+  switch (instruction) {
+    case OpCode::OP_CONSTANT:
+      return constantInstruction("OP_CONSTANT", offset);
+    case OpCode::OP_NIL:
+      return simpleInstruction("OP_NIL", offset);
+    case OpCode::OP_TRUE:
+      return simpleInstruction("OP_TRUE", offset);
+    case OpCode::OP_FALSE:
+      return simpleInstruction("OP_FALSE", offset);
+    case OpCode::OP_POP:
+      return simpleInstruction("OP_POP", offset);
+    case OpCode::OP_POP_COMPLETION:
+      return simpleInstruction("OP_POP_COMPLETION", offset);
+    case OpCode::OP_SET_COMPLETION:
+      return simpleInstruction("OP_SET_COMPLETION", offset);
+    case OpCode::OP_GET_LOCAL:
+      return byteInstruction("OP_GET_LOCAL", offset);
+    case OpCode::OP_SET_LOCAL:
+      return byteInstruction("OP_SET_LOCAL", offset);
+    case OpCode::OP_GET_GLOBAL:
+      return constantInstruction("OP_GET_GLOBAL", offset);
+    case OpCode::OP_DEFINE_GLOBAL:
+      return constantInstruction("OP_DEFINE_GLOBAL", offset);
+    case OpCode::OP_SET_GLOBAL:
+      return constantInstruction("OP_SET_GLOBAL", offset);
+    case OpCode::OP_GET_UPVALUE:
+      return byteInstruction("OP_GET_UPVALUE", offset);
+    case OpCode::OP_SET_UPVALUE:
+      return byteInstruction("OP_SET_UPVALUE", offset);
+    case OpCode::OP_GET_FIELD:
+      return constantInstruction("OP_GET_FIELD", offset);
+    case OpCode::OP_SET_FIELD:
+      return constantInstruction("OP_SET_FIELD", offset);
+    case OpCode::OP_GET_PROPERTY:
+      return constantInstruction("OP_GET_PROPERTY", offset);
+    case OpCode::OP_EQUAL:
+      return simpleInstruction("OP_EQUAL", offset);
+    case OpCode::OP_NOT_EQUAL:
+      return simpleInstruction("OP_NOT_EQUAL", offset);
+    case OpCode::OP_GREATER:
+      return simpleInstruction("OP_GREATER", offset);
+    case OpCode::OP_GREATER_EQUAL:
+      return simpleInstruction("OP_GREATER_EQUAL", offset);
+    case OpCode::OP_LESS:
+      return simpleInstruction("OP_LESS", offset);
+    case OpCode::OP_LESS_EQUAL:
+      return simpleInstruction("OP_LESS_EQUAL", offset);
+    case OpCode::OP_ADD:
+      return simpleInstruction("OP_ADD", offset);
+    case OpCode::OP_SUBTRACT:
+      return simpleInstruction("OP_SUBTRACT", offset);
+    case OpCode::OP_MULTIPLY:
+      return simpleInstruction("OP_MULTIPLY", offset);
+    case OpCode::OP_DIVIDE:
+      return simpleInstruction("OP_DIVIDE", offset);
+    case OpCode::OP_AND:
+      return simpleInstruction("OP_AND", offset);
+    case OpCode::OP_OR:
+      return simpleInstruction("OP_OR", offset);
+    case OpCode::OP_NOT:
+      return simpleInstruction("OP_NOT", offset);
+    case OpCode::OP_NEGATE:
+      return simpleInstruction("OP_NEGATE", offset);
+    case OpCode::OP_PRINT:
+      return simpleInstruction("OP_PRINT", offset);
+    case OpCode::OP_JUMP:
+      return jumpInstruction("OP_JUMP", 1, offset);
+    case OpCode::OP_JUMP_IF_FALSE:
+      return jumpInstruction("OP_JUMP_IF_FALSE", 1, offset);
+    case OpCode::OP_LOOP:
+      return jumpInstruction("OP_LOOP", -1, offset);
+    case OpCode::OP_CALL:
+      return byteInstruction("OP_CALL", offset);
+    case OpCode::OP_CLOSURE:
+      return closureInstruction(offset);
+    case OpCode::OP_CLOSE_UPVALUE:
+      return simpleInstruction("OP_CLOSE_UPVALUE", offset);
+    case OpCode::OP_RETURN:
+      return simpleInstruction("OP_RETURN", offset);
+    case OpCode::OP_RETURN_COMPLETION:
+      return simpleInstruction("OP_RETURN_COMPLETION", offset);
+    case OpCode::OP_ARRAY:
+      return shortInstruction("OP_ARRAY", offset);
+    case OpCode::OP_INDEX:
+      return simpleInstruction("OP_INDEX", offset);
+    case OpCode::OP_CLASS:
+      return constantInstruction("OP_CLASS", offset);
+    case OpCode::OP_METHOD:
+      return constantInstruction("OP_METHOD", offset);
+    case OpCode::OP_INITIALIZER:
+      return simpleInstruction("OP_INITIALIZER", offset);
+    default:
+      std::cout << "Unknown opcode " << (int)code[offset] << std::endl;
+      return offset + 1;
+  }
+}
+
+size_t Chunk::simpleInstruction(const char *name, size_t offset) {
+  std::cout << name << std::endl;
+  return offset + 1;
+}
+
+size_t Chunk::byteInstruction(const char *name, size_t offset) {
+  std::cout << std::left << std::setfill(' ') << std::setw(20) << name
+            << std::right << (int)code[offset + 1] << std::endl;
+  return offset + 2;
+}
+
+size_t Chunk::shortInstruction(const char *name, size_t offset) {
+  std::cout << std::left << std::setfill(' ') << std::setw(20) << name
+            << std::right << readShort(offset + 1) << std::endl;
+  return offset + 3;
+}
+
+size_t Chunk::constantInstruction(const char *name, size_t offset) {
+  const auto constant = readShort(offset + 1);
+  std::cout << std::left << std::setfill(' ') << std::setw(20) << name
+            << std::right << std::setw(4) << constant << " '"
+            << constants[constant]->toString() << "'" << std::endl;
+  return offset + 3;
+}
+
+size_t Chunk::jumpInstruction(const char *name, int sign, size_t offset) {
+  const auto jump = readShort(offset + 1);
+  std::cout << std::left << std::setfill(' ') << std::setw(20) << name
+            << std::right << std::setw(4) << offset << " -> "
+            << (int64_t)offset + 3 + sign * jump << std::endl;
+  return offset + 3;
+}
+
+size_t Chunk::closureInstruction(size_t offset) {
+  const auto constant = readShort(offset + 1);
+  offset += 3;
+  auto function = static_pointer_cast<CompiledFunction>(constants[constant]);
+  std::cout << std::left << std::setfill(' ') << std::setw(20) << "OP_CLOSURE"
+            << std::right << std::setw(4) << constant << " "
+            << function->toString() << std::endl;
+  for (int i = 0; i < function->upvalueCount; i++) {
+    const bool isLocal = code[offset++];
+    const int index = code[offset++];
+    std::cout << std::setfill('0') << std::setw(4) << offset - 2
+              << "    |                     "
+              << (isLocal ? "local" : "upvalue") << " " << index << std::endl;
+  }
+  return offset;
+}
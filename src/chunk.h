@@ -0,0 +1,88 @@
+#pragma once
+
+#include "common.h"
+#include "lineinfo.h"
+#include "object.h"
+
+enum class OpCode : uint8_t {
+  OP_CONSTANT,
+  OP_NIL,
+  OP_TRUE,
+  OP_FALSE,
+  OP_POP,
+  OP_POP_COMPLETION,
+  OP_SET_COMPLETION,
+  OP_GET_LOCAL,
+  OP_SET_LOCAL,
+  OP_GET_GLOBAL,
+  OP_DEFINE_GLOBAL,
+  OP_SET_GLOBAL,
+  OP_GET_UPVALUE,
+  OP_SET_UPVALUE,
+  OP_GET_FIELD,
+  OP_SET_FIELD,
+  OP_GET_PROPERTY,
+  OP_EQUAL,
+  OP_NOT_EQUAL,
+  OP_GREATER,
+  OP_GREATER_EQUAL,
+  OP_LESS,
+  OP_LESS_EQUAL,
+  OP_ADD,
+  OP_SUBTRACT,
+  OP_MULTIPLY,
+  OP_DIVIDE,
+  OP_AND,
+  OP_OR,
+  OP_NOT,
+  OP_NEGATE,
+  OP_PRINT,
+  OP_JUMP,
+  OP_JUMP_IF_FALSE,
+  OP_LOOP,
+  OP_CALL,
+  OP_CLOSURE,
+  OP_CLOSE_UPVALUE,
+  OP_RETURN,
+  OP_RETURN_COMPLETION,
+  OP_ARRAY,
+  OP_INDEX,
+  OP_CLASS,
+  OP_METHOD,
+  OP_INITIALIZER,
+};
+
+// Operands wider than a byte are encoded big-endian in two bytes.
+constexpr size_t UINT16_COUNT = UINT16_MAX + 1;
+
+class Chunk {
+ public:
+  std::vector<uint8_t> code;
+  std::vector<ObjectPtr> constants;
+  LineInfo lines;
+
+  Chunk() : code(), constants(), lines() {}
+
+  void write(uint8_t byte, size_t line = LINE_INFO_CONTINUE);
+  void write(OpCode opCode, size_t line = LINE_INFO_CONTINUE) {
+    write(static_cast<uint8_t>(opCode), line);
+  }
+  size_t addConstant(ObjectPtr value);
+  inline size_t getLine(size_t offset) { return lines.get(offset); }
+
+  void disassemble(const std::string &name);
+  size_t disassembleInstruction(size_t offset);
+
+ private:
+  size_t simpleInstruction(const char *name, size_t offset);
+  size_t byteInstruction(const char *name, size_t offset);
+  size_t shortInstruction(const char *name, size_t offset);
+  size_t constantInstruction(const char *name, size_t offset);
+  size_t jumpInstruction(const char *name, int sign, size_t offset);
+  size_t closureInstruction(size_t offset);
+  uint16_t readShort(size_t offset) const {
+    return static_cast<uint16_t>((code[offset] << 8) | code[offset + 1]);
+  }
+};
+
+using ChunkPtr = std::shared_ptr<Chunk>;
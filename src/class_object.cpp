@@ -15,7 +15,7 @@ bool ClassObject::isEqual(const ClassObject &other) const {
   return declaration->isEqual(*other.declaration);
 }
 
-std::shared_ptr<ClassObject> ClassObject::make(
-    ClassDeclarationPtr declaration) {
-  return std::make_shared<ClassObject>(declaration);
+Ref<ClassObject> ClassObject::make(
+    ClassDeclarationPtr declaration, EnvironmentPtr enclosingCtx) {
+  return makeRef<ClassObject>(declaration, enclosingCtx);
 }
\ No newline at end of file
@@ -7,11 +7,21 @@
 
 struct ClassObject : public Object {
   ClassDeclarationPtr declaration;
+  // scope the class was declared in, enclosing every record.
+  EnvironmentPtr enclosingCtx;
+  // unbound, in the order of declaration->methods, built once and shared
+  // by all records, which find them by Shape::findMethod.
+  std::vector<FunctionPtr> methods;
+  FunctionPtr ctor;
 
-  ClassObject(ClassDeclarationPtr declaration)
-      : Object(ObjectType::OBJ_CLASS), declaration(declaration) {}
+  ClassObject(ClassDeclarationPtr declaration, EnvironmentPtr enclosingCtx)
+      : Object(ObjectType::OBJ_CLASS),
+        declaration(declaration),
+        enclosingCtx(enclosingCtx),
+        methods(),
+        ctor() {}
 
-  std::string toString() const override { return "<class " + declaration->identifier + ">"; }
+  std::string toString() const override { return "<class " + declaration->identifier.str() + ">"; }
 
   bool isFalsey() const override { return false; }
   bool isTruthy() const override { return true; }
@@ -19,6 +29,7 @@ struct ClassObject : public Object {
   bool isEqual(const Object &obj) const override;
   bool isEqual(const ClassObject &other) const;
 
-  static std::shared_ptr<ClassObject> make(ClassDeclarationPtr declaration);
+  static Ref<ClassObject> make(ClassDeclarationPtr declaration,
+                               EnvironmentPtr enclosingCtx);
 };
-using ClassObjectPtr = std::shared_ptr<ClassObject>;
\ No newline at end of file
+using ClassObjectPtr = Ref<ClassObject>;
\ No newline at end of file
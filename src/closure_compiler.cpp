@@ -0,0 +1,918 @@
+#include "closure_compiler.h"
+
+#include "compiler.h"
+
+namespace {
+
+using Statements = std::vector<ExecStatementPtr>;
+
+int64_t integerValue(const ObjectPtr& value) {
+  if (value->Type != ObjectType::OBJ_INTEGER) {
+    std::ostringstream ss;
+    ss << "Cannot convert object to integer: " << value->toString();
+    throw RuntimeError::make(__FILE__, __LINE__, ss.str());
+  }
+  return static_cast<const IntegerObject&>(*value).Value;
+}
+
+ObjectPtr boolean(bool value) {
+  return value ? TRUE_OBJECT_PTR : FALSE_OBJECT_PTR;
+}
+
+// calls in progress, each of them recursing on the native stack.
+int callDepth = 0;
+
+ObjectPtr invoke(const FunctionCode& code, const ActivationPtr& frame) {
+  const auto maxCallDepth = Settings::getInstance()->getMaxCallDepth();
+  if (callDepth >= maxCallDepth || NativeStack::isExhausted()) {
+    std::ostringstream ss;
+    ss << "Stack overflow: " << callDepth << " nested calls";
+    throw RuntimeError::make(__FILE__, __LINE__, ss.str());
+  }
+  struct DepthGuard {
+    DepthGuard() { callDepth++; }
+    ~DepthGuard() { callDepth--; }
+  } guard;
+  ObjectPtr value = NULL_OBJECT_PTR;
+  code.body->exec(frame, value);
+  return value;
+}
+
+// Expressions
+
+struct ConstantNode : public ExecExpression {
+  ObjectPtr value;
+
+  ConstantNode(ObjectPtr value) : value(std::move(value)) {}
+  ObjectPtr eval(const ActivationPtr& act) override { return value; }
+};
+
+struct LocalGetNode : public ExecExpression {
+  size_t slot;
+
+  LocalGetNode(size_t slot) : slot(slot) {}
+  ObjectPtr eval(const ActivationPtr& act) override {
+    return act->slots[slot];
+  }
+};
+
+struct OuterGetNode : public ExecExpression {
+  size_t hops;
+  size_t slot;
+
+  OuterGetNode(size_t hops, size_t slot) : hops(hops), slot(slot) {}
+  ObjectPtr eval(const ActivationPtr& act) override {
+    auto* frame = act.get();
+    for (size_t i = 0; i < hops; i++) frame = frame->parent.get();
+    return frame->slots[slot];
+  }
+};
+
+struct GlobalGetNode : public ExecExpression {
+  ObjectPtr* cell;
+
+  GlobalGetNode(ObjectPtr* cell) : cell(cell) {}
+  ObjectPtr eval(const ActivationPtr& act) override { return *cell; }
+};
+
+struct LocalSetNode : public ExecExpression {
+  size_t slot;
+  ExecExpressionPtr value;
+
+  LocalSetNode(size_t slot, ExecExpressionPtr value)
+      : slot(slot), value(std::move(value)) {}
+  ObjectPtr eval(const ActivationPtr& act) override {
+    return act->slots[slot] = value->eval(act);
+  }
+};
+
+struct OuterSetNode : public ExecExpression {
+  size_t hops;
+  size_t slot;
+  ExecExpressionPtr value;
+
+  OuterSetNode(size_t hops, size_t slot, ExecExpressionPtr value)
+      : hops(hops), slot(slot), value(std::move(value)) {}
+  ObjectPtr eval(const ActivationPtr& act) override {
+    auto result = value->eval(act);
+    auto* frame = act.get();
+    for (size_t i = 0; i < hops; i++) frame = frame->parent.get();
+    return frame->slots[slot] = result;
+  }
+};
+
+struct GlobalSetNode : public ExecExpression {
+  ObjectPtr* cell;
+  ExecExpressionPtr value;
+
+  GlobalSetNode(ObjectPtr* cell, ExecExpressionPtr value)
+      : cell(cell), value(std::move(value)) {}
+  ObjectPtr eval(const ActivationPtr& act) override {
+    return *cell = value->eval(act);
+  }
+};
+
+struct Add {
+  static int64_t apply(int64_t lhs, int64_t rhs) { return lhs + rhs; }
+};
+struct Subtract {
+  static int64_t apply(int64_t lhs, int64_t rhs) { return lhs - rhs; }
+};
+struct Multiply {
+  static int64_t apply(int64_t lhs, int64_t rhs) { return lhs * rhs; }
+};
+struct Divide {
+  static int64_t apply(int64_t lhs, int64_t rhs) {
+    if (rhs == 0) {
+      throw RuntimeError::make(__FILE__, __LINE__, "Division by zero");
+    }
+    return lhs / rhs;
+  }
+};
+
+template <typename Op>
+struct ArithmeticNode : public ExecExpression {
+  ExecExpressionPtr left;
+  ExecExpressionPtr right;
+
+  ArithmeticNode(ExecExpressionPtr left, ExecExpressionPtr right)
+      : left(std::move(left)), right(std::move(right)) {}
+  ObjectPtr eval(const ActivationPtr& act) override {
+    auto lhs = left->eval(act);
+    auto rhs = right->eval(act);
+    if (lhs->Type != ObjectType::OBJ_INTEGER ||
+        rhs->Type != ObjectType::OBJ_INTEGER) {
+      std::ostringstream ss;
+      ss << "Invalid binary operands: " << lhs->toString() << " and "
+         << rhs->toString();
+      throw RuntimeError::make(__FILE__, __LINE__, ss.str());
+    }
+    return IntegerObject::make(
+        Op::apply(static_cast<const IntegerObject&>(*lhs).Value,
+                  static_cast<const IntegerObject&>(*rhs).Value));
+  }
+};
+
+template <typename Compare>
+struct ComparisonNode : public ExecExpression {
+  ExecExpressionPtr left;
+  ExecExpressionPtr right;
+
+  ComparisonNode(ExecExpressionPtr left, ExecExpressionPtr right)
+      : left(std::move(left)), right(std::move(right)) {}
+  ObjectPtr eval(const ActivationPtr& act) override {
+    auto lhs = left->eval(act);
+    auto rhs = right->eval(act);
+    return boolean(Compare()(integerValue(lhs), integerValue(rhs)));
+  }
+};
+
+template <bool Negate>
+struct EqualityNode : public ExecExpression {
+  ExecExpressionPtr left;
+  ExecExpressionPtr right;
+
+  EqualityNode(ExecExpressionPtr left, ExecExpressionPtr right)
+      : left(std::move(left)), right(std::move(right)) {}
+  ObjectPtr eval(const ActivationPtr& act) override {
+    auto lhs = left->eval(act);
+    auto rhs = right->eval(act);
+    return boolean(lhs->isEqual(*rhs) != Negate);
+  }
+};
+
+// both operands are always evaluated, as in the evaluator.
+template <typename Logic>
+struct LogicNode : public ExecExpression {
+  ExecExpressionPtr left;
+  ExecExpressionPtr right;
+
+  LogicNode(ExecExpressionPtr left, ExecExpressionPtr right)
+      : left(std::move(left)), right(std::move(right)) {}
+  ObjectPtr eval(const ActivationPtr& act) override {
+    const bool lhs = left->eval(act)->isTruthy();
+    const bool rhs = right->eval(act)->isTruthy();
+    return boolean(Logic()(lhs, rhs));
+  }
+};
+
+struct NegateNode : public ExecExpression {
+  ExecExpressionPtr right;
+
+  NegateNode(ExecExpressionPtr right) : right(std::move(right)) {}
+  ObjectPtr eval(const ActivationPtr& act) override {
+    return IntegerObject::make(-integerValue(right->eval(act)));
+  }
+};
+
+struct NotNode : public ExecExpression {
+  ExecExpressionPtr right;
+
+  NotNode(ExecExpressionPtr right) : right(std::move(right)) {}
+  ObjectPtr eval(const ActivationPtr& act) override {
+    return boolean(!right->eval(act)->isTruthy());
+  }
+};
+
+struct ArrayNode : public ExecExpression {
+  std::vector<ExecExpressionPtr> elements;
+
+  ArrayNode(std::vector<ExecExpressionPtr> elements)
+      : elements(std::move(elements)) {}
+  ObjectPtr eval(const ActivationPtr& act) override {
+    auto array = makeRef<ArrayObject>();
+    array->Values.reserve(elements.size());
+    for (const auto& element : elements) {
+      array->Values.push_back(element->eval(act));
+    }
+    return array;
+  }
+};
+
+struct SubscriptNode : public ExecExpression {
+  ExecExpressionPtr array;
+  ExecExpressionPtr index;
+
+  SubscriptNode(ExecExpressionPtr array, ExecExpressionPtr index)
+      : array(std::move(array)), index(std::move(index)) {}
+  ObjectPtr eval(const ActivationPtr& act) override {
+    auto arrayValue = array->eval(act);
+    auto indexValue = index->eval(act);
+    if (arrayValue->Type != ObjectType::OBJ_ARRAY) {
+      std::ostringstream ss;
+      ss << "Invalid array: " << arrayValue->toString();
+      throw RuntimeError::make(__FILE__, __LINE__, ss.str());
+    }
+    if (indexValue->Type != ObjectType::OBJ_INTEGER) {
+      std::ostringstream ss;
+      ss << "Invalid index: " << indexValue->toString();
+      throw RuntimeError::make(__FILE__, __LINE__, ss.str());
+    }
+    const auto& values = static_cast<const ArrayObject&>(*arrayValue).Values;
+    const auto i = static_cast<const IntegerObject&>(*indexValue).Value;
+    if (i < 0 || static_cast<size_t>(i) >= values.size()) {
+      std::ostringstream ss;
+      ss << "Index out of range: " << i;
+      throw RuntimeError::make(__FILE__, __LINE__, ss.str());
+    }
+    return values[i].toObject();
+  }
+};
+
+struct CallNode : public ExecExpression {
+  ExecExpressionPtr callee;
+  std::vector<ExecExpressionPtr> arguments;
+
+  CallNode(ExecExpressionPtr callee, std::vector<ExecExpressionPtr> arguments)
+      : callee(std::move(callee)), arguments(std::move(arguments)) {}
+
+  ObjectPtr eval(const ActivationPtr& act) override {
+    auto value = callee->eval(act);
+    switch (value->Type) {
+      case ObjectType::OBJ_EXEC_FUNCTION: {
+        const auto& function = static_cast<const ExecFunction&>(*value);
+        return invoke(*function.code,
+                      bindArguments(*function.code, function.closure, act));
+      }
+      case ObjectType::OBJ_EXEC_CLASS:
+        return instantiate(static_pointer_cast<ExecClass>(value), act);
+      default:
+        std::ostringstream ss;
+        ss << "Invalid callable: " << value->toString();
+        throw RuntimeError::make(__FILE__, __LINE__, ss.str());
+    }
+  }
+
+  ActivationPtr bindArguments(const FunctionCode& code,
+                              const ActivationPtr& closure,
+                              const ActivationPtr& act) {
+    if (arguments.size() != static_cast<size_t>(code.arity)) {
+      std::ostringstream ss;
+      ss << "Expected " << code.arity << " arguments but got "
+         << arguments.size() << ".";
+      throw RuntimeError::make(__FILE__, __LINE__, ss.str());
+    }
+    auto frame = Activation::make(code.frameSize, closure);
+    for (size_t i = 0; i < arguments.size(); i++) {
+      frame->slots[i] = arguments[i]->eval(act);
+    }
+    return frame;
+  }
+
+  ObjectPtr instantiate(const ExecClassPtr& klass, const ActivationPtr& act) {
+    const auto& code = *klass->code;
+    auto ctx = Activation::make(code.frameSize, klass->closure);
+    auto record = ExecRecord::make(klass, ctx);
+    ctx->slots[0] = record;
+    for (const auto& [slot, initializer] : code.fields) {
+      ctx->slots[slot] = initializer ? initializer->eval(ctx) : NULL_OBJECT_PTR;
+    }
+    for (const auto& [slot, method] : code.methods) {
+      ctx->slots[slot] = ExecFunction::make(method, ctx);
+    }
+    // the ctor runs once per record and its result is discarded.
+    if (code.ctor) {
+      invoke(*code.ctor, bindArguments(*code.ctor, ctx, act));
+    }
+    return record;
+  }
+};
+
+struct MemberNode : public ExecExpression {
+  ExecExpressionPtr object;
+  Symbol member;
+
+  MemberNode(ExecExpressionPtr object, Symbol member)
+      : object(std::move(object)), member(member) {}
+  ObjectPtr eval(const ActivationPtr& act) override {
+    auto value = object->eval(act);
+    if (value->Type != ObjectType::OBJ_EXEC_RECORD) {
+      std::ostringstream ss;
+      ss << "Invalid member expression: " << value->toString() << "."
+         << member;
+      throw RuntimeError::make(__FILE__, __LINE__, ss.str());
+    }
+    // only methods are reachable from outside the record.
+    const auto& record = static_cast<const ExecRecord&>(*value);
+    const auto& methodSlots = record.klass->code->methodSlots;
+    const auto it = methodSlots.find(member);
+    if (it == methodSlots.end()) {
+      return NULL_OBJECT_PTR;
+    }
+    return record.ctx->slots[it->second];
+  }
+};
+
+// Statements
+
+struct ExpressionNode : public ExecStatement {
+  ExecExpressionPtr expression;
+
+  ExpressionNode(ExecExpressionPtr expression)
+      : expression(std::move(expression)) {}
+  Completion exec(const ActivationPtr& act, ObjectPtr& value) override {
+    value = expression->eval(act);
+    return Completion::NORMAL;
+  }
+};
+
+struct PrintNode : public ExecStatement {
+  ExecExpressionPtr expression;
+
+  PrintNode(ExecExpressionPtr expression) : expression(std::move(expression)) {}
+  Completion exec(const ActivationPtr& act, ObjectPtr& value) override {
+    value = expression->eval(act);
+    std::cout << value->toString() << std::endl;
+    return Completion::NORMAL;
+  }
+};
+
+struct FunctionNode : public ExecStatement {
+  FunctionCodePtr code;
+  // either a local slot or a global cell receives the function.
+  size_t slot;
+  ObjectPtr* cell;
+
+  FunctionNode(FunctionCodePtr code, size_t slot, ObjectPtr* cell)
+      : code(std::move(code)), slot(slot), cell(cell) {}
+  Completion exec(const ActivationPtr& act, ObjectPtr& value) override {
+    value = ExecFunction::make(code, act);
+    if (cell) {
+      *cell = value;
+    } else {
+      act->slots[slot] = value;
+    }
+    return Completion::NORMAL;
+  }
+};
+
+struct ClassNode : public ExecStatement {
+  ClassCodePtr code;
+  ObjectPtr* cell;
+
+  ClassNode(ClassCodePtr code, ObjectPtr* cell)
+      : code(std::move(code)), cell(cell) {}
+  Completion exec(const ActivationPtr& act, ObjectPtr& value) override {
+    value = *cell = ExecClass::make(code, act);
+    return Completion::NORMAL;
+  }
+};
+
+struct BlockNode : public ExecStatement {
+  Statements statements;
+
+  BlockNode(Statements statements) : statements(std::move(statements)) {}
+  Completion exec(const ActivationPtr& act, ObjectPtr& value) override {
+    value = NULL_OBJECT_PTR;
+    for (const auto& stmt : statements) {
+      const auto completion = stmt->exec(act, value);
+      if (completion != Completion::NORMAL) {
+        return completion;
+      }
+    }
+    return Completion::NORMAL;
+  }
+};
+
+struct IfNode : public ExecStatement {
+  ExecExpressionPtr condition;
+  ExecStatementPtr thenBranch;
+  ExecStatementPtr elseBranch;
+
+  IfNode(ExecExpressionPtr condition, ExecStatementPtr thenBranch,
+         ExecStatementPtr elseBranch)
+      : condition(std::move(condition)),
+        thenBranch(std::move(thenBranch)),
+        elseBranch(std::move(elseBranch)) {}
+  Completion exec(const ActivationPtr& act, ObjectPtr& value) override {
+    if (condition->eval(act)->isTruthy()) {
+      return thenBranch->exec(act, value);
+    } else if (elseBranch) {
+      return elseBranch->exec(act, value);
+    }
+    value = FALSE_OBJECT_PTR;
+    return Completion::NORMAL;
+  }
+};
+
+struct WhileNode : public ExecStatement {
+  ExecExpressionPtr condition;
+  ExecStatementPtr body;
+
+  WhileNode(ExecExpressionPtr condition, ExecStatementPtr body)
+      : condition(std::move(condition)), body(std::move(body)) {}
+  Completion exec(const ActivationPtr& act, ObjectPtr& value) override {
+    value = condition->eval(act);
+    while (value->isTruthy()) {
+      const auto completion = body->exec(act, value);
+      if (completion == Completion::RETURN) {
+        return completion;
+      } else if (completion == Completion::BREAK) {
+        value = NULL_OBJECT_PTR;
+        return Completion::NORMAL;
+      }
+      value = condition->eval(act);
+    }
+    return Completion::NORMAL;
+  }
+};
+
+struct ForNode : public ExecStatement {
+  ExecStatementPtr initializer;
+  ExecExpressionPtr condition;
+  ExecExpressionPtr increment;
+  ExecStatementPtr body;
+
+  ForNode(ExecStatementPtr initializer, ExecExpressionPtr condition,
+          ExecExpressionPtr increment, ExecStatementPtr body)
+      : initializer(std::move(initializer)),
+        condition(std::move(condition)),
+        increment(std::move(increment)),
+        body(std::move(body)) {}
+  Completion exec(const ActivationPtr& act, ObjectPtr& value) override {
+    if (initializer) {
+      initializer->exec(act, value);
+    }
+    while (true) {
+      value = condition->eval(act);
+      if (value->isFalsey()) {
+        break;
+      }
+      const auto completion = body->exec(act, value);
+      if (completion == Completion::RETURN) {
+        return completion;
+      } else if (completion == Completion::BREAK) {
+        value = NULL_OBJECT_PTR;
+        return Completion::NORMAL;
+      }
+      if (increment) {
+        value = increment->eval(act);
+      }
+    }
+    return Completion::NORMAL;
+  }
+};
+
+struct ReturnNode : public ExecStatement {
+  ExecExpressionPtr expression;
+
+  ReturnNode(ExecExpressionPtr expression)
+      : expression(std::move(expression)) {}
+  Completion exec(const ActivationPtr& act, ObjectPtr& value) override {
+    value = expression ? expression->eval(act) : NULL_OBJECT_PTR;
+    return Completion::RETURN;
+  }
+};
+
+template <Completion Jump>
+struct JumpNode : public ExecStatement {
+  Completion exec(const ActivationPtr& act, ObjectPtr& value) override {
+    return Jump;
+  }
+};
+
+struct EmptyNode : public ExecStatement {
+  Completion exec(const ActivationPtr& act, ObjectPtr& value) override {
+    value = NULL_OBJECT_PTR;
+    return Completion::NORMAL;
+  }
+};
+
+}  // namespace
+
+std::string ExecFunction::toString() const {
+  std::ostringstream ss;
+  ss << "<func " << code->name << "(#" << code->arity << ")>";
+  return ss.str();
+}
+
+ObjectPtr ClosureCompiler::interpret(ProgramPtr program) {
+  Scope script{nullptr, {}, 0, 0, 0};
+  current = &script;
+  Statements statements;
+  for (const auto& stmt : program->statements) {
+    statements.push_back(compileStatement(stmt));
+  }
+  current = nullptr;
+
+  const auto maxCallDepth = Settings::getInstance()->getMaxCallDepth();
+  const auto stackSize = static_cast<size_t>(std::max(maxCallDepth, 0)) *
+                         Evaluator::NATIVE_FRAME_SIZE;
+  if (nativeStack == nullptr || nativeStack->getSize() != stackSize) {
+    nativeStack = std::make_unique<NativeStack>(stackSize);
+  }
+  auto act = Activation::make(script.frameSize, nullptr);
+  ObjectPtr value = NULL_OBJECT_PTR;
+  nativeStack->run([&]() {
+    for (const auto& stmt : statements) {
+      if (stmt->exec(act, value) == Completion::RETURN) {
+        break;
+      }
+    }
+  });
+  return value;
+}
+
+ObjectPtr ClosureCompiler::getGlobalValue(Symbol identifier) const {
+  const auto it = globals.find(identifier);
+  if (it == globals.end()) {
+    return NULL_OBJECT_PTR;
+  }
+  return it->second;
+}
+
+FunctionCodePtr ClosureCompiler::compileFunction(FunctionDeclarationPtr decl,
+                                                 FunctionType type) {
+  Scope scope{current, {}, 0, 0, 0};
+  current = &scope;
+  for (const auto& param : decl->params) {
+    declareLocal(param);
+  }
+  auto code = std::make_shared<FunctionCode>();
+  code->name = decl->identifier;
+  code->functionType = type;
+  code->arity = decl->params.size();
+  code->body = compileStatement(decl->body);
+  code->frameSize = scope.frameSize;
+  current = scope.enclosing;
+  return code;
+}
+
+ClassCodePtr ClosureCompiler::compileClass(ClassDeclarationPtr decl) {
+  Scope scope{current, {}, 0, 0, 0};
+  current = &scope;
+  auto code = std::make_shared<ClassCode>();
+  code->name = decl->identifier;
+  declareLocal("self");
+  for (const auto& field : decl->fields) {
+    auto initializer =
+        field->initializer ? compileExpression(field->initializer) : nullptr;
+    code->fields.emplace_back(declareLocal(field->identifier),
+                              std::move(initializer));
+  }
+  // all methods are declared before compiling them, so they can call each
+  // other.
+  for (const auto& method : decl->methods) {
+    code->methodSlots[method->identifier] = declareLocal(method->identifier);
+  }
+  for (const auto& method : decl->methods) {
+    code->methods.emplace_back(
+        code->methodSlots[method->identifier],
+        compileFunction(method, FunctionType::TYPE_METHOD));
+  }
+  if (decl->ctor) {
+    code->ctor = compileFunction(decl->ctor, FunctionType::TYPE_INITIALIZER);
+  }
+  code->frameSize = scope.frameSize;
+  current = scope.enclosing;
+  return code;
+}
+
+ExecStatementPtr ClosureCompiler::compileStatement(StatementPtr stmt) {
+  switch (stmt->Type) {
+    case NodeType::EXPRESSION_STATEMENT: {
+      auto exprStmt = static_cast<ExpressionStatement*>(stmt);
+      return std::make_unique<ExpressionNode>(
+          compileExpression(exprStmt->expression));
+    }
+    case NodeType::VAR_DECLARATION:
+      return compileVarDeclaration(static_cast<VarDeclaration*>(stmt));
+    case NodeType::FUNCTION_DECLARATION: {
+      auto funcDecl = static_cast<FunctionDeclaration*>(stmt);
+      if (current->enclosing == nullptr && current->depth == 0) {
+        auto code = compileFunction(funcDecl, FunctionType::TYPE_FUNCTION);
+        return std::make_unique<FunctionNode>(
+            code, 0, globalCell(funcDecl->identifier));
+      }
+      // declared before the body so that local functions can recurse.
+      const auto slot = declareLocal(funcDecl->identifier);
+      auto code = compileFunction(funcDecl, FunctionType::TYPE_FUNCTION);
+      return std::make_unique<FunctionNode>(code, slot, nullptr);
+    }
+    case NodeType::CLASS_DECLARATION: {
+      auto classDecl = static_cast<ClassDeclaration*>(stmt);
+      // classes live in the global scope, as in the evaluator.
+      return std::make_unique<ClassNode>(compileClass(classDecl),
+                                         globalCell(classDecl->identifier));
+    }
+    case NodeType::BLOCK_STATEMENT:
+      return compileBlock(static_cast<Block*>(stmt));
+    case NodeType::IF_STATEMENT: {
+      auto ifStmt = static_cast<IfStatement*>(stmt);
+      auto condition = compileExpression(ifStmt->condition);
+      auto thenBranch = compileStatement(ifStmt->thenBranch);
+      auto elseBranch =
+          ifStmt->elseBranch ? compileStatement(ifStmt->elseBranch) : nullptr;
+      return std::make_unique<IfNode>(std::move(condition),
+                                      std::move(thenBranch),
+                                      std::move(elseBranch));
+    }
+    case NodeType::FOR_STATEMENT:
+      return compileFor(static_cast<ForStatement*>(stmt));
+    case NodeType::WHILE_STATEMENT: {
+      auto whileStmt = static_cast<WhileStatement*>(stmt);
+      auto condition = compileExpression(whileStmt->condition);
+      current->loops++;
+      auto body = compileStatement(whileStmt->body);
+      current->loops--;
+      return std::make_unique<WhileNode>(std::move(condition),
+                                         std::move(body));
+    }
+    case NodeType::PRINT_STATEMENT: {
+      auto printStmt = static_cast<PrintStatement*>(stmt);
+      return std::make_unique<PrintNode>(
+          compileExpression(printStmt->expression));
+    }
+    case NodeType::RETURN_STATEMENT: {
+      auto returnStmt = static_cast<ReturnStatement*>(stmt);
+      return std::make_unique<ReturnNode>(
+          returnStmt->expression ? compileExpression(returnStmt->expression)
+                                 : nullptr);
+    }
+    case NodeType::BREAK_STATEMENT:
+    case NodeType::CONTINUE_STATEMENT: {
+      const bool isBreak = stmt->Type == NodeType::BREAK_STATEMENT;
+      if (current->loops == 0) {
+        std::ostringstream ss;
+        ss << "Can't use '" << (isBreak ? "break" : "continue")
+           << "' outside of a loop.";
+        throw CompileError::make(stmt->line, ss.str());
+      }
+      if (isBreak) {
+        return std::make_unique<JumpNode<Completion::BREAK>>();
+      }
+      return std::make_unique<JumpNode<Completion::CONTINUE>>();
+    }
+    case NodeType::EMPTY_STATEMENT:
+    default:
+      return std::make_unique<EmptyNode>();
+  }
+}
+
+ExecStatementPtr ClosureCompiler::compileVarDeclaration(
+    VarDeclarationPtr stmt) {
+  auto initializer = stmt->initializer
+                         ? compileExpression(stmt->initializer)
+                         : std::make_unique<ConstantNode>(NULL_OBJECT_PTR);
+  // the initializer is compiled first: `var a = a;` reads the outer `a`.
+  ExecExpressionPtr assignment;
+  if (current->enclosing == nullptr && current->depth == 0) {
+    assignment = std::make_unique<GlobalSetNode>(globalCell(stmt->identifier),
+                                                 std::move(initializer));
+  } else {
+    assignment = std::make_unique<LocalSetNode>(declareLocal(stmt->identifier),
+                                                std::move(initializer));
+  }
+  return std::make_unique<ExpressionNode>(std::move(assignment));
+}
+
+ExecStatementPtr ClosureCompiler::compileBlock(BlockPtr stmt) {
+  beginBlock();
+  Statements statements;
+  for (const auto& innerStmt : stmt->statements) {
+    statements.push_back(compileStatement(innerStmt));
+  }
+  endBlock();
+  return std::make_unique<BlockNode>(std::move(statements));
+}
+
+ExecStatementPtr ClosureCompiler::compileFor(ForStatementPtr stmt) {
+  beginBlock();
+  auto initializer =
+      stmt->initializer ? compileStatement(stmt->initializer) : nullptr;
+  auto condition = stmt->condition
+                       ? compileExpression(stmt->condition)
+                       : std::make_unique<ConstantNode>(TRUE_OBJECT_PTR);
+  auto increment =
+      stmt->increment ? compileExpression(stmt->increment) : nullptr;
+  current->loops++;
+  auto body = compileStatement(stmt->body);
+  current->loops--;
+  endBlock();
+  return std::make_unique<ForNode>(std::move(initializer), std::move(condition),
+                                   std::move(increment), std::move(body));
+}
+
+ExecExpressionPtr ClosureCompiler::compileExpression(ExpressionPtr expr) {
+  switch (expr->Type) {
+    case NodeType::INTEGER_LITERAL: {
+      auto intExpr = static_cast<IntegerLiteral*>(expr);
+      return std::make_unique<ConstantNode>(
+          IntegerObject::make(intExpr->Value));
+    }
+    case NodeType::BOOLEAN_LITERAL: {
+      auto boolExpr = static_cast<BooleanLiteral*>(expr);
+      return std::make_unique<ConstantNode>(boolean(boolExpr->Value));
+    }
+    case NodeType::STRING_LITERAL: {
+      auto stringExpr = static_cast<StringLiteral*>(expr);
+      return std::make_unique<ConstantNode>(
+          makeRef<StringObject>(stringExpr->Value));
+    }
+    case NodeType::ARRAY_LITERAL: {
+      auto arrayExpr = static_cast<ArrayLiteral*>(expr);
+      std::vector<ExecExpressionPtr> elements;
+      for (const auto& element : arrayExpr->elements) {
+        elements.push_back(compileExpression(element));
+      }
+      return std::make_unique<ArrayNode>(std::move(elements));
+    }
+    case NodeType::ARRAY_SUBSCRIPT_EXPRESSION: {
+      auto subscriptExpr = static_cast<ArraySubscriptExpr*>(expr);
+      return std::make_unique<SubscriptNode>(
+          compileExpression(subscriptExpr->array),
+          compileExpression(subscriptExpr->index));
+    }
+    case NodeType::UNARY_EXPRESSION: {
+      auto unaryExpr = static_cast<UnaryExpr*>(expr);
+      auto right = compileExpression(unaryExpr->right);
+      switch (unaryExpr->operator_.type) {
+        case TokenType::TOKEN_MINUS:
+          return std::make_unique<NegateNode>(std::move(right));
+        case TokenType::TOKEN_BANG:
+          return std::make_unique<NotNode>(std::move(right));
+        default:
+          std::ostringstream ss;
+          ss << "Invalid unary operator type: "
+             << unaryExpr->operator_.lexeme();
+          throw CompileError::make(expr->line, ss.str());
+      }
+    }
+    case NodeType::BINARY_EXPRESSION:
+      return compileBinary(static_cast<BinaryExpr*>(expr));
+    case NodeType::VARIABLE_EXPRESSION: {
+      auto varExpr = static_cast<VariableExpr*>(expr);
+      return compileVariable(varExpr->identifier);
+    }
+    case NodeType::ASSIGNMENT_EXPRESSION:
+      return compileAssignment(static_cast<Assignment*>(expr));
+    case NodeType::CALL_EXPRESSION: {
+      auto callExpr = static_cast<CallExpr*>(expr);
+      auto callee = compileExpression(callExpr->left);
+      std::vector<ExecExpressionPtr> arguments;
+      for (const auto& argument : callExpr->arguments) {
+        arguments.push_back(compileExpression(argument));
+      }
+      return std::make_unique<CallNode>(std::move(callee),
+                                        std::move(arguments));
+    }
+    case NodeType::MEMBER_EXPRESSION: {
+      auto memberExpr = static_cast<MemberExpr*>(expr);
+      return std::make_unique<MemberNode>(compileExpression(memberExpr->left),
+                                          memberExpr->member);
+    }
+    case NodeType::NIL_LITERAL:
+    default:
+      return std::make_unique<ConstantNode>(NULL_OBJECT_PTR);
+  }
+}
+
+ExecExpressionPtr ClosureCompiler::compileBinary(BinaryExprPtr expr) {
+  auto left = compileExpression(expr->left);
+  auto right = compileExpression(expr->right);
+  switch (expr->operator_.type) {
+    case TokenType::TOKEN_PLUS:
+      return std::make_unique<ArithmeticNode<Add>>(std::move(left),
+                                                   std::move(right));
+    case TokenType::TOKEN_MINUS:
+      return std::make_unique<ArithmeticNode<Subtract>>(std::move(left),
+                                                        std::move(right));
+    case TokenType::TOKEN_STAR:
+      return std::make_unique<ArithmeticNode<Multiply>>(std::move(left),
+                                                        std::move(right));
+    case TokenType::TOKEN_SLASH:
+      return std::make_unique<ArithmeticNode<Divide>>(std::move(left),
+                                                      std::move(right));
+    case TokenType::TOKEN_AND:
+      return std::make_unique<LogicNode<std::logical_and<bool>>>(
+          std::move(left), std::move(right));
+    case TokenType::TOKEN_OR:
+      return std::make_unique<LogicNode<std::logical_or<bool>>>(
+          std::move(left), std::move(right));
+    case TokenType::TOKEN_EQUAL_EQUAL:
+      return std::make_unique<EqualityNode<false>>(std::move(left),
+                                                   std::move(right));
+    case TokenType::TOKEN_BANG_EQUAL:
+      return std::make_unique<EqualityNode<true>>(std::move(left),
+                                                  std::move(right));
+    case TokenType::TOKEN_LESS:
+      return std::make_unique<ComparisonNode<std::less<int64_t>>>(
+          std::move(left), std::move(right));
+    case TokenType::TOKEN_LESS_EQUAL:
+      return std::make_unique<ComparisonNode<std::less_equal<int64_t>>>(
+          std::move(left), std::move(right));
+    case TokenType::TOKEN_GREATER:
+      return std::make_unique<ComparisonNode<std::greater<int64_t>>>(
+          std::move(left), std::move(right));
+    case TokenType::TOKEN_GREATER_EQUAL:
+      return std::make_unique<ComparisonNode<std::greater_equal<int64_t>>>(
+          std::move(left), std::move(right));
+    default:
+      std::ostringstream ss;
+      ss << "Invalid binary operator type: " << (int)expr->operator_.type;
+      throw CompileError::make(expr->line, ss.str());
+  }
+}
+
+ExecExpressionPtr ClosureCompiler::compileVariable(Symbol name) {
+  size_t hops, slot;
+  if (!resolve(name, hops, slot)) {
+    return std::make_unique<GlobalGetNode>(globalCell(name));
+  } else if (hops == 0) {
+    return std::make_unique<LocalGetNode>(slot);
+  }
+  return std::make_unique<OuterGetNode>(hops, slot);
+}
+
+ExecExpressionPtr ClosureCompiler::compileAssignment(AssignmentPtr expr) {
+  auto value = compileExpression(expr->value);
+  size_t hops, slot;
+  if (!resolve(expr->identifier, hops, slot)) {
+    // like the evaluator, assigning an undeclared name declares a global.
+    return std::make_unique<GlobalSetNode>(globalCell(expr->identifier),
+                                           std::move(value));
+  } else if (hops == 0) {
+    return std::make_unique<LocalSetNode>(slot, std::move(value));
+  }
+  return std::make_unique<OuterSetNode>(hops, slot, std::move(value));
+}
+
+size_t ClosureCompiler::declareLocal(Symbol name) {
+  // like the evaluator, redeclaring a name in the same block overwrites it.
+  for (auto it = current->locals.rbegin(); it != current->locals.rend();
+       it++) {
+    if (it->depth < current->depth) break;
+    if (it->name == name) return it->slot;
+  }
+  const auto slot = current->frameSize++;
+  current->locals.push_back(Local{name, current->depth, slot});
+  return slot;
+}
+
+void ClosureCompiler::endBlock() {
+  current->depth--;
+  // slots are not reused: closures may still reach them.
+  auto& locals = current->locals;
+  while (!locals.empty() && locals.back().depth > current->depth) {
+    locals.pop_back();
+  }
+}
+
+ObjectPtr* ClosureCompiler::globalCell(Symbol name) {
+  return &globals.try_emplace(name, NULL_OBJECT_PTR).first->second;
+}
+
+bool ClosureCompiler::resolve(Symbol name, size_t& hops,
+                              size_t& slot) const {
+  hops = 0;
+  for (auto* scope = current; scope != nullptr; scope = scope->enclosing) {
+    for (auto it = scope->locals.rbegin(); it != scope->locals.rend(); it++) {
+      if (it->name == name) {
+        slot = it->slot;
+        return true;
+      }
+    }
+    hops++;
+  }
+  return false;
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include "ast.h"
+#include "common.h"
+#include "evaluator.h"
+#include "function.h"
+#include "object.h"
+
+// Closure-compilation engine, selected with --engine=closure. The AST is
+// converted once into a tree of executable nodes: operators, literal values
+// and variable locations are decided at compile time, so running a node is a
+// single virtual call instead of a switch over NodeType.
+
+// Storage of one function call, or of a record: parameters and every local
+// declared in the function body get a fixed slot.
+struct Activation {
+  std::vector<ObjectPtr> slots;
+  std::shared_ptr<Activation> parent;
+
+  Activation(size_t size, std::shared_ptr<Activation> parent)
+      : slots(size, NULL_OBJECT_PTR), parent(std::move(parent)) {}
+
+  static std::shared_ptr<Activation> make(size_t size,
+                                          std::shared_ptr<Activation> parent) {
+    return std::make_shared<Activation>(size, std::move(parent));
+  }
+};
+using ActivationPtr = std::shared_ptr<Activation>;
+
+struct ExecExpression {
+  virtual ~ExecExpression() = default;
+  virtual ObjectPtr eval(const ActivationPtr& act) = 0;
+};
+using ExecExpressionPtr = std::unique_ptr<ExecExpression>;
+
+struct ExecStatement {
+  virtual ~ExecStatement() = default;
+  // `value` receives the completion value of the statement.
+  virtual Completion exec(const ActivationPtr& act, ObjectPtr& value) = 0;
+};
+using ExecStatementPtr = std::unique_ptr<ExecStatement>;
+
+struct FunctionCode {
+  Symbol name;
+  FunctionType functionType;
+  int arity;
+  size_t frameSize;
+  ExecStatementPtr body;
+};
+using FunctionCodePtr = std::shared_ptr<FunctionCode>;
+
+struct ClassCode {
+  Symbol name;
+  // record slots: self, then fields and methods in declaration order.
+  size_t frameSize;
+  std::vector<std::pair<size_t, ExecExpressionPtr>> fields;
+  std::vector<std::pair<size_t, FunctionCodePtr>> methods;
+  std::unordered_map<Symbol, size_t> methodSlots;
+  FunctionCodePtr ctor;
+};
+using ClassCodePtr = std::shared_ptr<ClassCode>;
+
+struct ExecFunction : public Object {
+  FunctionCodePtr code;
+  ActivationPtr closure;
+
+  ExecFunction(FunctionCodePtr code, ActivationPtr closure)
+      : Object(ObjectType::OBJ_EXEC_FUNCTION),
+        code(std::move(code)),
+        closure(std::move(closure)) {}
+
+  std::string toString() const override;
+  bool isFalsey() const override { return true; }
+  bool isTruthy() const override { return false; }
+  bool isEqual(const Object& obj) const override { return this == &obj; }
+
+  static Ref<ExecFunction> make(FunctionCodePtr code, ActivationPtr closure) {
+    return makeRef<ExecFunction>(std::move(code), std::move(closure));
+  }
+};
+using ExecFunctionPtr = Ref<ExecFunction>;
+
+struct ExecClass : public Object {
+  ClassCodePtr code;
+  ActivationPtr closure;
+
+  ExecClass(ClassCodePtr code, ActivationPtr closure)
+      : Object(ObjectType::OBJ_EXEC_CLASS),
+        code(std::move(code)),
+        closure(std::move(closure)) {}
+
+  std::string toString() const override {
+    return "<class " + code->name.str() + ">";
+  }
+  bool isFalsey() const override { return false; }
+  bool isTruthy() const override { return true; }
+  bool isEqual(const Object& obj) const override { return this == &obj; }
+
+  static Ref<ExecClass> make(ClassCodePtr code, ActivationPtr closure) {
+    return makeRef<ExecClass>(std::move(code), std::move(closure));
+  }
+};
+using ExecClassPtr = Ref<ExecClass>;
+
+struct ExecRecord : public Object {
+  ExecClassPtr klass;
+  ActivationPtr ctx;
+
+  ExecRecord(ExecClassPtr klass, ActivationPtr ctx)
+      : Object(ObjectType::OBJ_EXEC_RECORD),
+        klass(std::move(klass)),
+        ctx(std::move(ctx)) {}
+
+  std::string toString() const override {
+    return "<record " + klass->code->name.str() + ">";
+  }
+  bool isFalsey() const override { return !isTruthy(); }
+  bool isTruthy() const override {
+    return !klass->code->fields.empty() || !klass->code->methods.empty();
+  }
+  bool isEqual(const Object& obj) const override {
+    return obj.Type == ObjectType::OBJ_EXEC_RECORD &&
+           static_cast<const ExecRecord&>(obj).klass == klass;
+  }
+
+  static Ref<ExecRecord> make(ExecClassPtr klass, ActivationPtr ctx) {
+    return makeRef<ExecRecord>(std::move(klass), std::move(ctx));
+  }
+};
+using ExecRecordPtr = Ref<ExecRecord>;
+
+class ClosureCompiler {
+ public:
+  ClosureCompiler() = default;
+
+  ObjectPtr interpret(ProgramPtr program);
+  ObjectPtr getGlobalValue(Symbol identifier) const;
+
+ private:
+  struct Local {
+    Symbol name;
+    int depth;
+    size_t slot;
+  };
+
+  // Compile-time view of an Activation.
+  struct Scope {
+    Scope* enclosing;
+    std::vector<Local> locals;
+    size_t frameSize;
+    int depth;
+    // number of enclosing loops, to reject stray break/continue.
+    int loops;
+  };
+
+  // element references of an unordered_map survive rehashing, nodes keep a
+  // pointer to the value of the globals they use.
+  std::unordered_map<Symbol, ObjectPtr> globals;
+  Scope* current = nullptr;
+  // stack programs run on, as deep as the Evaluator's.
+  std::unique_ptr<NativeStack> nativeStack;
+
+  FunctionCodePtr compileFunction(FunctionDeclarationPtr decl,
+                                  FunctionType type);
+  ClassCodePtr compileClass(ClassDeclarationPtr decl);
+  ExecStatementPtr compileStatement(StatementPtr stmt);
+  ExecStatementPtr compileVarDeclaration(VarDeclarationPtr stmt);
+  ExecStatementPtr compileBlock(BlockPtr stmt);
+  ExecStatementPtr compileFor(ForStatementPtr stmt);
+  ExecExpressionPtr compileExpression(ExpressionPtr expr);
+  ExecExpressionPtr compileBinary(BinaryExprPtr expr);
+  ExecExpressionPtr compileVariable(Symbol name);
+  ExecExpressionPtr compileAssignment(AssignmentPtr expr);
+
+  size_t declareLocal(Symbol name);
+  void beginBlock() { current->depth++; }
+  void endBlock();
+  ObjectPtr* globalCell(Symbol name);
+  bool resolve(Symbol name, size_t& hops, size_t& slot) const;
+};
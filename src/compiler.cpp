@@ -0,0 +1,729 @@
+#include "compiler.h"
+
+#include "settings.h"
+
+namespace {
+
+constexpr auto SelfIdentifier = "self";
+constexpr auto InitializerName = "__init__";
+constexpr size_t MaxLocals = UINT8_MAX + 1;
+constexpr size_t MaxArguments = UINT8_MAX;
+constexpr size_t ForwardContinue = SIZE_MAX;
+
+bool isClassMember(ClassDeclarationPtr classDecl, Symbol name) {
+  for (const auto& field : classDecl->fields) {
+    if (field->identifier == name) return true;
+  }
+  for (const auto& method : classDecl->methods) {
+    if (method->identifier == name) return true;
+  }
+  return false;
+}
+
+}  // namespace
+
+CompileError CompileError::make(int line, const std::string& msg) {
+  std::ostringstream ss;
+  ss << "[line " << line << "] " << msg;
+  return CompileError(ss.str());
+}
+
+CompiledFunctionPtr Compiler::compile(ProgramPtr program) {
+  FunctionState state;
+  line = 0;
+  beginFunction(state, FunctionType::TYPE_SCRIPT, "script", nullptr);
+  for (const auto& stmt : program->statements) {
+    compileStatement(stmt);
+  }
+  emitOp(OpCode::OP_RETURN_COMPLETION);
+  return endFunction();
+}
+
+void Compiler::beginFunction(FunctionState& state, FunctionType type,
+                             Symbol name, ClassDeclarationPtr classDecl) {
+  state.enclosing = current;
+  state.function = CompiledFunction::make(name.str(), type);
+  state.type = type;
+  state.classDecl = classDecl;
+  state.scopeDepth = 0;
+  // slot zero holds the callee, or the receiver inside methods.
+  const bool hasReceiver = type == FunctionType::TYPE_METHOD ||
+                           type == FunctionType::TYPE_INITIALIZER;
+  state.locals.push_back(Local{hasReceiver ? SelfIdentifier : "", 0, false});
+  current = &state;
+}
+
+CompiledFunctionPtr Compiler::endFunction() {
+  auto function = current->function;
+  function->upvalueCount = current->upvalues.size();
+  if (Settings::getInstance()->isDebugMode()) {
+    function->chunk.disassemble(function->toString());
+  }
+  current = current->enclosing;
+  return function;
+}
+
+void Compiler::emitClosure(CompiledFunctionPtr function,
+                           const std::vector<Upvalue>& upvalues) {
+  emitOpShort(OpCode::OP_CLOSURE, makeConstant(function));
+  for (const auto& upvalue : upvalues) {
+    emitByte(upvalue.isLocal ? 1 : 0);
+    emitByte(upvalue.index);
+  }
+}
+
+void Compiler::compileStatement(StatementPtr stmt) {
+  setLine(stmt);
+  switch (stmt->Type) {
+    case NodeType::EXPRESSION_STATEMENT: {
+      auto exprStmt = static_cast<ExpressionStatement*>(stmt);
+      compileExpression(exprStmt->expression);
+      emitOp(OpCode::OP_POP_COMPLETION);
+      break;
+    }
+    case NodeType::VAR_DECLARATION:
+      compileVarDeclaration(static_cast<VarDeclaration*>(stmt));
+      break;
+    case NodeType::FUNCTION_DECLARATION:
+      compileFunctionDeclaration(static_cast<FunctionDeclaration*>(stmt));
+      break;
+    case NodeType::CLASS_DECLARATION:
+      compileClassDeclaration(static_cast<ClassDeclaration*>(stmt));
+      break;
+    case NodeType::BLOCK_STATEMENT:
+      compileBlock(static_cast<Block*>(stmt));
+      break;
+    case NodeType::IF_STATEMENT:
+      compileIfStatement(static_cast<IfStatement*>(stmt));
+      break;
+    case NodeType::FOR_STATEMENT:
+      compileForStatement(static_cast<ForStatement*>(stmt));
+      break;
+    case NodeType::WHILE_STATEMENT:
+      compileWhileStatement(static_cast<WhileStatement*>(stmt));
+      break;
+    case NodeType::PRINT_STATEMENT: {
+      auto printStmt = static_cast<PrintStatement*>(stmt);
+      compileExpression(printStmt->expression);
+      emitOp(OpCode::OP_PRINT);
+      emitOp(OpCode::OP_POP_COMPLETION);
+      break;
+    }
+    case NodeType::RETURN_STATEMENT:
+      compileReturnStatement(static_cast<ReturnStatement*>(stmt));
+      break;
+    case NodeType::BREAK_STATEMENT:
+      compileBreakStatement(static_cast<BreakStatement*>(stmt));
+      break;
+    case NodeType::CONTINUE_STATEMENT:
+      compileContinueStatement(static_cast<ContinueStatement*>(stmt));
+      break;
+    case NodeType::EMPTY_STATEMENT:
+    default:
+      emitOp(OpCode::OP_NIL);
+      emitOp(OpCode::OP_POP_COMPLETION);
+      break;
+  }
+}
+
+void Compiler::compileVarDeclaration(VarDeclarationPtr stmt) {
+  if (stmt->initializer) {
+    compileExpression(stmt->initializer);
+  } else {
+    emitOp(OpCode::OP_NIL);
+  }
+  emitOp(OpCode::OP_SET_COMPLETION);
+  if (current->scopeDepth == 0) {
+    emitOpShort(OpCode::OP_DEFINE_GLOBAL, identifierConstant(stmt->identifier));
+    return;
+  }
+  // like the evaluator, redeclaring a name in the same scope overwrites it.
+  for (int i = current->locals.size() - 1; i >= 0; i--) {
+    const auto& local = current->locals[i];
+    if (local.depth < current->scopeDepth) break;
+    if (local.name == stmt->identifier) {
+      emitOp(OpCode::OP_SET_LOCAL);
+      emitByte(i);
+      emitOp(OpCode::OP_POP);
+      return;
+    }
+  }
+  // the initializer value left on the stack becomes the local's slot.
+  declareLocal(stmt->identifier);
+  markInitialized();
+}
+
+void Compiler::compileFunctionDeclaration(FunctionDeclarationPtr stmt) {
+  if (current->scopeDepth == 0) {
+    compileFunction(stmt, FunctionType::TYPE_FUNCTION, nullptr);
+    emitOp(OpCode::OP_SET_COMPLETION);
+    emitOpShort(OpCode::OP_DEFINE_GLOBAL, identifierConstant(stmt->identifier));
+    return;
+  }
+  // declared before the body so that local functions can recurse.
+  declareLocal(stmt->identifier);
+  markInitialized();
+  compileFunction(stmt, FunctionType::TYPE_FUNCTION, nullptr);
+  emitOp(OpCode::OP_SET_COMPLETION);
+}
+
+void Compiler::compileFunction(FunctionDeclarationPtr stmt, FunctionType type,
+                               ClassDeclarationPtr classDecl) {
+  FunctionState state;
+  beginFunction(state, type, stmt->identifier, classDecl);
+  beginScope();
+  for (const auto& param : stmt->params) {
+    declareLocal(param);
+    markInitialized();
+  }
+  state.function->arity = stmt->params.size();
+  compileStatement(stmt->body);
+  emitOp(OpCode::OP_RETURN_COMPLETION);
+  auto function = endFunction();
+  emitClosure(function, state.upvalues);
+}
+
+void Compiler::compileInitializer(ClassDeclarationPtr stmt) {
+  FunctionState state;
+  beginFunction(state, FunctionType::TYPE_INITIALIZER, InitializerName, stmt);
+  beginScope();
+  const auto ctor = stmt->ctor;
+  if (ctor) {
+    // ctor params are not visible from field initializers, hide their names
+    // until the ctor body is compiled.
+    for (size_t i = 0; i < ctor->params.size(); i++) {
+      declareLocal("");
+      markInitialized();
+    }
+    state.function->arity = ctor->params.size();
+  }
+  for (const auto& field : stmt->fields) {
+    setLine(field);
+    if (field->initializer) {
+      compileExpression(field->initializer);
+    } else {
+      emitOp(OpCode::OP_NIL);
+    }
+    emitOp(OpCode::OP_GET_LOCAL);
+    emitByte(0);
+    emitOpShort(OpCode::OP_SET_FIELD, identifierConstant(field->identifier));
+    emitOp(OpCode::OP_POP);
+  }
+  if (ctor) {
+    setLine(ctor);
+    for (size_t i = 0; i < ctor->params.size(); i++) {
+      state.locals[i + 1].name = ctor->params[i];
+    }
+    compileStatement(ctor->body);
+  }
+  emitOp(OpCode::OP_GET_LOCAL);
+  emitByte(0);
+  emitOp(OpCode::OP_RETURN);
+  auto function = endFunction();
+  emitClosure(function, state.upvalues);
+}
+
+void Compiler::compileClassDeclaration(ClassDeclarationPtr stmt) {
+  const auto nameConstant = identifierConstant(stmt->identifier);
+  emitOpShort(OpCode::OP_CLASS, nameConstant);
+  for (const auto& method : stmt->methods) {
+    setLine(method);
+    compileFunction(method, FunctionType::TYPE_METHOD, stmt);
+    emitOpShort(OpCode::OP_METHOD, identifierConstant(method->identifier));
+  }
+  if (stmt->ctor || !stmt->fields.empty()) {
+    compileInitializer(stmt);
+    emitOp(OpCode::OP_INITIALIZER);
+  }
+  setLine(stmt);
+  emitOp(OpCode::OP_SET_COMPLETION);
+  // classes live in the global scope, as in the evaluator.
+  emitOpShort(OpCode::OP_DEFINE_GLOBAL, nameConstant);
+}
+
+void Compiler::compileBlock(BlockPtr stmt) {
+  if (stmt->statements.empty()) {
+    // an empty block evaluates to nil.
+    emitOp(OpCode::OP_NIL);
+    emitOp(OpCode::OP_POP_COMPLETION);
+    return;
+  }
+  beginScope();
+  for (const auto& innerStmt : stmt->statements) {
+    compileStatement(innerStmt);
+  }
+  endScope();
+}
+
+void Compiler::compileIfStatement(IfStatementPtr stmt) {
+  compileExpression(stmt->condition);
+  const auto thenJump = emitJump(OpCode::OP_JUMP_IF_FALSE);
+  emitOp(OpCode::OP_POP);
+  compileStatement(stmt->thenBranch);
+  const auto elseJump = emitJump(OpCode::OP_JUMP);
+  patchJump(thenJump);
+  emitOp(OpCode::OP_POP);
+  if (stmt->elseBranch) {
+    compileStatement(stmt->elseBranch);
+  } else {
+    emitOp(OpCode::OP_FALSE);
+    emitOp(OpCode::OP_POP_COMPLETION);
+  }
+  patchJump(elseJump);
+}
+
+void Compiler::compileWhileStatement(WhileStatementPtr stmt) {
+  const auto loopStart = currentChunk().code.size();
+  compileExpression(stmt->condition);
+  const auto exitJump = emitJump(OpCode::OP_JUMP_IF_FALSE);
+  emitOp(OpCode::OP_POP);
+  current->loops.push_back(Loop{loopStart, current->scopeDepth, {}, {}});
+  compileStatement(stmt->body);
+  emitLoop(loopStart);
+  patchJump(exitJump);
+  // a loop that runs to completion evaluates to its last condition value.
+  emitOp(OpCode::OP_POP_COMPLETION);
+  for (const auto breakJump : current->loops.back().breakJumps) {
+    patchJump(breakJump);
+  }
+  current->loops.pop_back();
+}
+
+void Compiler::compileForStatement(ForStatementPtr stmt) {
+  beginScope();
+  if (stmt->initializer) {
+    compileStatement(stmt->initializer);
+  }
+  const auto loopStart = currentChunk().code.size();
+  if (stmt->condition) {
+    compileExpression(stmt->condition);
+  } else {
+    emitOp(OpCode::OP_TRUE);
+  }
+  const auto exitJump = emitJump(OpCode::OP_JUMP_IF_FALSE);
+  emitOp(OpCode::OP_POP);
+  current->loops.push_back(
+      Loop{ForwardContinue, current->scopeDepth, {}, {}});
+  compileStatement(stmt->body);
+  for (const auto continueJump : current->loops.back().continueJumps) {
+    patchJump(continueJump);
+  }
+  if (stmt->increment) {
+    setLine(stmt->increment);
+    compileExpression(stmt->increment);
+    emitOp(OpCode::OP_POP);
+  }
+  emitLoop(loopStart);
+  patchJump(exitJump);
+  emitOp(OpCode::OP_POP_COMPLETION);
+  for (const auto breakJump : current->loops.back().breakJumps) {
+    patchJump(breakJump);
+  }
+  current->loops.pop_back();
+  endScope();
+}
+
+void Compiler::compileReturnStatement(ReturnStatementPtr stmt) {
+  if (current->type == FunctionType::TYPE_INITIALIZER) {
+    // the value returned from a ctor is discarded, the call yields `self`.
+    if (stmt->expression) {
+      compileExpression(stmt->expression);
+      emitOp(OpCode::OP_POP);
+    }
+    emitOp(OpCode::OP_GET_LOCAL);
+    emitByte(0);
+  } else if (stmt->expression) {
+    compileExpression(stmt->expression);
+  } else {
+    emitOp(OpCode::OP_NIL);
+  }
+  emitOp(OpCode::OP_RETURN);
+}
+
+void Compiler::compileBreakStatement(BreakStatementPtr stmt) {
+  auto& loop = currentLoop("break");
+  emitPops(loop.scopeDepth);
+  // a loop left through `break` evaluates to nil.
+  emitOp(OpCode::OP_NIL);
+  emitOp(OpCode::OP_POP_COMPLETION);
+  loop.breakJumps.push_back(emitJump(OpCode::OP_JUMP));
+}
+
+void Compiler::compileContinueStatement(ContinueStatementPtr stmt) {
+  auto& loop = currentLoop("continue");
+  emitPops(loop.scopeDepth);
+  if (loop.start != ForwardContinue) {
+    emitLoop(loop.start);
+  } else {
+    loop.continueJumps.push_back(emitJump(OpCode::OP_JUMP));
+  }
+}
+
+void Compiler::compileExpression(ExpressionPtr expr) {
+  setLine(expr);
+  switch (expr->Type) {
+    case NodeType::INTEGER_LITERAL: {
+      auto intExpr = static_cast<IntegerLiteral*>(expr);
+      emitOpShort(OpCode::OP_CONSTANT, integerConstant(intExpr->Value));
+      break;
+    }
+    case NodeType::BOOLEAN_LITERAL: {
+      auto boolExpr = static_cast<BooleanLiteral*>(expr);
+      emitOp(boolExpr->Value ? OpCode::OP_TRUE : OpCode::OP_FALSE);
+      break;
+    }
+    case NodeType::STRING_LITERAL: {
+      auto stringExpr = static_cast<StringLiteral*>(expr);
+      emitOpShort(OpCode::OP_CONSTANT, identifierConstant(stringExpr->Value));
+      break;
+    }
+    case NodeType::ARRAY_LITERAL:
+      compileArrayLiteral(static_cast<ArrayLiteral*>(expr));
+      break;
+    case NodeType::ARRAY_SUBSCRIPT_EXPRESSION: {
+      auto subscriptExpr = static_cast<ArraySubscriptExpr*>(expr);
+      compileExpression(subscriptExpr->array);
+      compileExpression(subscriptExpr->index);
+      emitOp(OpCode::OP_INDEX);
+      break;
+    }
+    case NodeType::UNARY_EXPRESSION:
+      compileUnaryExpression(static_cast<UnaryExpr*>(expr));
+      break;
+    case NodeType::BINARY_EXPRESSION:
+      compileBinaryExpression(static_cast<BinaryExpr*>(expr));
+      break;
+    case NodeType::VARIABLE_EXPRESSION: {
+      auto varExpr = static_cast<VariableExpr*>(expr);
+      compileVariable(varExpr->identifier);
+      break;
+    }
+    case NodeType::ASSIGNMENT_EXPRESSION:
+      compileAssignment(static_cast<Assignment*>(expr));
+      break;
+    case NodeType::CALL_EXPRESSION:
+      compileCallExpression(static_cast<CallExpr*>(expr));
+      break;
+    case NodeType::MEMBER_EXPRESSION:
+      compileMemberExpression(static_cast<MemberExpr*>(expr));
+      break;
+    case NodeType::NIL_LITERAL:
+    default:
+      emitOp(OpCode::OP_NIL);
+      break;
+  }
+}
+
+void Compiler::compileBinaryExpression(BinaryExprPtr expr) {
+  compileExpression(expr->left);
+  compileExpression(expr->right);
+  setLine(expr);
+  switch (expr->operator_.type) {
+    case TokenType::TOKEN_PLUS:
+      emitOp(OpCode::OP_ADD);
+      break;
+    case TokenType::TOKEN_MINUS:
+      emitOp(OpCode::OP_SUBTRACT);
+      break;
+    case TokenType::TOKEN_STAR:
+      emitOp(OpCode::OP_MULTIPLY);
+      break;
+    case TokenType::TOKEN_SLASH:
+      emitOp(OpCode::OP_DIVIDE);
+      break;
+    case TokenType::TOKEN_AND:
+      emitOp(OpCode::OP_AND);
+      break;
+    case TokenType::TOKEN_OR:
+      emitOp(OpCode::OP_OR);
+      break;
+    case TokenType::TOKEN_EQUAL_EQUAL:
+      emitOp(OpCode::OP_EQUAL);
+      break;
+    case TokenType::TOKEN_BANG_EQUAL:
+      emitOp(OpCode::OP_NOT_EQUAL);
+      break;
+    case TokenType::TOKEN_LESS:
+      emitOp(OpCode::OP_LESS);
+      break;
+    case TokenType::TOKEN_LESS_EQUAL:
+      emitOp(OpCode::OP_LESS_EQUAL);
+      break;
+    case TokenType::TOKEN_GREATER:
+      emitOp(OpCode::OP_GREATER);
+      break;
+    case TokenType::TOKEN_GREATER_EQUAL:
+      emitOp(OpCode::OP_GREATER_EQUAL);
+      break;
+    default:
+      std::ostringstream ss;
+      ss << "Invalid binary operator type: " << (int)expr->operator_.type;
+      throw CompileError::make(line, ss.str());
+  }
+}
+
+void Compiler::compileUnaryExpression(UnaryExprPtr expr) {
+  compileExpression(expr->right);
+  setLine(expr);
+  switch (expr->operator_.type) {
+    case TokenType::TOKEN_MINUS:
+      emitOp(OpCode::OP_NEGATE);
+      break;
+    case TokenType::TOKEN_BANG:
+      emitOp(OpCode::OP_NOT);
+      break;
+    default:
+      std::ostringstream ss;
+      ss << "Invalid unary operator type: " << expr->operator_.lexeme();
+      throw CompileError::make(line, ss.str());
+  }
+}
+
+void Compiler::compileCallExpression(CallExprPtr expr) {
+  compileExpression(expr->left);
+  if (expr->arguments.size() > MaxArguments) {
+    throw CompileError::make(line, "Can't have more than 255 arguments.");
+  }
+  for (const auto& argument : expr->arguments) {
+    compileExpression(argument);
+  }
+  setLine(expr);
+  emitOp(OpCode::OP_CALL);
+  emitByte(expr->arguments.size());
+}
+
+void Compiler::compileMemberExpression(MemberExprPtr expr) {
+  compileExpression(expr->left);
+  setLine(expr);
+  emitOpShort(OpCode::OP_GET_PROPERTY, identifierConstant(expr->member));
+}
+
+void Compiler::compileArrayLiteral(ArrayLiteralPtr expr) {
+  if (expr->elements.size() > UINT16_MAX) {
+    throw CompileError::make(line, "Too many elements in array literal.");
+  }
+  for (const auto& element : expr->elements) {
+    compileExpression(element);
+  }
+  setLine(expr);
+  emitOpShort(OpCode::OP_ARRAY, expr->elements.size());
+}
+
+void Compiler::compileVariable(Symbol name) {
+  const auto resolution = resolve(current, name);
+  switch (resolution.kind) {
+    case Resolution::LOCAL:
+      emitOp(OpCode::OP_GET_LOCAL);
+      emitByte(resolution.index);
+      break;
+    case Resolution::UPVALUE:
+      emitOp(OpCode::OP_GET_UPVALUE);
+      emitByte(resolution.index);
+      break;
+    case Resolution::MEMBER:
+      emitSelf(resolution);
+      emitOpShort(OpCode::OP_GET_FIELD, identifierConstant(name));
+      break;
+    case Resolution::GLOBAL:
+      emitOpShort(OpCode::OP_GET_GLOBAL, identifierConstant(name));
+      break;
+  }
+}
+
+void Compiler::compileAssignment(AssignmentPtr expr) {
+  compileExpression(expr->value);
+  setLine(expr);
+  const auto resolution = resolve(current, expr->identifier);
+  switch (resolution.kind) {
+    case Resolution::LOCAL:
+      emitOp(OpCode::OP_SET_LOCAL);
+      emitByte(resolution.index);
+      break;
+    case Resolution::UPVALUE:
+      emitOp(OpCode::OP_SET_UPVALUE);
+      emitByte(resolution.index);
+      break;
+    case Resolution::MEMBER:
+      emitSelf(resolution);
+      emitOpShort(OpCode::OP_SET_FIELD, identifierConstant(expr->identifier));
+      break;
+    case Resolution::GLOBAL:
+      emitOpShort(OpCode::OP_SET_GLOBAL, identifierConstant(expr->identifier));
+      break;
+  }
+}
+
+void Compiler::beginScope() { current->scopeDepth++; }
+
+void Compiler::endScope() {
+  current->scopeDepth--;
+  auto& locals = current->locals;
+  while (!locals.empty() && locals.back().depth > current->scopeDepth) {
+    emitOp(locals.back().isCaptured ? OpCode::OP_CLOSE_UPVALUE
+                                    : OpCode::OP_POP);
+    locals.pop_back();
+  }
+}
+
+void Compiler::declareLocal(Symbol name) {
+  if (current->locals.size() >= MaxLocals) {
+    throw CompileError::make(line, "Too many local variables in function.");
+  }
+  current->locals.push_back(Local{name, -1, false});
+}
+
+void Compiler::markInitialized() {
+  current->locals.back().depth = current->scopeDepth;
+}
+
+void Compiler::emitPops(int depth) {
+  const auto& locals = current->locals;
+  for (auto it = locals.rbegin(); it != locals.rend() && it->depth > depth;
+       it++) {
+    emitOp(it->isCaptured ? OpCode::OP_CLOSE_UPVALUE : OpCode::OP_POP);
+  }
+}
+
+Compiler::Resolution Compiler::resolve(FunctionState* state,
+                                       Symbol name) {
+  const auto slot = resolveLocal(state, name);
+  if (slot >= 0) {
+    return Resolution{Resolution::LOCAL, slot, false};
+  }
+  if (state->classDecl && isClassMember(state->classDecl, name)) {
+    return Resolution{Resolution::MEMBER, 0, true};
+  }
+  if (state->enclosing == nullptr) {
+    return Resolution{Resolution::GLOBAL, 0, false};
+  }
+  const auto outer = resolve(state->enclosing, name);
+  switch (outer.kind) {
+    case Resolution::LOCAL:
+      state->enclosing->locals[outer.index].isCaptured = true;
+      return Resolution{Resolution::UPVALUE,
+                        addUpvalue(state, outer.index, true), false};
+    case Resolution::UPVALUE:
+      return Resolution{Resolution::UPVALUE,
+                        addUpvalue(state, outer.index, false), false};
+    case Resolution::MEMBER:
+      // nested functions reach the fields of `self` through an upvalue.
+      if (outer.selfIsLocal) {
+        state->enclosing->locals[outer.index].isCaptured = true;
+      }
+      return Resolution{Resolution::MEMBER,
+                        addUpvalue(state, outer.index, outer.selfIsLocal),
+                        false};
+    case Resolution::GLOBAL:
+    default:
+      return outer;
+  }
+}
+
+int Compiler::resolveLocal(FunctionState* state, Symbol name) {
+  for (int i = state->locals.size() - 1; i >= 0; i--) {
+    const auto& local = state->locals[i];
+    if (local.depth >= 0 && local.name == name) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int Compiler::addUpvalue(FunctionState* state, uint8_t index, bool isLocal) {
+  auto& upvalues = state->upvalues;
+  for (size_t i = 0; i < upvalues.size(); i++) {
+    if (upvalues[i].index == index && upvalues[i].isLocal == isLocal) {
+      return i;
+    }
+  }
+  if (upvalues.size() >= MaxLocals) {
+    throw CompileError::make(line, "Too many closure variables in function.");
+  }
+  upvalues.push_back(Upvalue{index, isLocal});
+  return upvalues.size() - 1;
+}
+
+void Compiler::emitSelf(const Resolution& resolution) {
+  emitOp(resolution.selfIsLocal ? OpCode::OP_GET_LOCAL
+                                : OpCode::OP_GET_UPVALUE);
+  emitByte(resolution.index);
+}
+
+Compiler::Loop& Compiler::currentLoop(const char* statement) {
+  if (current->loops.empty()) {
+    std::ostringstream ss;
+    ss << "Can't use '" << statement << "' outside of a loop.";
+    throw CompileError::make(line, ss.str());
+  }
+  return current->loops.back();
+}
+
+void Compiler::emitShort(uint16_t value) {
+  emitByte((value >> 8) & 0xff);
+  emitByte(value & 0xff);
+}
+
+void Compiler::emitOpShort(OpCode opCode, uint16_t operand) {
+  emitOp(opCode);
+  emitShort(operand);
+}
+
+uint16_t Compiler::makeConstant(ObjectPtr value) {
+  if (currentChunk().constants.size() >= UINT16_COUNT) {
+    throw CompileError::make(line, "Too many constants in one chunk.");
+  }
+  return currentChunk().addConstant(value);
+}
+
+uint16_t Compiler::identifierConstant(const std::string& name) {
+  auto& constants = current->identifierConstants;
+  const auto it = constants.find(name);
+  if (it != constants.end()) {
+    return it->second;
+  }
+  const auto index = makeConstant(makeRef<StringObject>(name));
+  constants[name] = index;
+  return index;
+}
+
+uint16_t Compiler::integerConstant(int64_t value) {
+  auto& constants = current->integerConstants;
+  const auto it = constants.find(value);
+  if (it != constants.end()) {
+    return it->second;
+  }
+  const auto index = makeConstant(IntegerObject::make(value));
+  constants[value] = index;
+  return index;
+}
+
+size_t Compiler::emitJump(OpCode opCode) {
+  emitOp(opCode);
+  emitByte(0xff);
+  emitByte(0xff);
+  return currentChunk().code.size() - 2;
+}
+
+void Compiler::patchJump(size_t offset) {
+  const auto jump = currentChunk().code.size() - offset - 2;
+  if (jump > UINT16_MAX) {
+    throw CompileError::make(line, "Too much code to jump over.");
+  }
+  currentChunk().code[offset] = (jump >> 8) & 0xff;
+  currentChunk().code[offset + 1] = jump & 0xff;
+}
+
+void Compiler::emitLoop(size_t loopStart) {
+  emitOp(OpCode::OP_LOOP);
+  const auto offset = currentChunk().code.size() - loopStart + 2;
+  if (offset > UINT16_MAX) {
+    throw CompileError::make(line, "Loop body too large.");
+  }
+  emitShort(offset);
+}
+
+void Compiler::setLine(NodePtr node) {
+  if (node && node->line > 0) {
+    line = node->line;
+  }
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "ast.h"
+#include "chunk.h"
+#include "common.h"
+#include "vm_object.h"
+
+class CompileError : public std::runtime_error {
+ public:
+  CompileError(const std::string& message) : std::runtime_error(message) {}
+
+  static CompileError make(int line, const std::string& msg);
+};
+
+// Compiles a Program into bytecode for the VM. The top-level statements
+// become the body of a TYPE_SCRIPT function.
+class Compiler {
+ public:
+  Compiler() = default;
+
+  CompiledFunctionPtr compile(ProgramPtr program);
+
+ private:
+  struct Local {
+    Symbol name;
+    // -1 while the local is declared but its initializer is not compiled.
+    int depth;
+    bool isCaptured;
+  };
+
+  struct Upvalue {
+    uint8_t index;
+    bool isLocal;
+  };
+
+  struct Loop {
+    // target of `continue`, or SIZE_MAX when continues are forward-patched.
+    size_t start;
+    int scopeDepth;
+    std::vector<size_t> breakJumps;
+    std::vector<size_t> continueJumps;
+  };
+
+  struct FunctionState {
+    FunctionState* enclosing;
+    CompiledFunctionPtr function;
+    FunctionType type;
+    // set while compiling a method: field and method names of the class
+    // resolve against `self`.
+    ClassDeclarationPtr classDecl = nullptr;
+    std::vector<Local> locals;
+    std::vector<Upvalue> upvalues;
+    std::vector<Loop> loops;
+    std::unordered_map<std::string, uint16_t> identifierConstants;
+    std::unordered_map<int64_t, uint16_t> integerConstants;
+    int scopeDepth;
+  };
+
+  // How an identifier is reached from the current function.
+  struct Resolution {
+    enum Kind { LOCAL, UPVALUE, MEMBER, GLOBAL } kind;
+    // slot or upvalue index; for MEMBER, where `self` lives.
+    int index;
+    bool selfIsLocal;
+  };
+
+  FunctionState* current = nullptr;
+  int line = 0;
+
+  void beginFunction(FunctionState& state, FunctionType type, Symbol name,
+                     ClassDeclarationPtr classDecl);
+  CompiledFunctionPtr endFunction();
+  void emitClosure(CompiledFunctionPtr function,
+                   const std::vector<Upvalue>& upvalues);
+
+  void compileStatement(StatementPtr stmt);
+  void compileVarDeclaration(VarDeclarationPtr stmt);
+  void compileFunctionDeclaration(FunctionDeclarationPtr stmt);
+  void compileFunction(FunctionDeclarationPtr stmt, FunctionType type,
+                       ClassDeclarationPtr classDecl);
+  void compileInitializer(ClassDeclarationPtr stmt);
+  void compileClassDeclaration(ClassDeclarationPtr stmt);
+  void compileBlock(BlockPtr stmt);
+  void compileIfStatement(IfStatementPtr stmt);
+  void compileWhileStatement(WhileStatementPtr stmt);
+  void compileForStatement(ForStatementPtr stmt);
+  void compileReturnStatement(ReturnStatementPtr stmt);
+  void compileBreakStatement(BreakStatementPtr stmt);
+  void compileContinueStatement(ContinueStatementPtr stmt);
+
+  void compileExpression(ExpressionPtr expr);
+  void compileBinaryExpression(BinaryExprPtr expr);
+  void compileUnaryExpression(UnaryExprPtr expr);
+  void compileCallExpression(CallExprPtr expr);
+  void compileMemberExpression(MemberExprPtr expr);
+  void compileArrayLiteral(ArrayLiteralPtr expr);
+  void compileVariable(Symbol name);
+  void compileAssignment(AssignmentPtr expr);
+
+  void beginScope();
+  void endScope();
+  void declareLocal(Symbol name);
+  void markInitialized();
+  void emitPops(int depth);
+  Resolution resolve(FunctionState* state, Symbol name);
+  int resolveLocal(FunctionState* state, Symbol name);
+  int addUpvalue(FunctionState* state, uint8_t index, bool isLocal);
+  void emitSelf(const Resolution& resolution);
+  Loop& currentLoop(const char* statement);
+
+  Chunk& currentChunk() { return current->function->chunk; }
+  void emitByte(uint8_t byte) { currentChunk().write(byte, line); }
+  void emitOp(OpCode opCode) { currentChunk().write(opCode, line); }
+  void emitShort(uint16_t value);
+  void emitOpShort(OpCode opCode, uint16_t operand);
+  uint16_t makeConstant(ObjectPtr value);
+  // the VM looks names up by string at run time.
+  uint16_t identifierConstant(const std::string& name);
+  uint16_t identifierConstant(Symbol name) {
+    return identifierConstant(name.str());
+  }
+  uint16_t integerConstant(int64_t value);
+  size_t emitJump(OpCode opCode);
+  void patchJump(size_t offset);
+  void emitLoop(size_t loopStart);
+  void setLine(NodePtr node);
+};
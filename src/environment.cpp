@@ -1,56 +1,95 @@
 #include "environment.h"
 
-bool Environment::existsInLocalScope(const std::string& identifier) {
-  return values.count(identifier) > 0;
+Environment::Environment(ObjectType type, EnvironmentPtr enclosing,
+                         size_t size, Slots slots)
+    : Object(type),
+      enclosing(std::move(enclosing)),
+      values(slots.values),
+      count(0),
+      capacity(static_cast<uint32_t>(slots.capacity)) {
+  reserve(size);
+  for (; count < size; count++) {
+    new (values + count) Value();
+  }
 }
 
-EnvironmentPtr Environment::findEnvironment(const std::string& identifier) {
-  if (existsInLocalScope(identifier)) {
-    return shared_from_this();
+Environment::~Environment() {
+  clear();
+  if (spilled) {
+    ::operator delete(values);
   }
-  if (enclosing) {
-    return enclosing->findEnvironment(identifier);
+}
+
+void Environment::reserve(size_t size) {
+  if (size <= capacity) {
+    return;
+  }
+  const auto newCapacity = std::max<size_t>(size, capacity * 2);
+  auto* newValues =
+      static_cast<Value*>(::operator new(newCapacity * sizeof(Value)));
+  for (uint32_t slot = 0; slot < count; slot++) {
+    new (newValues + slot) Value(std::move(values[slot]));
+    values[slot].~Value();
+  }
+  if (spilled) {
+    ::operator delete(values);
   }
-  return nullptr;
+  values = newValues;
+  capacity = static_cast<uint32_t>(newCapacity);
+  spilled = true;
 }
 
-std::string Environment::toString() {
-  std::string result = "";
-  if (enclosing) {
-    result += enclosing->toString() + "\n";
+void Environment::set(int slot, Value value) {
+  if (static_cast<size_t>(slot) >= count) {
+    reserve(slot + 1);
+    for (; count <= static_cast<uint32_t>(slot); count++) {
+      new (values + count) Value();
+    }
   }
-  result += "{";
-  for (auto& [key, value] : values) {
-    result += key + ": " + value->toString() + ", ";
+  if (old && value.isObject()) {
+    value.asObject()->old = true;
   }
-  result += "}";
-  return result;
+  values[slot] = std::move(value);
 }
 
-void Environment::declare(const std::string& identifier, ObjectPtr value) {
-  values[identifier] = value;
+void Environment::reset(EnvironmentPtr enclosing, size_t size) {
+  clear();
+  this->enclosing = std::move(enclosing);
+  reserve(size);
+  for (; count < size; count++) {
+    new (values + count) Value();
+  }
+  old = false;
 }
 
-void Environment::set(const std::string& identifier, ObjectPtr value) {
-  if (existsInLocalScope(identifier)) {
-    values[identifier] = value;
-    return;
-  } else if (enclosing) {
-    auto parentEnv = enclosing->findEnvironment(identifier);
-    if (parentEnv != nullptr) {
-      parentEnv->set(identifier, value);
-      return;
-    }
+void Environment::clear() {
+  enclosing.reset();
+  // the slots are gone before any object they held is destroyed, in case
+  // that reaches this environment again.
+  const auto last = count;
+  count = 0;
+  for (uint32_t slot = 0; slot < last; slot++) {
+    values[slot].~Value();
   }
-  values[identifier] = value;
 }
 
-ObjectPtr Environment::get(const std::string& identifier) {
-  if (values.count(identifier) > 0) {
-    return values[identifier];
+Environment* Environment::ancestor(int depth) {
+  auto env = this;
+  for (int i = 0; i < depth; i++) {
+    env = env->enclosing.get();
   }
+  return env;
+}
+
+std::string Environment::toString() const {
+  std::string result = "";
   if (enclosing) {
-    return enclosing->get(identifier);
+    result += enclosing->toString() + "\n";
+  }
+  result += "{";
+  for (size_t slot = 0; slot < count; slot++) {
+    result += std::to_string(slot) + ": " + values[slot].toString() + ", ";
   }
-  return NULL_OBJECT_PTR;
-}
\ No newline at end of file
+  result += "}";
+  return result;
+}
@@ -2,34 +2,101 @@
 #define __cpplox_environment_h
 
 #include "common.h"
+#include "scope_pool.h"
 #include "object.h"
 
 class Environment;
-using EnvironmentPtr = std::shared_ptr<Environment>;
-
-class Environment : public std::enable_shared_from_this<Environment> {
- private:
-  EnvironmentPtr enclosing{nullptr};
-  std::unordered_map<std::string, ObjectPtr> values = {};
+using EnvironmentPtr = Ref<Environment>;
 
+// Variables of one scope, stored by the slot the Resolver assigned them.
+// Scopes are counted like any other object; the Heap traces them but only
+// tracks the objects that can refer back to them.
+//
+// The slots are allocated along with the environment, right after it, so a
+// scope is one allocation; a slot set past them moves the slots to storage
+// of their own.
+class Environment : public Object {
  public:
-  Environment() {}
-  Environment(EnvironmentPtr enclosing) : enclosing(enclosing) {}
+  // slots allocated after an environment, for its constructor.
+  struct Slots {
+    Value* values;
+    size_t capacity;
+  };
+
+  Environment(EnvironmentPtr enclosing, size_t size, Slots slots)
+      : Environment(ObjectType::OBJ_ENVIRONMENT, std::move(enclosing), size,
+                    slots) {}
+  Environment(const Environment&) = delete;
+  Environment& operator=(const Environment&) = delete;
+  ~Environment() override;
+
+  // unset slots read as nil.
+  Value get(int slot) const {
+    return static_cast<size_t>(slot) < count ? values[slot] : Value::nil();
+  }
+  // write barrier: an object stored into an old environment is promoted,
+  // since minor collections would otherwise retrace it as a root each time.
+  void set(int slot, Value value);
+  // turns this into a fresh, young environment of size unset slots, keeping
+  // the storage already allocated.
+  void reset(EnvironmentPtr enclosing, size_t size);
+
+  Value getAt(int depth, int slot) { return ancestor(depth)->get(slot); }
+  void setAt(int depth, int slot, Value value) {
+    ancestor(depth)->set(slot, std::move(value));
+  }
 
-  void declare(const std::string& identifier, ObjectPtr value);
-  void set(const std::string& identifier, ObjectPtr value);
-  ObjectPtr get(const std::string& identifier);
+  // the environment depth hops up the enclosing chain.
+  Environment* ancestor(int depth);
+  const EnvironmentPtr& getEnclosing() const { return enclosing; }
+  const Value* begin() const { return values; }
+  const Value* end() const { return values + count; }
+  size_t size() const { return count; }
+  // drops every reference this holds, for the Heap breaking a cycle.
+  void clear();
 
-  bool existsInLocalScope(const std::string& identifier);
+  std::string toString() const override;
 
-  EnvironmentPtr findEnvironment(const std::string& identifier);
+  static EnvironmentPtr make() { return make(nullptr, 0); }
+  static EnvironmentPtr make(EnvironmentPtr enclosing, size_t size = 0) {
+    return allocate<Environment>(size, false, std::move(enclosing), size);
+  }
+  // in the ScopePool, for the scope of a block nothing can capture, which
+  // dies with it.
+  static EnvironmentPtr makePooled(EnvironmentPtr enclosing, size_t size) {
+    return allocate<Environment>(size, true, std::move(enclosing), size);
+  }
 
-  std::string toString();
+ protected:
+  Environment(ObjectType type, EnvironmentPtr enclosing, size_t size,
+              Slots slots);
 
-  static EnvironmentPtr make() { return std::make_shared<Environment>(); }
-  static EnvironmentPtr make(EnvironmentPtr enclosing) {
-    return std::make_shared<Environment>(enclosing);
+  // allocates a T with capacity slots after it, from the ScopePool if
+  // pooled is set and they fit in it.
+  template <typename T, typename... Args>
+  static Ref<T> allocate(size_t capacity, bool pooled, Args&&... args) {
+    static_assert(sizeof(T) % alignof(Value) == 0, "misaligned slots");
+    const auto objectSize = sizeof(RefCounts) + sizeof(T);
+    const auto size = objectSize + capacity * sizeof(Value);
+    pooled = pooled && size <= ScopePool::MAX_SIZE;
+    auto* memory =
+        pooled ? ScopePool::allocate(size) : ::operator new(size);
+    auto* values =
+        reinterpret_cast<Value*>(static_cast<char*>(memory) + objectSize);
+    return constructRef<T>(memory, pooled, std::forward<Args>(args)...,
+                           Slots{values, capacity});
   }
+
+ private:
+  EnvironmentPtr enclosing;
+  Value* values;
+  uint32_t count;
+  uint32_t capacity;
+  // the slots outgrew the ones allocated with the environment.
+  bool spilled = false;
+
+  // makes room for size slots, keeping the first count.
+  void reserve(size_t size);
 };
 
-#endif  // __cpplox_environment_h
\ No newline at end of file
+#endif  // __cpplox_environment_h
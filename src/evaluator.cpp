@@ -5,26 +5,104 @@
 
 namespace {
 
-static bool isReturnObject(ObjectPtr value) {
-  return value->Type == ObjectType::OBJ_RETURN_VALUE;
+static const char* toString(Completion completion) {
+  switch (completion) {
+    case Completion::RETURN:
+      return "return";
+    case Completion::BREAK:
+      return "break";
+    case Completion::CONTINUE:
+      return "continue";
+    default:
+      return "normal";
+  }
+}
+
+// the result of operator_ on two integers, false when the generic path
+// has to handle it, e.g. to report a division by zero.
+static bool evalIntegerOperator(TokenType operator_, int64_t lhs, int64_t rhs,
+                                Value& result) {
+  switch (operator_) {
+    case TokenType::TOKEN_PLUS:
+      result = Value::integer(lhs + rhs);
+      return true;
+    case TokenType::TOKEN_MINUS:
+      result = Value::integer(lhs - rhs);
+      return true;
+    case TokenType::TOKEN_STAR:
+      result = Value::integer(lhs * rhs);
+      return true;
+    case TokenType::TOKEN_SLASH:
+      if (rhs == 0) {
+        return false;
+      }
+      result = Value::integer(lhs / rhs);
+      return true;
+    case TokenType::TOKEN_EQUAL_EQUAL:
+      result = Value::boolean(lhs == rhs);
+      return true;
+    case TokenType::TOKEN_BANG_EQUAL:
+      result = Value::boolean(lhs != rhs);
+      return true;
+    case TokenType::TOKEN_LESS:
+      result = Value::boolean(lhs < rhs);
+      return true;
+    case TokenType::TOKEN_LESS_EQUAL:
+      result = Value::boolean(lhs <= rhs);
+      return true;
+    case TokenType::TOKEN_GREATER:
+      result = Value::boolean(lhs > rhs);
+      return true;
+    case TokenType::TOKEN_GREATER_EQUAL:
+      result = Value::boolean(lhs >= rhs);
+      return true;
+    default:
+      return false;
+  }
+}
+
+// index of expr's method in the class of record, answered by the inline
+// cache of expr when it has seen the record's shape before.
+static int lookupMember(const MemberExprPtr& expr, const Record* record) {
+  const auto* shape = record->getShape();
+  for (const auto& entry : expr->cache) {
+    if (entry.shape == shape) {
+      return entry.method;
+    }
+  }
+  const auto method = shape->findMethod(expr->member);
+  if (!expr->megamorphic) {
+    if (expr->cache.size() < MemberExpr::MAX_CACHE_ENTRIES) {
+      expr->cache.push_back(MemberExpr::CacheEntry{
+          shape, record->getDeclaration()->shape, method});
+    } else {
+      expr->cache.clear();
+      expr->megamorphic = true;
+    }
+  }
+  return method;
 }
 
-static bool isBreakObject(ObjectPtr value) {
-  return value->Type == ObjectType::OBJ_BREAK;
+static bool isUnboundMethod(const Value& value) {
+  return value.isObject() &&
+         value.asObject()->Type == ObjectType::OBJ_FUNCTION &&
+         static_cast<Function*>(value.asObject())->isUnbound();
 }
 
-static bool isContinueObject(ObjectPtr value) {
-  return value->Type == ObjectType::OBJ_CONTINUE;
+// the record a method of expr is read from, found from ctx.
+static Record* receiverOf(const EnvironmentPtr& ctx,
+                          const VariableExpr& expr) {
+  return static_cast<Record*>(ctx->ancestor(expr.address.depth));
 }
 
-static bool isCallable(ObjectPtr value) {
-  return value->Type == ObjectType::OBJ_CLASS ||
-         value->Type == ObjectType::OBJ_FUNCTION;
+static bool isCallable(const Value& value) {
+  const auto type = value.type();
+  return type == ObjectType::OBJ_CLASS || type == ObjectType::OBJ_FUNCTION;
 }
 
 }  // namespace
 
-static IntegerObjectPtr tryCastAsInteger(ObjectPtr obj);
+static int64_t tryCastAsInteger(const Value& value);
 
 RuntimeError RuntimeError::make(const char* file_name, int line,
                                 const std::string& msg) {
@@ -34,362 +112,612 @@ RuntimeError RuntimeError::make(const char* file_name, int line,
   return RuntimeError(ss.str());
 }
 
-Evaluator::Evaluator() { globalCtx = Environment::make(); }
+Evaluator::Evaluator()
+    : globalCtx(Environment::make()), heap(globalCtx, frames) {}
+
+Evaluator::~Evaluator() { globalCtx.reset(); }
 
 ObjectPtr Evaluator::eval(ProgramPtr program) {
-  ObjectPtr lastValue = NULL_OBJECT_PTR;
+  programs.push_back(program);
+  const auto maxCallDepth = Settings::getInstance()->getMaxCallDepth();
+  const auto stackSize =
+      static_cast<size_t>(std::max(maxCallDepth, 0)) * NATIVE_FRAME_SIZE;
+  if (nativeStack == nullptr || nativeStack->getSize() != stackSize) {
+    nativeStack = std::make_unique<NativeStack>(stackSize);
+  }
+  ObjectPtr result;
+  nativeStack->run([&]() { result = evalProgram(program); });
+  return result;
+}
+
+ObjectPtr Evaluator::evalProgram(const ProgramPtr& program) {
+  resolver.resolve(program);
+  completion = Completion::NORMAL;
+  Value lastValue;
   for (const auto& stmt : program->statements) {
+    // before the statement, so the value of the last one is never swept.
+    safePoint();
     if (Settings::getInstance()->isDebugMode()) {
       LOG(INFO) << "Env: " << globalCtx->toString();
       LOG(INFO) << "Executing: " << stmt->toString();
     }
     lastValue = evalStatement(globalCtx, stmt);
-    if (isReturnObject(lastValue)) {
-      return lastValue;
-    } else if (isBreakObject(lastValue) || isContinueObject(lastValue)) {
+    if (completion == Completion::RETURN) {
+      completion = Completion::NORMAL;
+      return lastValue.toObject();
+    } else if (completion != Completion::NORMAL) {
       std::ostringstream ss;
-      ss << "Invalid statement: " << lastValue->toString();
+      ss << "Invalid statement: " << toString(completion);
+      completion = Completion::NORMAL;
       throw RuntimeError::make(__FILE__, __LINE__, ss.str());
     }
   }
-  return lastValue;
+  return lastValue.toObject();
+}
+
+Value Evaluator::lookupVariable(const EnvironmentPtr& ctx,
+                                const LexicalAddress& address) {
+  if (address.isGlobal()) {
+    return globalCtx->get(address.slot);
+  }
+  return ctx->getAt(address.depth, address.slot);
+}
+
+void Evaluator::assignVariable(const EnvironmentPtr& ctx,
+                               const LexicalAddress& address, Value value) {
+  if (address.isGlobal()) {
+    globalCtx->set(address.slot, std::move(value));
+  } else {
+    ctx->setAt(address.depth, address.slot, std::move(value));
+  }
 }
 
-ObjectPtr Evaluator::evalStatement(EnvironmentPtr ctx, StatementPtr stmt) {
+Value Evaluator::evalStatement(EnvironmentPtr ctx, StatementPtr stmt) {
   switch (stmt->Type) {
     case NodeType::EXPRESSION_STATEMENT: {
-      auto exprStmt = std::static_pointer_cast<ExpressionStatement>(stmt);
+      auto exprStmt = static_cast<ExpressionStatement*>(stmt);
       return evalExpression(ctx, exprStmt->expression);
     }
     case NodeType::VAR_DECLARATION: {
-      auto varDeclStmt = std::static_pointer_cast<VarDeclaration>(stmt);
+      auto varDeclStmt = static_cast<VarDeclaration*>(stmt);
       return evalVarDeclarationStatement(ctx, varDeclStmt);
     }
     case NodeType::FUNCTION_DECLARATION: {
-      auto funcDeclStmt = std::static_pointer_cast<FunctionDeclaration>(stmt);
+      auto funcDeclStmt = static_cast<FunctionDeclaration*>(stmt);
       return evalFuncDeclarationStatement(ctx, funcDeclStmt,
                                           FunctionType::TYPE_FUNCTION);
     }
     case NodeType::CLASS_DECLARATION: {
-      auto classDeclStmt = std::static_pointer_cast<ClassDeclaration>(stmt);
+      auto classDeclStmt = static_cast<ClassDeclaration*>(stmt);
       return evalClassDeclarationStatement(ctx, classDeclStmt);
     }
     case NodeType::BLOCK_STATEMENT: {
-      auto blockStmt = std::static_pointer_cast<Block>(stmt);
+      auto blockStmt = static_cast<Block*>(stmt);
       return evalBlockStatement(ctx, blockStmt);
     }
     case NodeType::IF_STATEMENT: {
-      auto ifStmt = std::static_pointer_cast<IfStatement>(stmt);
+      auto ifStmt = static_cast<IfStatement*>(stmt);
       return evalIfStatement(ctx, ifStmt);
     }
     case NodeType::FOR_STATEMENT: {
-      auto forStmt = std::static_pointer_cast<ForStatement>(stmt);
+      auto forStmt = static_cast<ForStatement*>(stmt);
       return evalForStatement(ctx, forStmt);
     }
     case NodeType::WHILE_STATEMENT: {
-      auto whileStmt = std::static_pointer_cast<WhileStatement>(stmt);
+      auto whileStmt = static_cast<WhileStatement*>(stmt);
       return evalWhileStatement(ctx, whileStmt);
     }
     case NodeType::PRINT_STATEMENT: {
-      auto printStmt = std::static_pointer_cast<PrintStatement>(stmt);
+      auto printStmt = static_cast<PrintStatement*>(stmt);
       return evalPrintStatement(ctx, printStmt);
     }
     case NodeType::RETURN_STATEMENT: {
-      auto returnStmt = std::static_pointer_cast<ReturnStatement>(stmt);
+      auto returnStmt = static_cast<ReturnStatement*>(stmt);
       return evalReturnStatement(ctx, returnStmt);
     }
     case NodeType::BREAK_STATEMENT: {
-      auto breakStmt = std::static_pointer_cast<BreakStatement>(stmt);
+      auto breakStmt = static_cast<BreakStatement*>(stmt);
       return evalBreakStatement(ctx, breakStmt);
     }
     case NodeType::CONTINUE_STATEMENT: {
-      auto continueStmt = std::static_pointer_cast<ContinueStatement>(stmt);
+      auto continueStmt = static_cast<ContinueStatement*>(stmt);
       return evalContinueStatement(ctx, continueStmt);
     }
     case NodeType::EMPTY_STATEMENT:
     default:
-      return NULL_OBJECT_PTR;
+      return Value::nil();
   }
 }
 
-ObjectPtr Evaluator::evalVarDeclarationStatement(EnvironmentPtr ctx,
-                                                 VarDeclarationPtr stmt) {
-  ObjectPtr value = NULL_OBJECT_PTR;
+Value Evaluator::evalVarDeclarationStatement(EnvironmentPtr ctx,
+                                             VarDeclarationPtr stmt) {
+  Value value;
   if (stmt->initializer) {
     value = evalExpression(ctx, stmt->initializer);
   }
-  ctx->set(stmt->identifier, value);
+  assignVariable(ctx, stmt->address, value);
   return value;
 }
 
-ObjectPtr Evaluator::evalFuncDeclarationStatement(EnvironmentPtr ctx,
-                                                  FunctionDeclarationPtr stmt,
-                                                  FunctionType functionType) {
+Value Evaluator::evalFuncDeclarationStatement(EnvironmentPtr ctx,
+                                              FunctionDeclarationPtr stmt,
+                                              FunctionType functionType) {
   const auto& functionName = stmt->identifier;
   auto function = Function::make(ctx, functionType, stmt, functionName,
                                  stmt->params.size());
-  ctx->set(functionName, function);
+  heap.track(function);
+  if (functionType != FunctionType::TYPE_INITIALIZER) {
+    assignVariable(ctx, stmt->address, function);
+  }
   return function;
 }
 
-ObjectPtr Evaluator::evalClassDeclarationStatement(EnvironmentPtr ctx,
-                                                   ClassDeclarationPtr stmt) {
-  const auto& className = stmt->identifier;
-  auto classDeclaration = ClassObject::make(stmt);
+Value Evaluator::evalClassDeclarationStatement(EnvironmentPtr ctx,
+                                               ClassDeclarationPtr stmt) {
+  auto classDeclaration = ClassObject::make(stmt, ctx);
+  heap.track(classDeclaration);
+  // methods are shared by every record, which binds them when called.
+  for (const auto& method : stmt->methods) {
+    classDeclaration->methods.push_back(
+        Function::make(nullptr, FunctionType::TYPE_METHOD, method,
+                       method->identifier, method->params.size()));
+  }
+  if (stmt->ctor) {
+    classDeclaration->ctor =
+        Function::make(nullptr, FunctionType::TYPE_INITIALIZER, stmt->ctor,
+                       stmt->ctor->identifier, stmt->ctor->params.size());
+  }
   // classes live in the global ctx
-  globalCtx->set(className, classDeclaration);
+  assignVariable(ctx, stmt->address, classDeclaration);
   return classDeclaration;
 }
 
-ObjectPtr Evaluator::evalBlockStatement(EnvironmentPtr ctx, BlockPtr stmt) {
-  auto localCtx = Environment::make(ctx);
-  ObjectPtr lastValue = NULL_OBJECT_PTR;
-  for (const auto& stmt : stmt->statements) {
-    lastValue = evalStatement(localCtx, stmt);
-    if (isReturnObject(lastValue) || isBreakObject(lastValue) ||
-        isContinueObject(lastValue)) {
+Value Evaluator::evalBlockStatement(EnvironmentPtr ctx, BlockPtr stmt) {
+  auto localCtx = stmt->captured
+                      ? Environment::make(ctx, stmt->scopeSize)
+                      : Environment::makePooled(ctx, stmt->scopeSize);
+  Heap::TemporaryRoots roots(heap);
+  roots.add(localCtx);
+  return evalStatements(localCtx, stmt->statements);
+}
+
+Value Evaluator::evalStatements(EnvironmentPtr ctx,
+                                const std::vector<StatementPtr>& statements) {
+  Value lastValue;
+  for (const auto& stmt : statements) {
+    lastValue = evalStatement(ctx, stmt);
+    if (completion != Completion::NORMAL) {
       return lastValue;
     }
   }
   return lastValue;
 }
 
-ObjectPtr Evaluator::evalIfStatement(EnvironmentPtr ctx, IfStatementPtr stmt) {
+Value Evaluator::evalIfStatement(EnvironmentPtr ctx, IfStatementPtr stmt) {
   auto conditionValue = evalExpression(ctx, stmt->condition);
-  if (conditionValue->isTruthy()) {
+  if (conditionValue.isTruthy()) {
     return evalStatement(ctx, stmt->thenBranch);
   } else if (stmt->elseBranch != nullptr) {
     return evalStatement(ctx, stmt->elseBranch);
   } else {
-    return FALSE_OBJECT_PTR;
+    return Value::boolean(false);
   }
 }
 
-ObjectPtr Evaluator::evalForStatement(EnvironmentPtr ctx,
-                                      ForStatementPtr stmt) {
-  auto localCtx = Environment::make(ctx);
-  ObjectPtr lastValue = NULL_OBJECT_PTR;
-  lastValue = evalStatement(localCtx, stmt->initializer);
+Value Evaluator::evalForStatement(EnvironmentPtr ctx, ForStatementPtr stmt) {
+  auto localCtx = stmt->captured
+                      ? Environment::make(ctx, stmt->scopeSize)
+                      : Environment::makePooled(ctx, stmt->scopeSize);
+  Heap::TemporaryRoots roots(heap);
+  roots.add(localCtx);
+  Value lastValue = evalStatement(localCtx, stmt->initializer);
   while (true) {
     auto conditionValue = evalExpression(localCtx, stmt->condition);
     lastValue = conditionValue;
-    if (conditionValue->isFalsey()) {
+    if (conditionValue.isFalsey()) {
       break;
     }
     lastValue = evalStatement(localCtx, stmt->body);
-    if (isReturnObject(lastValue)) {
+    if (completion == Completion::RETURN) {
       return lastValue;
-    } else if (isBreakObject(lastValue)) {
-      return NULL_OBJECT_PTR;
+    } else if (completion == Completion::BREAK) {
+      completion = Completion::NORMAL;
+      return Value::nil();
     }
+    completion = Completion::NORMAL;
     lastValue = evalExpression(localCtx, stmt->increment);
+    loopTracer.onBackEdge(stmt, localCtx);
+    safePoint();
   }
   return lastValue;
 }
 
-ObjectPtr Evaluator::evalWhileStatement(EnvironmentPtr ctx,
-                                        WhileStatementPtr stmt) {
-  ObjectPtr lastValue = evalExpression(ctx, stmt->condition);
-  while (lastValue->isTruthy()) {
+Value Evaluator::evalWhileStatement(EnvironmentPtr ctx,
+                                    WhileStatementPtr stmt) {
+  Value lastValue = evalExpression(ctx, stmt->condition);
+  while (lastValue.isTruthy()) {
     lastValue = evalStatement(ctx, stmt->body);
-    if (isReturnObject(lastValue)) {
+    if (completion == Completion::RETURN) {
       return lastValue;
-    } else if (isBreakObject(lastValue)) {
-      return NULL_OBJECT_PTR;
+    } else if (completion == Completion::BREAK) {
+      completion = Completion::NORMAL;
+      return Value::nil();
     }
+    completion = Completion::NORMAL;
+    loopTracer.onBackEdge(stmt, ctx);
+    safePoint();
     lastValue = evalExpression(ctx, stmt->condition);
   }
   return lastValue;
 }
 
-ObjectPtr Evaluator::evalPrintStatement(EnvironmentPtr ctx,
-                                        PrintStatementPtr stmt) {
-  ObjectPtr lastValue = evalExpression(ctx, stmt->expression);
-  std::cout << lastValue->toString() << std::endl;
+Value Evaluator::evalPrintStatement(EnvironmentPtr ctx,
+                                    PrintStatementPtr stmt) {
+  Value lastValue = evalExpression(ctx, stmt->expression);
+  std::cout << lastValue.toString() << std::endl;
   return lastValue;
 }
 
-ObjectPtr Evaluator::evalReturnStatement(EnvironmentPtr ctx,
-                                         ReturnStatementPtr stmt) {
-  ObjectPtr lastValue = evalExpression(ctx, stmt->expression);
-  return ReturnObject::make(lastValue);
+Value Evaluator::evalReturnStatement(EnvironmentPtr ctx,
+                                     ReturnStatementPtr stmt) {
+  Value lastValue;
+  if (stmt->expression) {
+    if (stmt->expression->Type == NodeType::CALL_EXPRESSION &&
+        frames.depth() > 0) {
+      auto callExpr = static_cast<CallExpr*>(stmt->expression);
+      lastValue = evalCallExpression(ctx, callExpr, true);
+    } else {
+      lastValue = evalOperand(ctx, stmt->operand, stmt->expression);
+    }
+  }
+  completion = Completion::RETURN;
+  return lastValue;
 }
 
-ObjectPtr Evaluator::evalBreakStatement(EnvironmentPtr ctx,
-                                        BreakStatementPtr stmt) {
-  return BreakObject::make();
+Value Evaluator::evalBreakStatement(EnvironmentPtr ctx,
+                                    BreakStatementPtr stmt) {
+  completion = Completion::BREAK;
+  return Value::nil();
 }
 
-ObjectPtr Evaluator::evalContinueStatement(EnvironmentPtr ctx,
-                                           ContinueStatementPtr stmt) {
-  return ContinueObject::make();
+Value Evaluator::evalContinueStatement(EnvironmentPtr ctx,
+                                       ContinueStatementPtr stmt) {
+  completion = Completion::CONTINUE;
+  return Value::nil();
 }
 
-ObjectPtr Evaluator::evalExpression(EnvironmentPtr ctx, ExpressionPtr expr) {
+Value Evaluator::evalExpression(EnvironmentPtr ctx, ExpressionPtr expr) {
   switch (expr->Type) {
     case NodeType::INTEGER_LITERAL: {
-      auto intExpr = std::static_pointer_cast<IntegerLiteral>(expr);
+      auto intExpr = static_cast<IntegerLiteral*>(expr);
       return evalIntegerLiteral(ctx, intExpr);
     }
     case NodeType::BOOLEAN_LITERAL: {
-      auto boolExpr = std::static_pointer_cast<BooleanLiteral>(expr);
+      auto boolExpr = static_cast<BooleanLiteral*>(expr);
       return evalBooleanLiteral(ctx, boolExpr);
     }
     case NodeType::STRING_LITERAL: {
-      auto stringExpr = std::static_pointer_cast<StringLiteral>(expr);
+      auto stringExpr = static_cast<StringLiteral*>(expr);
       return evalStringLiteral(ctx, stringExpr);
     }
     case NodeType::ARRAY_LITERAL: {
-      auto arrayExpr = std::static_pointer_cast<ArrayLiteral>(expr);
+      auto arrayExpr = static_cast<ArrayLiteral*>(expr);
       return evalArrayLiteral(ctx, arrayExpr);
     }
     case NodeType::ARRAY_SUBSCRIPT_EXPRESSION: {
-      auto arraySubscriptExpr =
-          std::static_pointer_cast<ArraySubscriptExpr>(expr);
+      auto arraySubscriptExpr = static_cast<ArraySubscriptExpr*>(expr);
       return evalArraySubscriptExpression(ctx, arraySubscriptExpr);
     }
     case NodeType::NIL_LITERAL: {
-      auto nilExpr = std::static_pointer_cast<NilLiteral>(expr);
+      auto nilExpr = static_cast<NilLiteral*>(expr);
       return evalNilLiteral(ctx, nilExpr);
     }
     case NodeType::UNARY_EXPRESSION: {
-      auto unaryExpr = std::static_pointer_cast<UnaryExpr>(expr);
+      auto unaryExpr = static_cast<UnaryExpr*>(expr);
       return evalUnaryExpression(ctx, unaryExpr);
     }
     case NodeType::BINARY_EXPRESSION: {
-      auto binaryExpr = std::static_pointer_cast<BinaryExpr>(expr);
+      auto binaryExpr = static_cast<BinaryExpr*>(expr);
       return evalBinaryExpression(ctx, binaryExpr);
     }
     case NodeType::VARIABLE_EXPRESSION: {
-      auto varExpr = std::static_pointer_cast<VariableExpr>(expr);
-      return ctx->get(varExpr->identifier);
+      auto varExpr = static_cast<VariableExpr*>(expr);
+      return evalVariableExpr(ctx, *varExpr);
     }
     case NodeType::ASSIGNMENT_EXPRESSION: {
-      auto assignExpr = std::static_pointer_cast<Assignment>(expr);
+      auto assignExpr = static_cast<Assignment*>(expr);
       return evalAssignExpression(ctx, assignExpr);
     }
     case NodeType::CALL_EXPRESSION: {
-      auto callExpr = std::static_pointer_cast<CallExpr>(expr);
+      auto callExpr = static_cast<CallExpr*>(expr);
       return evalCallExpression(ctx, callExpr);
     }
     case NodeType::MEMBER_EXPRESSION: {
-      auto memberExpr = std::static_pointer_cast<MemberExpr>(expr);
+      auto memberExpr = static_cast<MemberExpr*>(expr);
       return evalMemberExpr(ctx, memberExpr);
     }
     default:
       break;
   }
-  return NULL_OBJECT_PTR;
+  return Value::nil();
 }
 
-ObjectPtr Evaluator::evalAssignExpression(EnvironmentPtr ctx,
-                                          AssignmentPtr expr) {
-  const auto& identifier = expr->identifier;
-  auto value = evalExpression(ctx, expr->value);
-  ctx->set(identifier, value);
-  return ctx->get(identifier);
+Value Evaluator::evalOperand(const EnvironmentPtr& ctx, Operand operand,
+                             const ExpressionPtr& expr) {
+  switch (operand) {
+    case Operand::VARIABLE:
+      return evalVariableExpr(ctx, static_cast<const VariableExpr&>(*expr));
+    case Operand::CONSTANT:
+      return static_cast<const IntegerLiteral&>(*expr).constant;
+    default:
+      return evalExpression(ctx, expr);
+  }
 }
 
-ObjectPtr Evaluator::evalCallExpression(EnvironmentPtr ctx, CallExprPtr expr) {
-  auto value = evalExpression(ctx, expr->left);
-  if (isReturnObject(value)) {
-    auto returnValue = std::dynamic_pointer_cast<ReturnObject>(value);
-    value = returnValue->Value;
+Value Evaluator::bindMethod(const Value& method,
+                            const EnvironmentPtr& recordCtx) {
+  auto function = method.as<Function>()->bind(recordCtx);
+  heap.track(function);
+  return function;
+}
+
+Value Evaluator::evalVariableExpr(const EnvironmentPtr& ctx,
+                                  const VariableExpr& expr) {
+  // a method read by name becomes a value of its own.
+  if (expr.method >= 0) {
+    auto* record = receiverOf(ctx, expr);
+    return bindMethod(record->getMethod(expr.method), EnvironmentPtr(record));
+  }
+  return lookupVariable(ctx, expr.address);
+}
+
+Value Evaluator::evalAssignExpression(EnvironmentPtr ctx, AssignmentPtr expr) {
+  if (expr->increment) {
+    const auto current = lookupVariable(ctx, expr->address);
+    Value result;
+    if (current.isInteger() &&
+        evalIntegerOperator(TokenType::TOKEN_PLUS, current.asInteger(),
+                            expr->step, result)) {
+      assignVariable(ctx, expr->address, result);
+      return result;
+    }
   }
+  auto value = evalExpression(ctx, expr->value);
+  assignVariable(ctx, expr->address, value);
+  return value;
+}
+
+Value Evaluator::evalCallExpression(EnvironmentPtr ctx, CallExprPtr expr,
+                                   bool tailPosition) {
+  EnvironmentPtr recordCtx;
+  auto value = evalCallee(ctx, expr->left, recordCtx);
   if (!isCallable(value)) {
     std::ostringstream ss;
-    ss << "Invalid callable: " << value->toString();
+    ss << "Invalid callable: " << value.toString();
     throw RuntimeError::make(__FILE__, __LINE__, ss.str());
   }
-  if (value->Type == ObjectType::OBJ_FUNCTION) {
-    auto funcValue = std::dynamic_pointer_cast<Function>(value);
-    assert(funcValue != nullptr);
-    return evalFunctionCall(ctx, funcValue, expr);
-  } else if (value->Type == ObjectType::OBJ_CLASS) {
-    auto classDeclValue = std::dynamic_pointer_cast<ClassObject>(value);
-    return evalClassCall(ctx, classDeclValue, expr);
+  // the arguments may reach a safe point, and the callee may be a
+  // temporary like the record a method was read from.
+  Heap::TemporaryRoots roots(heap);
+  roots.add(value);
+  roots.add(recordCtx);
+  if (value.type() == ObjectType::OBJ_FUNCTION) {
+    auto function = value.as<Function>();
+    if (!function->isUnbound()) {
+      recordCtx = function->getEnclosingCtx();
+    }
+    if (tailPosition) {
+      auto args = evalArguments(ctx, function, expr);
+      tailCall = TailCall{std::move(function), std::move(recordCtx),
+                          std::move(args)};
+      return Value::nil();
+    }
+    return evalFunctionCall(ctx, function, expr, recordCtx);
+  } else if (value.type() == ObjectType::OBJ_CLASS) {
+    return evalClassCall(ctx, value.as<ClassObject>(), expr);
   }
   throw RuntimeError::make(__FILE__, __LINE__, "Invalid callable");
 }
 
-ObjectPtr Evaluator::evalFunctionCall(EnvironmentPtr ctx, FunctionPtr callee,
-                                      CallExprPtr expr) {
-  auto funcDeclStmt = callee->getDeclaration();
-  auto funcCtx = callee->getCtx();
-  // bind arguments
-  for (size_t i = 0; i < funcDeclStmt->params.size(); i++) {
-    const auto paramName = funcDeclStmt->params[i];
-    auto argExpr = expr->arguments[i];
-    auto argValue = evalExpression(ctx, argExpr);
-    funcCtx->declare(paramName, argValue);
-  }
-  // execute function body
-  auto lastValue = evalStatement(funcCtx, funcDeclStmt->body);
-  if (isReturnObject(lastValue)) {
-    auto returnValue = std::dynamic_pointer_cast<ReturnObject>(lastValue);
-    assert(returnValue != nullptr);
-    return returnValue->Value;
-  } else if (isBreakObject(lastValue) || isContinueObject(lastValue)) {
+Value Evaluator::evalCallee(EnvironmentPtr ctx, ExpressionPtr expr,
+                            EnvironmentPtr& recordCtx) {
+  if (expr->Type == NodeType::MEMBER_EXPRESSION) {
+    auto memberExpr = static_cast<MemberExpr*>(expr);
+    return lookupMethod(ctx, memberExpr, recordCtx);
+  }
+  if (expr->Type == NodeType::VARIABLE_EXPRESSION) {
+    const auto& varExpr = static_cast<const VariableExpr&>(*expr);
+    if (varExpr.method >= 0) {
+      auto* record = receiverOf(ctx, varExpr);
+      recordCtx = EnvironmentPtr(record);
+      return record->getMethod(varExpr.method);
+    }
+    return lookupVariable(ctx, varExpr.address);
+  }
+  return evalExpression(ctx, expr);
+}
+
+Value Evaluator::evalFunctionCall(EnvironmentPtr ctx, const FunctionPtr& callee,
+                                  CallExprPtr expr,
+                                  const EnvironmentPtr& enclosingCtx) {
+  return callFunction(callee, enclosingCtx, evalArguments(ctx, callee, expr));
+}
+
+std::vector<Value> Evaluator::evalArguments(EnvironmentPtr ctx,
+                                            const FunctionPtr& callee,
+                                            CallExprPtr expr) {
+  // evaluate every argument before binding any of them, so a recursive call
+  // in an argument cannot clobber the parameters being bound.
+  const auto arity = callee->getDeclaration()->params.size();
+  std::vector<Value> args;
+  args.reserve(arity);
+  Heap::TemporaryRoots roots(heap);
+  for (size_t i = 0; i < arity; i++) {
+    args.push_back(evalExpression(ctx, expr->arguments[i]));
+    roots.add(args.back());
+  }
+  return args;
+}
+
+Value Evaluator::callFunction(FunctionPtr callee, EnvironmentPtr enclosingCtx,
+                              std::vector<Value> args) {
+  // frames live on the heap, but each nested call also takes native stack,
+  // and native code needs the reserved area to recurse into.
+  const auto maxCallDepth = Settings::getInstance()->getMaxCallDepth();
+  if (frames.depth() >= static_cast<size_t>(std::max(maxCallDepth, 0)) ||
+      NativeStack::isExhausted()) {
     std::ostringstream ss;
-    ss << "Invalid statement: " << funcDeclStmt->toString();
+    ss << "Stack overflow: " << frames.depth() << " nested calls";
     throw RuntimeError::make(__FILE__, __LINE__, ss.str());
   }
-  return lastValue;
+
+  Value jitValue;
+  if (evalJitCall(callee, args, jitValue)) {
+    return jitValue;
+  }
+
+  // every call gets its own frame, so recursive calls keep their locals.
+  auto funcDeclStmt = callee->getDeclaration();
+  CallFrame frame(frames, std::move(enclosingCtx), funcDeclStmt->scopeSize);
+  // native code recurses on the native stack, so once it bails out of a
+  // chain of tail calls the rest of the chain is interpreted.
+  bool tryJit = true;
+  while (true) {
+    const auto& funcCtx = frame.getCtx();
+    // bind arguments, params take the first slots.
+    for (size_t i = 0; i < args.size(); i++) {
+      funcCtx->set(i, std::move(args[i]));
+    }
+    // the frame roots the arguments now, and tail calls get here too.
+    safePoint();
+    // execute function body, its outermost block lives in the frame too.
+    Value lastValue;
+    if (funcDeclStmt->body->Type == NodeType::BLOCK_STATEMENT) {
+      auto body = static_cast<Block*>(funcDeclStmt->body);
+      lastValue = evalStatements(funcCtx, body->statements);
+    } else {
+      lastValue = evalStatement(funcCtx, funcDeclStmt->body);
+    }
+    if (completion == Completion::RETURN) {
+      completion = Completion::NORMAL;
+    } else if (completion != Completion::NORMAL) {
+      completion = Completion::NORMAL;
+      std::ostringstream ss;
+      ss << "Invalid statement: " << funcDeclStmt->toString();
+      throw RuntimeError::make(__FILE__, __LINE__, ss.str());
+    }
+    if (tailCall.callee == nullptr) {
+      return lastValue;
+    }
+
+    // a tail call replaces this call's frame instead of nesting in it.
+    auto next = std::move(tailCall);
+    tailCall = TailCall{};
+    callee = std::move(next.callee);
+    args = std::move(next.args);
+    if (tryJit) {
+      if (evalJitCall(callee, args, jitValue)) {
+        return jitValue;
+      }
+      tryJit = callee->getJitCode() == nullptr;
+    }
+    funcDeclStmt = callee->getDeclaration();
+    frame.reuse(std::move(next.enclosingCtx), funcDeclStmt->scopeSize);
+  }
 }
 
-ObjectPtr Evaluator::evalClassCall(EnvironmentPtr ctx, ClassObjectPtr callee,
-                                   CallExprPtr expr) {
-  auto recordCtx = Environment::make(ctx);
-  auto recordObj = Record::make(recordCtx, callee->declaration);
-  recordCtx->declare("self", recordObj);
+bool Evaluator::evalJitCall(const FunctionPtr& callee,
+                            const std::vector<Value>& args, Value& result) {
+  auto settings = Settings::getInstance();
+  if (!settings->isJitEnabled() ||
+      callee->getType() != FunctionType::TYPE_FUNCTION) {
+    return false;
+  }
+  auto jitCode = callee->getJitCode();
+  if (!jitCode) {
+    if (callee->isJitFailed() ||
+        callee->incrCallCount() < settings->getJitThreshold()) {
+      return false;
+    }
+    jitCode = JitCompiler::compile(callee->getDeclaration());
+    if (!jitCode) {
+      callee->markJitFailed();
+      return false;
+    }
+    callee->setJitCode(jitCode);
+  }
 
-  auto classDecl = callee->declaration;
-  for (auto& field : classDecl->fields) {
-    const auto& fieldName = field->identifier;
-    auto fieldValue = evalVarDeclarationStatement(recordCtx, field);
-    recordObj->setField(fieldName, fieldValue);
+  // native code only handles integers and calls itself by name, so check
+  // those assumptions still hold for this call.
+  std::vector<int64_t> intArgs;
+  intArgs.reserve(args.size());
+  for (const auto& arg : args) {
+    if (!arg.isInteger()) {
+      return false;
+    }
+    intArgs.push_back(arg.asInteger());
+  }
+  const auto& address = callee->getDeclaration()->address;
+  if (lookupVariable(callee->getEnclosingCtx(), address).asObject() !=
+      callee.get()) {
+    return false;
   }
 
-  for (auto& method : classDecl->methods) {
-    const auto& methodName = method->identifier;
-    const auto arity = method->params.size();
-    auto functionObj = evalFuncDeclarationStatement(recordCtx, method,
-                                                    FunctionType::TYPE_METHOD);
-    assert(functionObj->Type == ObjectType::OBJ_FUNCTION);
-    auto methodObj = std::dynamic_pointer_cast<Function>(functionObj);
-    assert(methodObj != nullptr);
-    recordObj->setMethod(methodName, methodObj);
+  int64_t nativeResult;
+  if (!jitCode->call(intArgs.data(), nativeResult)) {
+    // bailout: the code has no side effects, so just interpret the call.
+    return false;
+  }
+  result = Value::integer(nativeResult);
+  return true;
+}
+
+Value Evaluator::evalClassCall(EnvironmentPtr ctx, ClassObjectPtr callee,
+                               CallExprPtr expr) {
+  auto record = Record::make(callee);
+  heap.track(record);
+  Heap::TemporaryRoots roots(heap);
+  roots.add(record);
+  record->set(Resolver::SELF_SLOT, record);
+
+  // fields go straight into the slots the shape maps them to, methods stay
+  // in the class.
+  for (auto& field : callee->declaration->fields) {
+    evalVarDeclarationStatement(record, field);
   }
 
-  // If we have a ctor, invoke it.
-  if (callee->declaration->ctor) {
-    // we don't store ctors, they are invoked only once per object.
-    auto functionObj = evalFuncDeclarationStatement(
-        recordCtx, callee->declaration->ctor, FunctionType::TYPE_INITIALIZER);
-    assert(functionObj->Type == ObjectType::OBJ_FUNCTION);
-    auto ctor = std::dynamic_pointer_cast<Function>(functionObj);
-    assert(ctor != nullptr);
-    evalFunctionCall(recordCtx, ctor, expr);
+  // ctors are invoked only once per record.
+  if (callee->ctor) {
+    evalFunctionCall(ctx, callee->ctor, expr, record);
   }
-  return recordObj;
+  return record;
+}
+
+Value Evaluator::evalIntegerLiteral(EnvironmentPtr ctx,
+                                    IntegerLiteralPtr expr) {
+  return expr->constant;
 }
 
-IntegerObjectPtr Evaluator::evalIntegerLiteral(EnvironmentPtr ctx,
-                                               IntegerLiteralPtr expr) {
-  return std::make_shared<IntegerObject>(expr->Value);
+Value Evaluator::evalMemberExpr(EnvironmentPtr ctx, MemberExprPtr expr) {
+  EnvironmentPtr recordCtx;
+  auto value = lookupMethod(ctx, expr, recordCtx);
+  if (isUnboundMethod(value)) {
+    return bindMethod(value, recordCtx);
+  }
+  return value;
 }
 
-ObjectPtr Evaluator::evalMemberExpr(EnvironmentPtr ctx, MemberExprPtr expr) {
+Value Evaluator::lookupMethod(EnvironmentPtr ctx, MemberExprPtr expr,
+                              EnvironmentPtr& recordCtx) {
   auto varValue = evalExpression(ctx, expr->left);
-  if (varValue->Type == ObjectType::OBJ_RECORD) {
-    auto recordValue = std::dynamic_pointer_cast<Record>(varValue);
-    assert(recordValue != nullptr);
-    auto memberIdentifier = expr->member;
-    if (recordValue->methods.find(memberIdentifier) !=
-        recordValue->methods.end()) {
-      return recordValue->methods[memberIdentifier];
-    }
-    return NULL_OBJECT_PTR;
+  if (varValue.type() == ObjectType::OBJ_RECORD) {
+    auto record = static_cast<Record*>(varValue.asObject());
+    const auto method = lookupMember(expr, record);
+    if (method >= 0) {
+      recordCtx = EnvironmentPtr(record);
+      return record->getMethod(method);
+    }
+    return Value::nil();
   } else {
     std::ostringstream ss;
     ss << "Invalid member expression: " << expr->toString();
@@ -397,66 +725,79 @@ ObjectPtr Evaluator::evalMemberExpr(EnvironmentPtr ctx, MemberExprPtr expr) {
   }
 }
 
-BooleanObjectPtr Evaluator::evalBooleanLiteral(EnvironmentPtr ctx,
-                                               BooleanLiteralPtr expr) {
+Value Evaluator::evalBooleanLiteral(EnvironmentPtr ctx,
+                                    BooleanLiteralPtr expr) {
   if (expr->Value) {
-    return TRUE_OBJECT_PTR;
+    return Value::boolean(true);
   } else {
-    return FALSE_OBJECT_PTR;
+    return Value::boolean(false);
   }
 }
 
-NullObjectPtr Evaluator::evalNilLiteral(EnvironmentPtr ctx,
-                                        NilLiteralPtr expr) {
-  return NULL_OBJECT_PTR;
+Value Evaluator::evalNilLiteral(EnvironmentPtr ctx, NilLiteralPtr expr) {
+  return Value::nil();
 }
 
-StringObjectPtr Evaluator::evalStringLiteral(EnvironmentPtr ctx,
-                                             StringLiteralPtr expr) {
-  return std::make_shared<StringObject>(expr->Value);
+Value Evaluator::evalStringLiteral(EnvironmentPtr ctx, StringLiteralPtr expr) {
+  return expr->constant;
 }
 
-ArrayObjectPtr Evaluator::evalArrayLiteral(EnvironmentPtr ctx,
-                                           ArrayLiteralPtr expr) {
-  std::vector<ObjectPtr> elements;
-  for (auto elementExpr : expr->elements) {
-    auto elementValue = evalExpression(ctx, elementExpr);
-    elements.push_back(elementValue);
+Value Evaluator::evalArrayLiteral(EnvironmentPtr ctx, ArrayLiteralPtr expr) {
+  std::vector<Value> elements;
+  elements.reserve(expr->elements.size());
+  Heap::TemporaryRoots roots(heap);
+  for (const auto& elementExpr : expr->elements) {
+    elements.push_back(evalExpression(ctx, elementExpr));
+    roots.add(elements.back());
   }
-  return ArrayObject::make(elements);
+  return ArrayObject::make(std::move(elements));
 }
 
-ObjectPtr Evaluator::evalArraySubscriptExpression(EnvironmentPtr ctx,
-                                                  ArraySubscriptExprPtr expr) {
-  auto arrayValue = evalExpression(ctx, expr->array);
-  auto indexValue = evalExpression(ctx, expr->index);
-  if (arrayValue->Type != ObjectType::OBJ_ARRAY) {
+Value Evaluator::evalArraySubscriptExpression(EnvironmentPtr ctx,
+                                              ArraySubscriptExprPtr expr) {
+  auto arrayValue = evalOperand(ctx, expr->arrayOperand, expr->array);
+  Heap::TemporaryRoots roots(heap);
+  roots.add(arrayValue);
+  auto indexValue = evalOperand(ctx, expr->indexOperand, expr->index);
+  if (arrayValue.type() != ObjectType::OBJ_ARRAY) {
     std::ostringstream ss;
-    ss << "Invalid array: " << arrayValue->toString();
+    ss << "Invalid array: " << arrayValue.toString();
     throw RuntimeError::make(__FILE__, __LINE__, ss.str());
   }
-  if (indexValue->Type != ObjectType::OBJ_INTEGER) {
+  if (!indexValue.isInteger()) {
     std::ostringstream ss;
-    ss << "Invalid index: " << indexValue->toString();
+    ss << "Invalid index: " << indexValue.toString();
     throw RuntimeError::make(__FILE__, __LINE__, ss.str());
   }
-  auto arrayObject = std::dynamic_pointer_cast<ArrayObject>(arrayValue);
-  auto indexObject = std::dynamic_pointer_cast<IntegerObject>(indexValue);
-  assert(arrayObject != nullptr);
-  assert(indexObject != nullptr);
-  if (indexObject->Value < 0 ||
-      indexObject->Value >= arrayObject->Values.size()) {
+  const auto& values = static_cast<ArrayObject*>(arrayValue.asObject())->Values;
+  const auto index = indexValue.asInteger();
+  if (index < 0 || static_cast<size_t>(index) >= values.size()) {
     std::ostringstream ss;
-    ss << "Index out of range: " << indexObject->Value;
+    ss << "Index out of range: " << index;
     throw RuntimeError::make(__FILE__, __LINE__, ss.str());
   }
-  return arrayObject->Values[indexObject->Value];
-}
-
-ObjectPtr Evaluator::evalBinaryExpression(EnvironmentPtr ctx,
-                                          BinaryExprPtr expr) {
-  auto leftValue = evalExpression(ctx, expr->left);
-  auto rightValue = evalExpression(ctx, expr->right);
+  return values[index];
+}
+
+Value Evaluator::evalBinaryExpression(EnvironmentPtr ctx, BinaryExprPtr expr) {
+  auto leftValue = evalOperand(ctx, expr->leftOperand, expr->left);
+  Heap::TemporaryRoots roots(heap);
+  roots.add(leftValue);
+  auto rightValue = evalOperand(ctx, expr->rightOperand, expr->right);
+  if (expr->feedback != BinaryExpr::Feedback::GENERIC) {
+    const bool integers = leftValue.isInteger() && rightValue.isInteger();
+    if (!integers) {
+      // the guard failed, the site goes back to the generic operators.
+      expr->feedback = BinaryExpr::Feedback::GENERIC;
+    } else {
+      expr->feedback = BinaryExpr::Feedback::INTEGER;
+      Value result;
+      if (evalIntegerOperator(expr->operator_.type, leftValue.asInteger(),
+                              rightValue.asInteger(), result)) {
+        return result;
+      }
+    }
+  }
   switch (expr->operator_.type) {
     case TokenType::TOKEN_PLUS:
     case TokenType::TOKEN_MINUS:
@@ -480,12 +821,11 @@ ObjectPtr Evaluator::evalBinaryExpression(EnvironmentPtr ctx,
     }
     default:
       // TODO: throw RuntimeError
-      return NULL_OBJECT_PTR;
+      return Value::nil();
   }
 }
 
-ObjectPtr Evaluator::evalUnaryExpression(EnvironmentPtr ctx,
-                                         UnaryExprPtr expr) {
+Value Evaluator::evalUnaryExpression(EnvironmentPtr ctx, UnaryExprPtr expr) {
   auto rhsValue = evalExpression(ctx, expr->right);
 
   switch (expr->operator_.type) {
@@ -502,11 +842,10 @@ ObjectPtr Evaluator::evalUnaryExpression(EnvironmentPtr ctx,
   }
 }
 
-ObjectPtr Evaluator::evalLogicOperator(EnvironmentPtr ctx, ObjectPtr lhsValue,
-                                       TokenType operator_,
-                                       ObjectPtr rhsValue) {
-  auto lhsBoolValue = lhsValue->isTruthy();
-  auto rhsBoolValue = rhsValue->isTruthy();
+Value Evaluator::evalLogicOperator(EnvironmentPtr ctx, const Value& lhsValue,
+                                   TokenType operator_, const Value& rhsValue) {
+  auto lhsBoolValue = lhsValue.isTruthy();
+  auto rhsBoolValue = rhsValue.isTruthy();
   bool result = false;
   switch (operator_) {
     case TokenType::TOKEN_AND:
@@ -518,105 +857,107 @@ ObjectPtr Evaluator::evalLogicOperator(EnvironmentPtr ctx, ObjectPtr lhsValue,
     default:
       std::ostringstream ss;
       ss << "Invalid binary operands for logic operator: "
-         << lhsValue->toString() << (int)operator_ << rhsValue->toString();
+         << lhsValue.toString() << (int)operator_ << rhsValue.toString();
       throw RuntimeError::make(__FILE__, __LINE__, ss.str());
   }
-  return BooleanObject::make(result);
+  return Value::boolean(result);
 }
 
-ObjectPtr Evaluator::evalComparisonOperator(EnvironmentPtr ctx,
-                                            ObjectPtr lhsValue,
-                                            TokenType operator_,
-                                            ObjectPtr rhsValue) {
+Value Evaluator::evalComparisonOperator(EnvironmentPtr ctx,
+                                        const Value& lhsValue,
+                                        TokenType operator_,
+                                        const Value& rhsValue) {
   bool result = false;
   switch (operator_) {
     case TokenType::TOKEN_EQUAL_EQUAL:
-      result = lhsValue->isEqual(*rhsValue);
+      result = lhsValue.isEqual(rhsValue);
       break;
     case TokenType::TOKEN_BANG_EQUAL:
-      result = !lhsValue->isEqual(*rhsValue);
+      result = !lhsValue.isEqual(rhsValue);
       break;
     case TokenType::TOKEN_LESS: {
       auto lhsIntValue = tryCastAsInteger(lhsValue);
       auto rhsIntValue = tryCastAsInteger(rhsValue);
-      result = lhsIntValue->Value < rhsIntValue->Value;
+      result = lhsIntValue < rhsIntValue;
       break;
     }
     case TokenType::TOKEN_LESS_EQUAL: {
       auto lhsIntValue = tryCastAsInteger(lhsValue);
       auto rhsIntValue = tryCastAsInteger(rhsValue);
-      result = lhsIntValue->Value <= rhsIntValue->Value;
+      result = lhsIntValue <= rhsIntValue;
       break;
     }
     case TokenType::TOKEN_GREATER: {
       auto lhsIntValue = tryCastAsInteger(lhsValue);
       auto rhsIntValue = tryCastAsInteger(rhsValue);
-      result = lhsIntValue->Value > rhsIntValue->Value;
+      result = lhsIntValue > rhsIntValue;
       break;
     }
     case TokenType::TOKEN_GREATER_EQUAL: {
       auto lhsIntValue = tryCastAsInteger(lhsValue);
       auto rhsIntValue = tryCastAsInteger(rhsValue);
-      result = lhsIntValue->Value >= rhsIntValue->Value;
+      result = lhsIntValue >= rhsIntValue;
       break;
     }
     default:
       std::ostringstream ss;
       ss << "Invalid operands types for comparison operator: "
-         << lhsValue->toString() << " " << (int)operator_
-         << rhsValue->toString();
+         << lhsValue.toString() << " " << (int)operator_
+         << rhsValue.toString();
       throw RuntimeError::make(__FILE__, __LINE__, ss.str());
   }
-  return BooleanObject::make(result);
+  return Value::boolean(result);
 }
 
-ObjectPtr Evaluator::evalBinaryOperator(EnvironmentPtr ctx, ObjectPtr lhsValue,
-                                        TokenType operator_,
-                                        ObjectPtr rhsValue) {
-  if (lhsValue->isNumeric() && rhsValue->isNumeric()) {
+Value Evaluator::evalBinaryOperator(EnvironmentPtr ctx, const Value& lhsValue,
+                                    TokenType operator_,
+                                    const Value& rhsValue) {
+  if (lhsValue.isInteger() && rhsValue.isInteger()) {
     auto lhsIntValue = tryCastAsInteger(lhsValue);
     auto rhsIntValue = tryCastAsInteger(rhsValue);
     int64_t result;
     switch (operator_) {
       case TokenType::TOKEN_STAR:
-        result = lhsIntValue->Value * rhsIntValue->Value;
+        result = lhsIntValue * rhsIntValue;
         break;
       case TokenType::TOKEN_SLASH:
-        result = lhsIntValue->Value / rhsIntValue->Value;
+        if (rhsIntValue == 0) {
+          throw RuntimeError::make(__FILE__, __LINE__, "Division by zero");
+        }
+        result = lhsIntValue / rhsIntValue;
         break;
       case TokenType::TOKEN_PLUS:
-        result = lhsIntValue->Value + rhsIntValue->Value;
+        result = lhsIntValue + rhsIntValue;
         break;
       case TokenType::TOKEN_MINUS:
-        result = lhsIntValue->Value - rhsIntValue->Value;
+        result = lhsIntValue - rhsIntValue;
         break;
       default:
         std::ostringstream ss;
         ss << "Invalid binary operator type: " << (int)operator_;
         throw RuntimeError::make(__FILE__, __LINE__, ss.str());
     }
-    return IntegerObject::make(result);
+    return Value::integer(result);
   }
   std::ostringstream ss;
-  ss << "Invalid binary operands: " << lhsValue->toString() << " and "
-     << rhsValue->toString();
+  ss << "Invalid binary operands: " << lhsValue.toString() << " and "
+     << rhsValue.toString();
   throw RuntimeError::make(__FILE__, __LINE__, ss.str());
 }
 
-ObjectPtr Evaluator::evalMinusOperator(EnvironmentPtr ctx, ObjectPtr rhsValue) {
-  auto intObj = tryCastAsInteger(rhsValue);
-  return IntegerObject::make(-intObj->Value);
+Value Evaluator::evalMinusOperator(EnvironmentPtr ctx, const Value& rhsValue) {
+  return Value::integer(-tryCastAsInteger(rhsValue));
 }
 
-ObjectPtr Evaluator::evalBangOperator(EnvironmentPtr ctx, ObjectPtr rhsValue) {
-  return BooleanObject::make(!rhsValue->isTruthy());
+Value Evaluator::evalBangOperator(EnvironmentPtr ctx, const Value& rhsValue) {
+  return Value::boolean(!rhsValue.isTruthy());
 }
 
-IntegerObjectPtr tryCastAsInteger(ObjectPtr obj) {
-  if (obj->Type == ObjectType::OBJ_INTEGER) {
-    return std::static_pointer_cast<IntegerObject>(obj);
+int64_t tryCastAsInteger(const Value& value) {
+  if (value.isInteger()) {
+    return value.asInteger();
   }
   std::ostringstream ss;
-  ss << "Cannot convert object to integer: " << obj->toString();
+  ss << "Cannot convert object to integer: " << value.toString();
   throw RuntimeError::make(__FILE__, __LINE__, ss.str());
 }
@@ -4,10 +4,15 @@
 #include "class_object.h"
 #include "common.h"
 #include "environment.h"
+#include "frame_stack.h"
 #include "function.h"
+#include "heap.h"
+#include "native_stack.h"
 #include "object.h"
 #include "record.h"
+#include "resolver.h"
 #include "settings.h"
+#include "trace.h"
 
 class RuntimeError : public std::runtime_error {
  public:
@@ -19,60 +24,131 @@ class RuntimeError : public std::runtime_error {
 
 class Evaluator {
  private:
+  // every program evaluated, which own the nodes that functions, classes,
+  // traces and native code refer to; they go last.
+  std::vector<ProgramPtr> programs;
   EnvironmentPtr globalCtx;
+  Resolver resolver;
+  FrameStack frames;
+  // how the statement evaluated last left, anything but NORMAL unwinds to
+  // the enclosing loop or call; a returned value is the statement's value.
+  Completion completion = Completion::NORMAL;
+  // call a return statement left for its caller to run in the returning
+  // frame, set while the RETURN completion unwinds.
+  struct TailCall {
+    FunctionPtr callee;
+    EnvironmentPtr enclosingCtx;
+    std::vector<Value> args;
+  };
+  TailCall tailCall;
+  LoopTracer loopTracer;
+  Heap heap;
+  // stack programs run on, mapped by the first eval and reused after.
+  std::unique_ptr<NativeStack> nativeStack;
 
  public:
   Evaluator();
+  // drops the globals before the heap, so it reclaims the cycles they held.
+  ~Evaluator();
 
+  // native stack set aside for each nested Lox call, a few times what a
+  // call with nested expressions takes; it is address space only until
+  // calls grow into it. Deeper expressions run out early and report a
+  // stack overflow.
+  static constexpr size_t NATIVE_FRAME_SIZE = 8 * 1024;
+
+  // runs program on a native stack sized for the maximum call depth, and
+  // keeps it for as long as the evaluator lives.
   ObjectPtr eval(ProgramPtr program);
   ObjectPtr getGlobalValue(const std::string& identifier) const {
-    return globalCtx->get(identifier);
+    const auto slot = resolver.findGlobal(identifier);
+    return slot >= 0 ? globalCtx->get(slot).toObject() : NULL_OBJECT_PTR;
   }
+  const LoopTracer& getLoopTracer() const { return loopTracer; }
+  // runs a full collection now, returns how many objects it reclaimed.
+  size_t collectGarbage() { return heap.collect(); }
+  Heap& getHeap() { return heap; }
 
  private:
-  ObjectPtr evalStatement(EnvironmentPtr ctx, StatementPtr stmt);
-  ObjectPtr evalVarDeclarationStatement(EnvironmentPtr ctx,
-                                        VarDeclarationPtr stmt);
-  ObjectPtr evalFuncDeclarationStatement(EnvironmentPtr ctx,
-                                         FunctionDeclarationPtr stmt,
-                                         FunctionType functionType);
-  ObjectPtr evalClassDeclarationStatement(EnvironmentPtr ctx,
-                                          ClassDeclarationPtr stmt);
-  ObjectPtr evalIfStatement(EnvironmentPtr ctx, IfStatementPtr stmt);
-  ObjectPtr evalForStatement(EnvironmentPtr ctx, ForStatementPtr stmt);
-  ObjectPtr evalWhileStatement(EnvironmentPtr ctx, WhileStatementPtr stmt);
-  ObjectPtr evalPrintStatement(EnvironmentPtr ctx, PrintStatementPtr stmt);
-  ObjectPtr evalReturnStatement(EnvironmentPtr ctx, ReturnStatementPtr stmt);
-  ObjectPtr evalBreakStatement(EnvironmentPtr ctx, BreakStatementPtr stmt);
-  ObjectPtr evalContinueStatement(EnvironmentPtr ctx,
-                                  ContinueStatementPtr stmt);
-  ObjectPtr evalBlockStatement(EnvironmentPtr ctx, BlockPtr stmt);
+  ObjectPtr evalProgram(const ProgramPtr& program);
+  // takes a step of collection when due. Only called where every object
+  // the evaluation still uses is reachable from the roots of the heap.
+  void safePoint() {
+    if (heap.shouldCollect()) {
+      heap.step();
+    }
+  }
+  Value lookupVariable(const EnvironmentPtr& ctx,
+                       const LexicalAddress& address);
+  void assignVariable(const EnvironmentPtr& ctx,
+                      const LexicalAddress& address, Value value);
 
-  ObjectPtr evalExpression(EnvironmentPtr ctx, ExpressionPtr expr);
-  ObjectPtr evalBinaryExpression(EnvironmentPtr ctx, BinaryExprPtr expr);
-  ObjectPtr evalUnaryExpression(EnvironmentPtr ctx, UnaryExprPtr expr);
-  ObjectPtr evalAssignExpression(EnvironmentPtr ctx, AssignmentPtr expr);
-  ObjectPtr evalCallExpression(EnvironmentPtr ctx, CallExprPtr expr);
-  ObjectPtr evalFunctionCall(EnvironmentPtr ctx, FunctionPtr callee,
-                             CallExprPtr expr);
-  ObjectPtr evalClassCall(EnvironmentPtr ctx, ClassObjectPtr callee,
-                          CallExprPtr expr);
-  ObjectPtr evalMemberExpr(EnvironmentPtr ctx, MemberExprPtr expr);
-  IntegerObjectPtr evalIntegerLiteral(EnvironmentPtr ctx,
-                                      IntegerLiteralPtr expr);
-  BooleanObjectPtr evalBooleanLiteral(EnvironmentPtr ctx,
-                                      BooleanLiteralPtr expr);
-  NullObjectPtr evalNilLiteral(EnvironmentPtr ctx, NilLiteralPtr expr);
-  StringObjectPtr evalStringLiteral(EnvironmentPtr ctx, StringLiteralPtr expr);
-  ArrayObjectPtr evalArrayLiteral(EnvironmentPtr ctx, ArrayLiteralPtr expr);
-  ObjectPtr evalArraySubscriptExpression(EnvironmentPtr ctx,
-                                         ArraySubscriptExprPtr expr);
-  ObjectPtr evalBinaryOperator(EnvironmentPtr ctx, ObjectPtr lhsValue,
-                               TokenType operator_, ObjectPtr rhsValue);
-  ObjectPtr evalLogicOperator(EnvironmentPtr ctx, ObjectPtr lhsValue,
-                              TokenType operator_, ObjectPtr rhsValue);
-  ObjectPtr evalComparisonOperator(EnvironmentPtr ctx, ObjectPtr lhsValue,
-                                   TokenType operator_, ObjectPtr rhsValue);
-  ObjectPtr evalMinusOperator(EnvironmentPtr ctx, ObjectPtr rhsValue);
-  ObjectPtr evalBangOperator(EnvironmentPtr ctx, ObjectPtr rhsValue);
-};
\ No newline at end of file
+  Value evalStatement(EnvironmentPtr ctx, StatementPtr stmt);
+  Value evalVarDeclarationStatement(EnvironmentPtr ctx,
+                                    VarDeclarationPtr stmt);
+  Value evalFuncDeclarationStatement(EnvironmentPtr ctx,
+                                     FunctionDeclarationPtr stmt,
+                                     FunctionType functionType);
+  Value evalClassDeclarationStatement(EnvironmentPtr ctx,
+                                      ClassDeclarationPtr stmt);
+  Value evalIfStatement(EnvironmentPtr ctx, IfStatementPtr stmt);
+  Value evalForStatement(EnvironmentPtr ctx, ForStatementPtr stmt);
+  Value evalWhileStatement(EnvironmentPtr ctx, WhileStatementPtr stmt);
+  Value evalPrintStatement(EnvironmentPtr ctx, PrintStatementPtr stmt);
+  Value evalReturnStatement(EnvironmentPtr ctx, ReturnStatementPtr stmt);
+  Value evalBreakStatement(EnvironmentPtr ctx, BreakStatementPtr stmt);
+  Value evalContinueStatement(EnvironmentPtr ctx, ContinueStatementPtr stmt);
+  Value evalBlockStatement(EnvironmentPtr ctx, BlockPtr stmt);
+  Value evalStatements(EnvironmentPtr ctx,
+                       const std::vector<StatementPtr>& statements);
+
+  Value evalExpression(EnvironmentPtr ctx, ExpressionPtr expr);
+  // reads expr in place when the Optimizer fused it into its parent as
+  // operand, and evaluates it otherwise.
+  Value evalOperand(const EnvironmentPtr& ctx, Operand operand,
+                    const ExpressionPtr& expr);
+  Value evalVariableExpr(const EnvironmentPtr& ctx, const VariableExpr& expr);
+  Value bindMethod(const Value& method, const EnvironmentPtr& recordCtx);
+  Value evalBinaryExpression(EnvironmentPtr ctx, BinaryExprPtr expr);
+  Value evalUnaryExpression(EnvironmentPtr ctx, UnaryExprPtr expr);
+  Value evalAssignExpression(EnvironmentPtr ctx, AssignmentPtr expr);
+  // a call in tail position is left in tailCall rather than run.
+  Value evalCallExpression(EnvironmentPtr ctx, CallExprPtr expr,
+                           bool tailPosition = false);
+  // evaluates a callee; when it is an unbound method, also gives the scope
+  // of the record it was read from.
+  Value evalCallee(EnvironmentPtr ctx, ExpressionPtr expr,
+                   EnvironmentPtr& recordCtx);
+  Value evalFunctionCall(EnvironmentPtr ctx, const FunctionPtr& callee,
+                         CallExprPtr expr, const EnvironmentPtr& enclosingCtx);
+  std::vector<Value> evalArguments(EnvironmentPtr ctx,
+                                   const FunctionPtr& callee, CallExprPtr expr);
+  // runs callee and then, in the same frame, any tail calls it makes.
+  Value callFunction(FunctionPtr callee, EnvironmentPtr enclosingCtx,
+                     std::vector<Value> args);
+  // runs callee natively once it is hot; false when the call must be
+  // interpreted instead.
+  bool evalJitCall(const FunctionPtr& callee, const std::vector<Value>& args,
+                   Value& result);
+  Value evalClassCall(EnvironmentPtr ctx, ClassObjectPtr callee,
+                      CallExprPtr expr);
+  Value evalMemberExpr(EnvironmentPtr ctx, MemberExprPtr expr);
+  // the method expr names, unbound, and the scope of its record.
+  Value lookupMethod(EnvironmentPtr ctx, MemberExprPtr expr,
+                     EnvironmentPtr& recordCtx);
+  Value evalIntegerLiteral(EnvironmentPtr ctx, IntegerLiteralPtr expr);
+  Value evalBooleanLiteral(EnvironmentPtr ctx, BooleanLiteralPtr expr);
+  Value evalNilLiteral(EnvironmentPtr ctx, NilLiteralPtr expr);
+  Value evalStringLiteral(EnvironmentPtr ctx, StringLiteralPtr expr);
+  Value evalArrayLiteral(EnvironmentPtr ctx, ArrayLiteralPtr expr);
+  Value evalArraySubscriptExpression(EnvironmentPtr ctx,
+                                     ArraySubscriptExprPtr expr);
+  Value evalBinaryOperator(EnvironmentPtr ctx, const Value& lhsValue,
+                           TokenType operator_, const Value& rhsValue);
+  Value evalLogicOperator(EnvironmentPtr ctx, const Value& lhsValue,
+                          TokenType operator_, const Value& rhsValue);
+  Value evalComparisonOperator(EnvironmentPtr ctx, const Value& lhsValue,
+                               TokenType operator_, const Value& rhsValue);
+  Value evalMinusOperator(EnvironmentPtr ctx, const Value& rhsValue);
+  Value evalBangOperator(EnvironmentPtr ctx, const Value& rhsValue);
+};
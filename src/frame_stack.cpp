@@ -0,0 +1,24 @@
+#include "frame_stack.h"
+
+EnvironmentPtr FrameStack::push(EnvironmentPtr enclosing, size_t size) {
+  if (top == frames.size()) {
+    frames.push_back(Environment::make(std::move(enclosing), size));
+  } else if (frames[top] == nullptr) {
+    frames[top] = Environment::make(std::move(enclosing), size);
+  } else {
+    frames[top]->reset(std::move(enclosing), size);
+  }
+  return frames[top++];
+}
+
+void FrameStack::pop() {
+  assert(top > 0);
+  auto& frame = frames[--top];
+  if (frame.use_count() == 1) {
+    // drop the references now rather than on the frame's next reuse.
+    frame->reset(nullptr, 0);
+  } else {
+    // captured by a closure from the call, which now owns it alone.
+    frame.reset();
+  }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "common.h"
+#include "environment.h"
+
+// LIFO pool of call frames. Frames are reused once their call returns, so a
+// call allocates nothing unless the frame it would reuse was captured by a
+// function, class or record created during the earlier call; that frame is
+// left to its owners when the call returns and replaced.
+class FrameStack {
+ public:
+  FrameStack() : frames(), top(0) {}
+
+  EnvironmentPtr push(EnvironmentPtr enclosing, size_t size);
+  void pop();
+
+  size_t depth() const { return top; }
+  // the frames of the calls in progress, outermost first.
+  std::vector<EnvironmentPtr>::const_iterator begin() const {
+    return frames.begin();
+  }
+  std::vector<EnvironmentPtr>::const_iterator end() const {
+    return frames.begin() + top;
+  }
+
+ private:
+  std::vector<EnvironmentPtr> frames;
+  size_t top;
+};
+
+// Frame of one call, released when it goes out of scope, exceptions
+// included.
+class CallFrame {
+ public:
+  CallFrame(FrameStack& stack, EnvironmentPtr enclosing, size_t size)
+      : stack(stack), ctx(stack.push(std::move(enclosing), size)) {}
+  ~CallFrame() {
+    ctx.reset();
+    stack.pop();
+  }
+  CallFrame(const CallFrame&) = delete;
+  CallFrame& operator=(const CallFrame&) = delete;
+
+  const EnvironmentPtr& getCtx() const { return ctx; }
+
+  // replaces this frame with a fresh one for a tail call.
+  void reuse(EnvironmentPtr enclosing, size_t size) {
+    ctx.reset();
+    stack.pop();
+    ctx = stack.push(std::move(enclosing), size);
+  }
+
+ private:
+  FrameStack& stack;
+  EnvironmentPtr ctx;
+};
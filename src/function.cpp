@@ -1,23 +1,24 @@
 #include "function.h"
 
 Function::Function(EnvironmentPtr enclosingCtx, FunctionType functionType,
-                   FunctionDeclarationPtr declaration, const std::string &name,
-                   int arity)
+                   FunctionDeclarationPtr declaration, Symbol name, int arity)
     : Object(ObjectType::OBJ_FUNCTION),
       enclosingCtx(enclosingCtx),
       functionType(functionType),
       declaration(declaration),
       name(name),
-      arity(arity) {
-  ctx = Environment::make(enclosingCtx);
+      arity(arity) {}
+
+Ref<Function> Function::bind(EnvironmentPtr recordCtx) const {
+  return make(recordCtx, functionType, declaration, name, arity);
 }
 
-std::shared_ptr<Function> Function::make(EnvironmentPtr enclosingCtx,
-                                         FunctionType functionType,
-                                         FunctionDeclarationPtr declaration,
-                                         const std::string &name, int arity) {
-  return std::make_shared<Function>(enclosingCtx, functionType, declaration,
-                                    name, arity);
+Ref<Function> Function::make(EnvironmentPtr enclosingCtx,
+                             FunctionType functionType,
+                             FunctionDeclarationPtr declaration, Symbol name,
+                             int arity) {
+  return makeRef<Function>(enclosingCtx, functionType, declaration, name,
+                           arity);
 }
 
 std::string Function::toString() const {
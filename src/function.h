@@ -3,6 +3,7 @@
 #include "ast.h"
 #include "common.h"
 #include "environment.h"
+#include "jit.h"
 #include "object.h"
 
 enum FunctionType { TYPE_SCRIPT, TYPE_FUNCTION, TYPE_METHOD, TYPE_INITIALIZER };
@@ -10,19 +11,21 @@ enum FunctionType { TYPE_SCRIPT, TYPE_FUNCTION, TYPE_METHOD, TYPE_INITIALIZER };
 class Function : public Object {
  private:
   EnvironmentPtr enclosingCtx;
-  EnvironmentPtr ctx;
   FunctionType functionType;
   FunctionDeclarationPtr declaration;
-  std::string name;
+  Symbol name;
   int arity;
+  // baseline JIT state: calls seen so far and the native code, if any.
+  int callCount = 0;
+  bool jitFailed = false;
+  JitCodePtr jitCode;
 
  public:
   Function(EnvironmentPtr enclosingCtx, FunctionType functionType,
-           FunctionDeclarationPtr declaration, const std::string &name,
-           int arity = 0);
+           FunctionDeclarationPtr declaration, Symbol name, int arity = 0);
 
   inline FunctionType getType() const { return functionType; }
-  inline const std::string &getName() const { return name; }
+  inline Symbol getName() const { return name; }
   inline int getArity() const { return arity; }
   inline int incrArity() { return ++arity; }
   inline FunctionDeclarationPtr getDeclaration() { return declaration; }
@@ -32,12 +35,27 @@ class Function : public Object {
   virtual bool isTruthy() const override;
   virtual bool isEqual(const Object &obj) const override;
   inline bool isEqual(const Function &other) const;
-  inline EnvironmentPtr getCtx() const { return ctx; }
-
-  static std::shared_ptr<Function> make(EnvironmentPtr enclosingCtx,
-                                        FunctionType functionType,
-                                        FunctionDeclarationPtr declaration,
-                                        const std::string &name, int arity);
+  inline const EnvironmentPtr &getEnclosingCtx() const { return enclosingCtx; }
+  // for the Heap breaking a cycle.
+  inline void clearEnclosingCtx() { enclosingCtx.reset(); }
+  // methods are shared by every record of their class and run in the scope
+  // of whichever record they are called on.
+  inline bool isUnbound() const {
+    return functionType == TYPE_METHOD && enclosingCtx == nullptr;
+  }
+  // this method as a value of its own, running in recordCtx.
+  Ref<Function> bind(EnvironmentPtr recordCtx) const;
+
+  inline int incrCallCount() { return ++callCount; }
+  inline bool isJitFailed() const { return jitFailed; }
+  inline void markJitFailed() { jitFailed = true; }
+  inline JitCodePtr getJitCode() const { return jitCode; }
+  inline void setJitCode(JitCodePtr code) { jitCode = std::move(code); }
+
+  static Ref<Function> make(EnvironmentPtr enclosingCtx,
+                            FunctionType functionType,
+                            FunctionDeclarationPtr declaration, Symbol name,
+                            int arity);
 };
 
-using FunctionPtr = std::shared_ptr<Function>;
+using FunctionPtr = Ref<Function>;
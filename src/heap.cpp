@@ -0,0 +1,413 @@
+#include "heap.h"
+
+#include <algorithm>
+
+#include "class_object.h"
+#include "frame_stack.h"
+#include "function.h"
+#include "record.h"
+
+namespace {
+
+// a record, function, class, array or environment reached while collecting.
+struct Node {
+  ObjectPtr object;
+  // references to the node, less those the graph accounts for.
+  long refs = 0;
+  bool marked = false;
+};
+
+// whether object can refer to a record, function or class.
+bool isTraced(const Object& object) {
+  switch (object.Type) {
+    case ObjectType::OBJ_RECORD:
+    case ObjectType::OBJ_FUNCTION:
+    case ObjectType::OBJ_CLASS:
+    case ObjectType::OBJ_ARRAY:
+    case ObjectType::OBJ_ENVIRONMENT:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool isTracked(const Object& object) {
+  switch (object.Type) {
+    case ObjectType::OBJ_RECORD:
+    case ObjectType::OBJ_FUNCTION:
+    case ObjectType::OBJ_CLASS:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// calls visit with every traced object object refers to, once per
+// reference.
+template <typename Visitor>
+void forEachReference(const Object& object, const Visitor& visit) {
+  auto reference = [&](Object* target) {
+    if (target != nullptr && isTraced(*target)) {
+      visit(target);
+    }
+  };
+  auto value = [&](const Value& value) {
+    if (value.isObject()) {
+      reference(value.asObject());
+    }
+  };
+  auto environment = [&](const Environment& environment) {
+    reference(environment.getEnclosing().get());
+    for (const auto& slot : environment) {
+      value(slot);
+    }
+  };
+  switch (object.Type) {
+    case ObjectType::OBJ_ENVIRONMENT:
+      environment(static_cast<const Environment&>(object));
+      break;
+    case ObjectType::OBJ_RECORD: {
+      const auto& record = static_cast<const Record&>(object);
+      environment(record);
+      reference(record.getClass().get());
+      break;
+    }
+    case ObjectType::OBJ_FUNCTION:
+      reference(static_cast<const Function&>(object).getEnclosingCtx().get());
+      break;
+    case ObjectType::OBJ_CLASS: {
+      const auto& klass = static_cast<const ClassObject&>(object);
+      reference(klass.enclosingCtx.get());
+      for (const auto& method : klass.methods) {
+        reference(method.get());
+      }
+      reference(klass.ctor.get());
+      break;
+    }
+    case ObjectType::OBJ_ARRAY:
+      for (const auto& element :
+           static_cast<const ArrayObject&>(object).Values) {
+        value(element);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+// every node reachable from the tracked objects, each held once. A minor
+// graph leaves old nodes out.
+class Graph {
+ public:
+  static constexpr size_t NONE = SIZE_MAX;
+
+  std::vector<Node> nodes;
+  // nodes whose references were added, in the order they were found.
+  size_t expanded = 0;
+
+  explicit Graph(bool minor) : minor(minor) {}
+
+  // adds the references of the nodes found so far, breadth first, until
+  // limit nodes were found.
+  void expand(size_t limit) {
+    while (expanded < nodes.size() && nodes.size() < limit) {
+      forEachEdge(expanded++, [](size_t) {});
+    }
+  }
+
+  size_t addObject(Object* object) {
+    if (object == nullptr || !isTraced(*object) || (minor && object->old)) {
+      return NONE;
+    }
+    const auto [it, added] = indexes.emplace(object, nodes.size());
+    if (added) {
+      nodes.push_back(Node{ObjectPtr(object)});
+    }
+    return it->second;
+  }
+
+  // calls visit with the index of every node the node at index refers to,
+  // once per reference, adding the nodes not seen yet.
+  template <typename Visitor>
+  void forEachEdge(size_t index, const Visitor& visit) {
+    // copied, adding nodes may move the one at index.
+    const auto object = nodes[index].object;
+    forEachReference(*object, [&](Object* target) {
+      const auto node = addObject(target);
+      if (node != NONE) {
+        visit(node);
+      }
+    });
+  }
+
+ private:
+  bool minor;
+  std::unordered_map<const Object*, size_t> indexes;
+};
+
+// drops the references a garbage object holds.
+void clearReferences(Object& object) {
+  switch (object.Type) {
+    case ObjectType::OBJ_ENVIRONMENT:
+      static_cast<Environment&>(object).clear();
+      break;
+    case ObjectType::OBJ_RECORD:
+      // the class is kept for the record to still tell its shape.
+      static_cast<Record&>(object).clear();
+      break;
+    case ObjectType::OBJ_FUNCTION:
+      static_cast<Function&>(object).clearEnclosingCtx();
+      break;
+    case ObjectType::OBJ_CLASS: {
+      auto& klass = static_cast<ClassObject&>(object);
+      klass.enclosingCtx.reset();
+      klass.methods.clear();
+      klass.ctor.reset();
+      break;
+    }
+    case ObjectType::OBJ_ARRAY:
+      static_cast<ArrayObject&>(object).Values.clear();
+      break;
+    default:
+      break;
+  }
+}
+
+// reclaims the garbage in an expanded graph and promotes the expanded
+// nodes that survive, settling the objects among them if settle is set.
+// Returns how many tracked objects were garbage.
+size_t collectGraph(Graph& graph, bool settle) {
+  // references from outside the graph: the graph's own copy is not one.
+  for (auto& node : graph.nodes) {
+    node.refs = node.object.use_count() - 1;
+  }
+  for (size_t i = 0; i < graph.expanded; i++) {
+    graph.forEachEdge(i, [&](size_t target) { graph.nodes[target].refs--; });
+  }
+
+  // mark from the nodes held from outside.
+  std::vector<size_t> pending;
+  for (size_t i = 0; i < graph.nodes.size(); i++) {
+    if (graph.nodes[i].refs > 0) {
+      graph.nodes[i].marked = true;
+      pending.push_back(i);
+    }
+  }
+  while (!pending.empty()) {
+    const auto index = pending.back();
+    pending.pop_back();
+    if (index >= graph.expanded) {
+      continue;
+    }
+    graph.forEachEdge(index, [&](size_t target) {
+      if (!graph.nodes[target].marked) {
+        graph.nodes[target].marked = true;
+        pending.push_back(target);
+      }
+    });
+  }
+
+  // sweep: garbage is freed by its counts once its cycles are broken, when
+  // the graph lets go of it. Survivors are promoted.
+  size_t reclaimed = 0;
+  for (size_t i = 0; i < graph.nodes.size(); i++) {
+    const auto& node = graph.nodes[i];
+    if (!node.marked) {
+      clearReferences(*node.object);
+      reclaimed += isTracked(*node.object);
+    } else if (i < graph.expanded) {
+      node.object->old = true;
+      node.object->settled = settle;
+    }
+  }
+  graph.nodes.clear();
+  return reclaimed;
+}
+
+// settled objects that lost a reference on this thread since a Heap took
+// them, whichever Heap tracks them: collecting only relies on their counts.
+thread_local std::vector<WeakRef<Object>> unsettled;
+// set while a Heap collects on this thread, whose own references to the
+// objects come and go.
+thread_local bool collecting = false;
+
+// marks the thread as collecting while in scope.
+class Collecting {
+ public:
+  Collecting() : outer(collecting) { collecting = true; }
+  ~Collecting() { collecting = outer; }
+
+ private:
+  bool outer;
+};
+
+}  // namespace
+
+void unsettle(Object* object) {
+  if (collecting) {
+    return;
+  }
+  object->settled = false;
+  unsettled.emplace_back(object);
+}
+
+Heap::~Heap() {
+  Collecting guard;
+  Graph graph(false);
+  for (const auto& weak : old) {
+    graph.addObject(weak.lock().get());
+  }
+  for (const auto& weak : young) {
+    graph.addObject(weak.lock().get());
+  }
+  graph.expand(SIZE_MAX);
+  collectGraph(graph, false);
+}
+
+void Heap::track(const ObjectPtr& object) { young.push_back(object); }
+
+size_t Heap::step() {
+  Collecting guard;
+  takeUnsettled();
+  if (old.size() >= threshold) {
+    // the old space has doubled: trace all of it from the roots.
+    return collect();
+  } else if (young.size() < YOUNG_THRESHOLD && candidateSize() > 0) {
+    Graph graph(false);
+    while (cursor < candidates.size() && graph.nodes.size() < STEP_BUDGET) {
+      const auto object = candidates[cursor++].lock();
+      if (object && !object->settled) {
+        graph.addObject(object.get());
+        graph.expand(STEP_BUDGET);
+      }
+    }
+    const auto reclaimed = collectGraph(graph, true);
+    if (cursor == candidates.size()) {
+      candidates.clear();
+      cursor = 0;
+    }
+    return reclaimed;
+  } else if (young.empty()) {
+    return 0;
+  }
+
+  // candidates are expanded fully so none is promoted on a partial view.
+  Graph graph(true);
+  std::vector<WeakRef<Object>> taken;
+  while (!young.empty() && graph.nodes.size() < STEP_BUDGET) {
+    taken.push_back(std::move(young.front()));
+    young.pop_front();
+    graph.addObject(taken.back().lock().get());
+    graph.expand(SIZE_MAX);
+  }
+  const auto reclaimed = collectGraph(graph, false);
+
+  // survivors are old candidates now.
+  for (auto& weak : taken) {
+    if (!weak.expired()) {
+      candidates.push_back(weak);
+      old.push_back(std::move(weak));
+    }
+  }
+  return reclaimed;
+}
+
+size_t Heap::collectYoung() {
+  Collecting guard;
+  Graph graph(true);
+  for (const auto& weak : young) {
+    graph.addObject(weak.lock().get());
+  }
+  graph.expand(SIZE_MAX);
+  auto reclaimed = collectGraph(graph, false);
+
+  for (auto& weak : young) {
+    if (!weak.expired()) {
+      candidates.push_back(weak);
+      old.push_back(std::move(weak));
+    }
+  }
+  young.clear();
+  if (old.size() >= threshold) {
+    reclaimed += collect();
+  }
+  return reclaimed;
+}
+
+size_t Heap::collect() {
+  Collecting guard;
+  takeUnsettled();
+
+  // mark: what the roots reach is live. Marked objects stay alive until
+  // they are unmarked, since the roots keep holding them.
+  std::vector<Object*> marked;
+  auto mark = [&](Object* object) {
+    if (!object->marked) {
+      object->marked = true;
+      marked.push_back(object);
+    }
+  };
+  if (globals) {
+    mark(globals.get());
+  }
+  for (const auto& frame : frames) {
+    mark(frame.get());
+  }
+  for (const auto& temporary : temporaries) {
+    if (isTraced(*temporary.asObject())) {
+      mark(temporary.asObject());
+    }
+  }
+  for (size_t i = 0; i < marked.size(); i++) {
+    forEachReference(*marked[i], mark);
+  }
+
+  // sweep: the garbage is held until all of it is cleared, so that none is
+  // freed by its counts before it is counted.
+  std::vector<ObjectPtr> garbage;
+  auto sweep = [&](const WeakRef<Object>& weak) {
+    auto object = weak.lock();
+    if (object && !object->marked) {
+      garbage.push_back(std::move(object));
+    }
+  };
+  std::for_each(young.begin(), young.end(), sweep);
+  std::for_each(old.begin(), old.end(), sweep);
+  for (const auto& object : garbage) {
+    clearReferences(*object);
+  }
+  const auto reclaimed = garbage.size();
+  garbage.clear();
+
+  // everything that survives was traced, so it is old and settled.
+  for (auto* object : marked) {
+    object->marked = false;
+    object->old = true;
+    object->settled = true;
+  }
+  old.insert(old.end(), std::make_move_iterator(young.begin()),
+             std::make_move_iterator(young.end()));
+  young.clear();
+  candidates.clear();
+  cursor = 0;
+  compact();
+  return reclaimed;
+}
+
+void Heap::takeUnsettled() {
+  for (auto& weak : unsettled) {
+    if (!weak.expired()) {
+      candidates.push_back(std::move(weak));
+    }
+  }
+  unsettled.clear();
+}
+
+void Heap::compact() {
+  old.erase(std::remove_if(old.begin(), old.end(),
+                           [](const WeakRef<Object>& weak) {
+                             return weak.expired();
+                           }),
+            old.end());
+  threshold = std::max(INITIAL_THRESHOLD, old.size() * 2);
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <deque>
+
+#include "common.h"
+#include "environment.h"
+#include "object.h"
+
+class FrameStack;
+
+// Cycle collector for the objects the Evaluator creates. The counts own
+// everything and free acyclic garbage at once; the Heap tracks the records,
+// functions and classes, which every cycle goes through, and breaks the
+// references of those that are garbage so the counts free them too.
+//
+// A full collection marks from explicit roots: the global ctx, the frames
+// of the calls in progress and the temporaries the running evaluation
+// registered. Every tracked object left unmarked is garbage. Collections
+// only run at safe points of the Evaluator, and an object it holds in a
+// local across one must be registered as a temporary, or it may be swept.
+// The same holds for objects held outside the Evaluator across an eval.
+//
+// Minor collections and steps need no roots: they find garbage cycles by
+// trial deletion. Subtracting the references the graph accounts for from
+// each node's count leaves those held from outside, and what they reach is
+// live. Most objects die young, so a minor collection only traces the
+// objects tracked since the last one and the young nodes they reach,
+// promoting the survivors; old nodes it comes across are simply treated as
+// holding references from outside. A full collection runs instead once the
+// old space has doubled. The generations are bookkeeping only: objects never
+// move, and young or old just says whether a collection traced an object
+// yet. Scopes that die with their statement come from the ScopePool.
+//
+// The Evaluator collects incrementally, in the manner of Bacon and Rajan:
+// candidate roots of garbage cycles are buffered until a step takes them,
+// and each step traces from as many as fit in a budget of nodes. Objects
+// are young candidates when tracked and old candidates once promoted. A
+// step over the old candidates that proves one live settles it, and a
+// settled object is only buffered again when it loses a reference and
+// survives, which is how every cycle loses its last reference from outside:
+// a frame a closure captured is buffered when its call returns, a record
+// when the variable holding it is overwritten. The references the collector
+// takes itself are not counted as lost.
+//
+// A young step traces all the young nodes its candidates reach, which the
+// young space bounds. A step over the old candidates stops expanding nodes
+// at the budget instead; the references held by the nodes left unexpanded
+// stay unknown, which only makes what they refer to look held from
+// outside, so it reclaims less but never too much.
+class Heap {
+ public:
+  // old objects before the old space is first examined in full.
+  static constexpr size_t INITIAL_THRESHOLD = 1 << 14;
+  // young objects that make a minor collection due.
+  static constexpr size_t YOUNG_THRESHOLD = 1 << 12;
+  // old candidates that make a step over them due.
+  static constexpr size_t CANDIDATE_THRESHOLD = 1 << 12;
+  // nodes a step traces, give or take those the last candidate reaches.
+  static constexpr size_t STEP_BUDGET = 1 << 10;
+
+  // Values the running evaluation holds in locals across a safe point,
+  // rooted until the guard goes out of scope.
+  class TemporaryRoots {
+   public:
+    explicit TemporaryRoots(Heap& heap)
+        : temporaries(heap.temporaries), mark(temporaries.size()) {}
+    ~TemporaryRoots() { temporaries.resize(mark); }
+    TemporaryRoots(const TemporaryRoots&) = delete;
+    TemporaryRoots& operator=(const TemporaryRoots&) = delete;
+
+    void add(const Value& value) {
+      if (value.isObject()) {
+        temporaries.push_back(value);
+      }
+    }
+    template <typename T>
+    void add(const Ref<T>& object) {
+      if (object) {
+        temporaries.emplace_back(object);
+      }
+    }
+
+   private:
+    std::vector<Value>& temporaries;
+    size_t mark;
+  };
+
+  // globals and frames are the roots of full collections, besides the
+  // temporaries.
+  Heap(const EnvironmentPtr& globals, const FrameStack& frames)
+      : globals(globals),
+        frames(frames),
+        temporaries(),
+        young(),
+        old(),
+        candidates(),
+        threshold(INITIAL_THRESHOLD),
+        cursor(0) {}
+  // reclaims the cycles nothing outside the heap refers to any more.
+  ~Heap();
+  Heap(const Heap&) = delete;
+  Heap& operator=(const Heap&) = delete;
+
+  // starts tracking a record, function or class.
+  void track(const ObjectPtr& object);
+
+  // true while there are enough young or old candidates, or the old space
+  // is due to be examined again.
+  bool shouldCollect() const {
+    return young.size() >= YOUNG_THRESHOLD ||
+           candidateSize() >= CANDIDATE_THRESHOLD || old.size() >= threshold;
+  }
+
+  // a full collection once the old space has doubled, or else one bounded
+  // increment: from the next old candidates, unless young candidates pile
+  // up; or else from the oldest young candidates, promoting those that
+  // survive. Returns how many tracked objects were reclaimed.
+  size_t step();
+
+  // reclaims unreachable cycles of young nodes and promotes the survivors,
+  // then collects everything if the old space is due. Returns how many
+  // tracked objects were reclaimed.
+  size_t collectYoung();
+  // marks from the roots and reclaims every tracked object left unmarked,
+  // returns how many there were.
+  size_t collect();
+
+  size_t size() const { return young.size() + old.size(); }
+  size_t youngSize() const { return young.size(); }
+  // old candidates no step took yet.
+  size_t candidateSize() const { return candidates.size() - cursor; }
+
+ private:
+  // buffers the objects unsettled since the last step as old candidates.
+  void takeUnsettled();
+  // drops the expired old objects and sets when the old space is due next.
+  void compact();
+
+  const EnvironmentPtr& globals;
+  const FrameStack& frames;
+  std::vector<Value> temporaries;
+  std::deque<WeakRef<Object>> young;
+  // every promoted object.
+  std::vector<WeakRef<Object>> old;
+  std::vector<WeakRef<Object>> candidates;
+  size_t threshold;
+  // the next old candidate a step takes.
+  size_t cursor;
+};
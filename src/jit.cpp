@@ -0,0 +1,491 @@
+#include "jit.h"
+
+#include "assembler.h"
+
+#ifdef CPPLOX_JIT_SUPPORTED
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstring>
+#endif
+
+namespace {
+
+// thrown while generating code for a construct the JIT does not handle.
+struct Unsupported {};
+
+enum class ValueType { INT, BOOL, NIL };
+
+// Frame layout, relative to rbp:
+//   [rbp - 8]            result pointer (rsi)
+//   [rbp - 16]           remaining depth (rdx)
+//   [rbp - 24 - 8 * i]   variable slot i, params first
+constexpr int32_t RESULT_OFFSET = -8;
+constexpr int32_t DEPTH_OFFSET = -16;
+constexpr int32_t FIRST_SLOT_OFFSET = -24;
+
+class CodeGenerator {
+ public:
+  explicit CodeGenerator(const FunctionDeclarationPtr& declaration)
+      : declaration(declaration) {}
+
+  std::vector<uint8_t> generate();
+
+ private:
+  struct Loop {
+    Label* breakLabel;
+    Label* continueLabel;
+  };
+
+  FunctionDeclarationPtr declaration;
+  Assembler masm;
+  Label entry;
+  Label bailout;
+  Label epilogue;
+  // name -> slot of every scope, mirroring the Resolver's scopes.
+  std::vector<std::unordered_map<Symbol, int32_t>> scopes;
+  int32_t slotCount = 0;
+  std::vector<Loop> loops;
+
+  static int32_t slotOffset(int32_t slot) {
+    return FIRST_SLOT_OFFSET - 8 * slot;
+  }
+  // slot of identifier, -1 when it is not a local.
+  int32_t lookup(Symbol identifier) const;
+  int32_t declare(Symbol identifier);
+  // body of an if/while/for that is not a block: a declaration in it would
+  // only conditionally initialise a slot of the enclosing scope.
+  void branchStatement(const StatementPtr& stmt);
+
+  void statement(const StatementPtr& stmt);
+  void varDeclaration(const VarDeclarationPtr& stmt);
+  void ifStatement(const IfStatementPtr& stmt);
+  void whileStatement(const WhileStatementPtr& stmt);
+  void forStatement(const ForStatementPtr& stmt);
+  void returnStatement(const ReturnStatementPtr& stmt);
+
+  ValueType expression(const ExpressionPtr& expr);
+  void intExpression(const ExpressionPtr& expr);
+  ValueType binaryExpression(const BinaryExprPtr& expr);
+  ValueType unaryExpression(const UnaryExprPtr& expr);
+  void callExpression(const CallExprPtr& expr);
+  // rax <- rax != 0
+  void truthy();
+};
+
+std::vector<uint8_t> CodeGenerator::generate() {
+  // params are bound by position, a repeated name resolves to the last one.
+  scopes.emplace_back();
+  for (const auto& param : declaration->params) {
+    scopes.back()[param] = slotCount++;
+  }
+
+  masm.bind(entry);
+  masm.push(Register::RBP);
+  masm.mov(Register::RBP, Register::RSP);
+  masm.subImm(Register::RSP, 0);
+  const auto frameSizePosition = masm.size() - 4;
+  masm.store(Register::RBP, RESULT_OFFSET, Register::RSI);
+  masm.store(Register::RBP, DEPTH_OFFSET, Register::RDX);
+  masm.test(Register::RDX, Register::RDX);
+  masm.jcc(Condition::LESS_EQUAL, bailout);
+  for (size_t i = 0; i < declaration->params.size(); i++) {
+    masm.load(Register::RAX, Register::RDI, 8 * i);
+    masm.store(Register::RBP, slotOffset(i), Register::RAX);
+  }
+
+  statement(declaration->body);
+
+  // falling off the end yields the last statement value, which may not be
+  // an integer: let the Evaluator produce it.
+  masm.bind(bailout);
+  masm.mov(Register::RAX, 1);
+  masm.bind(epilogue);
+  masm.mov(Register::RSP, Register::RBP);
+  masm.pop(Register::RBP);
+  masm.ret();
+
+  masm.patch32(frameSizePosition, 16 + 8 * slotCount);
+  return masm.getCode();
+}
+
+int32_t CodeGenerator::lookup(Symbol identifier) const {
+  for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
+    const auto slot = it->find(identifier);
+    if (slot != it->end()) {
+      return slot->second;
+    }
+  }
+  return -1;
+}
+
+int32_t CodeGenerator::declare(Symbol identifier) {
+  // redeclaring a name in the same scope reuses its slot, like the Resolver.
+  auto& scope = scopes.back();
+  const auto it = scope.find(identifier);
+  if (it != scope.end()) {
+    return it->second;
+  }
+  scope[identifier] = slotCount;
+  return slotCount++;
+}
+
+void CodeGenerator::branchStatement(const StatementPtr& stmt) {
+  if (stmt->Type == NodeType::VAR_DECLARATION) {
+    throw Unsupported();
+  }
+  statement(stmt);
+}
+
+void CodeGenerator::statement(const StatementPtr& stmt) {
+  switch (stmt->Type) {
+    case NodeType::EXPRESSION_STATEMENT: {
+      auto exprStmt = static_cast<ExpressionStatement*>(stmt);
+      expression(exprStmt->expression);
+      break;
+    }
+    case NodeType::VAR_DECLARATION:
+      varDeclaration(static_cast<VarDeclaration*>(stmt));
+      break;
+    case NodeType::BLOCK_STATEMENT: {
+      auto block = static_cast<Block*>(stmt);
+      scopes.emplace_back();
+      for (const auto& blockStmt : block->statements) {
+        statement(blockStmt);
+      }
+      scopes.pop_back();
+      break;
+    }
+    case NodeType::IF_STATEMENT:
+      ifStatement(static_cast<IfStatement*>(stmt));
+      break;
+    case NodeType::WHILE_STATEMENT:
+      whileStatement(static_cast<WhileStatement*>(stmt));
+      break;
+    case NodeType::FOR_STATEMENT:
+      forStatement(static_cast<ForStatement*>(stmt));
+      break;
+    case NodeType::RETURN_STATEMENT:
+      returnStatement(static_cast<ReturnStatement*>(stmt));
+      break;
+    case NodeType::BREAK_STATEMENT:
+      if (loops.empty()) {
+        throw Unsupported();
+      }
+      masm.jmp(*loops.back().breakLabel);
+      break;
+    case NodeType::CONTINUE_STATEMENT:
+      if (loops.empty()) {
+        throw Unsupported();
+      }
+      masm.jmp(*loops.back().continueLabel);
+      break;
+    case NodeType::EMPTY_STATEMENT:
+      break;
+    default:
+      throw Unsupported();
+  }
+}
+
+void CodeGenerator::varDeclaration(const VarDeclarationPtr& stmt) {
+  if (!stmt->initializer) {
+    throw Unsupported();
+  }
+  intExpression(stmt->initializer);
+  masm.store(Register::RBP, slotOffset(declare(stmt->identifier)),
+             Register::RAX);
+}
+
+void CodeGenerator::ifStatement(const IfStatementPtr& stmt) {
+  Label elseBranch, end;
+  expression(stmt->condition);
+  masm.test(Register::RAX, Register::RAX);
+  masm.jcc(Condition::EQUAL, elseBranch);
+  branchStatement(stmt->thenBranch);
+  masm.jmp(end);
+  masm.bind(elseBranch);
+  if (stmt->elseBranch) {
+    branchStatement(stmt->elseBranch);
+  }
+  masm.bind(end);
+}
+
+void CodeGenerator::whileStatement(const WhileStatementPtr& stmt) {
+  Label top, end;
+  masm.bind(top);
+  expression(stmt->condition);
+  masm.test(Register::RAX, Register::RAX);
+  masm.jcc(Condition::EQUAL, end);
+  loops.push_back(Loop{&end, &top});
+  branchStatement(stmt->body);
+  loops.pop_back();
+  masm.jmp(top);
+  masm.bind(end);
+}
+
+void CodeGenerator::forStatement(const ForStatementPtr& stmt) {
+  Label top, increment, end;
+  scopes.emplace_back();
+  statement(stmt->initializer);
+  masm.bind(top);
+  expression(stmt->condition);
+  masm.test(Register::RAX, Register::RAX);
+  masm.jcc(Condition::EQUAL, end);
+  loops.push_back(Loop{&end, &increment});
+  branchStatement(stmt->body);
+  loops.pop_back();
+  masm.bind(increment);
+  expression(stmt->increment);
+  masm.jmp(top);
+  masm.bind(end);
+  scopes.pop_back();
+}
+
+void CodeGenerator::returnStatement(const ReturnStatementPtr& stmt) {
+  if (!stmt->expression) {
+    throw Unsupported();
+  }
+  intExpression(stmt->expression);
+  masm.load(Register::RCX, Register::RBP, RESULT_OFFSET);
+  masm.store(Register::RCX, 0, Register::RAX);
+  masm.mov(Register::RAX, 0);
+  masm.jmp(epilogue);
+}
+
+ValueType CodeGenerator::expression(const ExpressionPtr& expr) {
+  switch (expr->Type) {
+    case NodeType::INTEGER_LITERAL:
+      masm.mov(Register::RAX,
+               static_cast<IntegerLiteral*>(expr)->Value);
+      return ValueType::INT;
+    case NodeType::BOOLEAN_LITERAL:
+      masm.mov(Register::RAX,
+               static_cast<BooleanLiteral*>(expr)->Value ? 1 : 0);
+      return ValueType::BOOL;
+    case NodeType::NIL_LITERAL:
+      masm.mov(Register::RAX, 0);
+      return ValueType::NIL;
+    case NodeType::VARIABLE_EXPRESSION: {
+      const auto slot = lookup(static_cast<VariableExpr*>(expr)->identifier);
+      if (slot < 0) {
+        throw Unsupported();
+      }
+      masm.load(Register::RAX, Register::RBP, slotOffset(slot));
+      return ValueType::INT;
+    }
+    case NodeType::ASSIGNMENT_EXPRESSION: {
+      auto assignment = static_cast<Assignment*>(expr);
+      const auto slot = lookup(assignment->identifier);
+      if (slot < 0) {
+        throw Unsupported();
+      }
+      intExpression(assignment->value);
+      masm.store(Register::RBP, slotOffset(slot), Register::RAX);
+      return ValueType::INT;
+    }
+    case NodeType::BINARY_EXPRESSION:
+      return binaryExpression(static_cast<BinaryExpr*>(expr));
+    case NodeType::UNARY_EXPRESSION:
+      return unaryExpression(static_cast<UnaryExpr*>(expr));
+    case NodeType::CALL_EXPRESSION:
+      callExpression(static_cast<CallExpr*>(expr));
+      return ValueType::INT;
+    default:
+      throw Unsupported();
+  }
+}
+
+void CodeGenerator::intExpression(const ExpressionPtr& expr) {
+  if (expression(expr) != ValueType::INT) {
+    throw Unsupported();
+  }
+}
+
+ValueType CodeGenerator::binaryExpression(const BinaryExprPtr& expr) {
+  const auto operator_ = expr->operator_.type;
+  const auto lhsType = expression(expr->left);
+  masm.push(Register::RAX);
+  const auto rhsType = expression(expr->right);
+  masm.mov(Register::RCX, Register::RAX);
+  masm.pop(Register::RAX);
+
+  // and/or evaluate both operands and combine their truthiness.
+  if (operator_ == TokenType::TOKEN_AND || operator_ == TokenType::TOKEN_OR) {
+    truthy();
+    masm.mov(Register::RDX, Register::RAX);
+    masm.mov(Register::RAX, Register::RCX);
+    truthy();
+    if (operator_ == TokenType::TOKEN_AND) {
+      masm.imul(Register::RAX, Register::RDX);
+    } else {
+      masm.add(Register::RAX, Register::RDX);
+      truthy();
+    }
+    return ValueType::BOOL;
+  }
+  if (operator_ == TokenType::TOKEN_EQUAL_EQUAL ||
+      operator_ == TokenType::TOKEN_BANG_EQUAL) {
+    if (lhsType != rhsType) {
+      throw Unsupported();
+    }
+    masm.cmp(Register::RAX, Register::RCX);
+    masm.setcc(operator_ == TokenType::TOKEN_EQUAL_EQUAL
+                   ? Condition::EQUAL
+                   : Condition::NOT_EQUAL);
+    return ValueType::BOOL;
+  }
+
+  if (lhsType != ValueType::INT || rhsType != ValueType::INT) {
+    throw Unsupported();
+  }
+  switch (operator_) {
+    case TokenType::TOKEN_PLUS:
+      masm.add(Register::RAX, Register::RCX);
+      return ValueType::INT;
+    case TokenType::TOKEN_MINUS:
+      masm.sub(Register::RAX, Register::RCX);
+      return ValueType::INT;
+    case TokenType::TOKEN_STAR:
+      masm.imul(Register::RAX, Register::RCX);
+      return ValueType::INT;
+    case TokenType::TOKEN_SLASH: {
+      // division by zero is reported by the Evaluator.
+      Label divide, done;
+      masm.test(Register::RCX, Register::RCX);
+      masm.jcc(Condition::EQUAL, bailout);
+      masm.mov(Register::RDX, -1);
+      masm.cmp(Register::RCX, Register::RDX);
+      masm.jcc(Condition::NOT_EQUAL, divide);
+      // idiv traps on INT64_MIN / -1.
+      masm.neg(Register::RAX);
+      masm.jmp(done);
+      masm.bind(divide);
+      masm.cqo();
+      masm.idiv(Register::RCX);
+      masm.bind(done);
+      return ValueType::INT;
+    }
+    case TokenType::TOKEN_LESS:
+      masm.cmp(Register::RAX, Register::RCX);
+      masm.setcc(Condition::LESS);
+      return ValueType::BOOL;
+    case TokenType::TOKEN_LESS_EQUAL:
+      masm.cmp(Register::RAX, Register::RCX);
+      masm.setcc(Condition::LESS_EQUAL);
+      return ValueType::BOOL;
+    case TokenType::TOKEN_GREATER:
+      masm.cmp(Register::RAX, Register::RCX);
+      masm.setcc(Condition::GREATER);
+      return ValueType::BOOL;
+    case TokenType::TOKEN_GREATER_EQUAL:
+      masm.cmp(Register::RAX, Register::RCX);
+      masm.setcc(Condition::GREATER_EQUAL);
+      return ValueType::BOOL;
+    default:
+      throw Unsupported();
+  }
+}
+
+ValueType CodeGenerator::unaryExpression(const UnaryExprPtr& expr) {
+  switch (expr->operator_.type) {
+    case TokenType::TOKEN_MINUS:
+      intExpression(expr->right);
+      masm.neg(Register::RAX);
+      return ValueType::INT;
+    case TokenType::TOKEN_BANG:
+      expression(expr->right);
+      masm.test(Register::RAX, Register::RAX);
+      masm.setcc(Condition::EQUAL);
+      return ValueType::BOOL;
+    default:
+      throw Unsupported();
+  }
+}
+
+void CodeGenerator::callExpression(const CallExprPtr& expr) {
+  // only direct self-recursion is compiled; the Evaluator checks on entry
+  // that the function's name still resolves to the function itself.
+  if (expr->left->Type != NodeType::VARIABLE_EXPRESSION) {
+    throw Unsupported();
+  }
+  const auto& callee = static_cast<VariableExpr*>(expr->left)->identifier;
+  if (callee != declaration->identifier || lookup(callee) >= 0 ||
+      expr->arguments.size() != declaration->params.size()) {
+    throw Unsupported();
+  }
+
+  const auto argc = static_cast<int32_t>(expr->arguments.size());
+  for (auto it = expr->arguments.rbegin(); it != expr->arguments.rend();
+       ++it) {
+    intExpression(*it);
+    masm.push(Register::RAX);
+  }
+  // result slot below the arguments
+  masm.push(Register::RAX);
+  masm.mov(Register::RSI, Register::RSP);
+  masm.lea(Register::RDI, Register::RSP, 8);
+  masm.load(Register::RDX, Register::RBP, DEPTH_OFFSET);
+  masm.subImm(Register::RDX, 1);
+  masm.call(entry);
+  masm.test(Register::RAX, Register::RAX);
+  masm.jcc(Condition::NOT_EQUAL, bailout);
+  masm.pop(Register::RAX);
+  if (argc > 0) {
+    masm.addImm(Register::RSP, 8 * argc);
+  }
+}
+
+void CodeGenerator::truthy() {
+  masm.test(Register::RAX, Register::RAX);
+  masm.setcc(Condition::NOT_EQUAL);
+}
+
+}  // namespace
+
+#ifdef CPPLOX_JIT_SUPPORTED
+
+ExecutableMemory::~ExecutableMemory() { munmap(memory, mappedSize); }
+
+std::unique_ptr<ExecutableMemory> ExecutableMemory::make(
+    const std::vector<uint8_t>& code) {
+  const size_t pageSize = sysconf(_SC_PAGESIZE);
+  const size_t mappedSize = (code.size() + pageSize - 1) / pageSize * pageSize;
+  void* memory = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (memory == MAP_FAILED) {
+    return nullptr;
+  }
+  std::memcpy(memory, code.data(), code.size());
+  if (mprotect(memory, mappedSize, PROT_READ | PROT_EXEC) != 0) {
+    munmap(memory, mappedSize);
+    return nullptr;
+  }
+  return std::unique_ptr<ExecutableMemory>(
+      new ExecutableMemory(memory, mappedSize, code.size()));
+}
+
+#else
+
+ExecutableMemory::~ExecutableMemory() {}
+
+std::unique_ptr<ExecutableMemory> ExecutableMemory::make(
+    const std::vector<uint8_t>& code) {
+  return nullptr;
+}
+
+#endif  // CPPLOX_JIT_SUPPORTED
+
+JitCodePtr JitCompiler::compile(const FunctionDeclarationPtr& declaration) {
+  CodeGenerator generator(declaration);
+  std::vector<uint8_t> code;
+  try {
+    code = generator.generate();
+  } catch (const Unsupported&) {
+    return nullptr;
+  }
+  auto memory = ExecutableMemory::make(code);
+  if (!memory) {
+    return nullptr;
+  }
+  return std::make_shared<JitCode>(std::move(memory));
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "ast.h"
+#include "common.h"
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define CPPLOX_JIT_SUPPORTED 1
+#endif
+
+// Read+exec pages holding generated machine code.
+class ExecutableMemory {
+ public:
+  ~ExecutableMemory();
+
+  ExecutableMemory(const ExecutableMemory&) = delete;
+  ExecutableMemory& operator=(const ExecutableMemory&) = delete;
+
+  void* getEntry() const { return memory; }
+  size_t size() const { return codeSize; }
+
+  // copies code into fresh executable pages, nullptr when that fails or the
+  // platform has no JIT support.
+  static std::unique_ptr<ExecutableMemory> make(
+      const std::vector<uint8_t>& code);
+
+ private:
+  void* memory;
+  size_t mappedSize;
+  size_t codeSize;
+
+  ExecutableMemory(void* memory, size_t mappedSize, size_t codeSize)
+      : memory(memory), mappedSize(mappedSize), codeSize(codeSize) {}
+};
+
+// Native code for a single Lox function.
+class JitCode {
+ public:
+  // int64_t fn(const int64_t* args, int64_t* result, int64_t depth)
+  // returns 0 when *result holds the return value and 1 when execution
+  // must be redone by the Evaluator.
+  using NativeFunction = int64_t (*)(const int64_t*, int64_t*, int64_t);
+
+  // native recursion budget before bailing out to the Evaluator.
+  static constexpr int64_t MAX_DEPTH = 4096;
+
+  explicit JitCode(std::unique_ptr<ExecutableMemory> memory)
+      : memory(std::move(memory)) {
+    entry = reinterpret_cast<NativeFunction>(this->memory->getEntry());
+  }
+
+  bool call(const int64_t* args, int64_t& result) const {
+    return entry(args, &result, MAX_DEPTH) == 0;
+  }
+
+  size_t size() const { return memory->size(); }
+
+ private:
+  std::unique_ptr<ExecutableMemory> memory;
+  NativeFunction entry;
+};
+
+using JitCodePtr = std::shared_ptr<JitCode>;
+
+// Baseline compiler for integer kernels. Supports int and bool expressions,
+// int locals, control flow and direct self-recursive calls; returns nullptr
+// for anything else so the caller keeps interpreting.
+class JitCompiler {
+ public:
+  static JitCodePtr compile(const FunctionDeclarationPtr& declaration);
+};
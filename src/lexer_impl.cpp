@@ -10,6 +10,7 @@ extern JSParser::value_type yylval;
 
 int yylex(JSParser::value_type* value, ASTBuilder& builder, JSLexer& lexer) {
   int yyToken = lexer.yylex();
+  builder.setLine(lexer.lineno());
   const auto& token = yylval.as<Token>();
   value->emplace<Token>(yylval.as<Token>());
   return yyToken;
@@ -1,18 +1,30 @@
 #include <gflags/gflags.h>
 
 #include "astbuilder.h"
+#include "closure_compiler.h"
 #include "common.h"
 #include "evaluator.h"
 #include "lexer.h"
+#include "optimizer.h"
 #include "parser.h"
 #include "settings.h"
 #include "token.h"
+#include "vm.h"
 
 #define EXIT_CMDLINE_HELP 64
 
 using Parser::JSParser;
 
 DEFINE_bool(debug, false, "Enable debugging");
+DEFINE_string(engine, "tree", "Execution engine: tree, closure or vm");
+DEFINE_bool(jit, true, "Compile hot functions to native code (tree engine)");
+DEFINE_int32(jit_threshold, 10, "Calls before a function is JIT compiled");
+DEFINE_int32(trace_threshold, 50, "Loop iterations before a loop is traced");
+DEFINE_int32(opt_level, 1, "AST optimization level, 0 disables optimizations");
+DEFINE_bool(inline, true, "Inline small functions at their call sites");
+DEFINE_int32(max_call_depth, 10000,
+             "Nested calls before a stack overflow error "
+             "(every engine)");
 
 void fixNewLineAtEOF(std::string &source) {
   if (source.length() > 0 && source[source.length() - 1] != '\n') {
@@ -23,12 +35,25 @@ void fixNewLineAtEOF(std::string &source) {
 class Driver {
  private:
   Evaluator evaluator;
+  ClosureCompiler closureCompiler;
+  VM vm;
 
  public:
   Driver() {
     if (FLAGS_debug) {
       Settings::getInstance()->debugMode = true;
     }
+    if (FLAGS_engine != "tree" && FLAGS_engine != "closure" &&
+        FLAGS_engine != "vm") {
+      throw std::invalid_argument("Unknown engine: " + FLAGS_engine);
+    }
+    Settings::getInstance()->engine = FLAGS_engine;
+    Settings::getInstance()->jitEnabled = FLAGS_jit;
+    Settings::getInstance()->jitThreshold = FLAGS_jit_threshold;
+    Settings::getInstance()->traceThreshold = FLAGS_trace_threshold;
+    Settings::getInstance()->optLevel = FLAGS_opt_level;
+    Settings::getInstance()->inlineEnabled = FLAGS_inline;
+    Settings::getInstance()->maxCallDepth = FLAGS_max_call_depth;
   }
 
   void repl() {
@@ -73,8 +98,19 @@ class Driver {
       if (program == nullptr) {
         return false;
       }
+      Optimizer optimizer(Settings::getInstance()->getOptLevel(),
+                          Settings::getInstance()->isInlineEnabled());
+      optimizer.optimize(program);
       LOG(INFO) << "======== EVALUATION START ========";
-      auto value = evaluator.eval(program);
+      ObjectPtr value;
+      const auto &engine = Settings::getInstance()->getEngine();
+      if (engine == "vm") {
+        value = vm.interpret(program);
+      } else if (engine == "closure") {
+        value = closureCompiler.interpret(program);
+      } else {
+        value = evaluator.eval(program);
+      }
       LOG(INFO) << "Result: " << (value ? value->toString() : "nullptr");
       LOG(INFO) << "======== EVALUATION END ========";
       return true;
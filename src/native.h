@@ -34,8 +34,8 @@ class NativeFunction : public Object {
   friend bool operator==(const NativeFunction &lhs, const NativeFunction &rhs);
 };
 
-typedef std::shared_ptr<NativeFunction> NativeFunctionPtr;
-typedef std::weak_ptr<NativeFunction> NativeFunctionWeakPtr;
+typedef Ref<NativeFunction> NativeFunctionPtr;
+typedef WeakRef<NativeFunction> NativeFunctionWeakPtr;
 
 bool operator==(const NativeFunction &lhs, const NativeFunction &rhs);
 
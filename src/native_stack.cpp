@@ -0,0 +1,152 @@
+#include "native_stack.h"
+
+#ifdef CPPLOX_NATIVE_STACK_SUPPORTED
+#ifdef __APPLE__
+#define _XOPEN_SOURCE 600
+#endif
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+#endif
+
+#if defined(__SANITIZE_ADDRESS__)
+#define CPPLOX_ASAN 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define CPPLOX_ASAN 1
+#endif
+#endif
+
+#ifdef CPPLOX_ASAN
+#include <sanitizer/common_interface_defs.h>
+#endif
+
+namespace {
+
+#ifdef CPPLOX_ASAN
+// AddressSanitizer only unpoisons stacks of up to 64MB when an exception
+// unwinds them, so programs run under it overflow at a shallower depth.
+constexpr size_t MAX_STACK_SIZE = 64 * 1024 * 1024;
+#else
+constexpr size_t MAX_STACK_SIZE = SIZE_MAX;
+#endif
+
+// lowest address code on the current NativeStack may use, stacks grow down
+// on every supported platform.
+thread_local const char* stackLimit = nullptr;
+
+#ifdef CPPLOX_NATIVE_STACK_SUPPORTED
+struct Task {
+  const std::function<void()>* fn;
+  std::exception_ptr error;
+  // stack of the caller, so AddressSanitizer can be told when control
+  // returns to it.
+  const void* callerBottom;
+  size_t callerSize;
+};
+
+// makecontext only passes int arguments, so the task is handed over here.
+thread_local Task* startingTask = nullptr;
+
+void runTask() {
+  auto task = startingTask;
+#ifdef CPPLOX_ASAN
+  __sanitizer_finish_switch_fiber(nullptr, &task->callerBottom,
+                                  &task->callerSize);
+#endif
+  // exceptions cannot unwind past the start of the stack.
+  try {
+    (*task->fn)();
+  } catch (...) {
+    task->error = std::current_exception();
+  }
+#ifdef CPPLOX_ASAN
+  // the stack is left for good, its fake frames can be released.
+  __sanitizer_start_switch_fiber(nullptr, task->callerBottom,
+                                 task->callerSize);
+#endif
+}
+#endif
+
+}  // namespace
+
+NativeStack::NativeStack(size_t size)
+    : size(size), stackSize(std::min(size, getMaxSize()) + RESERVED_SIZE) {}
+
+NativeStack::~NativeStack() {
+#ifdef CPPLOX_NATIVE_STACK_SUPPORTED
+  if (memory != nullptr) {
+    munmap(memory - guardSize, guardSize + stackSize);
+  }
+#endif
+}
+
+size_t NativeStack::getMaxSize() { return MAX_STACK_SIZE - RESERVED_SIZE; }
+
+bool NativeStack::map() {
+#ifdef CPPLOX_NATIVE_STACK_SUPPORTED
+  const auto pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  const auto mappedSize = (stackSize + pageSize - 1) / pageSize * pageSize;
+  // reserves the address space only, nothing is committed before it is
+  // touched.
+  void* mapping =
+      mmap(nullptr, pageSize + mappedSize, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (mapping == MAP_FAILED) {
+    return false;
+  }
+  if (mprotect(mapping, pageSize, PROT_NONE) != 0) {
+    munmap(mapping, pageSize + mappedSize);
+    return false;
+  }
+  guardSize = pageSize;
+  stackSize = mappedSize;
+  memory = static_cast<char*>(mapping) + guardSize;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void NativeStack::run(const std::function<void()>& fn) {
+#ifdef CPPLOX_NATIVE_STACK_SUPPORTED
+  ucontext_t caller;
+  ucontext_t callee;
+  if (!running && (memory != nullptr || map()) &&
+      getcontext(&callee) == 0) {
+    callee.uc_stack.ss_sp = memory;
+    callee.uc_stack.ss_size = stackSize;
+    callee.uc_link = &caller;
+    makecontext(&callee, runTask, 0);
+
+    Task task{&fn, nullptr, nullptr, 0};
+    startingTask = &task;
+    const auto enclosingLimit = stackLimit;
+    stackLimit = memory + RESERVED_SIZE;
+    running = true;
+#ifdef CPPLOX_ASAN
+    void* fakeStack = nullptr;
+    __sanitizer_start_switch_fiber(&fakeStack, memory, stackSize);
+#endif
+    const auto switched = swapcontext(&caller, &callee) == 0;
+#ifdef CPPLOX_ASAN
+    __sanitizer_finish_switch_fiber(fakeStack, nullptr, nullptr);
+#endif
+    running = false;
+    stackLimit = enclosingLimit;
+    if (switched) {
+      if (task.error) {
+        std::rethrow_exception(task.error);
+      }
+      return;
+    }
+  }
+#endif
+  // no stack of our own, the limit of an enclosing run still applies.
+  fn();
+}
+
+bool NativeStack::isExhausted() {
+  const char here = 0;
+  return stackLimit != nullptr && &here < stackLimit;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "common.h"
+
+#if defined(__linux__) || defined(__APPLE__)
+#define CPPLOX_NATIVE_STACK_SUPPORTED 1
+#endif
+
+// A native stack of a chosen size to run code on, so how deep the Evaluator
+// can recurse depends on its settings rather than on the stack of whichever
+// thread calls it. No thread is created. The stack is mapped by the first
+// run and reused by every later one; the mapping only reserves address
+// space, pages are committed as the stack grows into them, and a guard page
+// below it faults rather than letting an overflow run into other memory.
+class NativeStack {
+ public:
+  // bytes kept free below the deepest point code may recurse to, enough for
+  // JIT compiled code to use up its whole native recursion budget.
+  static constexpr size_t RESERVED_SIZE = 1024 * 1024;
+
+  explicit NativeStack(size_t size);
+  ~NativeStack();
+  NativeStack(const NativeStack&) = delete;
+  NativeStack& operator=(const NativeStack&) = delete;
+
+  // usable bytes requested, not counting the reserved area.
+  size_t getSize() const { return size; }
+  // usable bytes a stack can have on this build; bigger requests are cut
+  // down to it.
+  static size_t getMaxSize();
+
+  // runs fn to completion on the stack, rethrowing whatever it throws. Runs
+  // fn on the current stack where the platform has no support, when the
+  // stack could not be mapped or when already running on it.
+  void run(const std::function<void()>& fn);
+
+  // true when code running on a NativeStack has reached its reserved area;
+  // always false elsewhere.
+  static bool isExhausted();
+
+ private:
+  size_t size;
+  // bytes of the stack, the reserved area included.
+  size_t stackSize;
+  // bytes of the guard page below the stack.
+  size_t guardSize = 0;
+  // lowest address of the stack, once mapped.
+  char* memory = nullptr;
+  bool running = false;
+
+  // maps the stack and its guard page, false when that failed.
+  bool map();
+};
@@ -1,9 +1,116 @@
 #include "object.h"
 
+#include "scope_pool.h"
+
+void destroyObject(Object *object) {
+  auto *counts = countsOf(object);
+  object->~Object();
+  if (counts->weakRefs == 0) {
+    freeObject(counts);
+  }
+}
+
+void freeObject(RefCounts *counts) {
+  if (counts->pooled) {
+    ScopePool::deallocate(counts);
+  } else {
+    ::operator delete(counts);
+  }
+}
+
 bool operator==(const Object &lhs, const Object &rhs) {
   return lhs.Type == rhs.Type && lhs.isEqual(rhs);
 }
 
 bool operator!=(const Object &lhs, const Object &rhs) {
   return lhs.Type != rhs.Type || !lhs.isEqual(rhs);
-}
\ No newline at end of file
+}
+
+Value::Value(const ObjectPtr &object) : bits(NIL_BITS) {
+  if (!object) {
+    return;
+  }
+  // immediates are never kept boxed.
+  switch (object->Type) {
+    case ObjectType::OBJ_NULL:
+      return;
+    case ObjectType::OBJ_BOOLEAN:
+      bits = static_cast<const BooleanObject &>(*object).Value ? TRUE_BITS
+                                                               : FALSE_BITS;
+      return;
+    case ObjectType::OBJ_INTEGER: {
+      const auto value = static_cast<const IntegerObject &>(*object).Value;
+      if (value >= MIN_INLINE_INTEGER && value <= MAX_INLINE_INTEGER) {
+        bits = Value::integer(value).bits;
+        return;
+      }
+      break;
+    }
+    default:
+      break;
+  }
+  bits = reinterpret_cast<uint64_t>(object.get());
+  assert((bits & TAG_MASK) == OBJECT_TAG);
+  retainObject(object.get());
+}
+
+Value Value::boxInteger(int64_t value) {
+  return Value(ObjectPtr(IntegerObject::make(value)));
+}
+
+int64_t Value::boxedInteger() const {
+  return static_cast<const IntegerObject *>(asObject())->Value;
+}
+
+ObjectType Value::type() const {
+  if (isObject()) {
+    return asObject()->Type;
+  } else if ((bits & INTEGER_TAG) != 0) {
+    return ObjectType::OBJ_INTEGER;
+  } else if (isBoolean()) {
+    return ObjectType::OBJ_BOOLEAN;
+  }
+  return ObjectType::OBJ_NULL;
+}
+
+bool Value::isTruthy() const {
+  if (isObject()) {
+    return asObject()->isTruthy();
+  } else if ((bits & INTEGER_TAG) != 0) {
+    return asInteger() != 0;
+  }
+  return asBoolean();
+}
+
+bool Value::isEqual(const Value &other) const {
+  if (bits == other.bits) {
+    return true;
+  } else if (isInteger() && other.isInteger()) {
+    return asInteger() == other.asInteger();
+  } else if (isObject() && other.isObject()) {
+    return asObject()->isEqual(*other.asObject());
+  }
+  return false;
+}
+
+std::string Value::toString() const {
+  if (isObject()) {
+    return asObject()->toString();
+  } else if ((bits & INTEGER_TAG) != 0) {
+    return std::to_string(asInteger());
+  } else if (isBoolean()) {
+    return asBoolean() ? "true" : "false";
+  }
+  return "nil";
+}
+
+ObjectPtr Value::toObject() const {
+  if (isObject()) {
+    return ObjectPtr(asObject());
+  } else if ((bits & INTEGER_TAG) != 0) {
+    return IntegerObject::make(asInteger());
+  } else if (isBoolean()) {
+    return asBoolean() ? TRUE_OBJECT_PTR : FALSE_OBJECT_PTR;
+  }
+  return NULL_OBJECT_PTR;
+}
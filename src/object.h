@@ -3,29 +3,46 @@
 
 #include "common.h"
 
-enum class ObjectType {
+enum class ObjectType : uint8_t {
   OBJ_EMPTY = 0,
   OBJ_INTEGER,
   OBJ_BOOLEAN,
   OBJ_STRING,
   OBJ_NULL,
-  OBJ_RETURN_VALUE,
-  OBJ_BREAK,
-  OBJ_CONTINUE,
   OBJ_ERROR,
   OBJ_FUNCTION,
   OBJ_CLASS,
   OBJ_ARRAY,
   OBJ_NATIVE,
   OBJ_RECORD,
+  OBJ_COMPILED_FUNCTION,
+  OBJ_CLOSURE,
+  OBJ_UPVALUE,
+  OBJ_COMPILED_CLASS,
+  OBJ_INSTANCE,
+  OBJ_BOUND_METHOD,
+  OBJ_EXEC_FUNCTION,
+  OBJ_EXEC_CLASS,
+  OBJ_EXEC_RECORD,
+  OBJ_ENVIRONMENT,
 };
 
 struct Object {
   const ObjectType Type;
+  // set once the object survived a collection or was stored into an old
+  // environment; minor collections of the Heap leave it alone.
+  bool old = false;
+  // set once a step of the Heap proved the object live; it is no candidate
+  // of a garbage cycle again until a reference to it is dropped.
+  bool settled = false;
+  // set while a full collection of the Heap traces the objects reachable
+  // from its roots.
+  bool marked = false;
 
   Object() : Type(ObjectType::OBJ_EMPTY) {}
   Object(const Object &obj) : Type(obj.Type) {}
   Object(const ObjectType type) : Type(type) {}
+  virtual ~Object() = default;
 
   virtual std::string toString() const { return std::string(); }
   virtual bool isFalsey() const { return true; }
@@ -41,11 +58,325 @@ struct Object {
   friend bool operator!=(const Object &, const Object &);
 };
 
-using ObjectPtr = std::shared_ptr<Object>;
+// Reference counts of an Object, allocated right before it by makeRef so
+// that they outlive the object while WeakRefs to it remain. They are not
+// atomic: objects never cross threads.
+struct alignas(8) RefCounts {
+  // Refs and Values referring to the object; the last one destroys it.
+  uint32_t refs = 0;
+  // WeakRefs referring to the object; its memory is freed once it is
+  // destroyed and none remain.
+  uint32_t weakRefs : 31;
+  // the memory came from the ScopePool rather than operator new.
+  uint32_t pooled : 1;
+
+  explicit RefCounts(bool pooled) : weakRefs(0), pooled(pooled) {}
+};
+
+inline RefCounts *countsOf(const Object *object) {
+  return reinterpret_cast<RefCounts *>(const_cast<Object *>(object)) - 1;
+}
+
+// runs the destructor of an object whose last reference was dropped.
+void destroyObject(Object *object);
+// frees the memory of a destroyed object the last WeakRef let go of.
+void freeObject(RefCounts *counts);
+
+// hands a settled object back to the Heap as a candidate, see heap.h.
+void unsettle(Object *object);
+
+inline void retainObject(const Object *object) { countsOf(object)->refs++; }
+// an object that survives losing a reference may be left to a garbage
+// cycle now, so a settled one is a candidate again.
+inline void releaseObject(const Object *object) {
+  if (--countsOf(object)->refs == 0) {
+    destroyObject(const_cast<Object *>(object));
+  } else if (object->settled) {
+    unsettle(const_cast<Object *>(object));
+  }
+}
+
+// Owning pointer to an Object allocated by makeRef, counted in its
+// RefCounts. Used like std::shared_ptr, without the separate control block
+// or the atomic count updates.
+template <typename T>
+class Ref {
+ public:
+  Ref() noexcept : object(nullptr) {}
+  Ref(std::nullptr_t) noexcept : object(nullptr) {}
+  // takes a new reference to an object makeRef allocated.
+  explicit Ref(T *object) noexcept : object(object) { retain(); }
+  Ref(const Ref &other) noexcept : object(other.object) { retain(); }
+  Ref(Ref &&other) noexcept : object(other.object) { other.object = nullptr; }
+  template <typename U, typename = std::enable_if_t<
+                            std::is_convertible<U *, T *>::value>>
+  Ref(const Ref<U> &other) noexcept : object(other.get()) {
+    retain();
+  }
+  template <typename U, typename = std::enable_if_t<
+                            std::is_convertible<U *, T *>::value>>
+  Ref(Ref<U> &&other) noexcept : object(other.object) {
+    other.object = nullptr;
+  }
+  ~Ref() { release(); }
+
+  Ref &operator=(const Ref &other) noexcept {
+    other.retain();
+    release();
+    object = other.object;
+    return *this;
+  }
+  Ref &operator=(Ref &&other) noexcept {
+    if (this != &other) {
+      release();
+      object = other.object;
+      other.object = nullptr;
+    }
+    return *this;
+  }
+
+  T *get() const noexcept { return object; }
+  T &operator*() const noexcept { return *object; }
+  T *operator->() const noexcept { return object; }
+  explicit operator bool() const noexcept { return object != nullptr; }
+
+  void reset() noexcept {
+    release();
+    object = nullptr;
+  }
+  long use_count() const noexcept {
+    return object ? countsOf(object)->refs : 0;
+  }
+
+ private:
+  template <typename U>
+  friend class Ref;
+
+  T *object;
+
+  void retain() const noexcept {
+    if (object) {
+      retainObject(object);
+    }
+  }
+  void release() noexcept {
+    if (object) {
+      releaseObject(object);
+    }
+  }
+};
+
+template <typename T, typename U>
+bool operator==(const Ref<T> &lhs, const Ref<U> &rhs) {
+  return lhs.get() == rhs.get();
+}
+template <typename T, typename U>
+bool operator!=(const Ref<T> &lhs, const Ref<U> &rhs) {
+  return lhs.get() != rhs.get();
+}
+template <typename T>
+bool operator==(const Ref<T> &lhs, std::nullptr_t) {
+  return lhs.get() == nullptr;
+}
+template <typename T>
+bool operator!=(const Ref<T> &lhs, std::nullptr_t) {
+  return lhs.get() != nullptr;
+}
+
+template <typename T, typename U>
+Ref<T> static_pointer_cast(const Ref<U> &ref) {
+  return Ref<T>(static_cast<T *>(ref.get()));
+}
+template <typename T, typename U>
+Ref<T> dynamic_pointer_cast(const Ref<U> &ref) {
+  return Ref<T>(dynamic_cast<T *>(ref.get()));
+}
+
+// constructs a T and its RefCounts in memory of sizeof(RefCounts) +
+// sizeof(T) bytes, which came from the ScopePool if pooled is set.
+template <typename T, typename... Args>
+Ref<T> constructRef(void *memory, bool pooled, Args &&...args) {
+  static_assert(std::is_base_of<Object, T>::value, "not an Object");
+  static_assert(alignof(T) <= alignof(RefCounts), "over-aligned object");
+  auto *counts = new (memory) RefCounts(pooled);
+  try {
+    auto *object = new (counts + 1) T(std::forward<Args>(args)...);
+    assert(static_cast<Object *>(object) == static_cast<void *>(counts + 1));
+    return Ref<T>(object);
+  } catch (...) {
+    freeObject(counts);
+    throw;
+  }
+}
+
+// allocates a T together with its RefCounts.
+template <typename T, typename... Args>
+Ref<T> makeRef(Args &&...args) {
+  return constructRef<T>(::operator new(sizeof(RefCounts) + sizeof(T)), false,
+                         std::forward<Args>(args)...);
+}
+
+// Reference to an Object that keeps its memory but not the object itself,
+// for the Heap to remember objects without keeping them alive.
+template <typename T>
+class WeakRef {
+ public:
+  WeakRef() noexcept : object(nullptr) {}
+  // object must be alive.
+  explicit WeakRef(T *object) noexcept : object(object) { retain(); }
+  WeakRef(const Ref<T> &ref) noexcept : object(ref.get()) { retain(); }
+  WeakRef(const WeakRef &other) noexcept : object(other.object) { retain(); }
+  WeakRef(WeakRef &&other) noexcept : object(other.object) {
+    other.object = nullptr;
+  }
+  ~WeakRef() { release(); }
+
+  WeakRef &operator=(const WeakRef &other) noexcept {
+    WeakRef copy(other);
+    std::swap(object, copy.object);
+    return *this;
+  }
+  WeakRef &operator=(WeakRef &&other) noexcept {
+    if (this != &other) {
+      release();
+      object = other.object;
+      other.object = nullptr;
+    }
+    return *this;
+  }
+
+  bool expired() const noexcept {
+    return object == nullptr || countsOf(object)->refs == 0;
+  }
+  Ref<T> lock() const noexcept { return expired() ? Ref<T>() : Ref<T>(object); }
+
+ private:
+  T *object;
+
+  void retain() const noexcept {
+    if (object) {
+      countsOf(object)->weakRefs++;
+    }
+  }
+  void release() noexcept {
+    if (object) {
+      auto *counts = countsOf(object);
+      if (--counts->weakRefs == 0 && counts->refs == 0) {
+        freeObject(counts);
+      }
+    }
+  }
+};
+
+using ObjectPtr = Ref<Object>;
 
 bool operator==(const Object &lhs, const Object &rhs);
 bool operator!=(const Object &lhs, const Object &rhs);
 
+// An 8-byte tagged value. nil, booleans and integers that fit in 63 bits
+// are stored inline; anything else is a pointer to a heap Object, counted
+// in its RefCounts like a Ref.
+class Value {
+ public:
+  Value() : bits(NIL_BITS) {}
+  Value(const ObjectPtr &object);
+  template <typename T, typename = std::enable_if_t<
+                            std::is_base_of<Object, T>::value>>
+  Value(const Ref<T> &object) : Value(ObjectPtr(object)) {}
+  Value(const Value &other) : bits(other.bits) { retain(); }
+  Value(Value &&other) noexcept : bits(other.bits) { other.bits = NIL_BITS; }
+  ~Value() { release(); }
+
+  Value &operator=(const Value &other) {
+    other.retain();
+    release();
+    bits = other.bits;
+    return *this;
+  }
+  Value &operator=(Value &&other) noexcept {
+    if (this != &other) {
+      release();
+      bits = other.bits;
+      other.bits = NIL_BITS;
+    }
+    return *this;
+  }
+
+  static Value nil() { return Value(); }
+  static Value boolean(bool value) {
+    return Value(value ? TRUE_BITS : FALSE_BITS);
+  }
+  static Value integer(int64_t value) {
+    if (value >= MIN_INLINE_INTEGER && value <= MAX_INLINE_INTEGER) {
+      return Value((static_cast<uint64_t>(value) << 1) | INTEGER_TAG);
+    }
+    return boxInteger(value);
+  }
+
+  bool isNil() const { return bits == NIL_BITS; }
+  bool isBoolean() const { return (bits & TAG_MASK) == BOOLEAN_TAG; }
+  bool isObject() const { return (bits & TAG_MASK) == OBJECT_TAG; }
+  bool isInteger() const {
+    return (bits & INTEGER_TAG) != 0 ||
+           (isObject() && asObject()->Type == ObjectType::OBJ_INTEGER);
+  }
+
+  bool asBoolean() const { return bits == TRUE_BITS; }
+  int64_t asInteger() const {
+    if ((bits & INTEGER_TAG) != 0) {
+      return static_cast<int64_t>(bits) >> 1;
+    }
+    return boxedInteger();
+  }
+  Object *asObject() const { return reinterpret_cast<Object *>(bits); }
+  // the heap object, which must be a T.
+  template <typename T>
+  Ref<T> as() const {
+    assert(isObject());
+    return Ref<T>(static_cast<T *>(asObject()));
+  }
+
+  ObjectType type() const;
+  bool isTruthy() const;
+  bool isFalsey() const { return !isTruthy(); }
+  bool isEqual(const Value &other) const;
+  std::string toString() const;
+  // the value as an Object, boxing immediates.
+  ObjectPtr toObject() const;
+
+ private:
+  // low bits: xx1 integer, 000 object, 010 nil, 100 boolean (bit 3 = value).
+  static constexpr uint64_t INTEGER_TAG = 1;
+  static constexpr uint64_t TAG_MASK = 7;
+  static constexpr uint64_t OBJECT_TAG = 0;
+  static constexpr uint64_t NIL_BITS = 2;
+  static constexpr uint64_t BOOLEAN_TAG = 4;
+  static constexpr uint64_t FALSE_BITS = BOOLEAN_TAG;
+  static constexpr uint64_t TRUE_BITS = BOOLEAN_TAG | 8;
+  static constexpr int64_t MAX_INLINE_INTEGER = INT64_MAX >> 1;
+  static constexpr int64_t MIN_INLINE_INTEGER = INT64_MIN >> 1;
+
+  uint64_t bits;
+
+  explicit Value(uint64_t bits) : bits(bits) {}
+
+  static Value boxInteger(int64_t value);
+  int64_t boxedInteger() const;
+
+  void retain() const {
+    if (isObject()) {
+      retainObject(asObject());
+    }
+  }
+  void release() {
+    if (isObject()) {
+      releaseObject(asObject());
+    }
+  }
+};
+
+static_assert(sizeof(Value) == 8, "Value must stay one word");
+
 struct NullObject : public Object {
   NullObject() : Object(ObjectType::OBJ_NULL) {}
 
@@ -57,7 +388,7 @@ struct NullObject : public Object {
   }
 };
 
-using NullObjectPtr = std::shared_ptr<NullObject>;
+using NullObjectPtr = Ref<NullObject>;
 
 struct IntegerObject : public Object {
   int64_t Value;
@@ -81,12 +412,12 @@ struct IntegerObject : public Object {
     return false;
   }
 
-  static std::shared_ptr<IntegerObject> make(const int64_t value) {
-    return std::make_shared<IntegerObject>(value);
+  static Ref<IntegerObject> make(const int64_t value) {
+    return makeRef<IntegerObject>(value);
   }
 };
 
-using IntegerObjectPtr = std::shared_ptr<IntegerObject>;
+using IntegerObjectPtr = Ref<IntegerObject>;
 
 struct BooleanObject : public Object {
   bool Value;
@@ -106,12 +437,12 @@ struct BooleanObject : public Object {
     return false;
   }
 
-  static std::shared_ptr<BooleanObject> make(const bool value) {
-    return std::make_shared<BooleanObject>(value);
+  static Ref<BooleanObject> make(const bool value) {
+    return makeRef<BooleanObject>(value);
   }
 };
 
-using BooleanObjectPtr = std::shared_ptr<BooleanObject>;
+using BooleanObjectPtr = Ref<BooleanObject>;
 
 struct StringObject : public Object {
   std::string Value;
@@ -132,82 +463,12 @@ struct StringObject : public Object {
   }
 };
 
-using StringObjectPtr = std::shared_ptr<StringObject>;
-
-struct ReturnObject : public Object {
-  ObjectPtr Value;
-
-  ReturnObject(const ObjectPtr &value)
-      : Object(ObjectType::OBJ_RETURN_VALUE), Value(value) {}
-
-  std::string toString() const override {
-    return "return " + Value->toString();
-  }
-
-  bool isFalsey() const override { return Value->isFalsey(); }
-  bool isTruthy() const override { return Value->isTruthy(); }
-
-  bool isEqual(const Object &obj) const override {
-    if (obj.Type == Type) {
-      const auto &rhs = static_cast<const ReturnObject &>(obj);
-      return Value == rhs.Value;
-    }
-    return false;
-  }
-
-  static std::shared_ptr<ReturnObject> make(const ObjectPtr &value) {
-    return std::make_shared<ReturnObject>(value);
-  }
-};
-
-using ReturnObjectPtr = std::shared_ptr<ReturnObject>;
-
-struct BreakObject : public Object {
-  BreakObject() : Object(ObjectType::OBJ_BREAK) {}
-
-  std::string toString() const override { return "break"; }
-
-  bool isFalsey() const override { return false; }
-  bool isTruthy() const override { return true; }
-
-  bool isEqual(const Object &obj) const override {
-    if (obj.Type == Type) {
-      return true;
-    }
-    return false;
-  }
-
-  static std::shared_ptr<BreakObject> make() {
-    return std::make_shared<BreakObject>();
-  }
-};
-
-using BreakObjectPtr = std::shared_ptr<BreakObject>;
-
-struct ContinueObject : public Object {
-  ContinueObject() : Object(ObjectType::OBJ_CONTINUE) {}
-
-  std::string toString() const override { return "continue"; }
-
-  bool isFalsey() const override { return false; }
-  bool isTruthy() const override { return true; }
-
-  bool isEqual(const Object &obj) const override {
-    if (obj.Type == Type) {
-      return true;
-    }
-    return false;
-  }
-
-  static std::shared_ptr<ContinueObject> make() {
-    return std::make_shared<ContinueObject>();
-  }
-};
-
-using ContinueObjectPtr = std::shared_ptr<ContinueObject>;
+using StringObjectPtr = Ref<StringObject>;
 
 struct ArrayObject : public Object {
-  std::vector<ObjectPtr> Values;
+  // filled in when the array is made and never stored into after, since
+  // Lox has no element assignment, so there is no write barrier to apply.
+  std::vector<Value> Values;
 
   ArrayObject() : Object(ObjectType::OBJ_ARRAY) {}
 
@@ -215,7 +476,7 @@ struct ArrayObject : public Object {
     std::ostringstream ss;
     ss << "[";
     for (size_t i = 0; i < Values.size(); i++) {
-      ss << Values[i]->toString();
+      ss << Values[i].toString();
       if (i < Values.size() - 1) {
         ss << ", ";
       }
@@ -234,7 +495,7 @@ struct ArrayObject : public Object {
         return false;
       }
       for (size_t i = 0; i < Values.size(); i++) {
-        if (!Values[i]->isEqual(*rhs.Values[i])) {
+        if (!Values[i].isEqual(rhs.Values[i])) {
           return false;
         }
       }
@@ -243,18 +504,17 @@ struct ArrayObject : public Object {
     return false;
   }
 
-  static std::shared_ptr<ArrayObject> make(
-      const std::vector<ObjectPtr> &values) {
-    auto array = std::make_shared<ArrayObject>();
-    array->Values = values;
+  static Ref<ArrayObject> make(std::vector<Value> values) {
+    auto array = makeRef<ArrayObject>();
+    array->Values = std::move(values);
     return array;
   }
 };
 
-using ArrayObjectPtr = std::shared_ptr<ArrayObject>;
+using ArrayObjectPtr = Ref<ArrayObject>;
 
-static auto NULL_OBJECT_PTR = std::make_shared<NullObject>();
-static auto TRUE_OBJECT_PTR = std::make_shared<BooleanObject>(true);
-static auto FALSE_OBJECT_PTR = std::make_shared<BooleanObject>(false);
+static auto NULL_OBJECT_PTR = makeRef<NullObject>();
+static auto TRUE_OBJECT_PTR = makeRef<BooleanObject>(true);
+static auto FALSE_OBJECT_PTR = makeRef<BooleanObject>(false);
 
 #endif  // __cpplox_object_h
\ No newline at end of file
@@ -0,0 +1,1014 @@
+#include "optimizer.h"
+
+#include <algorithm>
+
+namespace {
+
+// the value of a literal node; false for anything else.
+bool constantOf(const ExpressionPtr& expr, Value& value) {
+  switch (expr->Type) {
+    case NodeType::INTEGER_LITERAL:
+      value = static_cast<IntegerLiteral*>(expr)->constant;
+      return true;
+    case NodeType::STRING_LITERAL:
+      value = static_cast<StringLiteral*>(expr)->constant;
+      return true;
+    case NodeType::BOOLEAN_LITERAL:
+      value = Value::boolean(static_cast<BooleanLiteral*>(expr)->Value);
+      return true;
+    case NodeType::NIL_LITERAL:
+      value = Value::nil();
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool isArithmetic(TokenType operator_) {
+  return operator_ == TokenType::TOKEN_PLUS ||
+         operator_ == TokenType::TOKEN_MINUS ||
+         operator_ == TokenType::TOKEN_STAR ||
+         operator_ == TokenType::TOKEN_SLASH;
+}
+
+// true when expr either evaluates to an integer or raises, so dropping an
+// identity operation around it cannot change the program's behavior.
+bool isIntegerTyped(const ExpressionPtr& expr) {
+  switch (expr->Type) {
+    case NodeType::INTEGER_LITERAL:
+      return true;
+    case NodeType::BINARY_EXPRESSION:
+      return isArithmetic(static_cast<BinaryExpr*>(expr)->operator_.type);
+    case NodeType::UNARY_EXPRESSION:
+      return static_cast<UnaryExpr*>(expr)->operator_.type ==
+             TokenType::TOKEN_MINUS;
+    default:
+      return false;
+  }
+}
+
+bool isIntegerLiteral(const ExpressionPtr& expr, int64_t value) {
+  return expr->Type == NodeType::INTEGER_LITERAL &&
+         static_cast<IntegerLiteral*>(expr)->Value == value;
+}
+
+// true when evaluating expr can neither fail nor change any state.
+bool isPure(const ExpressionPtr& expr) {
+  switch (expr->Type) {
+    case NodeType::INTEGER_LITERAL:
+    case NodeType::STRING_LITERAL:
+    case NodeType::BOOLEAN_LITERAL:
+    case NodeType::NIL_LITERAL:
+    case NodeType::VARIABLE_EXPRESSION:
+      return true;
+    case NodeType::UNARY_EXPRESSION: {
+      auto unaryExpr = static_cast<UnaryExpr*>(expr);
+      return unaryExpr->operator_.type == TokenType::TOKEN_BANG &&
+             isPure(unaryExpr->right);
+    }
+    case NodeType::BINARY_EXPRESSION: {
+      auto binaryExpr = static_cast<BinaryExpr*>(expr);
+      switch (binaryExpr->operator_.type) {
+        case TokenType::TOKEN_EQUAL_EQUAL:
+        case TokenType::TOKEN_BANG_EQUAL:
+        case TokenType::TOKEN_AND:
+        case TokenType::TOKEN_OR:
+          return isPure(binaryExpr->left) && isPure(binaryExpr->right);
+        default:
+          return false;
+      }
+    }
+    default:
+      return false;
+  }
+}
+
+bool isConstantFalse(const ExpressionPtr& expr) {
+  Value value;
+  return constantOf(expr, value) && value.isFalsey();
+}
+
+// true when running stmt has no observable effect; its value only matters
+// as the last statement of a block.
+bool hasNoEffect(const StatementPtr& stmt) {
+  switch (stmt->Type) {
+    case NodeType::EMPTY_STATEMENT:
+      return true;
+    case NodeType::EXPRESSION_STATEMENT:
+      return isPure(static_cast<ExpressionStatement*>(stmt)->expression);
+    case NodeType::IF_STATEMENT: {
+      auto ifStmt = static_cast<IfStatement*>(stmt);
+      return isConstantFalse(ifStmt->condition) && !ifStmt->elseBranch;
+    }
+    case NodeType::WHILE_STATEMENT:
+      return isConstantFalse(static_cast<WhileStatement*>(stmt)->condition);
+    case NodeType::FOR_STATEMENT: {
+      auto forStmt = static_cast<ForStatement*>(stmt);
+      if (!isConstantFalse(forStmt->condition)) {
+        return false;
+      }
+      // the initializer still runs, but its variable is never read.
+      const auto& initializer = forStmt->initializer;
+      if (initializer && initializer->Type == NodeType::VAR_DECLARATION) {
+        auto varDecl = static_cast<VarDeclaration*>(initializer);
+        return !varDecl->initializer || isPure(varDecl->initializer);
+      }
+      return !initializer || hasNoEffect(initializer);
+    }
+    default:
+      return false;
+  }
+}
+
+// true when control never reaches the statement following stmt.
+bool terminates(const StatementPtr& stmt) {
+  switch (stmt->Type) {
+    case NodeType::RETURN_STATEMENT:
+    case NodeType::BREAK_STATEMENT:
+    case NodeType::CONTINUE_STATEMENT:
+      return true;
+    case NodeType::BLOCK_STATEMENT: {
+      auto block = static_cast<Block*>(stmt);
+      return !block->statements.empty() && terminates(block->statements.back());
+    }
+    case NodeType::IF_STATEMENT: {
+      auto ifStmt = static_cast<IfStatement*>(stmt);
+      return ifStmt->elseBranch && terminates(ifStmt->thenBranch) &&
+             terminates(ifStmt->elseBranch);
+    }
+    default:
+      return false;
+  }
+}
+
+using Visitor = std::function<bool(const NodePtr&)>;
+
+// calls visit on node and everything nested in it, skipping the children of
+// nodes for which visit returns false.
+void walk(const NodePtr& node, const Visitor& visit) {
+  if (!node || !visit(node)) {
+    return;
+  }
+  switch (node->Type) {
+    case NodeType::EXPRESSION_STATEMENT:
+      walk(static_cast<ExpressionStatement*>(node)->expression,
+           visit);
+      break;
+    case NodeType::VAR_DECLARATION:
+      walk(static_cast<VarDeclaration*>(node)->initializer, visit);
+      break;
+    case NodeType::FUNCTION_DECLARATION:
+      walk(static_cast<FunctionDeclaration*>(node)->body, visit);
+      break;
+    case NodeType::CLASS_DECLARATION: {
+      auto classDecl = static_cast<ClassDeclaration*>(node);
+      for (const auto& field : classDecl->fields) {
+        walk(field, visit);
+      }
+      walk(classDecl->ctor, visit);
+      for (const auto& method : classDecl->methods) {
+        walk(method, visit);
+      }
+      break;
+    }
+    case NodeType::BLOCK_STATEMENT:
+      for (const auto& stmt :
+           static_cast<Block*>(node)->statements) {
+        walk(stmt, visit);
+      }
+      break;
+    case NodeType::IF_STATEMENT: {
+      auto ifStmt = static_cast<IfStatement*>(node);
+      walk(ifStmt->condition, visit);
+      walk(ifStmt->thenBranch, visit);
+      walk(ifStmt->elseBranch, visit);
+      break;
+    }
+    case NodeType::FOR_STATEMENT: {
+      auto forStmt = static_cast<ForStatement*>(node);
+      walk(forStmt->initializer, visit);
+      walk(forStmt->condition, visit);
+      walk(forStmt->increment, visit);
+      walk(forStmt->body, visit);
+      break;
+    }
+    case NodeType::WHILE_STATEMENT: {
+      auto whileStmt = static_cast<WhileStatement*>(node);
+      walk(whileStmt->condition, visit);
+      walk(whileStmt->body, visit);
+      break;
+    }
+    case NodeType::PRINT_STATEMENT:
+      walk(static_cast<PrintStatement*>(node)->expression, visit);
+      break;
+    case NodeType::RETURN_STATEMENT:
+      walk(static_cast<ReturnStatement*>(node)->expression, visit);
+      break;
+    case NodeType::BINARY_EXPRESSION: {
+      auto binaryExpr = static_cast<BinaryExpr*>(node);
+      walk(binaryExpr->left, visit);
+      walk(binaryExpr->right, visit);
+      break;
+    }
+    case NodeType::UNARY_EXPRESSION:
+      walk(static_cast<UnaryExpr*>(node)->right, visit);
+      break;
+    case NodeType::ASSIGNMENT_EXPRESSION:
+      walk(static_cast<Assignment*>(node)->value, visit);
+      break;
+    case NodeType::CALL_EXPRESSION: {
+      auto callExpr = static_cast<CallExpr*>(node);
+      walk(callExpr->left, visit);
+      for (const auto& argument : callExpr->arguments) {
+        walk(argument, visit);
+      }
+      break;
+    }
+    case NodeType::MEMBER_EXPRESSION:
+      walk(static_cast<MemberExpr*>(node)->left, visit);
+      break;
+    case NodeType::ARRAY_LITERAL:
+      for (const auto& element :
+           static_cast<ArrayLiteral*>(node)->elements) {
+        walk(element, visit);
+      }
+      break;
+    case NodeType::ARRAY_SUBSCRIPT_EXPRESSION: {
+      auto subscript = static_cast<ArraySubscriptExpr*>(node);
+      walk(subscript->array, visit);
+      walk(subscript->index, visit);
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+// true when evaluating expr may raise but cannot change any state.
+bool isEffectFree(const ExpressionPtr& expr) {
+  bool effectFree = true;
+  walk(expr, [&](const NodePtr& node) {
+    switch (node->Type) {
+      case NodeType::INTEGER_LITERAL:
+      case NodeType::STRING_LITERAL:
+      case NodeType::BOOLEAN_LITERAL:
+      case NodeType::NIL_LITERAL:
+      case NodeType::VARIABLE_EXPRESSION:
+      case NodeType::BINARY_EXPRESSION:
+      case NodeType::UNARY_EXPRESSION:
+        return true;
+      default:
+        effectFree = false;
+        return false;
+    }
+  });
+  return effectFree;
+}
+
+// true for literals and variables, which may be read any number of times
+// and never raise; an unset variable reads nil.
+bool isLeaf(const ExpressionPtr& expr) {
+  switch (expr->Type) {
+    case NodeType::INTEGER_LITERAL:
+    case NodeType::STRING_LITERAL:
+    case NodeType::BOOLEAN_LITERAL:
+    case NodeType::NIL_LITERAL:
+    case NodeType::VARIABLE_EXPRESSION:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// true when the initializer of a for loop only writes a leaf to a variable,
+// so nothing it does can be told apart from running after a hoisted
+// invariant, which never reads what the loop writes.
+bool isLeafInitializer(const StatementPtr& stmt) {
+  if (!stmt) {
+    return true;
+  }
+  switch (stmt->Type) {
+    case NodeType::VAR_DECLARATION: {
+      const auto& initializer = static_cast<VarDeclaration*>(stmt)->initializer;
+      return !initializer || isLeaf(initializer);
+    }
+    case NodeType::EXPRESSION_STATEMENT: {
+      const auto& expr = static_cast<ExpressionStatement*>(stmt)->expression;
+      return !expr || isLeaf(expr) ||
+             (expr->Type == NodeType::ASSIGNMENT_EXPRESSION &&
+              isLeaf(static_cast<Assignment*>(expr)->value));
+    }
+    default:
+      return false;
+  }
+}
+
+// the expression a function returns when its whole body is a small return
+// over its parameters, nullptr otherwise.
+ExpressionPtr inlineBody(const FunctionDeclarationPtr& stmt) {
+  if (stmt->body->Type != NodeType::BLOCK_STATEMENT) {
+    return nullptr;
+  }
+  const auto& statements = static_cast<Block*>(stmt->body)->statements;
+  if (statements.size() != 1 ||
+      statements[0]->Type != NodeType::RETURN_STATEMENT) {
+    return nullptr;
+  }
+  auto expr = static_cast<ReturnStatement*>(statements[0])
+                  ->expression;
+  if (!expr || !isEffectFree(expr)) {
+    return nullptr;
+  }
+  int size = 0;
+  bool onlyParams = true;
+  walk(expr, [&](const NodePtr& node) {
+    size++;
+    if (node->Type == NodeType::VARIABLE_EXPRESSION) {
+      const auto& identifier = static_cast<VariableExpr*>(node)->identifier;
+      onlyParams = onlyParams &&
+                   std::find(stmt->params.begin(), stmt->params.end(),
+                             identifier) != stmt->params.end();
+    }
+    return true;
+  });
+  if (!onlyParams || size > Optimizer::MAX_INLINE_SIZE) {
+    return nullptr;
+  }
+  return expr;
+}
+
+// a copy of the inlined expression expr with every parameter replaced by
+// its argument; arguments used more than once are literals or variables.
+ExpressionPtr substitute(
+    const ExpressionPtr& expr,
+    const std::unordered_map<Symbol, ExpressionPtr>& arguments) {
+  switch (expr->Type) {
+    case NodeType::VARIABLE_EXPRESSION: {
+      auto argument = arguments.at(
+          static_cast<VariableExpr*>(expr)->identifier);
+      if (argument->Type == NodeType::VARIABLE_EXPRESSION) {
+        // variables get their own node, the Resolver annotates each one.
+        auto variable = VariableExpr::make(
+            static_cast<VariableExpr*>(argument)->identifier);
+        variable->line = argument->line;
+        return variable;
+      }
+      return argument;
+    }
+    case NodeType::BINARY_EXPRESSION: {
+      auto binaryExpr = static_cast<BinaryExpr*>(expr);
+      auto copy = BinaryExpr::make(substitute(binaryExpr->left, arguments),
+                                   binaryExpr->operator_,
+                                   substitute(binaryExpr->right, arguments));
+      copy->line = expr->line;
+      return copy;
+    }
+    case NodeType::UNARY_EXPRESSION: {
+      auto unaryExpr = static_cast<UnaryExpr*>(expr);
+      auto copy = UnaryExpr::make(unaryExpr->operator_,
+                                  substitute(unaryExpr->right, arguments));
+      copy->line = expr->line;
+      return copy;
+    }
+    default:
+      // literals are immutable and can be shared.
+      return expr;
+  }
+}
+
+// appends the steps of the inlined expression expr that may raise, in the
+// order they run: the index of each parameter whose argument may raise as
+// it is read, or -1 for an operator. Both operands of every operator are
+// always evaluated, left first.
+void raisingSteps(const ExpressionPtr& expr,
+                  const std::unordered_map<Symbol, int>& raising,
+                  std::vector<int>& steps) {
+  switch (expr->Type) {
+    case NodeType::VARIABLE_EXPRESSION: {
+      const auto& identifier = static_cast<VariableExpr*>(expr)->identifier;
+      const auto it = raising.find(identifier);
+      if (it != raising.end()) {
+        steps.push_back(it->second);
+      }
+      break;
+    }
+    case NodeType::BINARY_EXPRESSION: {
+      auto binaryExpr = static_cast<BinaryExpr*>(expr);
+      raisingSteps(binaryExpr->left, raising, steps);
+      raisingSteps(binaryExpr->right, raising, steps);
+      steps.push_back(-1);
+      break;
+    }
+    case NodeType::UNARY_EXPRESSION:
+      raisingSteps(static_cast<UnaryExpr*>(expr)->right, raising,
+                   steps);
+      steps.push_back(-1);
+      break;
+    default:
+      break;
+  }
+}
+
+// the names a loop may assign or declare; false when it calls anything,
+// since a call may change any global or captured variable.
+bool loopWrites(const StatementPtr& loop,
+                std::unordered_set<Symbol>& written) {
+  bool calls = false;
+  walk(loop, [&](const NodePtr& node) {
+    switch (node->Type) {
+      case NodeType::ASSIGNMENT_EXPRESSION:
+        written.insert(static_cast<Assignment*>(node)->identifier);
+        break;
+      case NodeType::VAR_DECLARATION:
+        written.insert(static_cast<VarDeclaration*>(node)->identifier);
+        break;
+      case NodeType::FUNCTION_DECLARATION: {
+        auto funcDecl = static_cast<FunctionDeclaration*>(node);
+        written.insert(funcDecl->identifier);
+        written.insert(funcDecl->params.begin(), funcDecl->params.end());
+        break;
+      }
+      case NodeType::CLASS_DECLARATION:
+        written.insert(static_cast<ClassDeclaration*>(node)->identifier);
+        break;
+      case NodeType::CALL_EXPRESSION:
+        calls = true;
+        break;
+      default:
+        break;
+    }
+    return true;
+  });
+  return !calls;
+}
+
+template <typename T>
+ExpressionPtr at(T* node, int line) {
+  node->line = line;
+  return node;
+}
+
+Operand operandOf(const ExpressionPtr& expr) {
+  if (!expr) {
+    return Operand::EXPRESSION;
+  }
+  switch (expr->Type) {
+    case NodeType::VARIABLE_EXPRESSION:
+      return Operand::VARIABLE;
+    case NodeType::INTEGER_LITERAL:
+      return Operand::CONSTANT;
+    default:
+      return Operand::EXPRESSION;
+  }
+}
+
+// x = x + c, x = c + x and x = x - c as an increment of x by step.
+bool incrementOf(const AssignmentPtr& assignment, int64_t& step) {
+  const auto& value = assignment->value;
+  if (value->Type != NodeType::BINARY_EXPRESSION) {
+    return false;
+  }
+  auto binaryExpr = static_cast<BinaryExpr*>(value);
+  auto isTarget = [&](const ExpressionPtr& expr) {
+    return expr->Type == NodeType::VARIABLE_EXPRESSION &&
+           static_cast<VariableExpr*>(expr)->identifier ==
+               assignment->identifier;
+  };
+  auto constant = [](const ExpressionPtr& expr) {
+    return static_cast<IntegerLiteral*>(expr)->Value;
+  };
+  const auto& left = binaryExpr->left;
+  const auto& right = binaryExpr->right;
+  switch (binaryExpr->operator_.type) {
+    case TokenType::TOKEN_PLUS:
+      if (isTarget(left) && operandOf(right) == Operand::CONSTANT) {
+        step = constant(right);
+        return true;
+      }
+      if (isTarget(right) && operandOf(left) == Operand::CONSTANT) {
+        step = constant(left);
+        return true;
+      }
+      return false;
+    case TokenType::TOKEN_MINUS:
+      if (isTarget(left) && operandOf(right) == Operand::CONSTANT &&
+          constant(right) != INT64_MIN) {
+        step = -constant(right);
+        return true;
+      }
+      return false;
+    default:
+      return false;
+  }
+}
+
+// marks the superinstruction forms the Evaluator runs in one step: the
+// same name always resolves to the same variable at one point, so these
+// hold whatever the Resolver later decides.
+void fuse(const NodePtr& root) {
+  walk(root, [](const NodePtr& node) {
+    switch (node->Type) {
+      case NodeType::BINARY_EXPRESSION: {
+        auto binaryExpr = static_cast<BinaryExpr*>(node);
+        binaryExpr->leftOperand = operandOf(binaryExpr->left);
+        binaryExpr->rightOperand = operandOf(binaryExpr->right);
+        break;
+      }
+      case NodeType::ASSIGNMENT_EXPRESSION: {
+        auto assignment = static_cast<Assignment*>(node);
+        assignment->increment = incrementOf(assignment, assignment->step);
+        break;
+      }
+      case NodeType::ARRAY_SUBSCRIPT_EXPRESSION: {
+        auto subscript = static_cast<ArraySubscriptExpr*>(node);
+        subscript->arrayOperand = operandOf(subscript->array);
+        subscript->indexOperand = operandOf(subscript->index);
+        break;
+      }
+      case NodeType::RETURN_STATEMENT: {
+        auto returnStmt = static_cast<ReturnStatement*>(node);
+        returnStmt->operand = operandOf(returnStmt->expression);
+        break;
+      }
+      default:
+        break;
+    }
+    return true;
+  });
+}
+
+}  // namespace
+
+void Optimizer::optimize(const ProgramPtr& program) {
+  if (level <= 0) {
+    return;
+  }
+  // the nodes made while optimizing belong to the program too.
+  Arena::Scope scope(program->getArena());
+  if (inlining) {
+    findRebound(program);
+  }
+  optimizeStatements(program->statements);
+  for (const auto& stmt : program->statements) {
+    fuse(stmt);
+  }
+}
+
+void Optimizer::findRebound(const ProgramPtr& program) {
+  std::unordered_map<Symbol, int> declarations;
+  for (const auto& stmt : program->statements) {
+    if (stmt->Type == NodeType::VAR_DECLARATION) {
+      declarations[static_cast<VarDeclaration*>(stmt)
+                       ->identifier]++;
+    } else if (stmt->Type == NodeType::FUNCTION_DECLARATION) {
+      declarations[static_cast<FunctionDeclaration*>(stmt)
+                       ->identifier]++;
+    }
+  }
+  for (const auto& stmt : program->statements) {
+    walk(stmt, [&](const NodePtr& node) {
+      if (node->Type == NodeType::ASSIGNMENT_EXPRESSION) {
+        // assignments may hit a local, being conservative is enough.
+        rebound.insert(static_cast<Assignment*>(node)->identifier);
+      } else if (node->Type == NodeType::CLASS_DECLARATION) {
+        // classes are global wherever they are declared.
+        declarations[static_cast<ClassDeclaration*>(node)
+                         ->identifier]++;
+      }
+      return true;
+    });
+  }
+  for (const auto& pair : declarations) {
+    if (pair.second > 1) {
+      rebound.insert(pair.first);
+    }
+  }
+}
+
+bool Optimizer::isShadowed(Symbol identifier) const {
+  for (const auto& scope : scopes) {
+    if (scope.count(identifier) > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void Optimizer::declare(Symbol identifier) {
+  if (!scopes.empty()) {
+    scopes.back().insert(identifier);
+  }
+}
+
+ExpressionPtr Optimizer::inlineCall(const CallExprPtr& expr) {
+  if (expr->left->Type != NodeType::VARIABLE_EXPRESSION) {
+    return expr;
+  }
+  const auto& identifier = static_cast<VariableExpr*>(expr->left)->identifier;
+  const auto candidate = inlineCandidates.find(identifier);
+  if (candidate == inlineCandidates.end() || isShadowed(identifier)) {
+    return expr;
+  }
+  const auto& callee = candidate->second;
+  if (callee->params.size() != expr->arguments.size()) {
+    return expr;
+  }
+  auto body = inlineBody(callee);
+  std::unordered_map<Symbol, int> uses;
+  walk(body, [&](const NodePtr& node) {
+    if (node->Type == NodeType::VARIABLE_EXPRESSION) {
+      uses[static_cast<VariableExpr*>(node)->identifier]++;
+    }
+    return true;
+  });
+  // every argument is still evaluated exactly once, except for leaves.
+  std::unordered_map<Symbol, ExpressionPtr> arguments;
+  std::unordered_map<Symbol, int> raising;
+  for (size_t i = 0; i < expr->arguments.size(); i++) {
+    const auto& argument = expr->arguments[i];
+    const auto count = uses[callee->params[i]];
+    if (!isEffectFree(argument) || (count != 1 && !isLeaf(argument))) {
+      return expr;
+    }
+    arguments[callee->params[i]] = argument;
+    if (!isLeaf(argument)) {
+      raising[callee->params[i]] = static_cast<int>(i);
+    }
+  }
+  // the call evaluates its arguments left to right before the body, so the
+  // arguments that may raise have to run first and in order for an error to
+  // be the one the call would raise.
+  std::vector<int> steps;
+  raisingSteps(body, raising, steps);
+  size_t next = 0;
+  for (size_t i = 0; i < expr->arguments.size(); i++) {
+    if (raising.count(callee->params[i]) == 0) {
+      continue;
+    }
+    if (next == steps.size() || steps[next++] != static_cast<int>(i)) {
+      return expr;
+    }
+  }
+  return optimizeExpression(substitute(body, arguments));
+}
+
+void Optimizer::optimizeStatements(std::vector<StatementPtr>& statements) {
+  std::vector<StatementPtr> live;
+  live.reserve(statements.size());
+  for (size_t i = 0; i < statements.size(); i++) {
+    auto stmt = optimizeStatement(statements[i]);
+    // the last statement is kept for its value.
+    if (i + 1 < statements.size() && hasNoEffect(stmt)) {
+      continue;
+    }
+    live.push_back(stmt);
+    if (terminates(stmt)) {
+      break;
+    }
+  }
+  statements = std::move(live);
+}
+
+StatementPtr Optimizer::optimizeStatement(const StatementPtr& stmt) {
+  switch (stmt->Type) {
+    case NodeType::EXPRESSION_STATEMENT: {
+      auto exprStmt = static_cast<ExpressionStatement*>(stmt);
+      exprStmt->expression = optimizeExpression(exprStmt->expression);
+      break;
+    }
+    case NodeType::VAR_DECLARATION: {
+      auto varDecl = static_cast<VarDeclaration*>(stmt);
+      if (varDecl->initializer) {
+        varDecl->initializer = optimizeExpression(varDecl->initializer);
+      }
+      declare(varDecl->identifier);
+      break;
+    }
+    case NodeType::FUNCTION_DECLARATION: {
+      auto funcDecl = static_cast<FunctionDeclaration*>(stmt);
+      declare(funcDecl->identifier);
+      optimizeFunction(funcDecl);
+      if (inlining && scopes.empty() &&
+          rebound.count(funcDecl->identifier) == 0 && inlineBody(funcDecl)) {
+        inlineCandidates[funcDecl->identifier] = funcDecl;
+      }
+      break;
+    }
+    case NodeType::CLASS_DECLARATION: {
+      auto classDecl = static_cast<ClassDeclaration*>(stmt);
+      // members shadow globals in initializers and methods.
+      scopes.push_back({"self"});
+      for (const auto& field : classDecl->fields) {
+        declare(field->identifier);
+      }
+      for (const auto& method : classDecl->methods) {
+        declare(method->identifier);
+      }
+      for (const auto& field : classDecl->fields) {
+        optimizeStatement(field);
+      }
+      if (classDecl->ctor) {
+        optimizeFunction(classDecl->ctor);
+      }
+      for (const auto& method : classDecl->methods) {
+        optimizeFunction(method);
+      }
+      scopes.pop_back();
+      break;
+    }
+    case NodeType::BLOCK_STATEMENT:
+      scopes.emplace_back();
+      optimizeStatements(static_cast<Block*>(stmt)->statements);
+      scopes.pop_back();
+      break;
+    case NodeType::IF_STATEMENT: {
+      auto ifStmt = static_cast<IfStatement*>(stmt);
+      ifStmt->condition = optimizeExpression(ifStmt->condition);
+      ifStmt->thenBranch = optimizeStatement(ifStmt->thenBranch);
+      if (ifStmt->elseBranch) {
+        ifStmt->elseBranch = optimizeStatement(ifStmt->elseBranch);
+      }
+      // a constant condition leaves only the branch taken, which is a block
+      // and so keeps its own scope.
+      Value condition;
+      if (constantOf(ifStmt->condition, condition)) {
+        if (condition.isTruthy()) {
+          return ifStmt->thenBranch;
+        } else if (ifStmt->elseBranch) {
+          return ifStmt->elseBranch;
+        }
+      }
+      break;
+    }
+    case NodeType::FOR_STATEMENT: {
+      auto forStmt = static_cast<ForStatement*>(stmt);
+      scopes.emplace_back();
+      if (forStmt->initializer) {
+        forStmt->initializer = optimizeStatement(forStmt->initializer);
+      }
+      forStmt->condition = optimizeExpression(forStmt->condition);
+      forStmt->increment = optimizeExpression(forStmt->increment);
+      forStmt->body = optimizeStatement(forStmt->body);
+      scopes.pop_back();
+      return hoistInvariants(forStmt, forStmt->condition);
+    }
+    case NodeType::WHILE_STATEMENT: {
+      auto whileStmt = static_cast<WhileStatement*>(stmt);
+      whileStmt->condition = optimizeExpression(whileStmt->condition);
+      whileStmt->body = optimizeStatement(whileStmt->body);
+      return hoistInvariants(whileStmt, whileStmt->condition);
+    }
+    case NodeType::PRINT_STATEMENT: {
+      auto printStmt = static_cast<PrintStatement*>(stmt);
+      printStmt->expression = optimizeExpression(printStmt->expression);
+      break;
+    }
+    case NodeType::RETURN_STATEMENT: {
+      auto returnStmt = static_cast<ReturnStatement*>(stmt);
+      if (returnStmt->expression) {
+        returnStmt->expression = optimizeExpression(returnStmt->expression);
+      }
+      break;
+    }
+    default:
+      break;
+  }
+  return stmt;
+}
+
+void Optimizer::optimizeFunction(const FunctionDeclarationPtr& stmt) {
+  scopes.emplace_back(stmt->params.begin(), stmt->params.end());
+  stmt->body = optimizeStatement(stmt->body);
+  scopes.pop_back();
+}
+
+StatementPtr Optimizer::hoistInvariants(const StatementPtr& loop,
+                                        ExpressionPtr& condition) {
+  // the condition runs before anything else in the loop, so computing its
+  // invariant parts up front only changes which error a failing one
+  // raises. The body may not run, or not reach an expression, so nothing
+  // in it is hoisted. The temporaries are computed before the initializer
+  // of a for loop too: the names it writes are among the loop's, which no
+  // invariant reads, and it has to be unable to raise.
+  std::unordered_set<Symbol> written;
+  if (!loopWrites(loop, written) || !isEffectFree(condition)) {
+    return loop;
+  }
+  if (loop->Type == NodeType::FOR_STATEMENT &&
+      !isLeafInitializer(static_cast<ForStatement*>(loop)->initializer)) {
+    return loop;
+  }
+  std::vector<StatementPtr> hoisted;
+  condition = hoistExpression(condition, written, hoisted);
+  if (hoisted.empty()) {
+    return loop;
+  }
+  // the temporaries live in a block of their own around the loop.
+  hoisted.push_back(loop);
+  auto block = Block::make(hoisted);
+  block->line = loop->line;
+  return block;
+}
+
+ExpressionPtr Optimizer::hoistExpression(
+    const ExpressionPtr& expr, const std::unordered_set<Symbol>& written,
+    std::vector<StatementPtr>& hoisted) {
+  if (expr->Type != NodeType::BINARY_EXPRESSION &&
+      expr->Type != NodeType::UNARY_EXPRESSION) {
+    return expr;
+  }
+  bool invariant = true;
+  walk(expr, [&](const NodePtr& node) {
+    if (node->Type == NodeType::VARIABLE_EXPRESSION &&
+        written.count(static_cast<VariableExpr*>(node)->identifier) > 0) {
+      invariant = false;
+    }
+    return invariant;
+  });
+  if (invariant) {
+    // not a valid Lox identifier, so it cannot clash with the program's.
+    const Symbol identifier("$invariant" + std::to_string(temporaries++));
+    auto declaration = VarDeclaration::make(identifier, expr);
+    declaration->line = expr->line;
+    hoisted.push_back(declaration);
+    auto variable = VariableExpr::make(identifier);
+    variable->line = expr->line;
+    return variable;
+  }
+  if (expr->Type == NodeType::BINARY_EXPRESSION) {
+    auto binaryExpr = static_cast<BinaryExpr*>(expr);
+    binaryExpr->left = hoistExpression(binaryExpr->left, written, hoisted);
+    binaryExpr->right = hoistExpression(binaryExpr->right, written, hoisted);
+  } else {
+    auto unaryExpr = static_cast<UnaryExpr*>(expr);
+    unaryExpr->right = hoistExpression(unaryExpr->right, written, hoisted);
+  }
+  return expr;
+}
+
+ExpressionPtr Optimizer::optimizeExpression(const ExpressionPtr& expr) {
+  switch (expr->Type) {
+    case NodeType::BINARY_EXPRESSION: {
+      auto binaryExpr = static_cast<BinaryExpr*>(expr);
+      binaryExpr->left = optimizeExpression(binaryExpr->left);
+      binaryExpr->right = optimizeExpression(binaryExpr->right);
+      return foldBinaryExpression(binaryExpr);
+    }
+    case NodeType::UNARY_EXPRESSION: {
+      auto unaryExpr = static_cast<UnaryExpr*>(expr);
+      unaryExpr->right = optimizeExpression(unaryExpr->right);
+      return foldUnaryExpression(unaryExpr);
+    }
+    case NodeType::ASSIGNMENT_EXPRESSION: {
+      auto assignment = static_cast<Assignment*>(expr);
+      assignment->value = optimizeExpression(assignment->value);
+      return expr;
+    }
+    case NodeType::CALL_EXPRESSION: {
+      auto callExpr = static_cast<CallExpr*>(expr);
+      callExpr->left = optimizeExpression(callExpr->left);
+      for (auto& argument : callExpr->arguments) {
+        argument = optimizeExpression(argument);
+      }
+      return inlineCall(callExpr);
+    }
+    case NodeType::ARRAY_LITERAL: {
+      for (auto& element :
+           static_cast<ArrayLiteral*>(expr)->elements) {
+        element = optimizeExpression(element);
+      }
+      return expr;
+    }
+    case NodeType::ARRAY_SUBSCRIPT_EXPRESSION: {
+      auto subscript = static_cast<ArraySubscriptExpr*>(expr);
+      subscript->array = optimizeExpression(subscript->array);
+      subscript->index = optimizeExpression(subscript->index);
+      return expr;
+    }
+    default:
+      return expr;
+  }
+}
+
+ExpressionPtr Optimizer::foldBinaryExpression(const BinaryExprPtr& expr) {
+  const auto operator_ = expr->operator_.type;
+  Value lhs, rhs;
+  if (constantOf(expr->left, lhs) && constantOf(expr->right, rhs)) {
+    if (isArithmetic(operator_) && lhs.isInteger() && rhs.isInteger()) {
+      // wrap around like the evaluator's int64_t arithmetic does.
+      const auto a = static_cast<uint64_t>(lhs.asInteger());
+      const auto b = static_cast<uint64_t>(rhs.asInteger());
+      int64_t result;
+      switch (operator_) {
+        case TokenType::TOKEN_PLUS:
+          result = static_cast<int64_t>(a + b);
+          break;
+        case TokenType::TOKEN_MINUS:
+          result = static_cast<int64_t>(a - b);
+          break;
+        case TokenType::TOKEN_STAR:
+          result = static_cast<int64_t>(a * b);
+          break;
+        default:
+          // division by zero stays a runtime error.
+          if (rhs.asInteger() == 0 ||
+              (rhs.asInteger() == -1 && lhs.asInteger() == INT64_MIN)) {
+            return expr;
+          }
+          result = lhs.asInteger() / rhs.asInteger();
+          break;
+      }
+      return at(IntegerLiteral::make(result), expr->line);
+    }
+    switch (operator_) {
+      case TokenType::TOKEN_EQUAL_EQUAL:
+        return at(BooleanLiteral::make(lhs.isEqual(rhs)), expr->line);
+      case TokenType::TOKEN_BANG_EQUAL:
+        return at(BooleanLiteral::make(!lhs.isEqual(rhs)), expr->line);
+      case TokenType::TOKEN_AND:
+        return at(BooleanLiteral::make(lhs.isTruthy() && rhs.isTruthy()),
+                  expr->line);
+      case TokenType::TOKEN_OR:
+        return at(BooleanLiteral::make(lhs.isTruthy() || rhs.isTruthy()),
+                  expr->line);
+      default:
+        break;
+    }
+    if (lhs.isInteger() && rhs.isInteger()) {
+      const auto a = lhs.asInteger();
+      const auto b = rhs.asInteger();
+      switch (operator_) {
+        case TokenType::TOKEN_LESS:
+          return at(BooleanLiteral::make(a < b), expr->line);
+        case TokenType::TOKEN_LESS_EQUAL:
+          return at(BooleanLiteral::make(a <= b), expr->line);
+        case TokenType::TOKEN_GREATER:
+          return at(BooleanLiteral::make(a > b), expr->line);
+        case TokenType::TOKEN_GREATER_EQUAL:
+          return at(BooleanLiteral::make(a >= b), expr->line);
+        default:
+          break;
+      }
+    }
+    return expr;
+  }
+
+  // identities only apply to operands that are integers or raise anyway;
+  // x * 1 with a string x must still fail.
+  switch (operator_) {
+    case TokenType::TOKEN_PLUS:
+      if (isIntegerLiteral(expr->right, 0) && isIntegerTyped(expr->left)) {
+        return expr->left;
+      }
+      if (isIntegerLiteral(expr->left, 0) && isIntegerTyped(expr->right)) {
+        return expr->right;
+      }
+      break;
+    case TokenType::TOKEN_MINUS:
+      if (isIntegerLiteral(expr->right, 0) && isIntegerTyped(expr->left)) {
+        return expr->left;
+      }
+      break;
+    case TokenType::TOKEN_STAR:
+      if (isIntegerLiteral(expr->right, 1) && isIntegerTyped(expr->left)) {
+        return expr->left;
+      }
+      if (isIntegerLiteral(expr->left, 1) && isIntegerTyped(expr->right)) {
+        return expr->right;
+      }
+      break;
+    case TokenType::TOKEN_SLASH:
+      if (isIntegerLiteral(expr->right, 1) && isIntegerTyped(expr->left)) {
+        return expr->left;
+      }
+      break;
+    default:
+      break;
+  }
+  return expr;
+}
+
+ExpressionPtr Optimizer::foldUnaryExpression(const UnaryExprPtr& expr) {
+  Value rhs;
+  if (constantOf(expr->right, rhs)) {
+    if (expr->operator_.type == TokenType::TOKEN_BANG) {
+      return at(BooleanLiteral::make(!rhs.isTruthy()), expr->line);
+    }
+    if (expr->operator_.type == TokenType::TOKEN_MINUS && rhs.isInteger()) {
+      const auto value = static_cast<uint64_t>(rhs.asInteger());
+      return at(IntegerLiteral::make(static_cast<int64_t>(0 - value)),
+                expr->line);
+    }
+    return expr;
+  }
+  // -(-x) is x for anything that is an integer or raises.
+  if (expr->operator_.type == TokenType::TOKEN_MINUS &&
+      expr->right->Type == NodeType::UNARY_EXPRESSION) {
+    auto inner = static_cast<UnaryExpr*>(expr->right);
+    if (inner->operator_.type == TokenType::TOKEN_MINUS &&
+        isIntegerTyped(inner->right)) {
+      return inner->right;
+    }
+  }
+  return expr;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "ast.h"
+#include "common.h"
+
+// AST-to-AST optimizations run between parsing and execution, so every
+// engine benefits from them. Level 0 leaves the program untouched; level 1
+// folds constant expressions, simplifies arithmetic identities, prunes
+// dead code, hoists loop-invariant conditions, unless disabled inlines
+// small global functions and finally marks the operand patterns the
+// Evaluator runs as superinstructions.
+class Optimizer {
+ public:
+  // largest return expression, in nodes, of a function that gets inlined.
+  static constexpr int MAX_INLINE_SIZE = 16;
+
+  Optimizer(int level, bool inlining = true)
+      : level(level), inlining(inlining) {}
+
+  void optimize(const ProgramPtr& program);
+
+ private:
+  int level;
+  bool inlining;
+  // global functions that can be inlined once their declaration is passed,
+  // by name.
+  std::unordered_map<Symbol, FunctionDeclarationPtr> inlineCandidates;
+  // globals that are assigned or declared more than once.
+  std::unordered_set<Symbol> rebound;
+  // names declared in the local scopes enclosing the current node, which
+  // shadow the globals.
+  std::vector<std::unordered_set<Symbol>> scopes;
+  // temporaries created for hoisted expressions.
+  int temporaries = 0;
+
+  void findRebound(const ProgramPtr& program);
+  bool isShadowed(Symbol identifier) const;
+  void declare(Symbol identifier);
+  ExpressionPtr inlineCall(const CallExprPtr& expr);
+  StatementPtr hoistInvariants(const StatementPtr& loop,
+                               ExpressionPtr& condition);
+  ExpressionPtr hoistExpression(const ExpressionPtr& expr,
+                                const std::unordered_set<Symbol>& written,
+                                std::vector<StatementPtr>& hoisted);
+
+  StatementPtr optimizeStatement(const StatementPtr& stmt);
+  void optimizeStatements(std::vector<StatementPtr>& statements);
+  void optimizeFunction(const FunctionDeclarationPtr& stmt);
+  ExpressionPtr optimizeExpression(const ExpressionPtr& expr);
+  ExpressionPtr foldBinaryExpression(const BinaryExprPtr& expr);
+  ExpressionPtr foldUnaryExpression(const UnaryExprPtr& expr);
+};
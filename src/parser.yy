@@ -29,9 +29,11 @@ using namespace std;
     class ASTBuilder {
     public:
         virtual ~ASTBuilder() = default;
+
+        virtual void setLine(int line) = 0;
         
         virtual ProgramPtr emitProgram(const std::vector<StatementPtr> &statements) = 0;
-        virtual VarDeclarationPtr emitVarDeclaration(VariableExprPtr identifier, ExpressionPtr initializer = nullptr) = 0;
+        virtual VarDeclarationPtr emitVarDeclaration(const Token& identifier, ExpressionPtr initializer = nullptr) = 0;
         virtual MemberExprPtr emitMemberExpression(VariableExprPtr object, const Token &member) = 0;
         virtual ClassDeclarationPtr emitClassDeclaration(const Token& name, const std::vector<StatementPtr> &definitions = {}) = 0;
         virtual ExpressionStatementPtr emitExpressionStatement(ExpressionPtr expr) = 0;
@@ -50,7 +52,7 @@ using namespace std;
         virtual IfStatementPtr emitIfStatement(ExpressionPtr condition, BlockPtr thenBody, BlockPtr elseBody = nullptr) = 0;
         virtual WhileStatementPtr emitWhileStatement(ExpressionPtr condition, BlockPtr body) = 0;
         virtual ForStatementPtr emitForStatement(StatementPtr initialization, ExpressionStatementPtr condition, ExpressionStatementPtr increment, BlockPtr body) = 0;
-        virtual FunctionDeclarationPtr emitDefStatement(VariableExprPtr name, const std::vector<VariableExprPtr>& arguments, BlockPtr body) = 0;
+        virtual FunctionDeclarationPtr emitDefStatement(const Token& name, const std::vector<Token>& arguments, BlockPtr body) = 0;
         virtual PrintStatementPtr emitPrintStatement(ExpressionPtr expr) = 0;
         virtual ReturnStatementPtr emitReturnStatement(ExpressionPtr expr = nullptr) = 0;
         virtual BreakStatementPtr emitBreakStatement() = 0;
@@ -127,7 +129,7 @@ using namespace std;
 %type<ExpressionStatementPtr> for_increment
 %type<ExpressionStatementPtr> expr_statement
 %type<FunctionDeclarationPtr> def_statement
-%type<std::vector<VariableExprPtr>> function_parameters
+%type<std::vector<Token>> function_parameters
 %type<PrintStatementPtr> print_statement
 %type<ReturnStatementPtr> return_statement
 %type<BreakStatementPtr> break_statement
@@ -154,7 +156,7 @@ program
 statements
     : /* empty */ { $$ = std::vector<StatementPtr>(); }
     | statements statement
-      { $1.push_back($2); $$ = $1; }
+      { $1.push_back($2); $$ = std::move($1); }
     ;
 
 statement
@@ -212,16 +214,16 @@ for_increment
     | /* empty */ { $$ = builder.emitExpressionStatement(builder.emitNilLiteral()); }
 
 def_statement
-    : DEF varExpr LPAREN function_parameters RPAREN suite
+    : DEF IDENTIFIER LPAREN function_parameters RPAREN suite
       { $$ = builder.emitDefStatement($2, $4, $6); }
     ;
 
 function_parameters
-    : /* empty */ { $$ = std::vector<VariableExprPtr>(); }
-    | function_parameters varExpr COMMA
-      { $1.push_back($2); $$ = $1; }
-    | function_parameters varExpr
-      { $1.push_back($2); $$ = $1; }
+    : /* empty */ { $$ = std::vector<Token>(); }
+    | function_parameters IDENTIFIER COMMA
+      { $1.push_back($2); $$ = std::move($1); }
+    | function_parameters IDENTIFIER
+      { $1.push_back($2); $$ = std::move($1); }
 
 print_statement
     : PRINT LPAREN expr RPAREN SEMICOLON
@@ -250,14 +252,14 @@ class_declaration
 class_body
     : /* empty */ { $$ = std::vector<StatementPtr>(); }
     | class_body def_statement
-      { $1.push_back($2); $$ = $1; }
+      { $1.push_back($2); $$ = std::move($1); }
     | class_body var_declaration
-      { $1.push_back($2); $$ = $1; }
+      { $1.push_back($2); $$ = std::move($1); }
     ;
 
 var_declaration
-    : VAR varExpr EQUAL expr SEMICOLON { $$ = builder.emitVarDeclaration($2, $4); }
-    | VAR varExpr SEMICOLON { $$ = builder.emitVarDeclaration($2); }
+    : VAR IDENTIFIER EQUAL expr SEMICOLON { $$ = builder.emitVarDeclaration($2, $4); }
+    | VAR IDENTIFIER SEMICOLON { $$ = builder.emitVarDeclaration($2); }
 
 varExpr
     : IDENTIFIER { $$ = builder.emitVarExpression($1); }
@@ -276,9 +278,9 @@ call_expr
 call_arguments
     : /* empty */ { $$ = std::vector<ExpressionPtr>(); }
     | call_arguments expr COMMA
-      { $1.push_back($2); $$ = $1; }
+      { $1.push_back($2); $$ = std::move($1); }
     | call_arguments expr
-      { $1.push_back($2); $$ = $1; }
+      { $1.push_back($2); $$ = std::move($1); }
 
 array_literal
     : LBRACKET array_elements RBRACKET { $$ = builder.emitArrayLiteral($2); }
@@ -286,9 +288,9 @@ array_literal
 array_elements
     : /* empty */ { $$ = std::vector<ExpressionPtr>(); }
     | array_elements expr COMMA
-      { $1.push_back($2); $$ = $1; }
+      { $1.push_back($2); $$ = std::move($1); }
     | array_elements expr
-      { $1.push_back($2); $$ = $1; }
+      { $1.push_back($2); $$ = std::move($1); }
 
 array_subscript
     : expr LBRACKET expr RBRACKET { $$ = builder.emitArraySubscript($1, $3); }
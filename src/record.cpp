@@ -1,17 +1,27 @@
 #include "record.h"
 
-Record::Record(EnvironmentPtr ctx, ClassDeclarationPtr classDecl)
-    : Object(ObjectType::OBJ_RECORD),
-      ctx{ctx},
-      classDecl{classDecl},
-      fields{},
-      methods{} {}
+Record::Record(ClassObjectPtr klass, Slots slots)
+    : Environment(ObjectType::OBJ_RECORD, klass->enclosingCtx,
+                  klass->declaration->shape->size(), slots),
+      klass(std::move(klass)) {}
 
-bool Record::isFalsey() const { return fields.empty() && methods.empty(); }
+bool Record::isFalsey() const { return getShape()->empty(); }
 
-bool Record::isTruthy() const { return !fields.empty() || !methods.empty(); }
+bool Record::isTruthy() const { return !getShape()->empty(); }
 
-std::shared_ptr<Record> Record::make(EnvironmentPtr ctx,
-                                     ClassDeclarationPtr classDecl) {
-  return std::make_shared<Record>(ctx, classDecl);
-}
\ No newline at end of file
+Value Record::getField(Symbol name) const {
+  const auto slot = getShape()->findField(name);
+  return slot >= 0 ? get(slot) : Value::nil();
+}
+
+void Record::setField(Symbol name, Value value) {
+  const auto slot = getShape()->findField(name);
+  if (slot >= 0) {
+    set(slot, std::move(value));
+  }
+}
+
+Ref<Record> Record::make(ClassObjectPtr klass) {
+  const auto size = klass->declaration->shape->size();
+  return allocate<Record>(size, false, std::move(klass));
+}
@@ -1,21 +1,21 @@
 #pragma once
 
+#include "class_object.h"
 #include "common.h"
 #include "environment.h"
-#include "function.h"
 #include "object.h"
+#include "shape.h"
 
-class Record : public Object {
+// A record is the scope of its own members: self and the fields sit in its
+// slots, laid out by the shape of its class and enclosed by the scope the
+// class was declared in. Methods stay in the table of the class, shared by
+// every record.
+class Record : public Environment {
  public:
-  EnvironmentPtr ctx;
-  ClassDeclarationPtr classDecl;
-  std::unordered_map<std::string, ObjectPtr> fields;
-  std::unordered_map<std::string, FunctionPtr> methods;
-
-  Record(EnvironmentPtr ctx, ClassDeclarationPtr classDecl);
+  Record(ClassObjectPtr klass, Slots slots);
 
   std::string toString() const override {
-    return "<record " + classDecl->identifier + ">";
+    return "<record " + getDeclaration()->identifier.str() + ">";
   }
   bool isFalsey() const override;
   bool isTruthy() const override;
@@ -24,23 +24,30 @@ class Record : public Object {
     if (obj.Type != ObjectType::OBJ_RECORD) {
       return false;
     }
-    auto other = dynamic_cast<const Record&>(obj);
-    assert(other.classDecl != nullptr);
-    return classDecl->isEqual(*other.classDecl);
+    const auto& other = static_cast<const Record&>(obj);
+    return getDeclaration()->isEqual(*other.getDeclaration());
   }
 
-  void setField(const std::string& name, ObjectPtr value) {
-    fields[name] = value;
-    ctx->declare(name, value);
+  const ClassObjectPtr& getClass() const { return klass; }
+  const ClassDeclarationPtr& getDeclaration() const {
+    return klass->declaration;
   }
+  const Shape* getShape() const { return getDeclaration()->shape.get(); }
+
+  // unknown fields read as nil and are not added.
+  Value getField(Symbol name) const;
+  void setField(Symbol name, Value value);
 
-  void setMethod(const std::string& name, FunctionPtr value) {
-    methods[name] = value;
-    ctx->declare(name, value);
+  // the unbound method at index in the table of the class, see
+  // Shape::findMethod.
+  const FunctionPtr& getMethod(int index) const {
+    return klass->methods[index];
   }
 
-  static std::shared_ptr<Record> make(EnvironmentPtr ctx,
-                                      ClassDeclarationPtr classDecl);
+  static Ref<Record> make(ClassObjectPtr klass);
+
+ private:
+  ClassObjectPtr klass;
 };
 
-using RecordPtr = std::shared_ptr<Record>;
\ No newline at end of file
+using RecordPtr = Ref<Record>;
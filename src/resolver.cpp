@@ -0,0 +1,253 @@
+#include "resolver.h"
+
+#include "shape.h"
+
+void Resolver::resolve(const ProgramPtr& program) {
+  for (const auto& stmt : program->statements) {
+    resolveStatement(stmt);
+  }
+}
+
+int Resolver::findGlobal(Symbol identifier) const {
+  const auto it = globals.find(identifier);
+  return it != globals.end() ? it->second : -1;
+}
+
+size_t Resolver::endScope() {
+  const auto size = scopes.back().size;
+  scopes.pop_back();
+  return size;
+}
+
+void Resolver::captureScopes() {
+  for (auto& scope : scopes) {
+    scope.captured = true;
+  }
+}
+
+LexicalAddress Resolver::declare(Symbol identifier) {
+  if (scopes.empty()) {
+    return declareGlobal(identifier);
+  }
+  // redeclaring a name in the same scope reuses its slot.
+  auto& scope = scopes.back();
+  const auto it = scope.slots.find(identifier);
+  if (it != scope.slots.end()) {
+    return LexicalAddress{0, it->second};
+  }
+  const auto slot = static_cast<int>(scope.size++);
+  scope.slots[identifier] = slot;
+  return LexicalAddress{0, slot};
+}
+
+LexicalAddress Resolver::declareGlobal(Symbol identifier) {
+  auto it = globals.find(identifier);
+  if (it == globals.end()) {
+    const auto slot = static_cast<int>(globals.size());
+    it = globals.emplace(identifier, slot).first;
+  }
+  return LexicalAddress{LexicalAddress::GLOBAL_DEPTH, it->second};
+}
+
+LexicalAddress Resolver::lookup(Symbol identifier, int* method) {
+  for (size_t depth = 0; depth < scopes.size(); depth++) {
+    const auto& scope = scopes[scopes.size() - 1 - depth];
+    if (method != nullptr) {
+      const auto it = scope.methods.find(identifier);
+      if (it != scope.methods.end()) {
+        *method = it->second;
+        return LexicalAddress{static_cast<int>(depth), SELF_SLOT};
+      }
+    }
+    const auto it = scope.slots.find(identifier);
+    if (it != scope.slots.end()) {
+      return LexicalAddress{static_cast<int>(depth), it->second};
+    }
+  }
+  // unknown names are globals that may be defined later.
+  return declareGlobal(identifier);
+}
+
+void Resolver::resolveStatement(const StatementPtr& stmt) {
+  switch (stmt->Type) {
+    case NodeType::EXPRESSION_STATEMENT: {
+      auto exprStmt = static_cast<ExpressionStatement*>(stmt);
+      resolveExpression(exprStmt->expression);
+      break;
+    }
+    case NodeType::VAR_DECLARATION: {
+      auto varDecl = static_cast<VarDeclaration*>(stmt);
+      if (varDecl->initializer) {
+        resolveExpression(varDecl->initializer);
+      }
+      varDecl->address = declare(varDecl->identifier);
+      break;
+    }
+    case NodeType::FUNCTION_DECLARATION: {
+      auto funcDecl = static_cast<FunctionDeclaration*>(stmt);
+      // declared first so the body can call itself.
+      funcDecl->address = declare(funcDecl->identifier);
+      captureScopes();
+      resolveFunction(funcDecl);
+      break;
+    }
+    case NodeType::CLASS_DECLARATION:
+      captureScopes();
+      resolveClass(static_cast<ClassDeclaration*>(stmt));
+      break;
+    case NodeType::BLOCK_STATEMENT: {
+      auto block = static_cast<Block*>(stmt);
+      beginScope();
+      for (const auto& blockStmt : block->statements) {
+        resolveStatement(blockStmt);
+      }
+      block->captured = scopes.back().captured;
+      block->scopeSize = endScope();
+      break;
+    }
+    case NodeType::IF_STATEMENT: {
+      auto ifStmt = static_cast<IfStatement*>(stmt);
+      resolveExpression(ifStmt->condition);
+      resolveStatement(ifStmt->thenBranch);
+      if (ifStmt->elseBranch) {
+        resolveStatement(ifStmt->elseBranch);
+      }
+      break;
+    }
+    case NodeType::FOR_STATEMENT: {
+      auto forStmt = static_cast<ForStatement*>(stmt);
+      beginScope();
+      resolveStatement(forStmt->initializer);
+      resolveExpression(forStmt->condition);
+      resolveStatement(forStmt->body);
+      resolveExpression(forStmt->increment);
+      forStmt->captured = scopes.back().captured;
+      forStmt->scopeSize = endScope();
+      break;
+    }
+    case NodeType::WHILE_STATEMENT: {
+      auto whileStmt = static_cast<WhileStatement*>(stmt);
+      resolveExpression(whileStmt->condition);
+      resolveStatement(whileStmt->body);
+      break;
+    }
+    case NodeType::PRINT_STATEMENT: {
+      auto printStmt = static_cast<PrintStatement*>(stmt);
+      resolveExpression(printStmt->expression);
+      break;
+    }
+    case NodeType::RETURN_STATEMENT: {
+      auto returnStmt = static_cast<ReturnStatement*>(stmt);
+      if (returnStmt->expression) {
+        resolveExpression(returnStmt->expression);
+      }
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+void Resolver::resolveFunction(const FunctionDeclarationPtr& stmt) {
+  // params are bound by position, a repeated name resolves to the last one.
+  beginScope();
+  auto& scope = scopes.back();
+  for (size_t i = 0; i < stmt->params.size(); i++) {
+    scope.slots[stmt->params[i]] = static_cast<int>(i);
+  }
+  scope.size = stmt->params.size();
+  // the body's block shares the call frame with the params.
+  if (stmt->body->Type == NodeType::BLOCK_STATEMENT) {
+    for (const auto& bodyStmt :
+         static_cast<Block*>(stmt->body)->statements) {
+      resolveStatement(bodyStmt);
+    }
+  } else {
+    resolveStatement(stmt->body);
+  }
+  stmt->scopeSize = endScope();
+}
+
+void Resolver::resolveClass(const ClassDeclarationPtr& stmt) {
+  // classes always live in the global table.
+  stmt->address = declareGlobal(stmt->identifier);
+
+  // members are visible to every initializer and method: self and the
+  // fields in slots, in declaration order, and the methods by their index
+  // in the class.
+  beginScope();
+  declare("self");
+  for (const auto& field : stmt->fields) {
+    field->address = declare(field->identifier);
+  }
+  if (stmt->shape == nullptr) {
+    stmt->shape = Shape::make(*stmt);
+  }
+  for (const auto& method : stmt->methods) {
+    scopes.back().methods[method->identifier] =
+        stmt->shape->findMethod(method->identifier);
+  }
+  for (const auto& field : stmt->fields) {
+    if (field->initializer) {
+      resolveExpression(field->initializer);
+    }
+  }
+  for (const auto& method : stmt->methods) {
+    resolveFunction(method);
+  }
+  if (stmt->ctor) {
+    resolveFunction(stmt->ctor);
+  }
+  endScope();
+}
+
+void Resolver::resolveExpression(const ExpressionPtr& expr) {
+  switch (expr->Type) {
+    case NodeType::VARIABLE_EXPRESSION: {
+      auto varExpr = static_cast<VariableExpr*>(expr);
+      varExpr->method = -1;
+      varExpr->address = lookup(varExpr->identifier, &varExpr->method);
+      break;
+    }
+    case NodeType::ASSIGNMENT_EXPRESSION: {
+      auto assignExpr = static_cast<Assignment*>(expr);
+      resolveExpression(assignExpr->value);
+      assignExpr->address = lookup(assignExpr->identifier);
+      break;
+    }
+    case NodeType::BINARY_EXPRESSION: {
+      auto binaryExpr = static_cast<BinaryExpr*>(expr);
+      resolveExpression(binaryExpr->left);
+      resolveExpression(binaryExpr->right);
+      break;
+    }
+    case NodeType::UNARY_EXPRESSION:
+      resolveExpression(static_cast<UnaryExpr*>(expr)->right);
+      break;
+    case NodeType::CALL_EXPRESSION: {
+      auto callExpr = static_cast<CallExpr*>(expr);
+      resolveExpression(callExpr->left);
+      for (const auto& argument : callExpr->arguments) {
+        resolveExpression(argument);
+      }
+      break;
+    }
+    case NodeType::MEMBER_EXPRESSION:
+      resolveExpression(static_cast<MemberExpr*>(expr)->left);
+      break;
+    case NodeType::ARRAY_LITERAL:
+      for (const auto& element :
+           static_cast<ArrayLiteral*>(expr)->elements) {
+        resolveExpression(element);
+      }
+      break;
+    case NodeType::ARRAY_SUBSCRIPT_EXPRESSION: {
+      auto subscriptExpr = static_cast<ArraySubscriptExpr*>(expr);
+      resolveExpression(subscriptExpr->array);
+      resolveExpression(subscriptExpr->index);
+      break;
+    }
+    default:
+      break;
+  }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "ast.h"
+#include "common.h"
+
+// Static pass that gives every variable declaration and reference a
+// LexicalAddress, mirroring the environments the Evaluator creates: one per
+// block, for statement, function call and record, plus the global table.
+// Methods are no variables: a name referring to one is resolved to the
+// record it is read from and the index of the method in its class.
+class Resolver {
+ public:
+  // slot of self in a record environment.
+  static constexpr int SELF_SLOT = 0;
+
+  Resolver() : scopes(), globals() {}
+
+  // Globals accumulate across calls, so a REPL can resolve one program at a
+  // time against the same global table.
+  void resolve(const ProgramPtr& program);
+
+  // global slot of identifier, -1 when no program has mentioned it.
+  int findGlobal(Symbol identifier) const;
+  size_t getGlobalCount() const { return globals.size(); }
+
+ private:
+  struct Scope {
+    std::unordered_map<Symbol, int> slots;
+    // methods of the class whose record the scope is, by index.
+    std::unordered_map<Symbol, int> methods;
+    size_t size = 0;
+    // a function or class declared within closes over the scope.
+    bool captured = false;
+  };
+
+  std::vector<Scope> scopes;
+  std::unordered_map<Symbol, int> globals;
+
+  void beginScope() { scopes.emplace_back(); }
+  size_t endScope();
+  // marks every open scope as closed over by a declaration in the innermost.
+  void captureScopes();
+  LexicalAddress declare(Symbol identifier);
+  LexicalAddress declareGlobal(Symbol identifier);
+  // a name read, rather than assigned, may refer to a method, whose index
+  // is then stored in method.
+  LexicalAddress lookup(Symbol identifier, int* method = nullptr);
+
+  void resolveStatement(const StatementPtr& stmt);
+  void resolveFunction(const FunctionDeclarationPtr& stmt);
+  void resolveClass(const ClassDeclarationPtr& stmt);
+  void resolveExpression(const ExpressionPtr& expr);
+};
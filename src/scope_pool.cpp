@@ -0,0 +1,98 @@
+#include "scope_pool.h"
+
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+// header at the start of every block, found from an object by masking its
+// address since blocks are aligned to their size.
+struct Block {
+  size_t live;
+  // no longer the current block, freed by its last deallocation.
+  bool retired;
+  char* top;
+
+  char* begin() {
+    return reinterpret_cast<char*>(this) +
+           ((sizeof(Block) + ScopePool::ALIGNMENT - 1) &
+            ~(ScopePool::ALIGNMENT - 1));
+  }
+  char* end() { return reinterpret_cast<char*>(this) + ScopePool::BLOCK_SIZE; }
+};
+
+// blocks of the thread not freed yet.
+thread_local size_t blocks = 0;
+
+Block* newBlock() {
+  auto memory =
+      std::aligned_alloc(ScopePool::BLOCK_SIZE, ScopePool::BLOCK_SIZE);
+  if (memory == nullptr) {
+    throw std::bad_alloc();
+  }
+  auto block = new (memory) Block{0, false, nullptr};
+  blocks++;
+  block->top = block->begin();
+  return block;
+}
+
+void freeBlock(Block* block) {
+  blocks--;
+  std::free(block);
+}
+
+// the current block of a thread, left to its objects when the thread ends.
+struct CurrentBlock {
+  Block* block = nullptr;
+
+  ~CurrentBlock() {
+    if (block == nullptr) {
+      return;
+    } else if (block->live == 0) {
+      freeBlock(block);
+    } else {
+      block->retired = true;
+    }
+  }
+};
+
+thread_local CurrentBlock current;
+
+}  // namespace
+
+void* ScopePool::allocate(size_t size) {
+  assert(size <= MAX_SIZE);
+  size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+  auto block = current.block;
+  if (block == nullptr || block->top + size > block->end()) {
+    if (block != nullptr && block->live == 0) {
+      block->top = block->begin();
+    } else {
+      if (block != nullptr) {
+        block->retired = true;
+      }
+      block = current.block = newBlock();
+    }
+  }
+  auto pointer = block->top;
+  block->top += size;
+  block->live++;
+  return pointer;
+}
+
+void ScopePool::deallocate(void* pointer) {
+  const auto address = reinterpret_cast<uintptr_t>(pointer);
+  auto block = reinterpret_cast<Block*>(address & ~(BLOCK_SIZE - 1));
+  if (--block->live > 0) {
+    return;
+  } else if (block->retired) {
+    freeBlock(block);
+  } else {
+    // the current block, empty again.
+    block->top = block->begin();
+  }
+}
+
+size_t ScopePool::blockCount() { return blocks; }
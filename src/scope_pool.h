@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+
+// Bump-pointer pool for the scopes of blocks and for loops that no function
+// or class declared within can capture, so they die with the statement.
+// Each thread carves scopes out of its current block by bumping a pointer; a
+// block counts its live scopes and is reused as soon as they are all freed,
+// which in a loop is every iteration.
+//
+// This is a scope pool, not a young generation: nothing is ever evacuated
+// from it, so only what cannot outlive its statement goes in, and every
+// other object is allocated by makeRef. Integers, booleans and nil need no
+// pool, since Values hold them inline.
+class ScopePool {
+ public:
+  static constexpr size_t BLOCK_SIZE = 32 * 1024;
+  static constexpr size_t ALIGNMENT = 16;
+
+  // size must be at most MAX_SIZE; objects are freed on the thread that
+  // allocated them.
+  static void* allocate(size_t size);
+  static void deallocate(void* pointer);
+
+  // blocks the calling thread allocated that are not freed yet.
+  static size_t blockCount();
+
+  static constexpr size_t MAX_SIZE = BLOCK_SIZE / 8;
+};
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <string>
+
 class Driver;
 
 class Settings {
@@ -7,6 +9,19 @@ class Settings {
   static Settings* instance;
 
   bool debugMode = false;
+  // tree (Evaluator), closure (ClosureCompiler) or vm (bytecode VM).
+  std::string engine = "tree";
+  // baseline JIT for hot functions under the tree engine.
+  bool jitEnabled = true;
+  int jitThreshold = 10;
+  // loop back-edges before the loop is traced.
+  int traceThreshold = 50;
+  // AST optimizations applied before execution, 0 disables them.
+  int optLevel = 1;
+  // inlining of small functions by the AST optimizer.
+  bool inlineEnabled = true;
+  // nested Lox calls before any engine reports a stack overflow.
+  int maxCallDepth = 10000;
 
   Settings() {}
 
@@ -14,6 +29,13 @@ class Settings {
   static Settings* getInstance();
 
   bool isDebugMode() { return debugMode; }
+  const std::string& getEngine() { return engine; }
+  bool isJitEnabled() { return jitEnabled; }
+  int getJitThreshold() { return jitThreshold; }
+  int getTraceThreshold() { return traceThreshold; }
+  int getOptLevel() { return optLevel; }
+  bool isInlineEnabled() { return inlineEnabled; }
+  int getMaxCallDepth() { return maxCallDepth; }
 
   // delete copy constructor and assignment operator
   Settings(const Settings&) = delete;
@@ -0,0 +1,20 @@
+#include "shape.h"
+
+Shape::Shape(const ClassDeclaration& declaration)
+    : fields(), methods(), slots(1) {
+  // the Resolver gives a redeclared field the slot it already had; a method
+  // hides the field of the same name, and the last method of a name wins.
+  for (const auto& field : declaration.fields) {
+    fields[field->identifier] = field->address.slot;
+    slots = std::max(slots, static_cast<size_t>(field->address.slot) + 1);
+  }
+  for (size_t i = 0; i < declaration.methods.size(); i++) {
+    const auto& method = declaration.methods[i];
+    methods[method->identifier] = static_cast<int>(i);
+    fields.erase(method->identifier);
+  }
+}
+
+std::shared_ptr<Shape> Shape::make(const ClassDeclaration& declaration) {
+  return std::make_shared<Shape>(declaration);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "ast.h"
+#include "common.h"
+
+// Layout shared by every record of a class: the slot of a record that holds
+// each of its fields, and the index of each method in the table of the
+// class.
+class Shape {
+ public:
+  explicit Shape(const ClassDeclaration& declaration);
+
+  // slot of the field called name, -1 when there is none.
+  int findField(Symbol name) const { return find(fields, name); }
+  // index of the method called name in declaration.methods and the table of
+  // the class, -1 when there is none.
+  int findMethod(Symbol name) const { return find(methods, name); }
+  bool empty() const { return fields.empty() && methods.empty(); }
+  // slots of a record: self, then the fields.
+  size_t size() const { return slots; }
+
+  static std::shared_ptr<Shape> make(const ClassDeclaration& declaration);
+
+ private:
+  using SlotMap = std::unordered_map<Symbol, int>;
+
+  static int find(const SlotMap& slots, Symbol name) {
+    const auto it = slots.find(name);
+    return it != slots.end() ? it->second : -1;
+  }
+
+  SlotMap fields;
+  SlotMap methods;
+  size_t slots;
+};
+
+using ShapePtr = std::shared_ptr<Shape>;
@@ -0,0 +1,40 @@
+#include "symbol.h"
+
+#include <deque>
+
+namespace {
+
+struct SymbolTable {
+  // a deque, so the names the index points into never move.
+  std::deque<std::string> names;
+  std::unordered_map<std::string_view, uint32_t> ids;
+
+  SymbolTable() { add(""); }
+
+  uint32_t add(std::string_view name) {
+    const auto id = static_cast<uint32_t>(names.size());
+    names.emplace_back(name);
+    ids.emplace(names.back(), id);
+    return id;
+  }
+};
+
+SymbolTable& table() {
+  // never destroyed, since symbols may be used by other static destructors.
+  static auto instance = new SymbolTable();
+  return *instance;
+}
+
+}  // namespace
+
+uint32_t Symbol::intern(std::string_view name) {
+  auto& symbols = table();
+  const auto it = symbols.ids.find(name);
+  return it != symbols.ids.end() ? it->second : symbols.add(name);
+}
+
+const std::string& Symbol::str() const { return table().names[id]; }
+
+std::ostream& operator<<(std::ostream& os, const Symbol& symbol) {
+  return os << symbol.str();
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string_view>
+
+#include "common.h"
+
+// Interned name of an identifier. Each distinct name is stored once, in a
+// table shared by the whole program, and a Symbol is just its index there:
+// comparing or hashing names compares or hashes integers, and the nodes of
+// the AST carry four bytes per name instead of a string.
+class Symbol {
+ public:
+  // the empty name.
+  Symbol() : id(0) {}
+  Symbol(std::string_view name) : id(intern(name)) {}
+  Symbol(const std::string& name) : Symbol(std::string_view(name)) {}
+  Symbol(const char* name) : Symbol(std::string_view(name)) {}
+
+  // the name, valid for as long as the program runs.
+  const std::string& str() const;
+  uint32_t getId() const { return id; }
+  bool empty() const { return id == 0; }
+
+  bool operator==(const Symbol& other) const { return id == other.id; }
+  bool operator!=(const Symbol& other) const { return id != other.id; }
+
+ private:
+  static uint32_t intern(std::string_view name);
+
+  uint32_t id;
+};
+
+std::ostream& operator<<(std::ostream& os, const Symbol& symbol);
+
+namespace std {
+template <>
+struct hash<Symbol> {
+  size_t operator()(const Symbol& symbol) const { return symbol.getId(); }
+};
+}  // namespace std
@@ -2,6 +2,7 @@
 
 #include "common.h"
 #include "location.h"
+#include "symbol.h"
 
 enum class TokenType {
   TOKEN_EMPTY,
@@ -64,6 +65,8 @@ struct Token {
   SourceLocation location_;
   std::string error;
   std::string lexeme_;
+  // the name of an identifier, interned by the lexer instead of copied.
+  Symbol symbol_;
 
   explicit Token() : type(TokenType::TOKEN_EMPTY), location_() {}
   explicit Token(TokenType type) : type(type), location_() {}
@@ -72,7 +75,10 @@ struct Token {
   explicit Token(TokenType type, const SourceLocation &location,
                  const std::string &lexeme)
       : type(type), location_(location), lexeme_(lexeme) {}
-  const std::string lexeme() const { return lexeme_; }
+  const std::string lexeme() const {
+    return type == TokenType::TOKEN_IDENTIFIER ? symbol_.str() : lexeme_;
+  }
+  Symbol symbol() const { return symbol_; }
   const std::string str() const {
     std::ostringstream ss;
     ss << std::setfill('0') << std::setw(4) << location_.line << ":"
@@ -86,6 +92,11 @@ struct Token {
   }
 
   static Token make(TokenType type);
+  static Token makeIdentifier(Symbol symbol) {
+    Token token(TokenType::TOKEN_IDENTIFIER);
+    token.symbol_ = symbol;
+    return token;
+  }
 };
 
 bool operator==(const Token &lhs, const Token &rhs);
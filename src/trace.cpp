@@ -0,0 +1,522 @@
+#include "trace.h"
+
+#include <map>
+
+#include "assembler.h"
+#include "settings.h"
+
+namespace {
+
+// thrown while recording an iteration the trace compiler cannot handle.
+struct Abort {};
+
+enum class ValueType { INT, BOOL, NIL };
+
+struct TraceValue {
+  ValueType type;
+  int64_t value;
+};
+
+// Frame layout, relative to rbp:
+//   [rbp - 8]            variables array (rdi)
+//   [rbp - 16 - 8 * i]   slot i: environment variables and temporaries
+constexpr int32_t VARIABLES_OFFSET = -8;
+constexpr int32_t FIRST_SLOT_OFFSET = -16;
+
+int64_t wrap(uint64_t value) { return static_cast<int64_t>(value); }
+
+// environment holding a variable addressed relative to loopCtx.
+Environment* environmentOf(const EnvironmentPtr& loopCtx,
+                           const LexicalAddress& address) {
+  if (!address.isGlobal()) {
+    return loopCtx->ancestor(address.depth);
+  }
+  auto env = loopCtx.get();
+  while (env->getEnclosing()) {
+    env = env->getEnclosing().get();
+  }
+  return env;
+}
+
+// Interprets one loop iteration over a private copy of the integer state,
+// emitting native code for the path it takes. Branches become guards that
+// leave the trace, so the emitted code is a single straight-line loop.
+class TraceRecorder {
+ public:
+  explicit TraceRecorder(const EnvironmentPtr& loopCtx) : loopCtx(loopCtx) {}
+
+  std::vector<uint8_t> record(const ExpressionPtr& condition,
+                              const StatementPtr& body,
+                              const ExpressionPtr& increment);
+
+  const std::vector<LexicalAddress>& getVariables() const {
+    return variables;
+  }
+  const std::vector<bool>& getWritten() const { return written; }
+
+ private:
+  enum class Flow { NORMAL, CONTINUE };
+
+  struct Binding {
+    int32_t slot;
+    // index into variables, -1 for a temporary.
+    int32_t variable;
+  };
+
+  EnvironmentPtr loopCtx;
+  Assembler masm;
+  Label exit;
+  // concrete value of every slot at the current point of the iteration.
+  std::vector<int64_t> values;
+  std::vector<LexicalAddress> variables;
+  std::vector<int32_t> variableSlots;
+  std::vector<bool> written;
+  std::map<std::pair<int, int>, int32_t> variableIndex;
+  // environment slot -> trace slot of the blocks open inside the body.
+  std::vector<std::unordered_map<int, int32_t>> scopes;
+
+  static int32_t slotOffset(int32_t slot) {
+    return FIRST_SLOT_OFFSET - 8 * slot;
+  }
+  int32_t newSlot(int64_t value) {
+    values.push_back(value);
+    return static_cast<int32_t>(values.size() - 1);
+  }
+  bool lookup(const LexicalAddress& address, Binding& binding);
+  void assign(const Binding& binding, int64_t value);
+  // leaves the trace unless rax's truthiness matches the recorded one.
+  void guard(bool truthy);
+
+  Flow statement(const StatementPtr& stmt);
+  void varDeclaration(const VarDeclarationPtr& stmt);
+  TraceValue expression(const ExpressionPtr& expr);
+  int64_t intExpression(const ExpressionPtr& expr);
+  TraceValue binaryExpression(const BinaryExprPtr& expr);
+  TraceValue unaryExpression(const UnaryExprPtr& expr);
+  // rax <- rax != 0
+  void truthy();
+};
+
+std::vector<uint8_t> TraceRecorder::record(const ExpressionPtr& condition,
+                                           const StatementPtr& body,
+                                           const ExpressionPtr& increment) {
+  Label head, loads;
+  masm.push(Register::RBP);
+  masm.mov(Register::RBP, Register::RSP);
+  masm.subImm(Register::RSP, 0);
+  const auto frameSizePosition = masm.size() - 4;
+  masm.store(Register::RBP, VARIABLES_OFFSET, Register::RDI);
+  // the variables are only known once the iteration has been recorded.
+  masm.jmp(loads);
+
+  masm.bind(head);
+  const auto conditionValue = expression(condition);
+  if (conditionValue.value == 0) {
+    // the loop is about to finish, nothing worth compiling.
+    throw Abort();
+  }
+  guard(true);
+  statement(body);
+  if (increment) {
+    expression(increment);
+  }
+  // commit the iteration, side exits resume from here.
+  masm.load(Register::RCX, Register::RBP, VARIABLES_OFFSET);
+  for (size_t i = 0; i < variables.size(); i++) {
+    if (written[i]) {
+      masm.load(Register::RAX, Register::RBP, slotOffset(variableSlots[i]));
+      masm.store(Register::RCX, 8 * i, Register::RAX);
+    }
+  }
+  masm.jmp(head);
+
+  masm.bind(exit);
+  masm.mov(Register::RSP, Register::RBP);
+  masm.pop(Register::RBP);
+  masm.ret();
+
+  masm.bind(loads);
+  masm.load(Register::RCX, Register::RBP, VARIABLES_OFFSET);
+  for (size_t i = 0; i < variables.size(); i++) {
+    masm.load(Register::RAX, Register::RCX, 8 * i);
+    masm.store(Register::RBP, slotOffset(variableSlots[i]), Register::RAX);
+  }
+  masm.jmp(head);
+
+  const auto frameSize = 8 + 8 * values.size();
+  masm.patch32(frameSizePosition, (frameSize + 15) / 16 * 16);
+  return masm.getCode();
+}
+
+bool TraceRecorder::lookup(const LexicalAddress& address, Binding& binding) {
+  // addresses count the body's open blocks before reaching the loop's
+  // environment.
+  const auto open = static_cast<int>(scopes.size());
+  if (!address.isGlobal() && address.depth < open) {
+    const auto& scope = scopes[open - 1 - address.depth];
+    const auto slot = scope.find(address.slot);
+    if (slot == scope.end()) {
+      return false;
+    }
+    binding = Binding{slot->second, -1};
+    return true;
+  }
+  auto variableAddress = address;
+  if (!address.isGlobal()) {
+    variableAddress.depth -= open;
+  }
+  const auto key = std::make_pair(variableAddress.depth, variableAddress.slot);
+  const auto index = variableIndex.find(key);
+  if (index != variableIndex.end()) {
+    binding = Binding{variableSlots[index->second], index->second};
+    return true;
+  }
+
+  auto value =
+      environmentOf(loopCtx, variableAddress)->get(variableAddress.slot);
+  if (!value.isInteger()) {
+    throw Abort();
+  }
+  const auto variable = static_cast<int32_t>(variables.size());
+  const auto slot = newSlot(value.asInteger());
+  variables.push_back(variableAddress);
+  variableSlots.push_back(slot);
+  written.push_back(false);
+  variableIndex[key] = variable;
+  binding = Binding{slot, variable};
+  return true;
+}
+
+void TraceRecorder::assign(const Binding& binding, int64_t value) {
+  masm.store(Register::RBP, slotOffset(binding.slot), Register::RAX);
+  values[binding.slot] = value;
+  if (binding.variable >= 0) {
+    written[binding.variable] = true;
+  }
+}
+
+void TraceRecorder::guard(bool truthy) {
+  masm.test(Register::RAX, Register::RAX);
+  masm.jcc(truthy ? Condition::EQUAL : Condition::NOT_EQUAL, exit);
+}
+
+TraceRecorder::Flow TraceRecorder::statement(const StatementPtr& stmt) {
+  switch (stmt->Type) {
+    case NodeType::EXPRESSION_STATEMENT: {
+      auto exprStmt = static_cast<ExpressionStatement*>(stmt);
+      expression(exprStmt->expression);
+      return Flow::NORMAL;
+    }
+    case NodeType::VAR_DECLARATION:
+      varDeclaration(static_cast<VarDeclaration*>(stmt));
+      return Flow::NORMAL;
+    case NodeType::BLOCK_STATEMENT: {
+      auto block = static_cast<Block*>(stmt);
+      auto flow = Flow::NORMAL;
+      scopes.emplace_back();
+      for (const auto& blockStmt : block->statements) {
+        flow = statement(blockStmt);
+        if (flow == Flow::CONTINUE) {
+          break;
+        }
+      }
+      scopes.pop_back();
+      return flow;
+    }
+    case NodeType::IF_STATEMENT: {
+      auto ifStmt = static_cast<IfStatement*>(stmt);
+      const auto taken = expression(ifStmt->condition).value != 0;
+      guard(taken);
+      if (taken) {
+        return statement(ifStmt->thenBranch);
+      } else if (ifStmt->elseBranch) {
+        return statement(ifStmt->elseBranch);
+      }
+      return Flow::NORMAL;
+    }
+    case NodeType::CONTINUE_STATEMENT:
+      return Flow::CONTINUE;
+    case NodeType::EMPTY_STATEMENT:
+      return Flow::NORMAL;
+    default:
+      // break and return leave the loop, anything else is not traced.
+      throw Abort();
+  }
+}
+
+void TraceRecorder::varDeclaration(const VarDeclarationPtr& stmt) {
+  if (!stmt->initializer) {
+    throw Abort();
+  }
+  const auto value = intExpression(stmt->initializer);
+  const auto& address = stmt->address;
+  Binding binding;
+  if (address.depth == 0 && !scopes.empty()) {
+    // declared in a body block: a temporary that dies with the iteration.
+    auto& scope = scopes.back();
+    const auto slot = scope.find(address.slot);
+    if (slot != scope.end()) {
+      binding = Binding{slot->second, -1};
+    } else {
+      binding = Binding{newSlot(value), -1};
+      scope[address.slot] = binding.slot;
+    }
+  } else if (!lookup(address, binding)) {
+    throw Abort();
+  }
+  assign(binding, value);
+}
+
+TraceValue TraceRecorder::expression(const ExpressionPtr& expr) {
+  switch (expr->Type) {
+    case NodeType::INTEGER_LITERAL: {
+      const auto value = static_cast<IntegerLiteral*>(expr)->Value;
+      masm.mov(Register::RAX, value);
+      return TraceValue{ValueType::INT, value};
+    }
+    case NodeType::BOOLEAN_LITERAL: {
+      const int64_t value = static_cast<BooleanLiteral*>(expr)->Value ? 1 : 0;
+      masm.mov(Register::RAX, value);
+      return TraceValue{ValueType::BOOL, value};
+    }
+    case NodeType::NIL_LITERAL:
+      masm.mov(Register::RAX, 0);
+      return TraceValue{ValueType::NIL, 0};
+    case NodeType::VARIABLE_EXPRESSION: {
+      const auto& varExpr = static_cast<const VariableExpr&>(*expr);
+      Binding binding;
+      if (varExpr.method >= 0 || !lookup(varExpr.address, binding)) {
+        throw Abort();
+      }
+      masm.load(Register::RAX, Register::RBP, slotOffset(binding.slot));
+      return TraceValue{ValueType::INT, values[binding.slot]};
+    }
+    case NodeType::ASSIGNMENT_EXPRESSION: {
+      auto assignment = static_cast<Assignment*>(expr);
+      const auto value = intExpression(assignment->value);
+      Binding binding;
+      if (!lookup(assignment->address, binding)) {
+        throw Abort();
+      }
+      assign(binding, value);
+      return TraceValue{ValueType::INT, value};
+    }
+    case NodeType::BINARY_EXPRESSION:
+      return binaryExpression(static_cast<BinaryExpr*>(expr));
+    case NodeType::UNARY_EXPRESSION:
+      return unaryExpression(static_cast<UnaryExpr*>(expr));
+    default:
+      throw Abort();
+  }
+}
+
+int64_t TraceRecorder::intExpression(const ExpressionPtr& expr) {
+  const auto result = expression(expr);
+  if (result.type != ValueType::INT) {
+    throw Abort();
+  }
+  return result.value;
+}
+
+TraceValue TraceRecorder::binaryExpression(const BinaryExprPtr& expr) {
+  const auto operator_ = expr->operator_.type;
+  const auto lhs = expression(expr->left);
+  masm.push(Register::RAX);
+  const auto rhs = expression(expr->right);
+  masm.mov(Register::RCX, Register::RAX);
+  masm.pop(Register::RAX);
+
+  // and/or evaluate both operands and combine their truthiness.
+  if (operator_ == TokenType::TOKEN_AND || operator_ == TokenType::TOKEN_OR) {
+    truthy();
+    masm.mov(Register::RDX, Register::RAX);
+    masm.mov(Register::RAX, Register::RCX);
+    truthy();
+    if (operator_ == TokenType::TOKEN_AND) {
+      masm.imul(Register::RAX, Register::RDX);
+      return TraceValue{ValueType::BOOL, lhs.value != 0 && rhs.value != 0};
+    }
+    masm.add(Register::RAX, Register::RDX);
+    truthy();
+    return TraceValue{ValueType::BOOL, lhs.value != 0 || rhs.value != 0};
+  }
+  if (operator_ == TokenType::TOKEN_EQUAL_EQUAL ||
+      operator_ == TokenType::TOKEN_BANG_EQUAL) {
+    if (lhs.type != rhs.type) {
+      throw Abort();
+    }
+    const bool equal = operator_ == TokenType::TOKEN_EQUAL_EQUAL;
+    masm.cmp(Register::RAX, Register::RCX);
+    masm.setcc(equal ? Condition::EQUAL : Condition::NOT_EQUAL);
+    return TraceValue{ValueType::BOOL, (lhs.value == rhs.value) == equal};
+  }
+
+  if (lhs.type != ValueType::INT || rhs.type != ValueType::INT) {
+    throw Abort();
+  }
+  const auto a = lhs.value;
+  const auto b = rhs.value;
+  switch (operator_) {
+    case TokenType::TOKEN_PLUS:
+      masm.add(Register::RAX, Register::RCX);
+      return TraceValue{ValueType::INT, wrap(uint64_t(a) + uint64_t(b))};
+    case TokenType::TOKEN_MINUS:
+      masm.sub(Register::RAX, Register::RCX);
+      return TraceValue{ValueType::INT, wrap(uint64_t(a) - uint64_t(b))};
+    case TokenType::TOKEN_STAR:
+      masm.imul(Register::RAX, Register::RCX);
+      return TraceValue{ValueType::INT, wrap(uint64_t(a) * uint64_t(b))};
+    case TokenType::TOKEN_SLASH: {
+      if (b == 0) {
+        throw Abort();
+      }
+      // a zero divisor leaves the trace, the Evaluator reports it.
+      Label divide, done;
+      masm.test(Register::RCX, Register::RCX);
+      masm.jcc(Condition::EQUAL, exit);
+      masm.mov(Register::RDX, -1);
+      masm.cmp(Register::RCX, Register::RDX);
+      masm.jcc(Condition::NOT_EQUAL, divide);
+      // idiv traps on INT64_MIN / -1.
+      masm.neg(Register::RAX);
+      masm.jmp(done);
+      masm.bind(divide);
+      masm.cqo();
+      masm.idiv(Register::RCX);
+      masm.bind(done);
+      return TraceValue{ValueType::INT,
+                        b == -1 ? wrap(0 - uint64_t(a)) : a / b};
+    }
+    case TokenType::TOKEN_LESS:
+      masm.cmp(Register::RAX, Register::RCX);
+      masm.setcc(Condition::LESS);
+      return TraceValue{ValueType::BOOL, a < b};
+    case TokenType::TOKEN_LESS_EQUAL:
+      masm.cmp(Register::RAX, Register::RCX);
+      masm.setcc(Condition::LESS_EQUAL);
+      return TraceValue{ValueType::BOOL, a <= b};
+    case TokenType::TOKEN_GREATER:
+      masm.cmp(Register::RAX, Register::RCX);
+      masm.setcc(Condition::GREATER);
+      return TraceValue{ValueType::BOOL, a > b};
+    case TokenType::TOKEN_GREATER_EQUAL:
+      masm.cmp(Register::RAX, Register::RCX);
+      masm.setcc(Condition::GREATER_EQUAL);
+      return TraceValue{ValueType::BOOL, a >= b};
+    default:
+      throw Abort();
+  }
+}
+
+TraceValue TraceRecorder::unaryExpression(const UnaryExprPtr& expr) {
+  switch (expr->operator_.type) {
+    case TokenType::TOKEN_MINUS: {
+      const auto value = intExpression(expr->right);
+      masm.neg(Register::RAX);
+      return TraceValue{ValueType::INT, wrap(0 - uint64_t(value))};
+    }
+    case TokenType::TOKEN_BANG: {
+      const auto value = expression(expr->right).value;
+      masm.test(Register::RAX, Register::RAX);
+      masm.setcc(Condition::EQUAL);
+      return TraceValue{ValueType::BOOL, value == 0};
+    }
+    default:
+      throw Abort();
+  }
+}
+
+void TraceRecorder::truthy() {
+  masm.test(Register::RAX, Register::RAX);
+  masm.setcc(Condition::NOT_EQUAL);
+}
+
+}  // namespace
+
+bool Trace::run(const EnvironmentPtr& loopCtx) const {
+  std::vector<Environment*> envs;
+  std::vector<int64_t> values;
+  envs.reserve(variables.size());
+  values.reserve(variables.size());
+  for (const auto& variable : variables) {
+    auto env = environmentOf(loopCtx, variable);
+    auto value = env->get(variable.slot);
+    if (!value.isInteger()) {
+      return false;
+    }
+    envs.push_back(env);
+    values.push_back(value.asInteger());
+  }
+
+  entry(values.data());
+
+  for (size_t i = 0; i < variables.size(); i++) {
+    if (written[i]) {
+      envs[i]->set(variables[i].slot, Value::integer(values[i]));
+    }
+  }
+  return true;
+}
+
+TracePtr Trace::record(const StatementPtr& loop,
+                       const EnvironmentPtr& loopCtx) {
+  ExpressionPtr condition = nullptr;
+  StatementPtr body = nullptr;
+  ExpressionPtr increment = nullptr;
+  switch (loop->Type) {
+    case NodeType::FOR_STATEMENT: {
+      auto forStmt = static_cast<ForStatement*>(loop);
+      condition = forStmt->condition;
+      body = forStmt->body;
+      increment = forStmt->increment;
+      break;
+    }
+    case NodeType::WHILE_STATEMENT: {
+      auto whileStmt = static_cast<WhileStatement*>(loop);
+      condition = whileStmt->condition;
+      body = whileStmt->body;
+      break;
+    }
+    default:
+      return nullptr;
+  }
+
+  TraceRecorder recorder(loopCtx);
+  std::vector<uint8_t> code;
+  try {
+    code = recorder.record(condition, body, increment);
+  } catch (const Abort&) {
+    return nullptr;
+  }
+  auto memory = ExecutableMemory::make(code);
+  if (!memory) {
+    return nullptr;
+  }
+  return std::make_shared<Trace>(std::move(memory), recorder.getVariables(),
+                                 recorder.getWritten());
+}
+
+void LoopTracer::onBackEdge(const StatementPtr& loop,
+                            const EnvironmentPtr& loopCtx) {
+  auto settings = Settings::getInstance();
+  if (!settings->isJitEnabled()) {
+    return;
+  }
+  auto& state = loops[loop];
+  if (!state.trace) {
+    if (state.failed || ++state.backEdges < settings->getTraceThreshold()) {
+      return;
+    }
+    state.trace = Trace::record(loop, loopCtx);
+    if (!state.trace) {
+      state.failed = true;
+      return;
+    }
+  }
+  state.trace->run(loopCtx);
+}
+
+TracePtr LoopTracer::getTrace(const StatementPtr& loop) const {
+  const auto it = loops.find(loop);
+  return it != loops.end() ? it->second.trace : nullptr;
+}
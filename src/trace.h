@@ -0,0 +1,69 @@
+#pragma once
+
+#include "ast.h"
+#include "common.h"
+#include "environment.h"
+#include "jit.h"
+
+// Native code for one hot loop, specialised to the path and integer types
+// seen while recording a single iteration.
+class Trace {
+ public:
+  // void fn(int64_t* variables): runs iterations until a guard fails,
+  // leaving the values as of the start of the failing iteration.
+  using NativeTrace = void (*)(int64_t*);
+
+  Trace(std::unique_ptr<ExecutableMemory> memory,
+        std::vector<LexicalAddress> variables, std::vector<bool> written)
+      : memory(std::move(memory)),
+        variables(std::move(variables)),
+        written(std::move(written)) {
+    entry = reinterpret_cast<NativeTrace>(this->memory->getEntry());
+  }
+
+  // Runs the trace against the variables visible from loopCtx and writes
+  // the results back. Returns false without running when an entry guard
+  // fails because a variable is no longer an integer.
+  bool run(const EnvironmentPtr& loopCtx) const;
+
+  const std::vector<LexicalAddress>& getVariables() const {
+    return variables;
+  }
+  size_t size() const { return memory->size(); }
+
+  // Records one iteration of a for or while loop starting from the current
+  // state of loopCtx. Returns nullptr when the iteration leaves the
+  // supported subset or exits the loop.
+  static std::shared_ptr<Trace> record(const StatementPtr& loop,
+                                       const EnvironmentPtr& loopCtx);
+
+ private:
+  std::unique_ptr<ExecutableMemory> memory;
+  NativeTrace entry;
+  // environment variables relative to the loop's environment, in the order
+  // of the native variables array.
+  std::vector<LexicalAddress> variables;
+  std::vector<bool> written;
+};
+
+using TracePtr = std::shared_ptr<Trace>;
+
+// Counts loop back-edges and switches hot loops over to recorded traces.
+class LoopTracer {
+ public:
+  // Called by the Evaluator after each iteration of loop; may run any
+  // number of further iterations natively before returning.
+  void onBackEdge(const StatementPtr& loop, const EnvironmentPtr& loopCtx);
+
+  TracePtr getTrace(const StatementPtr& loop) const;
+
+ private:
+  struct LoopState {
+    int backEdges = 0;
+    bool failed = false;
+    TracePtr trace;
+  };
+
+  // keyed by the node itself so it stays alive as long as its trace.
+  std::unordered_map<StatementPtr, LoopState> loops;
+};
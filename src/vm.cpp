@@ -0,0 +1,434 @@
+#include "vm.h"
+
+#include "settings.h"
+
+VM::VM() : stack(), frames(), globals(), openUpvalues(nullptr) {}
+
+ObjectPtr VM::interpret(ProgramPtr program) {
+  Compiler compiler;
+  auto function = compiler.compile(program);
+  auto closure = ClosureObject::make(function);
+  resetStack();
+  // frames are referenced by pointer while running, they must never move.
+  const auto maxCallDepth = Settings::getInstance()->getMaxCallDepth();
+  framesMax = static_cast<size_t>(std::max(maxCallDepth, 0)) + 1;
+  frames.reserve(framesMax);
+  push(closure);
+  call(closure, 0);
+  return run();
+}
+
+ObjectPtr VM::getGlobalValue(const std::string& identifier) const {
+  const auto it = globals.find(identifier);
+  if (it == globals.end()) {
+    return NULL_OBJECT_PTR;
+  }
+  return it->second;
+}
+
+void VM::resetStack() {
+  stack.clear();
+  frames.clear();
+  openUpvalues = nullptr;
+}
+
+ObjectPtr VM::run() {
+  CallFrame* frame = &frames.back();
+  auto readByte = [&]() -> uint8_t { return *frame->ip++; };
+  auto readShort = [&]() -> uint16_t {
+    frame->ip += 2;
+    return static_cast<uint16_t>((frame->ip[-2] << 8) | frame->ip[-1]);
+  };
+  auto readConstant = [&]() -> const ObjectPtr& {
+    return frame->closure->function->chunk.constants[readShort()];
+  };
+  auto readString = [&]() -> const std::string& {
+    return static_pointer_cast<StringObject>(readConstant())->Value;
+  };
+
+  for (;;) {
+#ifdef DEBUG_TRACE_EXECUTION
+    if (Settings::getInstance()->isDebugMode()) {
+      std::cout << "          ";
+      for (const auto& value : stack) {
+        std::cout << "[ " << value->toString() << " ]";
+      }
+      std::cout << std::endl;
+      auto& chunk = frame->closure->function->chunk;
+      chunk.disassembleInstruction(frame->ip - chunk.code.data());
+    }
+#endif
+    const auto instruction = static_cast<OpCode>(readByte());
+    switch (instruction) {
+      case OpCode::OP_CONSTANT:
+        push(readConstant());
+        break;
+      case OpCode::OP_NIL:
+        push(NULL_OBJECT_PTR);
+        break;
+      case OpCode::OP_TRUE:
+        push(TRUE_OBJECT_PTR);
+        break;
+      case OpCode::OP_FALSE:
+        push(FALSE_OBJECT_PTR);
+        break;
+      case OpCode::OP_POP:
+        stack.pop_back();
+        break;
+      case OpCode::OP_POP_COMPLETION:
+        frame->completion = pop();
+        break;
+      case OpCode::OP_SET_COMPLETION:
+        frame->completion = peek(0);
+        break;
+      case OpCode::OP_GET_LOCAL:
+        push(stack[frame->slots + readByte()]);
+        break;
+      case OpCode::OP_SET_LOCAL:
+        stack[frame->slots + readByte()] = peek(0);
+        break;
+      case OpCode::OP_GET_GLOBAL: {
+        const auto it = globals.find(readString());
+        push(it != globals.end() ? it->second : NULL_OBJECT_PTR);
+        break;
+      }
+      case OpCode::OP_DEFINE_GLOBAL: {
+        const auto& name = readString();
+        globals[name] = pop();
+        break;
+      }
+      case OpCode::OP_SET_GLOBAL: {
+        // like the evaluator, assigning an undeclared name declares it.
+        const auto& name = readString();
+        globals[name] = peek(0);
+        break;
+      }
+      case OpCode::OP_GET_UPVALUE: {
+        const auto& upvalue = frame->closure->upvalues[readByte()];
+        push(upvalue->open ? stack[upvalue->slot] : upvalue->closed);
+        break;
+      }
+      case OpCode::OP_SET_UPVALUE: {
+        const auto& upvalue = frame->closure->upvalues[readByte()];
+        if (upvalue->open) {
+          stack[upvalue->slot] = peek(0);
+        } else {
+          upvalue->closed = peek(0);
+        }
+        break;
+      }
+      case OpCode::OP_GET_FIELD: {
+        const auto& name = readString();
+        auto instance = static_pointer_cast<InstanceObject>(pop());
+        const auto it = instance->fields.find(name);
+        push(it != instance->fields.end() ? it->second : NULL_OBJECT_PTR);
+        break;
+      }
+      case OpCode::OP_SET_FIELD: {
+        const auto& name = readString();
+        auto instance = static_pointer_cast<InstanceObject>(pop());
+        instance->fields[name] = peek(0);
+        break;
+      }
+      case OpCode::OP_GET_PROPERTY: {
+        const auto& name = readString();
+        auto receiver = pop();
+        if (receiver->Type != ObjectType::OBJ_INSTANCE) {
+          std::ostringstream ss;
+          ss << "Invalid member expression: " << receiver->toString() << "."
+             << name;
+          runtimeError(ss.str());
+        }
+        // only methods are reachable from outside the record.
+        auto instance = static_pointer_cast<InstanceObject>(receiver);
+        const auto it = instance->klass->methods.find(name);
+        if (it != instance->klass->methods.end()) {
+          push(BoundMethodObject::make(receiver, it->second));
+        } else {
+          push(NULL_OBJECT_PTR);
+        }
+        break;
+      }
+      case OpCode::OP_EQUAL: {
+        auto b = pop();
+        auto a = pop();
+        push(BooleanObject::make(a->isEqual(*b)));
+        break;
+      }
+      case OpCode::OP_NOT_EQUAL: {
+        auto b = pop();
+        auto a = pop();
+        push(BooleanObject::make(!a->isEqual(*b)));
+        break;
+      }
+      case OpCode::OP_GREATER:
+      case OpCode::OP_GREATER_EQUAL:
+      case OpCode::OP_LESS:
+      case OpCode::OP_LESS_EQUAL: {
+        const auto b = popInteger();
+        const auto a = popInteger();
+        bool result = false;
+        switch (instruction) {
+          case OpCode::OP_GREATER:
+            result = a > b;
+            break;
+          case OpCode::OP_GREATER_EQUAL:
+            result = a >= b;
+            break;
+          case OpCode::OP_LESS:
+            result = a < b;
+            break;
+          default:
+            result = a <= b;
+            break;
+        }
+        push(BooleanObject::make(result));
+        break;
+      }
+      case OpCode::OP_ADD:
+      case OpCode::OP_SUBTRACT:
+      case OpCode::OP_MULTIPLY:
+      case OpCode::OP_DIVIDE: {
+        if (!peek(0)->isNumeric() || !peek(1)->isNumeric()) {
+          std::ostringstream ss;
+          ss << "Invalid binary operands: " << peek(1)->toString() << " and "
+             << peek(0)->toString();
+          runtimeError(ss.str());
+        }
+        const auto b = popInteger();
+        const auto a = popInteger();
+        int64_t result;
+        switch (instruction) {
+          case OpCode::OP_ADD:
+            result = a + b;
+            break;
+          case OpCode::OP_SUBTRACT:
+            result = a - b;
+            break;
+          case OpCode::OP_MULTIPLY:
+            result = a * b;
+            break;
+          default:
+            if (b == 0) {
+              runtimeError("Division by zero");
+            }
+            result = a / b;
+            break;
+        }
+        push(IntegerObject::make(result));
+        break;
+      }
+      case OpCode::OP_AND: {
+        const auto b = pop()->isTruthy();
+        const auto a = pop()->isTruthy();
+        push(BooleanObject::make(a && b));
+        break;
+      }
+      case OpCode::OP_OR: {
+        const auto b = pop()->isTruthy();
+        const auto a = pop()->isTruthy();
+        push(BooleanObject::make(a || b));
+        break;
+      }
+      case OpCode::OP_NOT:
+        push(BooleanObject::make(!pop()->isTruthy()));
+        break;
+      case OpCode::OP_NEGATE:
+        push(IntegerObject::make(-popInteger()));
+        break;
+      case OpCode::OP_PRINT:
+        std::cout << peek(0)->toString() << std::endl;
+        break;
+      case OpCode::OP_JUMP: {
+        const auto offset = readShort();
+        frame->ip += offset;
+        break;
+      }
+      case OpCode::OP_JUMP_IF_FALSE: {
+        const auto offset = readShort();
+        if (peek(0)->isFalsey()) {
+          frame->ip += offset;
+        }
+        break;
+      }
+      case OpCode::OP_LOOP: {
+        const auto offset = readShort();
+        frame->ip -= offset;
+        break;
+      }
+      case OpCode::OP_CALL: {
+        const auto argCount = readByte();
+        callValue(peek(argCount), argCount);
+        frame = &frames.back();
+        break;
+      }
+      case OpCode::OP_CLOSURE: {
+        auto function = static_pointer_cast<CompiledFunction>(readConstant());
+        auto closure = ClosureObject::make(function);
+        for (auto& upvalue : closure->upvalues) {
+          const auto isLocal = readByte();
+          const auto index = readByte();
+          if (isLocal) {
+            upvalue = captureUpvalue(frame->slots + index);
+          } else {
+            upvalue = frame->closure->upvalues[index];
+          }
+        }
+        push(closure);
+        break;
+      }
+      case OpCode::OP_CLOSE_UPVALUE:
+        closeUpvalues(stack.size() - 1);
+        stack.pop_back();
+        break;
+      case OpCode::OP_RETURN:
+      case OpCode::OP_RETURN_COMPLETION: {
+        auto result =
+            instruction == OpCode::OP_RETURN ? pop() : frame->completion;
+        closeUpvalues(frame->slots);
+        const auto slots = frame->slots;
+        frames.pop_back();
+        stack.resize(slots);
+        if (frames.empty()) {
+          return result;
+        }
+        push(result);
+        frame = &frames.back();
+        break;
+      }
+      case OpCode::OP_ARRAY: {
+        const auto count = readShort();
+        std::vector<Value> elements(stack.end() - count, stack.end());
+        stack.resize(stack.size() - count);
+        push(ArrayObject::make(std::move(elements)));
+        break;
+      }
+      case OpCode::OP_INDEX: {
+        auto indexValue = pop();
+        auto arrayValue = pop();
+        if (arrayValue->Type != ObjectType::OBJ_ARRAY) {
+          runtimeError("Invalid array: " + arrayValue->toString());
+        }
+        if (indexValue->Type != ObjectType::OBJ_INTEGER) {
+          runtimeError("Invalid index: " + indexValue->toString());
+        }
+        auto array = static_pointer_cast<ArrayObject>(arrayValue);
+        const auto index =
+            static_pointer_cast<IntegerObject>(indexValue)->Value;
+        if (index < 0 || static_cast<size_t>(index) >= array->Values.size()) {
+          runtimeError("Index out of range: " + std::to_string(index));
+        }
+        push(array->Values[index].toObject());
+        break;
+      }
+      case OpCode::OP_CLASS:
+        push(CompiledClass::make(readString()));
+        break;
+      case OpCode::OP_METHOD: {
+        const auto& name = readString();
+        auto method = static_pointer_cast<ClosureObject>(pop());
+        static_pointer_cast<CompiledClass>(peek(0))->methods[name] = method;
+        break;
+      }
+      case OpCode::OP_INITIALIZER: {
+        auto initializer = static_pointer_cast<ClosureObject>(pop());
+        static_pointer_cast<CompiledClass>(peek(0))->initializer = initializer;
+        break;
+      }
+      default:
+        runtimeError("Unknown opcode " + std::to_string((int)instruction));
+    }
+  }
+}
+
+void VM::callValue(ObjectPtr callee, int argCount) {
+  switch (callee->Type) {
+    case ObjectType::OBJ_CLOSURE:
+      call(static_pointer_cast<ClosureObject>(callee), argCount);
+      return;
+    case ObjectType::OBJ_BOUND_METHOD: {
+      auto boundMethod = static_pointer_cast<BoundMethodObject>(callee);
+      stack[stack.size() - argCount - 1] = boundMethod->receiver;
+      call(boundMethod->method, argCount);
+      return;
+    }
+    case ObjectType::OBJ_COMPILED_CLASS: {
+      auto klass = static_pointer_cast<CompiledClass>(callee);
+      stack[stack.size() - argCount - 1] = InstanceObject::make(klass);
+      if (klass->initializer) {
+        call(klass->initializer, argCount);
+      } else {
+        // without a ctor the arguments are ignored, as in the evaluator.
+        stack.resize(stack.size() - argCount);
+      }
+      return;
+    }
+    default:
+      runtimeError("Invalid callable: " + callee->toString());
+  }
+}
+
+void VM::call(ClosureObjectPtr closure, int argCount) {
+  if (argCount != closure->function->arity) {
+    std::ostringstream ss;
+    ss << "Expected " << closure->function->arity << " arguments but got "
+       << argCount << ".";
+    runtimeError(ss.str());
+  }
+  if (frames.size() == framesMax) {
+    runtimeError("Stack overflow.");
+  }
+  frames.push_back(CallFrame{closure, closure->function->chunk.code.data(),
+                             stack.size() - argCount - 1, NULL_OBJECT_PTR});
+}
+
+UpvalueObjectPtr VM::captureUpvalue(size_t slot) {
+  UpvalueObjectPtr prevUpvalue = nullptr;
+  auto upvalue = openUpvalues;
+  while (upvalue != nullptr && upvalue->slot > slot) {
+    prevUpvalue = upvalue;
+    upvalue = upvalue->next;
+  }
+  if (upvalue != nullptr && upvalue->slot == slot) {
+    return upvalue;
+  }
+  auto createdUpvalue = UpvalueObject::make(slot);
+  createdUpvalue->next = upvalue;
+  if (prevUpvalue == nullptr) {
+    openUpvalues = createdUpvalue;
+  } else {
+    prevUpvalue->next = createdUpvalue;
+  }
+  return createdUpvalue;
+}
+
+void VM::closeUpvalues(size_t lastSlot) {
+  while (openUpvalues != nullptr && openUpvalues->slot >= lastSlot) {
+    auto upvalue = openUpvalues;
+    upvalue->closed = stack[upvalue->slot];
+    upvalue->open = false;
+    openUpvalues = upvalue->next;
+    upvalue->next = nullptr;
+  }
+}
+
+int64_t VM::popInteger() {
+  auto value = pop();
+  if (value->Type != ObjectType::OBJ_INTEGER) {
+    runtimeError("Cannot convert object to integer: " + value->toString());
+  }
+  return static_pointer_cast<IntegerObject>(value)->Value;
+}
+
+void VM::runtimeError(const std::string& msg) {
+  std::ostringstream ss;
+  if (!frames.empty()) {
+    const auto& frame = frames.back();
+    auto& chunk = frame.closure->function->chunk;
+    const size_t instruction = frame.ip - chunk.code.data() - 1;
+    ss << "[line " << chunk.getLine(instruction) << "] ";
+  }
+  ss << msg;
+  resetStack();
+  throw RuntimeError(ss.str());
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "ast.h"
+#include "chunk.h"
+#include "common.h"
+#include "compiler.h"
+#include "evaluator.h"
+#include "object.h"
+#include "vm_object.h"
+
+// Stack-based bytecode interpreter, selected with --engine=vm. Programs are
+// compiled by Compiler and evaluate to the same values as with Evaluator.
+class VM {
+ public:
+  VM();
+
+  ObjectPtr interpret(ProgramPtr program);
+  ObjectPtr getGlobalValue(const std::string& identifier) const;
+
+ private:
+  struct CallFrame {
+    ClosureObjectPtr closure;
+    const uint8_t* ip;
+    // stack index of slot zero: the callee or the method receiver.
+    size_t slots;
+    // value of the last statement executed, returned when the function body
+    // ends without an explicit return.
+    ObjectPtr completion;
+  };
+
+  std::vector<ObjectPtr> stack;
+  std::vector<CallFrame> frames;
+  // frames before a call reports a stack overflow, the script's included.
+  size_t framesMax = 0;
+  std::unordered_map<std::string, ObjectPtr> globals;
+  // open upvalues sorted by stack slot, topmost first.
+  UpvalueObjectPtr openUpvalues;
+
+  ObjectPtr run();
+  void resetStack();
+  inline void push(ObjectPtr value) { stack.push_back(std::move(value)); }
+  inline ObjectPtr pop() {
+    auto value = std::move(stack.back());
+    stack.pop_back();
+    return value;
+  }
+  inline const ObjectPtr& peek(size_t distance) const {
+    return stack[stack.size() - 1 - distance];
+  }
+
+  void callValue(ObjectPtr callee, int argCount);
+  void call(ClosureObjectPtr closure, int argCount);
+  UpvalueObjectPtr captureUpvalue(size_t slot);
+  void closeUpvalues(size_t lastSlot);
+
+  int64_t popInteger();
+  [[noreturn]] void runtimeError(const std::string& msg);
+};
@@ -0,0 +1,23 @@
+#include "vm_object.h"
+
+std::string CompiledFunction::toString() const {
+  if (functionType == FunctionType::TYPE_SCRIPT) {
+    return "<script>";
+  }
+  std::ostringstream ss;
+  ss << "<func " << name << "(#" << arity << ")>";
+  return ss.str();
+}
+
+Ref<CompiledFunction> CompiledFunction::make(
+    const std::string &name, FunctionType functionType) {
+  return makeRef<CompiledFunction>(name, functionType);
+}
+
+bool InstanceObject::isEqual(const Object &obj) const {
+  if (obj.Type != ObjectType::OBJ_INSTANCE) {
+    return false;
+  }
+  const auto &other = static_cast<const InstanceObject &>(obj);
+  return klass == other.klass;
+}
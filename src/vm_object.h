@@ -0,0 +1,144 @@
+#pragma once
+
+#include "chunk.h"
+#include "common.h"
+#include "function.h"
+#include "object.h"
+
+// Runtime objects of the bytecode engine. They mirror Function, ClassObject
+// and Record from the tree-walking evaluator, but carry compiled chunks
+// instead of AST declarations and environments.
+
+struct CompiledFunction : public Object {
+  std::string name;
+  int arity;
+  int upvalueCount;
+  FunctionType functionType;
+  Chunk chunk;
+
+  CompiledFunction(const std::string &name, FunctionType functionType)
+      : Object(ObjectType::OBJ_COMPILED_FUNCTION),
+        name(name),
+        arity(0),
+        upvalueCount(0),
+        functionType(functionType),
+        chunk() {}
+
+  std::string toString() const override;
+  bool isFalsey() const override { return true; }
+  bool isTruthy() const override { return false; }
+  bool isEqual(const Object &obj) const override { return this == &obj; }
+
+  static Ref<CompiledFunction> make(const std::string &name,
+                                    FunctionType functionType);
+};
+using CompiledFunctionPtr = Ref<CompiledFunction>;
+
+struct UpvalueObject : public Object {
+  // stack slot of the captured variable while it is still open.
+  size_t slot;
+  bool open;
+  ObjectPtr closed;
+  Ref<UpvalueObject> next;
+
+  UpvalueObject(size_t slot)
+      : Object(ObjectType::OBJ_UPVALUE),
+        slot(slot),
+        open(true),
+        closed(NULL_OBJECT_PTR),
+        next(nullptr) {}
+
+  std::string toString() const override { return "<upvalue>"; }
+  bool isEqual(const Object &obj) const override { return this == &obj; }
+
+  static Ref<UpvalueObject> make(size_t slot) {
+    return makeRef<UpvalueObject>(slot);
+  }
+};
+using UpvalueObjectPtr = Ref<UpvalueObject>;
+
+struct ClosureObject : public Object {
+  CompiledFunctionPtr function;
+  std::vector<UpvalueObjectPtr> upvalues;
+
+  ClosureObject(CompiledFunctionPtr function)
+      : Object(ObjectType::OBJ_CLOSURE),
+        function(function),
+        upvalues(function->upvalueCount) {}
+
+  std::string toString() const override { return function->toString(); }
+  bool isFalsey() const override { return true; }
+  bool isTruthy() const override { return false; }
+  bool isEqual(const Object &obj) const override { return this == &obj; }
+
+  static Ref<ClosureObject> make(CompiledFunctionPtr function) {
+    return makeRef<ClosureObject>(function);
+  }
+};
+using ClosureObjectPtr = Ref<ClosureObject>;
+
+struct CompiledClass : public Object {
+  std::string name;
+  std::unordered_map<std::string, ClosureObjectPtr> methods;
+  // runs field initializers followed by the __init__ body, if any.
+  ClosureObjectPtr initializer;
+
+  CompiledClass(const std::string &name)
+      : Object(ObjectType::OBJ_COMPILED_CLASS),
+        name(name),
+        methods(),
+        initializer(nullptr) {}
+
+  std::string toString() const override { return "<class " + name + ">"; }
+  bool isFalsey() const override { return false; }
+  bool isTruthy() const override { return true; }
+  bool isEqual(const Object &obj) const override { return this == &obj; }
+
+  static Ref<CompiledClass> make(const std::string &name) {
+    return makeRef<CompiledClass>(name);
+  }
+};
+using CompiledClassPtr = Ref<CompiledClass>;
+
+struct InstanceObject : public Object {
+  CompiledClassPtr klass;
+  std::unordered_map<std::string, ObjectPtr> fields;
+
+  InstanceObject(CompiledClassPtr klass)
+      : Object(ObjectType::OBJ_INSTANCE), klass(klass), fields() {}
+
+  std::string toString() const override {
+    return "<record " + klass->name + ">";
+  }
+  bool isFalsey() const override { return !isTruthy(); }
+  bool isTruthy() const override {
+    return !fields.empty() || !klass->methods.empty();
+  }
+  bool isEqual(const Object &obj) const override;
+
+  static Ref<InstanceObject> make(CompiledClassPtr klass) {
+    return makeRef<InstanceObject>(klass);
+  }
+};
+using InstanceObjectPtr = Ref<InstanceObject>;
+
+struct BoundMethodObject : public Object {
+  ObjectPtr receiver;
+  ClosureObjectPtr method;
+
+  BoundMethodObject(ObjectPtr receiver, ClosureObjectPtr method)
+      : Object(ObjectType::OBJ_BOUND_METHOD),
+        receiver(receiver),
+        method(method) {}
+
+  std::string toString() const override { return method->toString(); }
+  bool isFalsey() const override { return true; }
+  bool isTruthy() const override { return false; }
+  bool isEqual(const Object &obj) const override { return this == &obj; }
+
+  static Ref<BoundMethodObject> make(ObjectPtr receiver,
+                                     ClosureObjectPtr method) {
+    return makeRef<BoundMethodObject>(receiver, method);
+  }
+};
+using BoundMethodObjectPtr = Ref<BoundMethodObject>;
@@ -0,0 +1,129 @@
+#include "closure_compiler.h"
+
+#include <gtest/gtest.h>
+
+#include "ast.h"
+#include "astbuilder.h"
+#include "common.h"
+#include "compiler.h"
+#include "lexer.h"
+#include "parser.h"
+#include "token.h"
+
+using Parser::JSParser;
+using namespace std;
+
+class ClosureCompilerTest : public ::testing::Test {
+ protected:
+  ObjectPtr interpret(ClosureCompiler& compiler, const string& source) {
+    std::istringstream ss(source);
+    JSLexer lexer(&ss);
+    ASTBuilderImpl builder;
+    JSParser parser(builder, lexer);
+    parser.parse();
+    auto program = builder.getProgram();
+    EXPECT_NE(program, nullptr) << "TestCase: " << source;
+    return compiler.interpret(program);
+  }
+
+  void expectIntValue(string_view testCase, ObjectPtr actualValue,
+                      int64_t expectedValue) {
+    ASSERT_EQ(actualValue->Type, ObjectType::OBJ_INTEGER) << testCase;
+    auto actualIntValue = dynamic_pointer_cast<IntegerObject>(actualValue);
+    ASSERT_NE(actualIntValue, nullptr) << testCase;
+    EXPECT_EQ(actualIntValue->Value, expectedValue) << testCase;
+  }
+};
+
+TEST_F(ClosureCompilerTest, TestCompletionValues) {
+  struct TestCase {
+    string source;
+    string expectedValue;
+  };
+  vector<TestCase> testCases = {
+      TestCase{"true;", "true"},
+      TestCase{";", "nil"},
+      TestCase{"\"test\";", "test"},
+      TestCase{"-1;", "-1"},
+      TestCase{"!true;", "false"},
+      TestCase{"1 + 2 * 3 - 4 / 2;", "5"},
+      TestCase{"(1 < 2) and (2 <= 2);", "true"},
+      TestCase{"0 or \"\";", "false"},
+      TestCase{"var a = 10;", "10"},
+      TestCase{"if (true) {}", "nil"},
+      TestCase{"if (false) 1;", "false"},
+      TestCase{"var i = 0; while (i < 3) i = i + 1;", "false"},
+      TestCase{"for (var i = 0; i < 3; i = i + 1) { break; }", "nil"},
+      TestCase{"def f() { 1; 2; } f();", "2"},
+      TestCase{"[1, [2, 3]][1][0];", "2"}};
+
+  for (const auto& testCase : testCases) {
+    ClosureCompiler compiler;
+    const auto value = interpret(compiler, testCase.source);
+    ASSERT_NE(value, nullptr) << "TestCase: " << testCase.source;
+    EXPECT_EQ(testCase.expectedValue, value->toString())
+        << "TestCase: " << testCase.source;
+  }
+}
+
+TEST_F(ClosureCompilerTest, TestPrograms) {
+  struct TestCase {
+    string source;
+    unordered_map<string, int> expectedValues;
+  };
+  vector<TestCase> testCases = {
+      TestCase{"var a = 1; var b = a + 1; b = b * 3; c = b;", {{"c", 6}}},
+      TestCase{"var a = 1; if (true) { var a = 2; c = a; }",
+               {{"a", 1}, {"c", 2}}},
+      TestCase{"var a = 0; for (var i = 0; i < 10; i = i + 1) { if (i == 5) "
+               "break; if (i == 1) continue; a = a + i; }",
+               {{"a", 9}}},
+      TestCase{"def fib(n) { if (n < 2) return n; return fib(n - 1) + fib(n - "
+               "2); } var f = fib(15);",
+               {{"f", 610}}},
+      TestCase{"def makeCounter() { var i = 0; def count() { i = i + 1; return "
+               "i; } return count; } var counter = makeCounter(); counter(); "
+               "var c = counter();",
+               {{"c", 2}}},
+      TestCase{"class A { var c = 2; def __init__() { c = 3; } def method1(a, "
+               "b) { return c*(a + b); } } var a1 = A(); var b = "
+               "a1.method1(1,2);",
+               {{"b", 9}}},
+      TestCase{"class P { var x = 0; def __init__(v) { x = v; } def inc() { x "
+               "= x + 1; return x; } } var p = P(5); p.inc(); var x = p.inc();",
+               {{"x", 7}}}};
+
+  for (const auto& testCase : testCases) {
+    ClosureCompiler compiler;
+    interpret(compiler, testCase.source);
+    for (const auto& pair : testCase.expectedValues) {
+      expectIntValue(testCase.source, compiler.getGlobalValue(pair.first),
+                     pair.second);
+    }
+  }
+}
+
+TEST_F(ClosureCompilerTest, TestErrors) {
+  vector<string> runtimeErrors = {"1 / 0;", "1 + true;", "var a = 1; a();",
+                                  "[1, 2][2];", "def f(a) {} f();"};
+  for (const auto& testCase : runtimeErrors) {
+    ClosureCompiler compiler;
+    EXPECT_THROW(interpret(compiler, testCase), RuntimeError)
+        << "TestCase: " << testCase;
+  }
+
+  ClosureCompiler compiler;
+  EXPECT_THROW(interpret(compiler, "def f() { break; }"), CompileError);
+}
+
+TEST_F(ClosureCompilerTest, TestStackOverflow) {
+  const string depth =
+      "def depth(n) { if (n == 0) return 0; return depth(n - 1) + 1; } ";
+
+  // past the maximum call depth is an error, and the compiler recovers.
+  ClosureCompiler compiler;
+  EXPECT_THROW(interpret(compiler, depth + "var d = depth(20000);"),
+               RuntimeError);
+  interpret(compiler, "d = depth(10);");
+  expectIntValue("recovered", compiler.getGlobalValue("d"), 10);
+}
@@ -7,47 +7,56 @@
 class EnvironmentTest : public ::testing::Test {};
 
 TEST_F(EnvironmentTest, TestBasic) {
-  auto env = std::make_shared<Environment>();
-  EXPECT_EQ(*env->get("id1"), *NULL_OBJECT_PTR);
-  env->set("id1", TRUE_OBJECT_PTR);
-  EXPECT_EQ(*env->get("id1"), *TRUE_OBJECT_PTR);
+  auto env = Environment::make();
+  EXPECT_TRUE(env->get(0).isNil());
+  env->set(0, Value::boolean(true));
+  EXPECT_TRUE(env->get(0).asBoolean());
+  EXPECT_EQ(env->size(), 1);
 }
 
-TEST_F(EnvironmentTest, TestEnclosing) {
-  auto enclosingEnv = std::make_shared<Environment>();
-  auto innerEnv = std::make_shared<Environment>(enclosingEnv);
-
-  EXPECT_EQ(*innerEnv->get("id1"), *NULL_OBJECT_PTR);
-  innerEnv->set("id1", TRUE_OBJECT_PTR);
-  EXPECT_EQ(*innerEnv->get("id1"), *TRUE_OBJECT_PTR);
-
-  enclosingEnv->set("globalId", TRUE_OBJECT_PTR);
-  EXPECT_EQ(*innerEnv->get("globalId"), *TRUE_OBJECT_PTR);
-  innerEnv->set("globalId", FALSE_OBJECT_PTR);
-  EXPECT_EQ(*enclosingEnv->get("globalId"), *FALSE_OBJECT_PTR);
-  EXPECT_EQ(*innerEnv->get("globalId"), *FALSE_OBJECT_PTR);
+TEST_F(EnvironmentTest, TestGrow) {
+  auto env = Environment::make(nullptr, 2);
+  EXPECT_EQ(env->size(), 2);
+  EXPECT_TRUE(env->get(1).isNil());
+  env->set(4, Value::boolean(true));
+  EXPECT_EQ(env->size(), 5);
+  EXPECT_TRUE(env->get(3).isNil());
+  EXPECT_TRUE(env->get(4).asBoolean());
 }
 
-TEST_F(EnvironmentTest, TestShadowing) {
-  auto enclosingEnv = std::make_shared<Environment>();
-  auto innerEnv = std::make_shared<Environment>(enclosingEnv);
+TEST_F(EnvironmentTest, TestReset) {
+  // growing moves the slots allocated with the environment out of it.
+  auto env = Environment::make(nullptr, 1);
+  env->set(0, Value::integer(7));
+  env->set(3, Value::boolean(true));
+  EXPECT_EQ(env->get(0).asInteger(), 7);
+  EXPECT_EQ(env->size(), 4);
+  env->reset(nullptr, 2);
+  EXPECT_EQ(env->size(), 2);
+  EXPECT_TRUE(env->get(0).isNil());
+  EXPECT_TRUE(env->get(3).isNil());
+}
 
-  EXPECT_EQ(*innerEnv->get("id1"), *NULL_OBJECT_PTR);
-  innerEnv->set("id1", TRUE_OBJECT_PTR);
-  EXPECT_EQ(*innerEnv->get("id1"), *TRUE_OBJECT_PTR);
+TEST_F(EnvironmentTest, TestEnclosing) {
+  auto enclosingEnv = Environment::make();
+  auto innerEnv = Environment::make(enclosingEnv);
 
-  enclosingEnv->set("id1", FALSE_OBJECT_PTR);
-  EXPECT_EQ(*innerEnv->get("id1"), *TRUE_OBJECT_PTR);
-  EXPECT_EQ(*enclosingEnv->get("id1"), *FALSE_OBJECT_PTR);
+  EXPECT_EQ(innerEnv->ancestor(0), innerEnv.get());
+  EXPECT_EQ(innerEnv->ancestor(1), enclosingEnv.get());
+
+  enclosingEnv->set(0, Value::boolean(true));
+  EXPECT_TRUE(innerEnv->getAt(1, 0).asBoolean());
+  innerEnv->setAt(1, 0, Value::boolean(false));
+  EXPECT_FALSE(enclosingEnv->get(0).asBoolean());
+  EXPECT_FALSE(innerEnv->getAt(1, 0).asBoolean());
 }
 
-TEST_F(EnvironmentTest, TestDeclare) {
-  auto enclosingEnv = std::make_shared<Environment>();
-  enclosingEnv->set("id1", FALSE_OBJECT_PTR);
+TEST_F(EnvironmentTest, TestShadowing) {
+  auto enclosingEnv = Environment::make();
+  auto innerEnv = Environment::make(enclosingEnv);
 
-  auto innerEnv = std::make_shared<Environment>(enclosingEnv);
-  EXPECT_EQ(*innerEnv->get("id1"), *FALSE_OBJECT_PTR);
-  innerEnv->declare("id1", TRUE_OBJECT_PTR);
-  EXPECT_EQ(*innerEnv->get("id1"), *TRUE_OBJECT_PTR);
-  EXPECT_EQ(*enclosingEnv->get("id1"), *FALSE_OBJECT_PTR);
-}
\ No newline at end of file
+  innerEnv->set(0, Value::boolean(true));
+  enclosingEnv->set(0, Value::boolean(false));
+  EXPECT_TRUE(innerEnv->getAt(0, 0).asBoolean());
+  EXPECT_FALSE(innerEnv->getAt(1, 0).asBoolean());
+}
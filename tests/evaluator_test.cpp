@@ -1,12 +1,16 @@
 #include "evaluator.h"
 
 #include <gtest/gtest.h>
+#include <pthread.h>
 
 #include "ast.h"
 #include "astbuilder.h"
 #include "common.h"
 #include "lexer.h"
+#include "native_stack.h"
 #include "parser.h"
+#include "settings.h"
+#include "test_helpers.h"
 #include "token.h"
 
 using Parser::JSParser;
@@ -14,6 +18,10 @@ using namespace std;
 
 class EvaluatorTest : public ::testing::Test {
  protected:
+  // the nodes of the expected trees.
+  Arena arena;
+  Arena::Scope scope{arena};
+
   void expectIntValue(string_view testCase, ObjectPtr actualValue,
                       int64_t expectedValue) {
     ASSERT_EQ(actualValue->Type, ObjectType::OBJ_INTEGER) << testCase;
@@ -79,12 +87,12 @@ TEST_F(EvaluatorTest, TestUnaryExpression) {
     if (testCase.expectedIntValue.has_value()) {
       ASSERT_EQ(value->Type, ObjectType::OBJ_INTEGER)
           << "TestCase: " << testCase.source;
-      auto intValue = std::static_pointer_cast<IntegerObject>(value);
+      auto intValue = static_pointer_cast<IntegerObject>(value);
       EXPECT_EQ(intValue->Value, *testCase.expectedIntValue)
           << "TestCase: " << testCase.source;
     } else if (testCase.expectedBoolValue.has_value()) {
       ASSERT_EQ(value->Type, ObjectType::OBJ_BOOLEAN) << testCase.source;
-      auto boolValue = std::static_pointer_cast<BooleanObject>(value);
+      auto boolValue = static_pointer_cast<BooleanObject>(value);
       EXPECT_EQ(boolValue->Value, *testCase.expectedBoolValue)
           << "TestCase: " << testCase.source;
     }
@@ -135,13 +143,13 @@ TEST_F(EvaluatorTest, TestBinaryExpression) {
       if (testCase.expectedIntValue.has_value()) {
         ASSERT_EQ(value->Type, ObjectType::OBJ_INTEGER)
             << "TestCase: " << testCase.source;
-        auto intValue = std::static_pointer_cast<IntegerObject>(value);
+        auto intValue = static_pointer_cast<IntegerObject>(value);
         EXPECT_EQ(intValue->Value, *testCase.expectedIntValue)
             << "TestCase: " << testCase.source;
       } else if (testCase.expectedBoolValue.has_value()) {
         ASSERT_EQ(value->Type, ObjectType::OBJ_BOOLEAN)
             << "TestCase: " << testCase.source;
-        auto boolValue = std::static_pointer_cast<BooleanObject>(value);
+        auto boolValue = static_pointer_cast<BooleanObject>(value);
         EXPECT_EQ(boolValue->Value, *testCase.expectedBoolValue)
             << "TestCase: " << testCase.source;
       }
@@ -179,8 +187,7 @@ TEST_F(EvaluatorTest, TestVarDeclarationStmts) {
         auto actualValue = evaluator.getGlobalValue(it->first);
         ASSERT_EQ(actualValue->Type, ObjectType::OBJ_INTEGER)
             << "TestCase: " << testCase.source;
-        auto actualIntValue =
-            std::static_pointer_cast<IntegerObject>(actualValue);
+        auto actualIntValue = static_pointer_cast<IntegerObject>(actualValue);
         EXPECT_EQ(actualIntValue->Value, it->second)
             << "TestCase: " << testCase.source;
         it++;
@@ -410,7 +417,17 @@ TEST_F(EvaluatorTest, TestFunctionCallExpression) {
                {{"a", 2}, {"b", 3}}},
       TestCase{"def test(a,b) { while (a < b) { a = "
                "a + 1; if (a > 5) { return 90; }}} var a = test(1,10);",
-               {{"a", 90}}}};
+               {{"a", 90}}},
+      TestCase{"def fib(n) { if (n < 2) return n; return fib(n - 1) + fib(n - "
+               "2); } var a = fib(15);",
+               {{"a", 610}}},
+      TestCase{"def sum(n) { var s = n; if (n > 0) { s = s + sum(n - 1); } "
+               "return s; } var a = sum(10);",
+               {{"a", 55}}},
+      TestCase{"def counter(n) { def next() { n = n + 1; return n; } return "
+               "next; } var c1 = counter(0); var c2 = counter(10); c1(); var "
+               "a = c1(); var b = c2();",
+               {{"a", 2}, {"b", 11}}}};
 
   for (const auto& testCase : testCases) {
     std::istringstream ss(testCase.source);
@@ -433,6 +450,115 @@ TEST_F(EvaluatorTest, TestFunctionCallExpression) {
   }
 }
 
+TEST_F(EvaluatorTest, TestTailCalls) {
+  struct TestCase {
+    string source;
+    unordered_map<string, variant<int, bool>> expectedValues;
+  };
+  // deep enough to overflow the native stack without frame reuse.
+  vector<TestCase> testCases = {
+      TestCase{"def sum(n, acc) { if (n == 0) return acc; return sum(n - 1, "
+               "acc + 1); } var s = sum(300000, 0);",
+               {{"s", 300000}}},
+      TestCase{"def even(n) { if (n == 0) return true; return odd(n - 1); } "
+               "def odd(n) { if (n == 0) return false; return even(n - 1); } "
+               "var e = even(300001);",
+               {{"e", false}}},
+      TestCase{"class C { var k = 0; def count(n) { if (n == 0) return k; k = "
+               "k + 1; return count(n - 1); } } var c = C(); var k = "
+               "c.count(300000);",
+               {{"k", 300000}}},
+      TestCase{"def f(n) { return n + 1; } def g(n) { var a = f(n); return "
+               "f(a); } var r = g(1);",
+               {{"r", 3}}}};
+
+  for (const auto& testCase : testCases) {
+    std::istringstream ss(testCase.source);
+    JSLexer lexer(&ss);
+    ASTBuilderImpl builder;
+    JSParser parser(builder, lexer);
+    parser.parse();
+    auto program = builder.getProgram();
+    ASSERT_NE(program, nullptr);
+    Evaluator evaluator;
+    evaluator.eval(program);
+    for (const auto& pair : testCase.expectedValues) {
+      auto actualValue = evaluator.getGlobalValue(pair.first);
+      auto& expectedValue = pair.second;
+      if (std::holds_alternative<int>(expectedValue)) {
+        expectIntValue(testCase.source, actualValue,
+                       std::get<int>(expectedValue));
+      } else {
+        expectBoolValue(testCase.source, actualValue,
+                        std::get<bool>(expectedValue));
+      }
+    }
+  }
+}
+
+TEST_F(EvaluatorTest, TestStackOverflow) {
+  const string depth =
+      "def depth(n) { if (n == 0) return 0; return 1 + depth(n - 1); } ";
+
+  // runs on a thread whose own 256KB stack is far too small for 5000
+  // nested calls, so the calls can only fit on the Evaluator's stack.
+  Evaluator evaluator;
+  struct Task {
+    Evaluator* evaluator;
+    ProgramPtr program;
+  };
+  Task task{&evaluator, parse(depth + "var d = depth(5000);")};
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, 256 * 1024);
+  pthread_t thread;
+  ASSERT_EQ(pthread_create(
+                &thread, &attr,
+                [](void* arg) -> void* {
+                  auto task = static_cast<Task*>(arg);
+                  task->evaluator->eval(task->program);
+                  return nullptr;
+                },
+                &task),
+            0);
+  pthread_join(thread, nullptr);
+  pthread_attr_destroy(&attr);
+  expectIntValue("deep", evaluator.getGlobalValue("d"), 5000);
+
+  // past the maximum call depth is an error, and the evaluator recovers.
+  EXPECT_THROW(evaluator.eval(parse("d = depth(100000);")), RuntimeError);
+  evaluator.eval(parse("d = depth(10);"));
+  expectIntValue("recovered", evaluator.getGlobalValue("d"), 10);
+}
+
+TEST_F(EvaluatorTest, TestMaxCallDepth) {
+  // the native stack set aside per call must hold real calls all the way
+  // to the maximum call depth, so the depth limit is what stops them.
+  const auto maxCallDepth = Settings::getInstance()->getMaxCallDepth();
+  if (maxCallDepth * Evaluator::NATIVE_FRAME_SIZE >
+      NativeStack::getMaxSize()) {
+    GTEST_SKIP() << "native stacks are capped on this build";
+  }
+  // methods are never compiled, so every call is interpreted, and each
+  // one is nested in others.
+  const string source =
+      "def id(x) { return x; } class C { def m(n) { if (n == 0) { return 0; "
+      "} return id(id(m(n - 1)) + 1); } } var c = C(); ";
+  Evaluator evaluator;
+  evaluator.eval(
+      parse(source + "var d = c.m(" + to_string(maxCallDepth - 1) + ");"));
+  expectIntValue("deepest", evaluator.getGlobalValue("d"), maxCallDepth - 1);
+  try {
+    evaluator.eval(parse("d = c.m(" + to_string(maxCallDepth) + ");"));
+    FAIL() << "no stack overflow";
+  } catch (const RuntimeError& error) {
+    EXPECT_NE(string(error.what()).find(to_string(maxCallDepth) +
+                                        " nested calls"),
+              string::npos)
+        << error.what();
+  }
+}
+
 TEST_F(EvaluatorTest, TestBreakStatement) {
   struct TestCase {
     string source;
@@ -444,7 +570,10 @@ TEST_F(EvaluatorTest, TestBreakStatement) {
           {{"a", 5}}},
       TestCase{
           "var a = 1; while (a < 10) { if (a == 5) { break; } a = a + 1; }",
-          {{"a", 5}}}};
+          {{"a", 5}}},
+      TestCase{"def f(n) { var i = 0; while (true) { i = i + 1; if (i == n) { "
+               "break; } } return i; } var a = f(3); var b = f(4);",
+               {{"a", 3}, {"b", 4}}}};
 
   for (const auto& testCase : testCases) {
     std::istringstream ss(testCase.source);
@@ -465,6 +594,12 @@ TEST_F(EvaluatorTest, TestBreakStatement) {
       }
     }
   }
+
+  // a break outside of a loop is an error that leaves the evaluator usable.
+  Evaluator evaluator;
+  EXPECT_THROW(evaluator.eval(parse("def f() { break; } f();")), RuntimeError);
+  evaluator.eval(parse("var a = 1; while (true) { a = a + 1; break; }"));
+  expectIntValue("break", evaluator.getGlobalValue("a"), 2);
 }
 
 TEST_F(EvaluatorTest, TestContinueStatement) {
@@ -481,7 +616,11 @@ TEST_F(EvaluatorTest, TestContinueStatement) {
       TestCase{"ContinueWhileLoop",
                "var a = 1; var b = 0;while (a < 10) { if (a == 5) {b = 1; a = "
                "20;continue;}a = a + 1;}",
-               {{"a", 20}, {"b", 1}}}};
+               {{"a", 20}, {"b", 1}}},
+      TestCase{"ContinueInFunction",
+               "def f() { var s = 0; for (var i = 0; i < 5; i = i + 1) { if "
+               "(i == 2) { continue; } s = s + i; } return s; } var a = f();",
+               {{"a", 8}}}};
 
   for (const auto& testCase : testCases) {
     std::istringstream ss(testCase.source);
@@ -536,7 +675,7 @@ TEST_F(EvaluatorTest, TestArrayExpressions) {
         ASSERT_NE(arrayValue, nullptr);
         EXPECT_EQ(arrayValue->Values.size(), expectedArray.size());
         for (size_t i = 0; i < expectedArray.size(); ++i) {
-          expectIntValue(testCase.source, arrayValue->Values[i],
+          expectIntValue(testCase.source, arrayValue->Values[i].toObject(),
                          expectedArray[i]);
         }
       }
@@ -612,10 +751,72 @@ TEST_F(EvaluatorTest, TestClassObjectInstantiation) {
     ASSERT_NE(value, nullptr);
     auto recordValue = dynamic_pointer_cast<Record>(value);
     ASSERT_NE(recordValue, nullptr);
-    ASSERT_EQ(recordValue->classDecl->identifier, testCase.recordClassName);
+    ASSERT_EQ(recordValue->getDeclaration()->identifier,
+              testCase.recordClassName);
   }
 }
 
+TEST_F(EvaluatorTest, TestRecordShapes) {
+  std::istringstream ss(
+      "class P { var x = 1; var y = 2; def x() { return 3; } } var a = P(); "
+      "var b = P();");
+  JSLexer lexer(&ss);
+  ASTBuilderImpl builder;
+  JSParser parser(builder, lexer);
+  parser.parse();
+  auto program = builder.getProgram();
+  ASSERT_NE(program, nullptr);
+  Evaluator evaluator;
+  evaluator.eval(program);
+  auto a = dynamic_pointer_cast<Record>(evaluator.getGlobalValue("a"));
+  auto b = dynamic_pointer_cast<Record>(evaluator.getGlobalValue("b"));
+  ASSERT_NE(a, nullptr);
+  ASSERT_NE(b, nullptr);
+  // every record of a class shares one shape, fields live in its slots
+  // after self.
+  EXPECT_EQ(a->getShape(), b->getShape());
+  EXPECT_EQ(a->getShape()->findField("x"), -1);
+  EXPECT_EQ(a->getShape()->findMethod("x"), 0);
+  EXPECT_EQ(a->getShape()->findField("y"), 2);
+  expectIntValue("field", a->getField("y").toObject(), 2);
+  a->setField("y", Value::integer(5));
+  expectIntValue("field", a->getField("y").toObject(), 5);
+  expectIntValue("field", b->getField("y").toObject(), 2);
+  EXPECT_EQ(a->getField("z").type(), ObjectType::OBJ_NULL);
+}
+
+TEST_F(EvaluatorTest, TestClassMethodTable) {
+  std::istringstream ss(
+      "class P { var x = 1; def get() { return x; } def twice() { return "
+      "get() * 2; } def set(v) { x = v; } } var a = P(); var b = P(); "
+      "a.set(5); var f = a.get; var g = b.twice; b.set(7); var r = f() + g();");
+  JSLexer lexer(&ss);
+  ASTBuilderImpl builder;
+  JSParser parser(builder, lexer);
+  parser.parse();
+  auto program = builder.getProgram();
+  ASSERT_NE(program, nullptr);
+  Evaluator evaluator;
+  evaluator.eval(program);
+  // methods read as values stay bound to their record.
+  expectIntValue("bound", evaluator.getGlobalValue("r"), 19);
+  auto a = dynamic_pointer_cast<Record>(evaluator.getGlobalValue("a"));
+  auto b = dynamic_pointer_cast<Record>(evaluator.getGlobalValue("b"));
+  ASSERT_NE(a, nullptr);
+  ASSERT_NE(b, nullptr);
+  // both records read the class's own unbound method, and hold only self
+  // and the field.
+  const auto index = a->getShape()->findMethod("get");
+  EXPECT_EQ(index, 0);
+  EXPECT_EQ(a->getMethod(index), b->getMethod(index));
+  EXPECT_TRUE(a->getMethod(index)->isUnbound());
+  auto klass = dynamic_pointer_cast<ClassObject>(evaluator.getGlobalValue("P"));
+  ASSERT_NE(klass, nullptr);
+  EXPECT_EQ(klass->methods[index], a->getMethod(index));
+  EXPECT_EQ(a->size(), 2);
+  EXPECT_EQ(a->getShape()->size(), 2);
+}
+
 TEST_F(EvaluatorTest, TestMemberExpression) {
   struct TestCase {
     string name;
@@ -687,4 +888,92 @@ class A {                 \
       expectIntValue(testCase.source, value, pair.second);
     }
   }
-}
\ No newline at end of file
+}
+
+TEST_F(EvaluatorTest, TestBinaryExpressionFeedback) {
+  // the expression returned by the function declared by the first statement.
+  auto returnedExpr = [](const ProgramPtr& program) {
+    auto function = static_cast<FunctionDeclaration*>(program->statements[0]);
+    auto body = static_cast<Block*>(function->body);
+    auto returnStmt = static_cast<ReturnStatement*>(body->statements[0]);
+    return static_cast<BinaryExpr*>(returnStmt->expression);
+  };
+
+  auto program = parse("def f(a, b) { return a < b; } var r = f(1, 2);");
+  auto expr = returnedExpr(program);
+  EXPECT_EQ(expr->feedback, BinaryExpr::Feedback::UNINITIALIZED);
+  Evaluator evaluator;
+  evaluator.eval(program);
+  EXPECT_EQ(expr->feedback, BinaryExpr::Feedback::INTEGER);
+  expectBoolValue("integer", evaluator.getGlobalValue("r"), true);
+
+  // other operand types de-specialize the site and keep their semantics.
+  program = parse(
+      "def eq(a, b) { return a == b; } var r1 = eq(1, 1); var r2 = eq(\"a\", "
+      "\"a\"); var r3 = eq(1, 2); var r4 = eq(1, true);");
+  expr = returnedExpr(program);
+  evaluator.eval(program);
+  EXPECT_EQ(expr->feedback, BinaryExpr::Feedback::GENERIC);
+  expectBoolValue("r1", evaluator.getGlobalValue("r1"), true);
+  expectBoolValue("r2", evaluator.getGlobalValue("r2"), true);
+  expectBoolValue("r3", evaluator.getGlobalValue("r3"), false);
+  expectBoolValue("r4", evaluator.getGlobalValue("r4"), false);
+
+  // a zero divisor still raises on a specialized site.
+  program = parse(
+      "def div(a, b) { return a / b; } var q = div(4, 2); var z = div(1, 0);");
+  expr = returnedExpr(program);
+  EXPECT_THROW(evaluator.eval(program), RuntimeError);
+  EXPECT_EQ(expr->feedback, BinaryExpr::Feedback::INTEGER);
+  expectIntValue("q", evaluator.getGlobalValue("q"), 2);
+}
+
+TEST_F(EvaluatorTest, TestMemberExpressionCache) {
+  const string classes =
+      "class A { def m() { return 1; } def n() { return 10; } } "
+      "class B { def n() { return 20; } def m() { return 2; } } "
+      "class C { def m() { return 3; } } class D { def m() { return 4; } } "
+      "class E { def m() { return 5; } } "
+      "def get(r) { return r.m(); } ";
+  // the member expression of get, the last class declared.
+  auto memberExpr = [](const ProgramPtr& program) {
+    auto function = static_cast<FunctionDeclaration*>(program->statements[5]);
+    auto body = static_cast<Block*>(function->body);
+    auto returnStmt = static_cast<ReturnStatement*>(body->statements[0]);
+    auto call = static_cast<CallExpr*>(returnStmt->expression);
+    return static_cast<MemberExpr*>(call->left);
+  };
+
+  auto program = parse(classes +
+                       "var a = A(); var s = 0; for (var i = 0; i < 20; i = i "
+                       "+ 1) { s = s + get(a); }");
+  Evaluator evaluator;
+  evaluator.eval(program);
+  expectIntValue("monomorphic", evaluator.getGlobalValue("s"), 20);
+  auto expr = memberExpr(program);
+  ASSERT_EQ(expr->cache.size(), 1);
+  EXPECT_EQ(expr->cache[0].method, 0);
+  EXPECT_FALSE(expr->megamorphic);
+
+  // each shape caches its own method.
+  program = parse(classes +
+                  "var a = A(); var b = B(); var s = 0; for (var i = 0; i < "
+                  "10; i = i + 1) { s = s + get(a) + get(b); }");
+  Evaluator polymorphicEvaluator;
+  polymorphicEvaluator.eval(program);
+  expectIntValue("polymorphic", polymorphicEvaluator.getGlobalValue("s"), 30);
+  expr = memberExpr(program);
+  ASSERT_EQ(expr->cache.size(), 2);
+  EXPECT_EQ(expr->cache[1].method, 1);
+
+  // a fifth class makes the site megamorphic, lookups keep working.
+  program = parse(classes +
+                  "var s = get(A()) + get(B()) + get(C()) + get(D()) + "
+                  "get(E()) + get(A());");
+  Evaluator megamorphicEvaluator;
+  megamorphicEvaluator.eval(program);
+  expr = memberExpr(program);
+  EXPECT_TRUE(expr->megamorphic);
+  EXPECT_TRUE(expr->cache.empty());
+  expectIntValue("megamorphic", megamorphicEvaluator.getGlobalValue("s"), 16);
+}
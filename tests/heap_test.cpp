@@ -0,0 +1,211 @@
+#include "heap.h"
+
+#include <gtest/gtest.h>
+
+#include "ast.h"
+#include "common.h"
+#include "evaluator.h"
+#include "record.h"
+#include "scope_pool.h"
+#include "test_helpers.h"
+#include "token.h"
+
+using namespace std;
+
+class HeapTest : public ::testing::Test {
+ protected:
+  void expectIntValue(string_view testCase, ObjectPtr actualValue,
+                      int64_t expectedValue) {
+    ASSERT_EQ(actualValue->Type, ObjectType::OBJ_INTEGER) << testCase;
+    auto actualIntValue = dynamic_pointer_cast<IntegerObject>(actualValue);
+    ASSERT_NE(actualIntValue, nullptr) << testCase;
+    EXPECT_EQ(actualIntValue->Value, expectedValue) << testCase;
+  }
+};
+
+TEST_F(HeapTest, TestCyclesAreReclaimed) {
+  Evaluator evaluator;
+  evaluator.eval(
+      parse("class P { var x = 0; def get() { return x; } def set(v) { x = "
+            "v; } } var keep = P(); keep.set(5); for (var i = 0; i < 100; i "
+            "= i + 1) { var p = P(); p.set(i); }"));
+  // each dropped record and its scope refer to each other.
+  EXPECT_EQ(evaluator.collectGarbage(), 100);
+  EXPECT_EQ(evaluator.getHeap().size(), 2);
+  EXPECT_EQ(evaluator.collectGarbage(), 0);
+  evaluator.eval(parse("var k = keep.get();"));
+  expectIntValue("live record", evaluator.getGlobalValue("k"), 5);
+}
+
+TEST_F(HeapTest, TestClosures) {
+  Evaluator evaluator;
+  evaluator.eval(
+      parse("def make() { var n = 1; def inc() { n = n + 1; return n; } "
+            "return inc; } var f = make(); make(); make();"));
+  // the functions the two dropped frames hold.
+  EXPECT_EQ(evaluator.collectGarbage(), 2);
+  evaluator.eval(parse("var r = f();"));
+  expectIntValue("live closure", evaluator.getGlobalValue("r"), 2);
+}
+
+TEST_F(HeapTest, TestTemporariesAreRoots) {
+  // enough records to collect while some are only held by the evaluation.
+  Evaluator evaluator;
+  evaluator.eval(
+      parse("class P { var x = 1; def get() { return x; } } def twice(p) { "
+            "return p.get() + p.get(); } var s = 0; for (var i = 0; i < "
+            "40000; i = i + 1) { s = s + twice(P()) + twice(P()); }"));
+  expectIntValue("temporaries", evaluator.getGlobalValue("s"), 160000);
+  EXPECT_LT(evaluator.getHeap().size(), Heap::INITIAL_THRESHOLD * 2);
+}
+
+TEST_F(HeapTest, TestFullCollectionsMarkFromTemporaries) {
+  // the tree promotes enough closures to make a full collection due while
+  // the record is only held as an argument being evaluated.
+  Evaluator evaluator;
+  evaluator.eval(
+      parse("class P { var x = 7; def get() { return x; } } def node(l, r) { "
+            "def get() { return l; } return get; } def tree(d) { if (d == 0) "
+            "{ return null; } return node(tree(d - 1), tree(d - 1)); } def "
+            "pick(p, t) { return p.get(); } var r = pick(P(), tree(15));"));
+  expectIntValue("temporary", evaluator.getGlobalValue("r"), 7);
+}
+
+TEST_F(HeapTest, TestMinorCollections) {
+  Evaluator evaluator;
+  evaluator.eval(
+      parse("class P { var x = 0; def get() { return x; } def set(v) { x = "
+            "v; } } var keep = P(); keep.set(5);"));
+  evaluator.collectGarbage();
+  EXPECT_EQ(evaluator.getHeap().youngSize(), 0);
+  EXPECT_TRUE(evaluator.getGlobalValue("keep")->old);
+
+  // young cycles are reclaimed without tracing the old space, old ones are
+  // left to full collections.
+  evaluator.eval(
+      parse("keep = null; for (var i = 0; i < 100; i = i + 1) { var p = P(); "
+            "p.set(i); }"));
+  EXPECT_EQ(evaluator.getHeap().collectYoung(), 100);
+  EXPECT_EQ(evaluator.getHeap().youngSize(), 0);
+  EXPECT_EQ(evaluator.collectGarbage(), 1);
+}
+
+TEST_F(HeapTest, TestScopePoolBlocksAreReclaimed) {
+  Evaluator evaluator;
+  const auto blocks = ScopePool::blockCount();
+  // every iteration leaves a closure and its scope referring to each other,
+  // one of them kept alive, next to plain scopes and arrays.
+  evaluator.eval(
+      parse("var keep = null; for (var i = 0; i < 2000; i = i + 1) { var n "
+            "= [i]; def get() { return n[0]; } if (i == 1000) { var m = [n, "
+            "get]; keep = m[1]; } }"));
+  evaluator.getHeap().collectYoung();
+  // nothing that outlives its statement was put in the pool, so no
+  // survivor pins a block.
+  EXPECT_LE(ScopePool::blockCount(), std::max<size_t>(blocks, 1));
+  evaluator.eval(parse("var r = keep();"));
+  expectIntValue("live closure", evaluator.getGlobalValue("r"), 1000);
+}
+
+TEST_F(HeapTest, TestWriteBarrier) {
+  Evaluator evaluator;
+  evaluator.eval(parse("class P { var x = 1; } var keep = P();"));
+  evaluator.collectGarbage();
+
+  // the globals are old now, so what is stored into them is promoted, but
+  // not what that refers to.
+  evaluator.eval(parse("var a = [P()];"));
+  const auto array = evaluator.getGlobalValue("a");
+  EXPECT_TRUE(array->old);
+  EXPECT_FALSE(
+      static_pointer_cast<ArrayObject>(array)->Values[0].asObject()->old);
+  EXPECT_EQ(evaluator.getHeap().collectYoung(), 0);
+  const auto record =
+      static_pointer_cast<ArrayObject>(array)->Values[0].as<Record>();
+  EXPECT_EQ(record->getField("x").asInteger(), 1);
+
+  // so is what is stored into an old record.
+  const auto keep =
+      static_pointer_cast<Record>(evaluator.getGlobalValue("keep"));
+  keep->setField("x", ArrayObject::make({}));
+  EXPECT_TRUE(keep->getField("x").asObject()->old);
+}
+
+TEST_F(HeapTest, TestIncrementalSteps) {
+  Evaluator evaluator;
+  evaluator.eval(
+      parse("class P { var x = 0; def set(v) { x = v; } } for (var i = 0; i < "
+            "3000; i = i + 1) { var p = P(); p.set(i); }"));
+  // each step stays within its budget, so the candidates take several:
+  // a record and its slots are one node.
+  size_t reclaimed = 0;
+  size_t steps = 0;
+  while (evaluator.getHeap().youngSize() > 0) {
+    reclaimed += evaluator.getHeap().step();
+    steps++;
+  }
+  EXPECT_EQ(reclaimed, 3000);
+  EXPECT_GT(steps, 2);
+  EXPECT_EQ(evaluator.getHeap().size(), 1);
+}
+
+TEST_F(HeapTest, TestLiveCandidatesAreSettled) {
+  Evaluator evaluator;
+  auto& heap = evaluator.getHeap();
+  evaluator.eval(
+      parse("class P { var x = 0; def get() { return x; } def set(v) { x = "
+            "v; } } var keep = P(); keep.set(5);"));
+  heap.collectYoung();
+  EXPECT_GT(heap.candidateSize(), 0);
+  auto keep = evaluator.getGlobalValue("keep");
+  EXPECT_FALSE(keep->settled);
+
+  // a step over the old candidates proves the record live and drops it.
+  while (heap.candidateSize() > 0) {
+    heap.step();
+  }
+  EXPECT_TRUE(keep->settled);
+
+  // reading it drops a reference to it, so it is a candidate again until
+  // the steps around the reads prove it live once more.
+  evaluator.eval(
+      parse("var k = 0; for (var i = 0; i < 100; i = i + 1) { var p = P(); "
+            "p.set(keep.get()); k = k + 1; }"));
+  size_t reclaimed = 0;
+  while (heap.youngSize() > 0) {
+    reclaimed += heap.step();
+  }
+  EXPECT_EQ(reclaimed, 100);
+  EXPECT_TRUE(keep->settled);
+  EXPECT_EQ(heap.candidateSize(), 0);
+
+  // overwriting its last reference makes it a candidate again, which the
+  // next step reclaims.
+  const WeakRef<Object> weak = keep;
+  keep.reset();
+  evaluator.eval(parse("keep = null;"));
+  EXPECT_FALSE(weak.lock()->settled);
+  EXPECT_EQ(heap.step(), 1);
+  EXPECT_TRUE(weak.expired());
+}
+
+TEST_F(HeapTest, TestCapturedFramesAreCandidates) {
+  Evaluator evaluator;
+  auto& heap = evaluator.getHeap();
+  // the tree of bound methods piles up enough old candidates for a step to
+  // settle inc and the frame it captured while the call runs.
+  evaluator.eval(
+      parse("class P { def get() { return 1; } } var p = P(); def tree(d) { "
+            "if (d == 0) { return p.get; } return [tree(d - 1), tree(d - "
+            "1)]; } def outer() { var n = 1; def inc() { n = n + 1; return "
+            "n; } var t = tree(13); return 0; } outer();"));
+
+  // returning dropped the frame from the stack, which made it a candidate,
+  // so steps alone reclaim the cycle.
+  size_t reclaimed = 0;
+  while (heap.candidateSize() > 0 || heap.youngSize() > 0) {
+    reclaimed += heap.step();
+  }
+  EXPECT_EQ(reclaimed, 1);
+  EXPECT_LT(heap.size(), Heap::INITIAL_THRESHOLD);
+}
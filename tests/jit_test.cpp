@@ -0,0 +1,156 @@
+#include "jit.h"
+
+#include <gtest/gtest.h>
+
+#include "ast.h"
+#include "common.h"
+#include "evaluator.h"
+#include "test_helpers.h"
+#include "token.h"
+
+using namespace std;
+
+class JitTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+#ifndef CPPLOX_JIT_SUPPORTED
+    GTEST_SKIP() << "JIT not supported on this platform";
+#endif
+  }
+
+  // compiles the first statement of source, which must be a function.
+  JitCodePtr compile(const string& source) {
+    auto program = parse(source);
+    auto declaration =
+        dynamic_cast<FunctionDeclaration*>(program->statements[0]);
+    EXPECT_NE(declaration, nullptr) << "TestCase: " << source;
+    return JitCompiler::compile(declaration);
+  }
+};
+
+TEST_F(JitTest, TestCompiledFunctions) {
+  struct TestCase {
+    string source;
+    vector<int64_t> args;
+    int64_t expectedValue;
+  };
+  vector<TestCase> testCases = {
+      TestCase{"def f() { return 1 + 2 * 3 - 4 / 2; }", {}, 5},
+      TestCase{"def f(a, b) { return a - b; }", {7, 10}, -3},
+      TestCase{"def f(a) { return -a / 2; }", {7}, -3},
+      TestCase{"def f(a) { return a / -1; }", {INT64_MIN + 1}, INT64_MAX},
+      TestCase{"def f(a) { if ((a > 1) and !(a == 3)) return 1; return 0; }",
+               {2},
+               1},
+      TestCase{"def f(a) { if ((a > 1) or false) return 1; return 0; }",
+               {1},
+               0},
+      TestCase{"def fib(n) { if (n < 2) return n; return fib(n - 1) + fib(n - "
+               "2); }",
+               {20},
+               6765},
+      TestCase{"def fib(n) { var n1 = 0; var n2 = 1; var sum = 0; for (var i = "
+               "3; i <= n; i = i + 1) { sum = n1 + n2; n1 = n2; n2 = sum; } "
+               "return sum; }",
+               {12},
+               89},
+      TestCase{"def f(n) { var a = 0; for (var i = 0; i < n; i = i + 1) { if "
+               "(i == 5) break; if (i == 1) continue; a = a + i; } return a; }",
+               {10},
+               9},
+      TestCase{"def f(n) { var i = 0; while (true) { i = i + 1; if (i >= n) "
+               "return i; } }",
+               {4},
+               4},
+      TestCase{"def f(a) { if (true) { var a = 2; } return a; }", {1}, 1},
+      TestCase{"def f(a) { var b = a; if (true) { var b = 2; b = b + 1; } "
+               "return b; }",
+               {5},
+               5}};
+
+  for (const auto& testCase : testCases) {
+    auto code = compile(testCase.source);
+    ASSERT_NE(code, nullptr) << "TestCase: " << testCase.source;
+    int64_t result = 0;
+    ASSERT_TRUE(code->call(testCase.args.data(), result))
+        << "TestCase: " << testCase.source;
+    EXPECT_EQ(testCase.expectedValue, result)
+        << "TestCase: " << testCase.source;
+  }
+}
+
+TEST_F(JitTest, TestUnsupportedFunctions) {
+  vector<string> testCases = {
+      "def f() { print 1; return 1; }",
+      "def f() { return \"test\"; }",
+      "def f() { return g; }",
+      "def f() { return g(1); }",
+      "def f(a) { return f(); }",
+      "def f(f) { return f(1); }",
+      "def f() { var a; return 1; }",
+      "def f() { if (true) { var a = 1; } return a; }",
+      "def f(a) { var f = a; return f(1); }",
+      "def f() { def g() {} return 1; }",
+      "def f() { return [1][0]; }",
+      "def f() { return true; }",
+      "def f() { return 1 + true; }"};
+  for (const auto& testCase : testCases) {
+    EXPECT_EQ(compile(testCase), nullptr) << "TestCase: " << testCase;
+  }
+}
+
+TEST_F(JitTest, TestBailouts) {
+  struct TestCase {
+    string source;
+    vector<int64_t> args;
+  };
+  vector<TestCase> testCases = {
+      TestCase{"def f(a) { return 1 / a; }", {0}},
+      TestCase{"def f(a) { a = a + 1; }", {0}},
+      TestCase{"def f(n) { if (n == 0) return 0; return f(n - 1); }",
+               {JitCode::MAX_DEPTH + 1}}};
+  for (const auto& testCase : testCases) {
+    auto code = compile(testCase.source);
+    ASSERT_NE(code, nullptr) << "TestCase: " << testCase.source;
+    int64_t result = 0;
+    EXPECT_FALSE(code->call(testCase.args.data(), result))
+        << "TestCase: " << testCase.source;
+  }
+}
+
+TEST_F(JitTest, TestEvaluatorIntegration) {
+  struct TestCase {
+    string source;
+    unordered_map<string, int> expectedValues;
+  };
+  vector<TestCase> testCases = {
+      TestCase{"def sq(n) { return n * n; } var s = 0; for (var i = 0; i < 50; "
+               "i = i + 1) { s = s + sq(i); }",
+               {{"s", 40425}}},
+      TestCase{"def fib(n) { if (n < 2) return n; return fib(n - 1) + fib(n - "
+               "2); } var f = 0; for (var i = 0; i < 20; i = i + 1) { f = "
+               "fib(i); }",
+               {{"f", 4181}}},
+      TestCase{"var k = 0; def f(n) { var k = n; return k; } for (var i = 0; i "
+               "< 20; i = i + 1) { f(i); }",
+               {{"k", 0}}},
+      TestCase{"def f(n) { return n; } var b = f(true); for (var i = 0; i < "
+               "20; i = i + 1) { f(i); } if (f(true)) b = 1;",
+               {{"b", 1}}}};
+
+  for (const auto& testCase : testCases) {
+    Evaluator evaluator;
+    evaluator.eval(parse(testCase.source));
+    for (const auto& pair : testCase.expectedValues) {
+      auto value = evaluator.getGlobalValue(pair.first);
+      ASSERT_EQ(value->Type, ObjectType::OBJ_INTEGER) << testCase.source;
+      EXPECT_EQ(static_pointer_cast<IntegerObject>(value)->Value, pair.second)
+          << testCase.source;
+    }
+  }
+
+  Evaluator evaluator;
+  EXPECT_THROW(evaluator.eval(parse("def f(n) { return 1 / n; } for (var i = "
+                                    "20; i >= 0; i = i - 1) { f(i); }")),
+               RuntimeError);
+}
@@ -41,4 +41,41 @@ TEST_F(ObjectTest, StringObjectTest) {
   EXPECT_EQ(s1.Type, s2.Type);
   EXPECT_TRUE(s1.isTruthy());
   EXPECT_FALSE(s1.isFalsey());
-}
\ No newline at end of file
+}
+TEST_F(ObjectTest, ValueTest) {
+  EXPECT_TRUE(Value().isNil());
+  EXPECT_TRUE(Value::boolean(true).asBoolean());
+  EXPECT_TRUE(Value::boolean(false).isFalsey());
+  EXPECT_EQ(Value::integer(-5).asInteger(), -5);
+  EXPECT_TRUE(Value::integer(0).isFalsey());
+
+  // integers beyond 63 bits are boxed but behave the same.
+  auto big = Value::integer(INT64_MAX);
+  EXPECT_TRUE(big.isObject());
+  EXPECT_TRUE(big.isInteger());
+  EXPECT_EQ(big.asInteger(), INT64_MAX);
+  EXPECT_TRUE(big.isEqual(Value::integer(INT64_MAX)));
+
+  // immediates coming from objects are unboxed.
+  Value fromObject = IntegerObject::make(7);
+  EXPECT_FALSE(fromObject.isObject());
+  EXPECT_TRUE(fromObject.isEqual(Value::integer(7)));
+  EXPECT_TRUE(Value(NULL_OBJECT_PTR).isNil());
+
+  // heap objects stay alive while a Value refers to them.
+  WeakRef<StringObject> weak;
+  Value copy;
+  {
+    auto string = makeRef<StringObject>("a");
+    weak = string;
+    Value value = string;
+    copy = value;
+    // Refs and Values share one count.
+    EXPECT_EQ(string.use_count(), 3);
+  }
+  EXPECT_FALSE(weak.expired());
+  EXPECT_EQ(copy.toString(), "a");
+  EXPECT_EQ(copy.type(), ObjectType::OBJ_STRING);
+  copy = Value::nil();
+  EXPECT_TRUE(weak.expired());
+}
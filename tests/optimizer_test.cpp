@@ -0,0 +1,296 @@
+#include "optimizer.h"
+
+#include <gtest/gtest.h>
+
+#include "ast.h"
+#include "common.h"
+#include "evaluator.h"
+#include "test_helpers.h"
+#include "token.h"
+
+using namespace std;
+
+class OptimizerTest : public ::testing::Test {
+ protected:
+  // the nodes of the expected trees.
+  Arena arena;
+  Arena::Scope scope{arena};
+
+  ProgramPtr optimize(const string& source, int level = 1) {
+    auto program = parse(source);
+    Optimizer optimizer(level);
+    optimizer.optimize(program);
+    return program;
+  }
+};
+
+TEST_F(OptimizerTest, TestConstantFolding) {
+  struct TestCase {
+    string source;
+    string expectedSource;
+  };
+  vector<TestCase> testCases = {
+      TestCase{"60 * 60 * 24;", "86400;"},
+      TestCase{"var s = 10 - 2 * 3;", "var s = 4;"},
+      TestCase{"-(2 - 5);", "3;"},
+      TestCase{"(1 < 2) and !(3 == 4);", "true;"},
+      TestCase{"\"a\" == \"a\";", "true;"},
+      TestCase{"!null;", "true;"},
+      TestCase{"(x + 1) * 1;", "x + 1;"},
+      TestCase{"def f(a) { return 0 + -(-(a * 2)); }",
+               "def f(a) { return a * 2; }"},
+      // identities on operands of unknown type and divisions by zero are
+      // left for the runtime to check.
+      TestCase{"x * 1;", "x * 1;"},
+      TestCase{"1 / 0;", "1 / 0;"},
+      TestCase{"x / (2 - 2);", "x / 0;"},
+      TestCase{"1 + true;", "1 + true;"}};
+
+  for (const auto& testCase : testCases) {
+    auto program = optimize(testCase.source);
+    auto expectedProgram = parse(testCase.expectedSource);
+    EXPECT_TRUE(program->isEqual(*expectedProgram))
+        << testCase.source << ": " << program->toString()
+        << " != " << expectedProgram->toString();
+  }
+}
+
+TEST_F(OptimizerTest, TestLevelZero) {
+  auto program = optimize("60 * 60;", 0);
+  EXPECT_TRUE(program->isEqual(*parse("60 * 60;")));
+}
+
+TEST_F(OptimizerTest, TestEvaluation) {
+  Evaluator evaluator;
+  evaluator.eval(optimize(
+      "var s = 0; for (var i = 0; i < 10; i = i + 1) { s = s + 60 * 2 - i * "
+      "1; }"));
+  auto value = evaluator.getGlobalValue("s");
+  ASSERT_EQ(value->Type, ObjectType::OBJ_INTEGER);
+  EXPECT_EQ(static_pointer_cast<IntegerObject>(value)->Value, 1155);
+
+  Evaluator divisionEvaluator;
+  EXPECT_THROW(divisionEvaluator.eval(optimize("var d = 1 / (3 - 3);")),
+               RuntimeError);
+}
+
+TEST_F(OptimizerTest, TestDeadCodeElimination) {
+  struct TestCase {
+    string source;
+    string expectedSource;
+  };
+  vector<TestCase> testCases = {
+      TestCase{"def f(a) { return a; print a; a = 2; }",
+               "def f(a) { return a; }"},
+      TestCase{"while (true) { break; print 1; }", "while (true) { break; }"},
+      TestCase{"def f(a) { if (a) { return 1; } else { return 2; } print a; }",
+               "def f(a) { if (a) { return 1; } else { return 2; } }"},
+      TestCase{"if (false) { print 1; } print 2;", "print 2;"},
+      TestCase{"while (false) { print 1; } print 2;", "print 2;"},
+      TestCase{"for (var i = 0; false; i = i + 1) { print i; } print 2;",
+               "print 2;"},
+      TestCase{"x; 1; \"a\"; !(x == y); print 2;", "print 2;"},
+      // statements that may fail or act are kept, and so is the last one
+      // for its value.
+      TestCase{"x + 1; f(); print 2; x;", "x + 1; f(); print 2; x;"},
+      TestCase{"def f(a) { a; }", "def f(a) { a; }"}};
+
+  for (const auto& testCase : testCases) {
+    auto program = optimize(testCase.source);
+    auto expectedProgram = parse(testCase.expectedSource);
+    EXPECT_TRUE(program->isEqual(*expectedProgram))
+        << testCase.source << ": " << program->toString()
+        << " != " << expectedProgram->toString();
+  }
+
+  // a constant condition leaves the block of the branch taken.
+  auto program = optimize("if (1 < 2) { print 1; } else { print 2; }");
+  ASSERT_EQ(program->statements.size(), 1);
+  EXPECT_TRUE(program->statements[0]->isEqual(*Block::make(
+      vector<StatementPtr>{PrintStatement::make(IntegerLiteral::make(1))})))
+      << program->toString();
+  program = optimize("if (false) { print 1; } else { print 2; }");
+  ASSERT_EQ(program->statements.size(), 1);
+  EXPECT_TRUE(program->statements[0]->isEqual(*Block::make(
+      vector<StatementPtr>{PrintStatement::make(IntegerLiteral::make(2))})))
+      << program->toString();
+}
+
+TEST_F(OptimizerTest, TestInlining) {
+  struct TestCase {
+    string source;
+    string expectedSource;
+  };
+  vector<TestCase> testCases = {
+      TestCase{"def add(a, b) { return a + b; } print add(x, 1);",
+               "def add(a, b) { return a + b; } print x + 1;"},
+      TestCase{"def sq(n) { return n * n; } print sq(x) + sq(3);",
+               "def sq(n) { return n * n; } print x * x + 9;"},
+      TestCase{"def inc(n) { return n + 1; } print inc(x * 2);",
+               "def inc(n) { return n + 1; } print x * 2 + 1;"},
+      TestCase{"def inc(n) { return n + 1; } def f(x) { return inc(x); }",
+               "def inc(n) { return n + 1; } def f(x) { return x + 1; }"},
+      // calls before the declaration, shadowed or rebound callees, large or
+      // non-trivial bodies and arguments that would be evaluated a different
+      // number of times are left alone.
+      TestCase{"print inc(1); def inc(n) { return n + 1; }",
+               "print inc(1); def inc(n) { return n + 1; }"},
+      TestCase{"def inc(n) { return n + 1; } def f(inc) { return inc(1); }",
+               "def inc(n) { return n + 1; } def f(inc) { return inc(1); }"},
+      TestCase{"def inc(n) { return n + 1; } print inc(1); inc = 2;",
+               "def inc(n) { return n + 1; } print inc(1); inc = 2;"},
+      TestCase{"def g(n) { return n + y; } print g(1);",
+               "def g(n) { return n + y; } print g(1);"},
+      TestCase{"def g(n) { print n; return n; } print g(1);",
+               "def g(n) { print n; return n; } print g(1);"},
+      TestCase{"def f(n) { return f(n - 1); } print f(1);",
+               "def f(n) { return f(n - 1); } print f(1);"},
+      TestCase{"def sq(n) { return n * n; } print sq(x + 1);",
+               "def sq(n) { return n * n; } print sq(x + 1);"},
+      TestCase{"def first(a, b) { return a; } print first(1, g());",
+               "def first(a, b) { return a; } print first(1, g());"},
+      TestCase{"def f(a) { return a + a + a + a + a + a + a + a + a; } f(1);",
+               "def f(a) { return a + a + a + a + a + a + a + a + a; } f(1);"},
+      // arguments that may raise are only inlined where they would still
+      // be evaluated left to right and before the body.
+      TestCase{"def add(a, b) { return a + b; } print add(x * 2, y * 3);",
+               "def add(a, b) { return a + b; } print x * 2 + y * 3;"},
+      TestCase{"def sub(a, b) { return b - a; } print sub(x * 2, y * 3);",
+               "def sub(a, b) { return b - a; } print sub(x * 2, y * 3);"},
+      TestCase{"def g(a, b) { return -b + a; } print g(x * 2, y);",
+               "def g(a, b) { return -b + a; } print g(x * 2, y);"}};
+
+  for (const auto& testCase : testCases) {
+    auto program = optimize(testCase.source);
+    auto expectedProgram = parse(testCase.expectedSource);
+    EXPECT_TRUE(program->isEqual(*expectedProgram))
+        << testCase.source << ": " << program->toString()
+        << " != " << expectedProgram->toString();
+  }
+
+  auto program = parse("def add(a, b) { return a + b; } print add(x, 1);");
+  Optimizer optimizer(1, false);
+  optimizer.optimize(program);
+  EXPECT_TRUE(program->isEqual(
+      *parse("def add(a, b) { return a + b; } print add(x, 1);")));
+
+  // with two erroring arguments, the first one raises either way.
+  const string source =
+      "var z = 0; var s = \"s\"; def sub(a, b) { return b - a; } var d = "
+      "sub(1 / z, s - 1);";
+  auto errorOf = [&](bool inlining) {
+    auto program = parse(source);
+    Optimizer optimizer(1, inlining);
+    optimizer.optimize(program);
+    Evaluator evaluator;
+    try {
+      evaluator.eval(program);
+    } catch (const RuntimeError& error) {
+      return string(error.what());
+    }
+    return string();
+  };
+  EXPECT_NE(errorOf(false), "");
+  EXPECT_EQ(errorOf(true), errorOf(false));
+}
+
+TEST_F(OptimizerTest, TestLoopInvariantCodeMotion) {
+  auto program = optimize(
+      "var n = 5; var s = 0; for (var i = 0; i < (n * 2 - 1); i = i + 1) { "
+      "s = s + i; }");
+  ASSERT_EQ(program->statements.size(), 3);
+  ASSERT_EQ(program->statements[2]->Type, NodeType::BLOCK_STATEMENT);
+  auto block = static_cast<Block*>(program->statements[2]);
+  ASSERT_EQ(block->statements.size(), 2);
+  auto hoisted = dynamic_cast<VarDeclaration*>(block->statements[0]);
+  ASSERT_NE(hoisted, nullptr);
+  EXPECT_TRUE(hoisted->initializer->isEqual(*BinaryExpr::make(
+      BinaryExpr::make(VariableExpr::make("n"),
+                       Token::make(TokenType::TOKEN_STAR),
+                       IntegerLiteral::make(2)),
+      Token::make(TokenType::TOKEN_MINUS), IntegerLiteral::make(1))))
+      << hoisted->toString();
+  auto loop = dynamic_cast<ForStatement*>(block->statements[1]);
+  ASSERT_NE(loop, nullptr);
+  EXPECT_TRUE(loop->condition->isEqual(
+      *BinaryExpr::make(VariableExpr::make("i"),
+                        Token::make(TokenType::TOKEN_LESS),
+                        VariableExpr::make(hoisted->identifier))));
+
+  // conditions over variables the loop or its initializer writes, loops
+  // that call anything and initializers that may raise are left alone.
+  vector<string> testCases = {
+      "while (i < (n * 2)) { n = n - 1; }",
+      "while (i < (n * 2)) { var n = 1; i = i + 1; }",
+      "while (i < (n * 2)) { i = f(i); }",
+      "while (g(n * 2)) { i = i + 1; }",
+      "for (n = 3; i < (n * 2); i = i + 1) { s = s + i; }",
+      "for (var i = n - 1; i < (m * 2); i = i + 1) { s = s + i; }"};
+  for (const auto& testCase : testCases) {
+    auto program = optimize(testCase);
+    EXPECT_TRUE(program->isEqual(*parse(testCase))) << testCase;
+  }
+
+  Evaluator evaluator;
+  evaluator.eval(optimize(
+      "var n = 5; var s = 0; for (var i = 0; i < (n * 2 - 1); i = i + 1) { "
+      "s = s + i; } var k = 0; while (k < (n + 1)) { k = k + 2; } var j = "
+      "0; for (n = 3; j < (n * 2); j = j + 1) { s = s + 1; }"));
+  auto s = evaluator.getGlobalValue("s");
+  ASSERT_EQ(s->Type, ObjectType::OBJ_INTEGER);
+  EXPECT_EQ(static_pointer_cast<IntegerObject>(s)->Value, 42);
+  auto k = evaluator.getGlobalValue("k");
+  ASSERT_EQ(k->Type, ObjectType::OBJ_INTEGER);
+  EXPECT_EQ(static_pointer_cast<IntegerObject>(k)->Value, 6);
+}
+
+TEST_F(OptimizerTest, TestSuperinstructions) {
+  auto program = optimize(
+      "var a = [1, 2, 3]; var s = 0; def get(i) { return a[i]; } for (var i "
+      "= 0; i < 3; i = i + 1) { s = s + get(i); } s = 2 + s; s = s - 1; "
+      "def id(x) { return x; }");
+  auto loop = static_cast<ForStatement*>(program->statements[3]);
+  auto condition = static_cast<BinaryExpr*>(loop->condition);
+  EXPECT_EQ(condition->leftOperand, Operand::VARIABLE);
+  EXPECT_EQ(condition->rightOperand, Operand::CONSTANT);
+  auto increment = static_cast<Assignment*>(loop->increment);
+  EXPECT_TRUE(increment->increment);
+  EXPECT_EQ(increment->step, 1);
+  // s = s + get(i) adds a call, not a constant.
+  auto body = static_cast<Block*>(loop->body);
+  auto sum = static_cast<Assignment*>(
+      static_cast<ExpressionStatement*>(body->statements[0])
+          ->expression);
+  EXPECT_FALSE(sum->increment);
+
+  auto get = static_cast<FunctionDeclaration*>(program->statements[2]);
+  auto getReturn = static_cast<ReturnStatement*>(
+      static_cast<Block*>(get->body)->statements[0]);
+  auto subscript = static_cast<ArraySubscriptExpr*>(getReturn->expression);
+  EXPECT_EQ(subscript->arrayOperand, Operand::VARIABLE);
+  EXPECT_EQ(subscript->indexOperand, Operand::VARIABLE);
+  auto id = static_cast<FunctionDeclaration*>(program->statements[6]);
+  auto idReturn = static_cast<ReturnStatement*>(
+      static_cast<Block*>(id->body)->statements[0]);
+  EXPECT_EQ(idReturn->operand, Operand::VARIABLE);
+
+  // s = 2 + s and s = s - 1.
+  vector<int64_t> expectedSteps = {2, -1};
+  for (size_t i = 0; i < expectedSteps.size(); i++) {
+    auto stmt = static_cast<ExpressionStatement*>(program->statements[4 + i]);
+    auto assignment = static_cast<Assignment*>(stmt->expression);
+    EXPECT_TRUE(assignment->increment);
+    EXPECT_EQ(assignment->step, expectedSteps[i]);
+  }
+
+  Evaluator evaluator;
+  evaluator.eval(program);
+  auto s = evaluator.getGlobalValue("s");
+  ASSERT_EQ(s->Type, ObjectType::OBJ_INTEGER);
+  EXPECT_EQ(static_pointer_cast<IntegerObject>(s)->Value, 7);
+
+  // an increment of something other than an integer takes the full path.
+  Evaluator stringEvaluator;
+  EXPECT_THROW(stringEvaluator.eval(optimize("var t = \"a\"; t = t + 1;")),
+               RuntimeError);
+}
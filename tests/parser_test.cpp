@@ -20,6 +20,10 @@ struct ParserTestData {
 
 class ParserTest : public ::testing::Test {
  protected:
+  // the nodes of the expected trees.
+  Arena arena;
+  Arena::Scope scope{arena};
+
   void assertTestCases(const std::vector<ParserTestData> &testCases) {
     for (const auto &testCase : testCases) {
       std::ostringstream os;
@@ -582,4 +586,67 @@ TEST_F(ParserTest, MemberExpressionAssertions) {
                                                  IntegerLiteral::make(2)}))}))};
 
   assertTestCases(testCases);
-}
\ No newline at end of file
+}
+
+TEST_F(ParserTest, LiteralConstantPool) {
+  std::istringstream is("\"a\"; \"a\"; \"b\"; 1; 1;\n");
+  JSLexer lexer(&is);
+  ASTBuilderImpl builder;
+  JSParser parser(builder, lexer);
+  parser.parse();
+  auto program = builder.getProgram();
+  ASSERT_NE(program, nullptr);
+  ASSERT_EQ(program->statements.size(), 5);
+
+  auto literalOf = [&](size_t i) {
+    auto stmt = static_cast<ExpressionStatement*>(program->statements[i]);
+    return stmt->expression;
+  };
+  auto a1 = static_cast<StringLiteral*>(literalOf(0));
+  auto a2 = static_cast<StringLiteral*>(literalOf(1));
+  auto b = static_cast<StringLiteral*>(literalOf(2));
+  EXPECT_EQ(a1->constant.asObject(), a2->constant.asObject());
+  EXPECT_NE(a1->constant.asObject(), b->constant.asObject());
+  EXPECT_EQ(a1->constant.toString(), "a");
+  auto one = static_cast<IntegerLiteral*>(literalOf(3));
+  EXPECT_EQ(one->constant.asInteger(), 1);
+  EXPECT_EQ(program->constants.size(), 3);
+}
+
+TEST_F(ParserTest, NodesLiveInTheirProgram) {
+  // nodes are owned by the arena of the program they were parsed into,
+  // not by their parents, and are freed with it in one go.
+  std::istringstream is("def test(arg1, arg2) { return arg2; } var a = 1;");
+  JSLexer lexer(&is);
+  ASTBuilderImpl builder;
+  JSParser parser(builder, lexer);
+  parser.parse();
+  auto program = builder.getProgram();
+  ASSERT_NE(program, nullptr);
+  auto declaration = dynamic_cast<FunctionDeclaration*>(program->statements[0]);
+  ASSERT_NE(declaration, nullptr);
+  EXPECT_TRUE(declaration->isEqual(*FunctionDeclaration::make(
+      "test", {"arg1", "arg2"},
+      Block::make(std::vector<StatementPtr>{
+          ReturnStatement::make(VariableExpr::make("arg2"))}))));
+  EXPECT_NE(&program->getArena(), &arena);
+}
+
+TEST(ArenaTest, DestroysInReverseOrder) {
+  std::vector<int> destroyed;
+  struct Tracked {
+    std::vector<int>& destroyed;
+    int id;
+    Tracked(std::vector<int>& destroyed, int id)
+        : destroyed(destroyed), id(id) {}
+    ~Tracked() { destroyed.push_back(id); }
+  };
+  {
+    Arena arena;
+    for (int i = 0; i < 3; i++) {
+      arena.make<Tracked>(destroyed, i);
+    }
+    EXPECT_TRUE(destroyed.empty());
+  }
+  EXPECT_EQ(destroyed, (std::vector<int>{2, 1, 0}));
+}
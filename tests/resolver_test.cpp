@@ -0,0 +1,138 @@
+#include "resolver.h"
+
+#include <gtest/gtest.h>
+
+#include "ast.h"
+#include "common.h"
+#include "evaluator.h"
+#include "test_helpers.h"
+#include "token.h"
+
+using namespace std;
+
+class ResolverTest : public ::testing::Test {
+ protected:
+  // address of the expression of the last statement of block.
+  LexicalAddress lastAddress(const BlockPtr& block) {
+    auto exprStmt =
+        dynamic_cast<ExpressionStatement*>(block->statements.back());
+    EXPECT_NE(exprStmt, nullptr);
+    auto varExpr = dynamic_cast<VariableExpr*>(exprStmt->expression);
+    EXPECT_NE(varExpr, nullptr);
+    return varExpr->address;
+  }
+
+  void expectAddress(const string& testCase, const LexicalAddress& address,
+                     int depth, int slot) {
+    EXPECT_EQ(address.depth, depth) << testCase;
+    EXPECT_EQ(address.slot, slot) << testCase;
+  }
+};
+
+TEST_F(ResolverTest, TestAddresses) {
+  Resolver resolver;
+  const string source =
+      "var a = 1; var b = 2; def f(x, y) { var z = x; y; if (true) { var y "
+      "= 3; y; } z; a; c; } var a = 4;";
+  auto program = parse(source);
+  resolver.resolve(program);
+
+  auto secondA = static_cast<VarDeclaration*>(program->statements[3]);
+  expectAddress(source, secondA->address, LexicalAddress::GLOBAL_DEPTH, 0);
+
+  auto function = static_cast<FunctionDeclaration*>(program->statements[2]);
+  expectAddress(source, function->address, LexicalAddress::GLOBAL_DEPTH, 2);
+  // the body's block shares the call frame with the params.
+  EXPECT_EQ(function->scopeSize, 3);
+  auto body = static_cast<Block*>(function->body);
+
+  auto z = static_cast<VarDeclaration*>(body->statements[0]);
+  expectAddress(source, z->address, 0, 2);
+  auto x = static_cast<VariableExpr*>(z->initializer);
+  expectAddress(source, x->address, 0, 0);
+  auto y = static_cast<ExpressionStatement*>(body->statements[1]);
+  expectAddress(source,
+                static_cast<VariableExpr*>(y->expression)->address, 0,
+                1);
+
+  auto ifStmt = static_cast<IfStatement*>(body->statements[2]);
+  auto inner = static_cast<Block*>(ifStmt->thenBranch);
+  EXPECT_EQ(inner->scopeSize, 1);
+  expectAddress(source, lastAddress(inner), 0, 0);
+
+  auto a = static_cast<ExpressionStatement*>(body->statements[4]);
+  expectAddress(source,
+                static_cast<VariableExpr*>(a->expression)->address,
+                LexicalAddress::GLOBAL_DEPTH, 0);
+  expectAddress(source, lastAddress(body), LexicalAddress::GLOBAL_DEPTH, 3);
+
+  EXPECT_EQ(resolver.findGlobal("c"), 3);
+  EXPECT_EQ(resolver.findGlobal("missing"), -1);
+}
+
+TEST_F(ResolverTest, TestGlobalsPersist) {
+  Resolver resolver;
+  resolver.resolve(parse("var a = 1;"));
+  auto program = parse("var b = a;");
+  resolver.resolve(program);
+  auto b = static_cast<VarDeclaration*>(program->statements[0]);
+  expectAddress("globals", b->address, LexicalAddress::GLOBAL_DEPTH, 1);
+  expectAddress("globals",
+                static_cast<VariableExpr*>(b->initializer)->address,
+                LexicalAddress::GLOBAL_DEPTH, 0);
+  EXPECT_EQ(resolver.getGlobalCount(), 2);
+}
+
+TEST_F(ResolverTest, TestMethodsAreNoSlots) {
+  Resolver resolver;
+  const string source =
+      "class P { var x = 1; def get() { return x; } def twice() { var n = "
+      "0; return n + get(); } def set(v) { x = v; } }";
+  auto program = parse(source);
+  resolver.resolve(program);
+
+  auto klass = static_cast<ClassDeclaration*>(program->statements[0]);
+  expectAddress(source, klass->fields[0]->address, 0, 1);
+  EXPECT_EQ(klass->shape->size(), 2);
+  // a method read in another is the record's self, one scope out.
+  auto twice = static_cast<Block*>(klass->methods[1]->body);
+  auto returnStmt = static_cast<ReturnStatement*>(twice->statements[1]);
+  auto sum = static_cast<BinaryExpr*>(returnStmt->expression);
+  auto local = static_cast<VariableExpr*>(sum->left);
+  expectAddress(source, local->address, 0, 0);
+  EXPECT_EQ(local->method, -1);
+  auto call = static_cast<CallExpr*>(sum->right);
+  auto get = static_cast<VariableExpr*>(call->left);
+  expectAddress(source, get->address, 1, Resolver::SELF_SLOT);
+  EXPECT_EQ(get->method, 0);
+}
+
+TEST_F(ResolverTest, TestLexicalScoping) {
+  struct TestCase {
+    string source;
+    string identifier;
+    int expectedValue;
+  };
+  vector<TestCase> testCases = {
+      TestCase{"var a = 1; if (true) { var a = 2; }", "a", 1},
+      TestCase{"var a = 1; if (true) { a = 2; }", "a", 2},
+      TestCase{"var a = 1; def f() { var a = 2; return a; } var b = f();", "b",
+               2},
+      TestCase{"var a = 1; def f() { var a = 2; return a; } f();", "a", 1},
+      TestCase{"var a = 1; def f() { return a; } a = 3; var b = f();", "b", 3},
+      TestCase{"def make() { var n = 0; def next() { n = n + 1; return n; } "
+               "return next; } var g = make(); g(); var b = g();",
+               "b", 2},
+      TestCase{"var s = 0; for (var i = 0; i < 4; i = i + 1) { var s = i; }",
+               "s", 0}};
+
+  for (const auto& testCase : testCases) {
+    Evaluator evaluator;
+    evaluator.eval(parse(testCase.source));
+    auto value = evaluator.getGlobalValue(testCase.identifier);
+    ASSERT_EQ(value->Type, ObjectType::OBJ_INTEGER) << testCase.source;
+    EXPECT_EQ(static_pointer_cast<IntegerObject>(value)->Value,
+              testCase.expectedValue)
+        << testCase.source;
+  }
+}
@@ -0,0 +1,37 @@
+#include "symbol.h"
+
+#include <gtest/gtest.h>
+
+#include "common.h"
+
+using namespace std;
+
+class SymbolTest : public ::testing::Test {};
+
+TEST_F(SymbolTest, TestInterning) {
+  const Symbol a("counter");
+  const Symbol b(string("counter"));
+  const Symbol c("count");
+  EXPECT_EQ(a, b);
+  EXPECT_EQ(a.getId(), b.getId());
+  EXPECT_NE(a, c);
+  EXPECT_EQ(&a.str(), &b.str());
+  EXPECT_EQ(a.str(), "counter");
+  EXPECT_EQ(c.str(), "count");
+}
+
+TEST_F(SymbolTest, TestEmptySymbol) {
+  EXPECT_TRUE(Symbol().empty());
+  EXPECT_EQ(Symbol(), Symbol(""));
+  EXPECT_EQ(Symbol().str(), "");
+  EXPECT_FALSE(Symbol("x").empty());
+}
+
+TEST_F(SymbolTest, TestHashing) {
+  unordered_map<Symbol, int> slots;
+  slots[Symbol("a")] = 1;
+  slots[string("b")] = 2;
+  EXPECT_EQ(slots.at("a"), 1);
+  EXPECT_EQ(slots.at(Symbol(string("b"))), 2);
+  EXPECT_EQ(slots.count("c"), 0);
+}
@@ -0,0 +1,24 @@
+#ifndef __cpplox_test_helpers_h
+#define __cpplox_test_helpers_h
+
+#include <gtest/gtest.h>
+
+#include "ast.h"
+#include "astbuilder.h"
+#include "common.h"
+#include "lexer.h"
+#include "parser.h"
+
+// parses source, failing the calling test when it is not a program.
+inline ProgramPtr parse(const std::string& source) {
+  std::istringstream ss(source);
+  JSLexer lexer(&ss);
+  ASTBuilderImpl builder;
+  Parser::JSParser parser(builder, lexer);
+  parser.parse();
+  auto program = builder.getProgram();
+  EXPECT_NE(program, nullptr) << "TestCase: " << source;
+  return program;
+}
+
+#endif  // __cpplox_test_helpers_h
@@ -0,0 +1,98 @@
+#include "trace.h"
+
+#include <gtest/gtest.h>
+
+#include "ast.h"
+#include "common.h"
+#include "evaluator.h"
+#include "test_helpers.h"
+#include "token.h"
+
+using namespace std;
+
+class TraceTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+#ifndef CPPLOX_JIT_SUPPORTED
+    GTEST_SKIP() << "JIT not supported on this platform";
+#endif
+  }
+
+  void expectIntValue(string_view testCase, ObjectPtr actualValue,
+                      int64_t expectedValue) {
+    ASSERT_EQ(actualValue->Type, ObjectType::OBJ_INTEGER) << testCase;
+    auto actualIntValue = dynamic_pointer_cast<IntegerObject>(actualValue);
+    ASSERT_NE(actualIntValue, nullptr) << testCase;
+    EXPECT_EQ(actualIntValue->Value, expectedValue) << testCase;
+  }
+};
+
+TEST_F(TraceTest, TestTracedLoops) {
+  struct TestCase {
+    string source;
+    // index of the loop statement in the program.
+    size_t loop;
+    bool traced;
+    unordered_map<string, int> expectedValues;
+  };
+  vector<TestCase> testCases = {
+      TestCase{"var s = 0; for (var i = 0; i < 1000; i = i + 1) { s = s + i; }",
+               1,
+               true,
+               {{"s", 499500}}},
+      TestCase{"var a = 0; var b = 0; var i = 0; while (i < 200) { if (i < "
+               "100) a = a + 1; else b = b + 2; i = i + 1; }",
+               3,
+               true,
+               {{"a", 100}, {"b", 200}, {"i", 200}}},
+      TestCase{"var s = 0; for (var i = 0; i < 300; i = i + 1) { var t = i * "
+               "2; if ((t / 3) == 0) continue; s = s + t; }",
+               1,
+               true,
+               {{"s", 89698}}},
+      TestCase{"var i = 0; var n = 0; while ((i < 100) and !(n == 7)) { i = i "
+               "+ 1; n = -i / 2; }",
+               2,
+               true,
+               {{"i", 100}, {"n", -50}}},
+      TestCase{"def f() { return 1; } var i = 0; while (i < 100) i = i + f();",
+               2,
+               false,
+               {{"i", 100}}},
+      TestCase{"var i = 0; var s = 0; while (i < 100) { i = i + 1; var j = 0; "
+               "while (j < 3) { s = s + 1; j = j + 1; } }",
+               2,
+               false,
+               {{"s", 300}}}};
+
+  for (const auto& testCase : testCases) {
+    Evaluator evaluator;
+    auto program = parse(testCase.source);
+    evaluator.eval(program);
+    const auto trace =
+        evaluator.getLoopTracer().getTrace(program->statements[testCase.loop]);
+    EXPECT_EQ(testCase.traced, trace != nullptr) << testCase.source;
+    for (const auto& pair : testCase.expectedValues) {
+      expectIntValue(testCase.source, evaluator.getGlobalValue(pair.first),
+                     pair.second);
+    }
+  }
+}
+
+TEST_F(TraceTest, TestGuards) {
+  // a variable that is no longer an integer keeps the loop interpreted.
+  Evaluator evaluator;
+  evaluator.eval(
+      parse("var f = 1; var r = 0; var k = 0; while (k < 2) { var i = 0; "
+            "while (i < 100) { if (f) r = r + 1; i = i + 1; } f = true; k = k "
+            "+ 1; }"));
+  expectIntValue("guards", evaluator.getGlobalValue("r"), 200);
+
+  // a zero divisor leaves the trace and is reported by the Evaluator.
+  Evaluator divisionEvaluator;
+  EXPECT_THROW(divisionEvaluator.eval(parse(
+                   "var d = 100; var q = 0; var i = 0; while (i < 200) { q = "
+                   "q + 1000 / (d - i); i = i + 1; }")),
+               RuntimeError);
+  expectIntValue("division", divisionEvaluator.getGlobalValue("i"), 100);
+}
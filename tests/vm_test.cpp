@@ -0,0 +1,228 @@
+#include "vm.h"
+
+#include <gtest/gtest.h>
+
+#include "ast.h"
+#include "astbuilder.h"
+#include "common.h"
+#include "lexer.h"
+#include "parser.h"
+#include "token.h"
+
+using Parser::JSParser;
+using namespace std;
+
+class VMTest : public ::testing::Test {
+ protected:
+  ObjectPtr interpret(VM& vm, const string& source) {
+    std::istringstream ss(source);
+    JSLexer lexer(&ss);
+    ASTBuilderImpl builder;
+    JSParser parser(builder, lexer);
+    parser.parse();
+    auto program = builder.getProgram();
+    EXPECT_NE(program, nullptr) << "TestCase: " << source;
+    return vm.interpret(program);
+  }
+
+  void expectIntValue(string_view testCase, ObjectPtr actualValue,
+                      int64_t expectedValue) {
+    ASSERT_EQ(actualValue->Type, ObjectType::OBJ_INTEGER) << testCase;
+    auto actualIntValue = dynamic_pointer_cast<IntegerObject>(actualValue);
+    ASSERT_NE(actualIntValue, nullptr) << testCase;
+    EXPECT_EQ(actualIntValue->Value, expectedValue) << testCase;
+  }
+
+  void expectBoolValue(string_view testCase, ObjectPtr actualValue,
+                       bool expectedValue) {
+    ASSERT_EQ(actualValue->Type, ObjectType::OBJ_BOOLEAN) << testCase;
+    auto actualBoolValue = dynamic_pointer_cast<BooleanObject>(actualValue);
+    ASSERT_NE(actualBoolValue, nullptr) << testCase;
+    EXPECT_EQ(actualBoolValue->Value, expectedValue) << testCase;
+  }
+};
+
+TEST_F(VMTest, TestCompletionValues) {
+  struct TestCase {
+    string source;
+    string expectedValue;
+  };
+  vector<TestCase> testCases = {
+      TestCase{"true;", "true"},
+      TestCase{"nil;", "nil"},
+      TestCase{";", "nil"},
+      TestCase{"\"test\";", "test"},
+      TestCase{"-1;", "-1"},
+      TestCase{"!true;", "false"},
+      TestCase{"1 + 2 * 3 - 4 / 2;", "5"},
+      TestCase{"(1 < 2) and (2 <= 2);", "true"},
+      TestCase{"0 or \"\";", "false"},
+      TestCase{"1 == 1;", "true"},
+      TestCase{"\"a\" != \"a\";", "false"},
+      TestCase{"var a = 10;", "10"},
+      TestCase{"if (true) {}", "nil"},
+      TestCase{"if (false) 1;", "false"},
+      TestCase{"if (false) 1; else 2;", "2"},
+      TestCase{"var i = 0; while (i < 3) i = i + 1;", "false"},
+      TestCase{"for (var i = 0; i < 3; i = i + 1) { break; }", "nil"},
+      TestCase{"def f() { 1; 2; } f();", "2"},
+      TestCase{"def f(a) { if (a) { return 1; } 3; } f(false);", "3"},
+      TestCase{"[1, 2, 3];", "[1, 2, 3]"},
+      TestCase{"[1, [2, 3]][1][0];", "2"}};
+
+  for (const auto& testCase : testCases) {
+    VM vm;
+    const auto value = interpret(vm, testCase.source);
+    ASSERT_NE(value, nullptr) << "TestCase: " << testCase.source;
+    EXPECT_EQ(testCase.expectedValue, value->toString())
+        << "TestCase: " << testCase.source;
+  }
+}
+
+TEST_F(VMTest, TestGlobalsAndLocals) {
+  struct TestCase {
+    string source;
+    unordered_map<string, variant<bool, int>> expectedValues;
+  };
+  vector<TestCase> testCases = {
+      TestCase{"var a = 1; var b = a + 1; b = b * 3;", {{"a", 1}, {"b", 6}}},
+      TestCase{"c = 5;", {{"c", 5}}},
+      TestCase{"var a = 1; if (true) { var a = 2; var b = a; a = 3; c = a + "
+               "b; }",
+               {{"a", 1}, {"c", 5}}},
+      TestCase{"var a = 1; if (a) { var b = a; var b = b + 1; a = b; }",
+               {{"a", 2}}},
+      TestCase{"var test = false; if (!test) test = true;", {{"test", true}}}};
+
+  for (const auto& testCase : testCases) {
+    VM vm;
+    interpret(vm, testCase.source);
+    for (const auto& pair : testCase.expectedValues) {
+      auto value = vm.getGlobalValue(pair.first);
+      if (std::holds_alternative<bool>(pair.second)) {
+        expectBoolValue(testCase.source, value, std::get<bool>(pair.second));
+      } else if (std::holds_alternative<int>(pair.second)) {
+        expectIntValue(testCase.source, value, std::get<int>(pair.second));
+      }
+    }
+  }
+}
+
+TEST_F(VMTest, TestLoops) {
+  struct TestCase {
+    string source;
+    unordered_map<string, int> expectedValues;
+  };
+  vector<TestCase> testCases = {
+      TestCase{"var i = 0; while (i < 10) { i = i + 1; }", {{"i", 10}}},
+      TestCase{"var a = 0; for (var i = 0; i < 10; i = i + 1) a = a + i;",
+               {{"a", 45}}},
+      TestCase{"var a = 0; for (var i = 0; i < 10; i = i + 1) { if (i == 5) "
+               "break; a = a + 1; }",
+               {{"a", 5}}},
+      TestCase{"var a = 0; for (var i = 0; i < 10; i = i + 1) { var j = i; if "
+               "(j < 5) continue; a = a + 1; }",
+               {{"a", 5}}},
+      TestCase{"var a = 0; var i = 0; while (i < 10) { i = i + 1; if (i > 3) "
+               "continue; a = a + 1; }",
+               {{"a", 3}, {"i", 10}}}};
+
+  for (const auto& testCase : testCases) {
+    VM vm;
+    interpret(vm, testCase.source);
+    for (const auto& pair : testCase.expectedValues) {
+      expectIntValue(testCase.source, vm.getGlobalValue(pair.first),
+                     pair.second);
+    }
+  }
+}
+
+TEST_F(VMTest, TestFunctions) {
+  struct TestCase {
+    string source;
+    unordered_map<string, int> expectedValues;
+  };
+  vector<TestCase> testCases = {
+      TestCase{"def add(a, b) { return a + b; } var c = add(1, 2);",
+               {{"c", 3}}},
+      TestCase{"def fib(n) { if (n < 2) return n; return fib(n - 1) + fib(n - "
+               "2); } var f = fib(15);",
+               {{"f", 610}}},
+      TestCase{"def makeCounter() { var i = 0; def count() { i = i + 1; return "
+               "i; } return count; } var counter = makeCounter(); counter(); "
+               "var c = counter();",
+               {{"c", 2}}},
+      TestCase{"def outer() { var a = 1; def middle() { var b = 2; def inner() "
+               "{ return a + b; } return inner; } return middle(); } var r = "
+               "outer()();",
+               {{"r", 3}}},
+      TestCase{"var a = 0; while (a == 0) { def local(n) { if (n == 0) return "
+               "0; return n + local(n - 1); } a = local(4); }",
+               {{"a", 10}}}};
+
+  for (const auto& testCase : testCases) {
+    VM vm;
+    interpret(vm, testCase.source);
+    for (const auto& pair : testCase.expectedValues) {
+      expectIntValue(testCase.source, vm.getGlobalValue(pair.first),
+                     pair.second);
+    }
+  }
+}
+
+TEST_F(VMTest, TestClasses) {
+  struct TestCase {
+    string source;
+    unordered_map<string, int> expectedValues;
+  };
+  vector<TestCase> testCases = {
+      TestCase{"class A { var a = 1; def method1() { return a + 1; } def "
+               "method2() { return 2; } } var a = A(); var b = a.method1(); "
+               "var c = a.method2();",
+               {{"b", 2}, {"c", 2}}},
+      TestCase{"class A { var c = 2; def __init__() { c = 3; } def method1(a, "
+               "b) { return c*(a + b); } } var a1 = A(); var b = "
+               "a1.method1(1,2); var a2 = A(); var c = a2.method1(3,4);",
+               {{"b", 9}, {"c", 21}}},
+      TestCase{"class P { var x = 0; def __init__(v) { x = v; } def inc() { x "
+               "= x + 1; return x; } def get() { def read() { return x; } "
+               "return read(); } } var p = P(5); p.inc(); var x = p.get();",
+               {{"x", 6}}}};
+
+  for (const auto& testCase : testCases) {
+    VM vm;
+    interpret(vm, testCase.source);
+    for (const auto& pair : testCase.expectedValues) {
+      expectIntValue(testCase.source, vm.getGlobalValue(pair.first),
+                     pair.second);
+    }
+  }
+}
+
+TEST_F(VMTest, TestRuntimeErrors) {
+  vector<string> testCases = {"1 / 0;",        "1 + true;",
+                              "-\"a\";",       "var a = 1; a();",
+                              "[1, 2][2];",    "def f(a) {} f();",
+                              "def f() { return f(); } f();"};
+
+  for (const auto& testCase : testCases) {
+    VM vm;
+    EXPECT_THROW(interpret(vm, testCase), RuntimeError)
+        << "TestCase: " << testCase;
+  }
+}
+
+TEST_F(VMTest, TestStackOverflow) {
+  const string depth =
+      "def depth(n) { if (n == 0) return 0; return 1 + depth(n - 1); } ";
+
+  // the call depth is bounded by the same setting as for the Evaluator.
+  VM vm;
+  interpret(vm, depth + "var d = depth(9000);");
+  expectIntValue("deep", vm.getGlobalValue("d"), 9000);
+
+  // past the maximum call depth is an error, and the VM recovers.
+  EXPECT_THROW(interpret(vm, "d = depth(10000);"), RuntimeError);
+  interpret(vm, "d = depth(10);");
+  expectIntValue("recovered", vm.getGlobalValue("d"), 10);
+}